@@ -48,11 +48,11 @@ extern "C"
 #define BOOTLOADER_FOR_MICO_KIT
 
 #ifdef BOOTLOADER_FOR_MICO_KIT
-  #define Bootloader_REVISION "V1.1"
+  #define Bootloader_REVISION "V1.2"
   #define MODEL               "\"MicoKit of EMW3165\""
 #else
   #define MODEL               "\"WiFiMCU Board\""
-  #define Bootloader_REVISION "V1.1"
+  #define Bootloader_REVISION "V1.2"
 #endif
 
 /* MICO RTOS tick rate in Hz */
@@ -148,13 +148,28 @@ extern "C"
 
 #define MICO_FLASH_FOR_APPLICATION  MICO_INTERNAL_FLASH
 #define APPLICATION_START_ADDRESS   (uint32_t)0x0800C000
-#define APPLICATION_END_ADDRESS     (uint32_t)0x0807FFFF
-#define APPLICATION_FLASH_SIZE      (APPLICATION_END_ADDRESS - APPLICATION_START_ADDRESS + 1) /* 464 bytes*/
+#define APPLICATION_END_ADDRESS     (uint32_t)0x0805FFFF
+#define APPLICATION_FLASH_SIZE      (APPLICATION_END_ADDRESS - APPLICATION_START_ADDRESS + 1) /* 336k bytes*/
+
+/* The application must end below the Lua image: ROM_region in micoLinkerForIAR.icf
+   ends at APPLICATION_END_ADDRESS, and the update paths of bootloader V1.2 take no
+   more than APPLICATION_FLASH_SIZE. Older bootloaders take 464k applications. */
+#define LUA_IMAGE_BOOTLOADER_REVISION "V1.2"
+#define MICO_FLASH_FOR_LUA_IMAGE    MICO_INTERNAL_FLASH
+#define LUA_IMAGE_START_ADDRESS     (uint32_t)0x08060000
+#define LUA_IMAGE_END_ADDRESS       (uint32_t)0x0807FFFF
+#define LUA_IMAGE_FLASH_SIZE        (LUA_IMAGE_END_ADDRESS - LUA_IMAGE_START_ADDRESS + 1) /* 128k bytes, sector 7*/
 
 #define MICO_FLASH_FOR_UPDATE       MICO_SPI_FLASH  /* Optional */
 #define UPDATE_START_ADDRESS        (uint32_t)0x00040000 /* Optional */
-#define UPDATE_END_ADDRESS          (uint32_t)0x000BFFFF /* Optional */
-#define UPDATE_FLASH_SIZE           (UPDATE_END_ADDRESS - UPDATE_START_ADDRESS + 1) /* 512k bytes, optional*/
+#define UPDATE_END_ADDRESS          (uint32_t)0x000BDFFF /* Optional */
+#define UPDATE_FLASH_SIZE           (UPDATE_END_ADDRESS - UPDATE_START_ADDRESS + 1) /* 504k bytes, optional*/
+
+#define MICO_FLASH_FOR_KV           MICO_SPI_FLASH
+#define KV_START_ADDRESS            (uint32_t)0x000BE000
+#define KV_END_ADDRESS              (uint32_t)0x000BFFFF
+#define KV_FLASH_SIZE               (KV_END_ADDRESS - KV_START_ADDRESS + 1) /* 8k bytes, two sectors, see KVStoreUtils.c */
+#define KV_BOOTLOADER_REVISION      "V1.2" /* older bootloaders erase 0x40000-0xBFFFF when it is not blank */
 
 #define MICO_FLASH_FOR_DRIVER       MICO_SPI_FLASH
 #define DRIVER_START_ADDRESS        (uint32_t)0x00002000
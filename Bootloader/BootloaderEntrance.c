@@ -46,11 +46,11 @@ extern OSStatus update(void);
 char menu[] =
 "\r\n"
 "MICO Bootloader for %s, Bootloader Version: %s\r\n"
-"0:BOOTUPDATE <-r>\r\n"
-"1:FWUPDATE <-r>\r\n"
-"2:DRIVERUPDATE <-r>\r\n"
-"3:PARAUPDATE <-r><-e>\r\n"
-"4:FLASHUPDATE  <-i><-s><-e><-r><-start><-end>\r\n"
+"0:BOOTUPDATE <-r><-b>\r\n"
+"1:FWUPDATE <-r><-b>\r\n"
+"2:DRIVERUPDATE <-r><-b>\r\n"
+"3:PARAUPDATE <-r><-e><-b>\r\n"
+"4:FLASHUPDATE  <-i><-s><-e><-r><-start><-end><-b>\r\n"
 "5:MEMORYMAP\r\n"
 "6:BOOT\r\n"
 "7:REBOOT\r\n";
@@ -59,12 +59,13 @@ char menu[] =
 "\r\n"
 "WiFiMCU Bootloader for %s, Bootloader Version: %s\r\n"
 "+ command -------------------------+ function ------------+\r\n"
-"| 0:BOOTUPDATE    <-r>             | Update bootloader    |\r\n"
-"| 1:FWUPDATE      <-r>             | Update application   |\r\n"
-"| 2:DRIVERUPDATE  <-r>             | Update RF driver     |\r\n"
-"| 3:PARAUPDATE    <-r><-e>         | Update MICO settings |\r\n"
+"| 0:BOOTUPDATE    <-r><-b>         | Update bootloader    |\r\n"
+"| 1:FWUPDATE      <-r><-b>         | Update application   |\r\n"
+"| 2:DRIVERUPDATE  <-r><-b>         | Update RF driver     |\r\n"
+"| 3:PARAUPDATE    <-r><-e><-b>     | Update MICO settings |\r\n"
 "| 4:FLASHUPDATE   <-i><-s><-e><-r> |                      |\r\n"
-"|    <-start address><-end address>| Update flash content |\r\n"
+"|    <-start address><-end address>|                      |\r\n"
+"|    <-b>                          | Update flash content |\r\n"
 "| 5:MEMORYMAP                      | List flash memory map|\r\n"
 "| 6:BOOT                           | Excute application   |\r\n"
 "| 7:REBOOT                         | Reboot               |\r\n"
@@ -73,6 +74,7 @@ char menu[] =
 " Notes:\r\n"
 " -e Erase only  -r Read from flash -i internal flash  -s SPI flash\r\n"
 " -start flash start address -end flash start address\r\n"
+" -b baud rate of the file transfer, e.g. \"1 -b 921600\"\r\n"
 " Example: Input \"4 -s -start 0x00002000 -end 0x0003FFFF\": Update spi\r\n"
 "          flash from 0x00002000 to 0x0003FFFF\r\n";
 #endif
@@ -33,6 +33,7 @@
 #include "MicoPlatform.h"
 #include "platform_config.h"
 #include "debug.h"
+#include "CRCUtils.h"
 
 typedef int Log_Status;					
 #define Log_NotExist				1
@@ -44,7 +45,8 @@ typedef int Log_Status;
 #define Log_UnkonwnERROR			7
 
 #define SizePerRW 4096   /* Bootloader need 2xSizePerRW RAM heap size to operate, 
-                            but it can boost the setup. */
+                            but it can boost the setup. newData is only used to
+                            rebuild a delta image. */
 
 #ifdef MICO_FLASH_FOR_UPDATE
 static uint8_t data[SizePerRW];
@@ -53,6 +55,10 @@ static uint8_t paraSaveInRam[PARA_FLASH_SIZE];
 
 static uint32_t destStartAddress, destEndAddress;
 static mico_flash_t destFlashType;
+
+/* Delta image being applied: patch read through data, output gathered in newData */
+static uint32_t patchAddress, patchEnd, patchPos, patchFill;
+static uint32_t oldPos, oldLength, outAddress, outFill, outLength, outCRC;
 #endif
 
 /* Upgrade iamge should save this table to flash */
@@ -62,9 +68,30 @@ typedef struct  _boot_table_t {
   uint8_t version[8];
   uint8_t type; // B:bootloader, P:boot_table, A:application, D: 8782 driver
   uint8_t upgrade_type; //u:upgrade, 
-  uint8_t reserved[6];
+  uint8_t reserved[2];
+  uint32_t crc32; // CRC-32 of the image, 0: not given
 }boot_table_t;
 
+/* A delta image starts with this header, all fields little endian. It rebuilds
+   newLength bytes from the first oldLength bytes of the destination and is
+   followed by records until the whole new image is produced:
+     varint diffLength, varint extraLength, zigzag varint seek
+     diff:  tokens until diffLength bytes are produced, varint t then
+            t odd:  t>>1 bytes are read, each one added to the next old byte
+            t even: t>>1 old bytes are copied unchanged
+     extra: extraLength bytes copied as they are
+   The old position advances by diffLength, and by seek after the extra bytes.
+   Tools/otadiff.c generates it. */
+#define DELTA_MAGIC   0x314C444D  /* "MDL1" */
+
+typedef struct  _delta_header_t {
+  uint32_t magic;
+  uint32_t oldLength;
+  uint32_t oldCRC;
+  uint32_t newLength;
+  uint32_t newCRC;
+}delta_header_t;
+
 #define update_log(M, ...) custom_log("UPDATE", M, ##__VA_ARGS__)
 #define update_log_trace() custom_log_trace("UPDATE")
 
@@ -121,14 +148,291 @@ Log_Status updateLogCheck(boot_table_t *updateLog)
 }
 
 
+/* Removes the update log from the parameter block and erases the image */
+static OSStatus clearUpdate(void)
+{
+  uint32_t paraStartAddress;
+  OSStatus err = kNoErr;
+
+  update_log("Update start to clear data...");
+    
+  paraStartAddress = PARA_START_ADDRESS;
+  err = MicoFlashRead(MICO_FLASH_FOR_PARA, &paraStartAddress, paraSaveInRam, PARA_FLASH_SIZE);
+  require_noerr(err, exit);
+  memset(paraSaveInRam, 0xff, sizeof(boot_table_t));
+  
+  err = MicoFlashErase(MICO_FLASH_FOR_PARA, PARA_START_ADDRESS, PARA_END_ADDRESS);
+  require_noerr(err, exit);
+
+  paraStartAddress = PARA_START_ADDRESS;
+  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, paraSaveInRam, PARA_FLASH_SIZE);
+  require_noerr(err, exit);
+  
+  err = MicoFlashErase(MICO_FLASH_FOR_UPDATE, UPDATE_START_ADDRESS, UPDATE_END_ADDRESS);
+  require_noerr(err, exit);
+
+exit:
+  return err;
+}
+
+/* CRC-32 of length bytes of flash from address */
+static OSStatus flashCRC(mico_flash_t flash, uint32_t address, uint32_t length, uint32_t *crc)
+{
+  uint32_t copyLength;
+  OSStatus err = kNoErr;
+
+  *crc = 0;
+  while(length > 0){
+    copyLength = (length > SizePerRW) ? SizePerRW : length;
+    err = MicoFlashRead(flash, &address, data, copyLength);
+    require_noerr(err, exit);
+    *crc = CRC32_Update(*crc, data, copyLength);
+    length -= copyLength;
+  }
+
+exit:
+  return err;
+}
+
+/* Last byte of the erase sector holding address: the internal flash has
+   16K, 16K, 16K, 16K, 64K and then 128K sectors, SPI flash 4K ones */
+static uint32_t sectorEnd(mico_flash_t flash, uint32_t address)
+{
+  if(flash != MICO_INTERNAL_FLASH)
+    return address | 0xFFF;
+  if(address < 0x08010000)
+    return address | 0x3FFF;
+  if(address < 0x08020000)
+    return 0x0801FFFF;
+  return address | 0x1FFFF;
+}
+
+/* Copies the image to the destination in one pass. Each sector is erased
+   just before the first write into it, so only the sectors the image covers
+   are erased. The CRC of what was read is kept as it goes, to be checked
+   against the digest of the image, and nothing is read back: internalFlashWrite
+   checks each word it programs, and a SPI flash write reports its status. */
+static OSStatus writeImage(uint32_t updateAddress, uint32_t length, uint32_t *crc)
+{
+  uint32_t destAddress = destStartAddress;
+  uint32_t erasedEnd = destStartAddress - 1;
+  uint32_t copyLength;
+  OSStatus err = kNoErr;
+
+  *crc = 0;
+  while(length > 0){
+    copyLength = (length > SizePerRW) ? SizePerRW : length;
+    err = MicoFlashRead(MICO_FLASH_FOR_UPDATE, &updateAddress, data, copyLength);
+    require_noerr(err, exit);
+    *crc = CRC32_Update(*crc, data, copyLength);
+
+    if(destAddress + copyLength - 1 > erasedEnd){
+      err = MicoFlashErase(destFlashType, erasedEnd + 1, destAddress + copyLength - 1);
+      require_noerr(err, exit);
+      erasedEnd = sectorEnd(destFlashType, destAddress + copyLength - 1);
+    }
+
+    err = MicoFlashWrite(destFlashType, &destAddress, data, copyLength);
+    require_noerr(err, exit);
+    length -= copyLength;
+  }
+
+exit:
+  return err;
+}
+
+//============================================================================
+// Delta image
+
+static OSStatus patchByte(uint8_t *byte)
+{
+  uint32_t readLength;
+  OSStatus err = kNoErr;
+
+  if(patchPos == patchFill){
+    require_action(patchAddress < patchEnd, exit, err = kUnderrunErr);
+    readLength = patchEnd - patchAddress;
+    if(readLength > SizePerRW) readLength = SizePerRW;
+    err = MicoFlashRead(MICO_FLASH_FOR_UPDATE, &patchAddress, data, readLength);
+    require_noerr(err, exit);
+    patchPos = 0;
+    patchFill = readLength;
+  }
+  *byte = data[patchPos++];
+
+exit:
+  return err;
+}
+
+static OSStatus patchVarint(uint32_t *value)
+{
+  uint8_t byte;
+  int shift;
+  OSStatus err = kNoErr;
+
+  *value = 0;
+  for(shift = 0; shift < 35; shift += 7){
+    err = patchByte(&byte);
+    require_noerr(err, exit);
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+      goto exit;
+  }
+  err = kMalformedErr;
+
+exit:
+  return err;
+}
+
+static OSStatus outFlush(void)
+{
+  OSStatus err = kNoErr;
+
+  outCRC = CRC32_Update(outCRC, newData, outFill);
+  err = MicoFlashWrite(MICO_FLASH_FOR_UPDATE, &outAddress, newData, outFill);
+  outFill = 0;
+  return err;
+}
+
+/* Copies length bytes of the old image to the output, adding patch bytes to
+   them when add is set */
+static OSStatus outOld(uint32_t length, bool add)
+{
+  uint32_t copyLength, oldAddress, i;
+  uint8_t byte;
+  OSStatus err = kNoErr;
+
+  require_action(oldPos <= oldLength && length <= oldLength - oldPos, exit, err = kRangeErr);
+  require_action(length <= outLength, exit, err = kRangeErr);
+  while(length > 0){
+    copyLength = SizePerRW - outFill;
+    if(copyLength > length) copyLength = length;
+    oldAddress = destStartAddress + oldPos;
+    err = MicoFlashRead(destFlashType, &oldAddress, newData + outFill, copyLength);
+    require_noerr(err, exit);
+    if(add){
+      for(i = 0; i < copyLength; i++){
+        err = patchByte(&byte);
+        require_noerr(err, exit);
+        newData[outFill + i] += byte;
+      }
+    }
+    oldPos += copyLength;
+    outFill += copyLength;
+    outLength -= copyLength;
+    length -= copyLength;
+    if(outFill == SizePerRW){
+      err = outFlush();
+      require_noerr(err, exit);
+    }
+  }
+
+exit:
+  return err;
+}
+
+static OSStatus outExtra(uint32_t length)
+{
+  OSStatus err = kNoErr;
+
+  require_action(length <= outLength, exit, err = kRangeErr);
+  outLength -= length;
+  while(length-- > 0){
+    err = patchByte(&newData[outFill++]);
+    require_noerr(err, exit);
+    if(outFill == SizePerRW){
+      err = outFlush();
+      require_noerr(err, exit);
+    }
+  }
+
+exit:
+  return err;
+}
+
+/* Rebuilds the new image from the delta image of length bytes in the update
+   partition and the old one in the destination. The new image goes to the
+   update partition behind the delta image, on the next 4K sector, and both
+   are left there until the copy to the destination has succeeded: when
+   the copy was interrupted the old image is gone, and the new one is found
+   already built on the next start. */
+static OSStatus applyDelta(uint32_t length, uint32_t *imageAddress, uint32_t *imageLength, uint32_t *imageCRC)
+{
+  delta_header_t header;
+  uint32_t headerAddress = UPDATE_START_ADDRESS;
+  uint32_t diffLength, extraLength, seek, token, crc;
+  OSStatus err = kNoErr;
+
+  err = MicoFlashRead(MICO_FLASH_FOR_UPDATE, &headerAddress, (uint8_t *)&header, sizeof(delta_header_t));
+  require_noerr(err, exit);
+  *imageAddress = (UPDATE_START_ADDRESS + length + 0xFFF) & ~0xFFF;
+  *imageLength = header.newLength;
+  *imageCRC = header.newCRC;
+  require_action(header.oldLength <= destEndAddress - destStartAddress + 1, exit, err = kSizeErr);
+  require_action(header.newLength <= destEndAddress - destStartAddress + 1, exit, err = kSizeErr);
+  require_action(header.newLength <= UPDATE_END_ADDRESS + 1 - *imageAddress, exit, err = kSizeErr);
+
+  err = flashCRC(MICO_FLASH_FOR_UPDATE, *imageAddress, header.newLength, &crc);
+  require_noerr(err, exit);
+  if(crc == header.newCRC){
+    update_log("New image already built");
+    goto exit;
+  }
+  err = flashCRC(destFlashType, destStartAddress, header.oldLength, &crc);
+  require_noerr(err, exit);
+  require_action(crc == header.oldCRC, exit, err = kVersionErr);
+
+  update_log("Build new image from delta, length 0x%x at 0x%08x", header.newLength, *imageAddress);
+  err = MicoFlashErase(MICO_FLASH_FOR_UPDATE, *imageAddress, *imageAddress + header.newLength - 1);
+  require_noerr(err, exit);
+
+  patchAddress = UPDATE_START_ADDRESS + sizeof(delta_header_t);
+  patchEnd = UPDATE_START_ADDRESS + length;
+  patchPos = patchFill = 0;
+  oldPos = 0;
+  oldLength = header.oldLength;
+  outAddress = *imageAddress;
+  outFill = 0;
+  outLength = header.newLength;
+  outCRC = 0;
+  while(outLength > 0){
+    err = patchVarint(&diffLength);
+    require_noerr(err, exit);
+    err = patchVarint(&extraLength);
+    require_noerr(err, exit);
+    err = patchVarint(&seek);
+    require_noerr(err, exit);
+
+    while(diffLength > 0){
+      err = patchVarint(&token);
+      require_noerr(err, exit);
+      require_action((token >> 1) <= diffLength, exit, err = kMalformedErr);
+      err = outOld(token >> 1, token & 1);
+      require_noerr(err, exit);
+      diffLength -= token >> 1;
+    }
+    err = outExtra(extraLength);
+    require_noerr(err, exit);
+    oldPos += (seek & 1) ? ~(seek >> 1) : (seek >> 1);
+  }
+  if(outFill > 0){
+    err = outFlush();
+    require_noerr(err, exit);
+  }
+  require_action(outCRC == header.newCRC, exit, err = kChecksumErr);
+
+exit:
+  return err;
+}
+
 OSStatus update(void)
 {
   boot_table_t updateLog;
   uint32_t i, j, size;
   uint32_t updateStartAddress;
-  uint32_t destStartAddress_tmp;
   uint32_t paraStartAddress;
-  uint32_t copyLength;
+  uint32_t imageAddress, imageLength, imageCRC;
+  uint32_t crc, magic;
   OSStatus err = kNoErr;
  
   MicoFlashInitialize( (mico_flash_t)MICO_FLASH_FOR_UPDATE );
@@ -171,54 +475,50 @@ OSStatus update(void)
     goto exit;
   }
   
-  update_log("Write OTA data to destination, type:%d, from 0x%08x to 0x%08x, length 0x%x", destFlashType, destStartAddress, destEndAddress, updateLog.length);
-  
-  destStartAddress_tmp = destStartAddress;
-  updateStartAddress = UPDATE_START_ADDRESS;
-  
   err = MicoFlashInitialize( destFlashType );
   require_noerr(err, exit);
-  err = MicoFlashErase( destFlashType, destStartAddress, destEndAddress );
+
+  imageAddress = UPDATE_START_ADDRESS;
+  imageLength = updateLog.length;
+  imageCRC = updateLog.crc32;
+  err = MicoFlashRead(MICO_FLASH_FOR_UPDATE, &imageAddress, (uint8_t *)&magic, sizeof(magic));
   require_noerr(err, exit);
-  size = (updateLog.length)/SizePerRW;
-  
-  for(i = 0; i <= size; i++){
-    if( i == size ){
-      if( (updateLog.length)%SizePerRW )
-        copyLength = (updateLog.length)%SizePerRW;
-      else
-        break;
-    }else{
-      copyLength = SizePerRW;
+  imageAddress = UPDATE_START_ADDRESS;
+  if(magic == DELTA_MAGIC){
+    err = applyDelta(updateLog.length, &imageAddress, &imageLength, &imageCRC);
+    if(err != kNoErr){
+      /* Made for another old image, or damaged: it is dropped and the old
+         image keeps running. After a flash error it is tried again on the
+         next start */
+      update_log("Delta image not applied, err = %d", err);
+      if(err == kMalformedErr || err == kRangeErr || err == kUnderrunErr ||
+         err == kVersionErr || err == kSizeErr || err == kChecksumErr)
+        clearUpdate();
+      goto exit;
     }
-    err = MicoFlashRead(MICO_FLASH_FOR_UPDATE, &updateStartAddress, data , copyLength);
-    require_noerr(err, exit);
-    err = MicoFlashInitialize( destFlashType );
-    require_noerr(err, exit);
-    err = MicoFlashWrite(destFlashType, &destStartAddress_tmp, data, copyLength);
-    require_noerr(err, exit);
-    destStartAddress_tmp -= copyLength;
-    err = MicoFlashRead(destFlashType, &destStartAddress_tmp, newData , copyLength);
-    require_noerr(err, exit);
-    err = memcmp(data, newData, copyLength);
-    require_noerr_action(err, exit, err = kWriteErr); 
- }  
+  }
 
-  update_log("Update start to clear data...");
-    
-  paraStartAddress = PARA_START_ADDRESS;
-  err = MicoFlashRead(MICO_FLASH_FOR_PARA, &paraStartAddress, paraSaveInRam, PARA_FLASH_SIZE);
-  require_noerr(err, exit);
-  memset(paraSaveInRam, 0xff, sizeof(boot_table_t));
+  update_log("Write OTA data to destination, type:%d, from 0x%08x to 0x%08x, length 0x%x", destFlashType, destStartAddress, destEndAddress, imageLength);
   
-  err = MicoFlashErase(MICO_FLASH_FOR_PARA, PARA_START_ADDRESS, PARA_END_ADDRESS);
-  require_noerr(err, exit);
+  /* A shorter bootloader leaves the sector of the version stamp alone, erase
+     it so the new bootloader writes its own version there */
+  if(updateLog.type == 'B' && sectorEnd(destFlashType, destStartAddress + imageLength - 1) < BOOT_END_ADDRESS + 1 - 0x20){
+    err = MicoFlashErase(destFlashType, BOOT_END_ADDRESS + 1 - 0x20, BOOT_END_ADDRESS);
+    require_noerr(err, exit);
+  }
 
-  paraStartAddress = PARA_START_ADDRESS;
-  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, paraSaveInRam, PARA_FLASH_SIZE);
+  err = writeImage(imageAddress, imageLength, &crc);
   require_noerr(err, exit);
-  
-  err = MicoFlashErase(MICO_FLASH_FOR_UPDATE, UPDATE_START_ADDRESS, UPDATE_END_ADDRESS);
+  /* The image is read once, a damaged one is only found once it is written.
+     Drop it anyway, copying it again on every start would not help */
+  if(imageCRC != 0 && imageCRC != 0xFFFFFFFF && crc != imageCRC){
+    update_log("OTA image CRC 0x%08x, expected 0x%08x", crc, imageCRC);
+    clearUpdate();
+    err = kChecksumErr;
+    goto exit;
+  }
+
+  err = clearUpdate();
   require_noerr(err, exit);
   update_log("Update success");
   
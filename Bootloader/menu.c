@@ -46,6 +46,8 @@
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 #define CMD_STRING_SIZE       128
+#define MIN_TRANSFER_BAUDRATE 9600
+#define MAX_TRANSFER_BAUDRATE 3000000
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 extern platform_flash_t platform_flash_peripherals[];
@@ -102,6 +104,7 @@ char MEMMAP[] = "\r\n\
 
 char FileName[FILE_NAME_LENGTH];
 char ERROR_STR [] = "\n\r*** ERROR: %s\n\r";    /* ERROR message string in code   */
+static int32_t transferBaudrate = 0;            /* -b option, 0: STDIO_UART_BAUDRATE */
 
 extern char menu[];
 extern void getline (char *line, int n);          /* input line               */
@@ -164,6 +167,17 @@ exit:
 }
 
 
+/**
+  * @brief  Switch the serial port to the baud rate of a transfer and back
+  * @param  baudrate: The new baud rate
+  * @retval None
+  */
+static void SerialSwitchBaudrate(int32_t baudrate)
+{
+  printf("\n\rSwitch the terminal to %d baud\n\r", baudrate);
+  stdio_set_baudrate(baudrate);
+}
+
 /**
   * @brief  Download a file via serial port
   * @param  None
@@ -174,6 +188,10 @@ void SerialDownload(mico_flash_t flash, uint32_t flashdestination, int32_t maxRe
   char Number[10] = "          ";
   int32_t Size = 0;
 
+  if (transferBaudrate != 0)
+  {
+    SerialSwitchBaudrate(transferBaudrate);
+  }
   printf("Waiting for the file to be sent ... (press 'a' to abort)\n\r");
   Size = Ymodem_Receive(&tab_1024[0], flash, flashdestination, maxRecvSize);
   if (Size > 0)
@@ -202,6 +220,10 @@ void SerialDownload(mico_flash_t flash, uint32_t flashdestination, int32_t maxRe
   {
     printf("\n\rFailed to receive file!\n\r");
   }
+  if (transferBaudrate != 0)
+  {
+    SerialSwitchBaudrate(STDIO_UART_BAUDRATE);
+  }
 }
 
 /**
@@ -214,6 +236,10 @@ void SerialUpload(mico_flash_t flash, uint32_t flashdestination, char *fileName,
   uint8_t status = 0;
   uint8_t key;
 
+  if (transferBaudrate != 0)
+  {
+    SerialSwitchBaudrate(transferBaudrate);
+  }
   printf("Select Receive File\n\r");
   MicoUartRecv( STDIO_UART, &key, 1, MICO_NEVER_TIMEOUT );
 
@@ -231,6 +257,10 @@ void SerialUpload(mico_flash_t flash, uint32_t flashdestination, char *fileName,
       printf("\n\rFile uploaded successfully \n\r");
     }
   }
+  if (transferBaudrate != 0)
+  {
+    SerialSwitchBaudrate(STDIO_UART_BAUDRATE);
+  }
 }
 
 /**
@@ -243,7 +273,7 @@ void Main_Menu(void)
   char cmdbuf [CMD_STRING_SIZE] = {0}, cmdname[15] = {0};     /* command input buffer        */
   int i, j;                                       /* index for command buffer    */
   int targetFlash;
-  char startAddressStr[10], endAddressStr[10];
+  char startAddressStr[10], endAddressStr[10], baudrateStr[10];
   int32_t startAddress, endAddress;
   bool inputFlashArea = false;
 
@@ -262,6 +292,17 @@ void Main_Menu(void)
     }
     cmdname[j] = '\0';
 
+    /* Files are sent and received at this baud rate, the menu stays at STDIO_UART_BAUDRATE */
+    transferBaudrate = 0;
+    if (findCommandPara(cmdbuf, "b", baudrateStr, 10) != -1){
+      if(Str2Int((uint8_t *)baudrateStr, &transferBaudrate)==0 ||
+         transferBaudrate < MIN_TRANSFER_BAUDRATE || transferBaudrate > MAX_TRANSFER_BAUDRATE){
+        printf ("\n\rIllegal baud rate.\n\r");
+        transferBaudrate = 0;
+        continue;
+      }
+    }
+
     /***************** Command "0" or "BOOTUPDATE": Update the application  *************************/
     if(strcmp(cmdname, "BOOTUPDATE") == 0 || strcmp(cmdname, "0") == 0) {
       if (findCommandPara(cmdbuf, "r", NULL, 0) != -1){
@@ -396,6 +437,10 @@ void Main_Menu(void)
       }
 
       printf ("\n\rUpdating flash content From 0x%x to 0x%x\n\r", startAddress, endAddress);
+      /* The download only erases the file's span, clear the rest of the range as before */
+      MicoFlashInitialize((mico_flash_t)targetFlash);
+      MicoFlashErase((mico_flash_t)targetFlash, startAddress, endAddress);
+      MicoFlashFinalize((mico_flash_t)targetFlash);
       SerialDownload((mico_flash_t)targetFlash, startAddress, endAddress-startAddress+1);                           
     }
 
@@ -35,15 +35,20 @@
 #include "ymodem.h"
 #include "string.h"
 #include "StringUtils.h"
+#include "CRCUtils.h"
 #include "MicoPlatform.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* Bytes taken from the ring buffer per wait, they arrive within NAK_TIMEOUT
+   down to 9600 baud */
+#define PACKET_CHUNK_SIZE       (32)
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 extern uint8_t FileName[];
 
 /* Private function prototypes -----------------------------------------------*/
+uint16_t Cal_CRC16(const uint8_t* data, uint32_t size);
 /* Private functions ---------------------------------------------------------*/
 
 /**
@@ -86,7 +91,7 @@ static uint32_t Send_Byte (uint8_t c)
   */
 static int32_t Receive_Packet (uint8_t *data, int32_t *length, uint32_t timeout)
 {
-  uint16_t i, packet_size;
+  uint16_t i, chunk, packet_size;
   uint8_t c;
   *length = 0;
   if (Receive_Byte(&c, timeout) != 0)
@@ -120,9 +125,11 @@ static int32_t Receive_Packet (uint8_t *data, int32_t *length, uint32_t timeout)
       return -1;
   }
   *data = c;
-  for (i = 1; i < (packet_size + PACKET_OVERHEAD); i ++)
+  /* The rest of the packet is taken from the DMA ring buffer in chunks */
+  for (i = 1; i < (packet_size + PACKET_OVERHEAD); i += chunk)
   {
-    if (Receive_Byte(data + i, timeout) != 0)
+    chunk = MIN(PACKET_CHUNK_SIZE, packet_size + PACKET_OVERHEAD - i);
+    if (MicoUartRecv( STDIO_UART, data + i, chunk, timeout ) != kNoErr)
     {
       return -1;
     }
@@ -131,12 +138,22 @@ static int32_t Receive_Packet (uint8_t *data, int32_t *length, uint32_t timeout)
   {
     return -1;
   }
+  /* CRC16 was asked for by sending 'C' */
+  if (Cal_CRC16(data + PACKET_HEADER, packet_size) !=
+      ((data[PACKET_HEADER + packet_size] << 8) | data[PACKET_HEADER + packet_size + 1]))
+  {
+    return -1;
+  }
   *length = packet_size;
   return 0;
 }
 
 /**
   * @brief  Receive a file using the ymodem protocol.
+  * @note   A data packet is acked as soon as it is copied to buf, so the
+  *         sender streams the next one into the UART ring buffer while buf
+  *         is programmed. A failed write cancels the session before the
+  *         next packet is acked.
   * @param  buf: Address of the first byte.
   * @retval The size of the file.
   */
@@ -144,7 +161,7 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
 {
   uint8_t packet_data[PACKET_1K_SIZE + PACKET_OVERHEAD], file_size[FILE_SIZE_LENGTH], *file_ptr, *buf_ptr;
   int32_t i, packet_length, session_done, file_done, packets_received, errors, session_begin, size = 0;
-  uint32_t  ramsource;
+  uint32_t  ramsource, flashend = flashdestination + maxRecvSize;
   MicoFlashInitialize(flash);
 
   for (session_done = 0, errors = 0, session_begin = 0; ;)
@@ -162,9 +179,10 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
               Send_Byte(ACK);
               MicoFlashFinalize(flash);
               return 0;
-            /* End of transmission */
+            /* End of transmission, ask for the next file header */
             case 0:
               Send_Byte(ACK);
+              Send_Byte(CRC16);
               file_done = 1;
               break;
             /* Normal packet */
@@ -195,7 +213,7 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
 
                     /* Test the size of the image to be sent */
                     /* Image size is greater than Flash size */
-                    if (size > (maxRecvSize + 1))
+                    if (size > maxRecvSize)
                     {
                       /* End session */
                       Send_Byte(CA);
@@ -203,8 +221,10 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
                       MicoFlashFinalize(flash);
                       return -1;//The image size is higher than memory!
                     }
-                    /* erase user application area */
-                    MicoFlashErase(flash, flashdestination, flashdestination + maxRecvSize - 1);
+                    /* erase the room the image needs, or all of it when no size is sent */
+                    if (size > 0)
+                      flashend = flashdestination + size;
+                    MicoFlashErase(flash, flashdestination, flashend - 1);
                     Send_Byte(ACK);
                     Send_Byte(CRC16);
                   }
@@ -222,15 +242,16 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
                 {
                   memcpy(buf_ptr, packet_data + PACKET_HEADER, packet_length);
                   ramsource = (uint32_t)buf;
+                  Send_Byte(ACK);
 
-                  /* Write received data in Flash */
-                  if (MicoFlashWrite(flash, &flashdestination, (uint8_t*) ramsource, (uint32_t) packet_length)  == 0)
-                  {
-                    Send_Byte(ACK);
-                  }
-                  else /* An error occurred while writing to Flash memory */
+                  /* The last packet is padded, only program what was erased */
+                  if (flashdestination + packet_length > flashend)
+                    packet_length = (flashdestination < flashend) ? flashend - flashdestination : 0;
+
+                  /* Write received data in Flash while the next packet comes in */
+                  if (packet_length > 0 && MicoFlashWrite(flash, &flashdestination, (uint8_t*) ramsource, (uint32_t) packet_length)  != 0)
                   {
-                    /* End session */
+                    /* An error occurred while writing to Flash memory, end session */
                     Send_Byte(CA);
                     Send_Byte(CA);
                     MicoFlashFinalize(flash);
@@ -259,7 +280,8 @@ int32_t Ymodem_Receive (uint8_t *buf, mico_flash_t flash, uint32_t flashdestinat
             MicoFlashFinalize(flash);
             return 0;//Failed to receive file!
           }
-          Send_Byte(CRC16);
+          /* 'C' asks for a file header, NAK for a data packet again */
+          Send_Byte((packets_received == 0) ? CRC16 : NAK);
           break;
       }
       if (file_done != 0)
@@ -360,33 +382,6 @@ void Ymodem_PreparePacket(mico_flash_t flash, uint32_t flashdestination, uint8_t
   }
 }
 
-/**
-  * @brief  Update CRC16 for input byte
-  * @param  CRC input value 
-  * @param  input byte
-  * @retval None
-  */
-uint16_t UpdateCRC16(uint16_t crcIn, uint8_t byte)
-{
-  uint32_t crc = crcIn;
-  uint32_t in = byte | 0x100;
-
-  do
-  {
-    crc <<= 1;
-    in <<= 1;
-    if(in & 0x100)
-      ++crc;
-    if(crc & 0x10000)
-      crc ^= 0x1021;
-  }
-  
-  while(!(in & 0x10000));
-
-  return crc & 0xffffu;
-}
-
-
 /**
   * @brief  Cal CRC16 for YModem Packet
   * @param  data
@@ -395,16 +390,7 @@ uint16_t UpdateCRC16(uint16_t crcIn, uint8_t byte)
   */
 uint16_t Cal_CRC16(const uint8_t* data, uint32_t size)
 {
-  uint32_t crc = 0;
-  const uint8_t* dataEnd = data+size;
-
-  while(data < dataEnd)
-    crc = UpdateCRC16(crc, *data++);
- 
-  crc = UpdateCRC16(crc, 0);
-  crc = UpdateCRC16(crc, 0);
-
-  return crc&0xffffu;
+  return CRC16_CCITT_Update(0, data, size);
 }
 
 /**
@@ -0,0 +1,30 @@
+--garbage collector benchmark
+print("------gc benchmark------")
+
+--the event loop collects after every timer, gpio and wifi
+--callback; in generational mode that is a young collection,
+--which only visits what the callback allocated, not the
+--tables and functions the program keeps
+local tick=tmr and tmr.tick or function() return os.clock()*1000 end
+
+local keep={}
+for i=1,500 do keep[i]={id=i,name="item"..i} end
+
+local function callback(i)
+	local t={}
+	for j=1,10 do t[j]={i,j} end
+	return #t
+end
+
+local function bench(mode,what,n)
+	collectgarbage(mode)
+	collectgarbage("collect")
+	local t=tick()
+	for i=1,n do
+		callback(i)
+		collectgarbage(what)
+	end
+	print(mode..": "..(tick()-t).."ms for "..n.." callbacks, "..collectgarbage("count").."KB in use")
+end
+bench("incremental","collect",500)
+bench("generational","step",500)
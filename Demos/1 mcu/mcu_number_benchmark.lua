@@ -0,0 +1,43 @@
+--integer and float arithmetic benchmark
+print("------number benchmark------")
+
+--numbers without a decimal point or exponent are integers,
+--others are single precision floats computed by the FPU,
+--tostring shows an integral float as 2.0
+print("7/2="..(7/2).."  7.0/2="..(7.0/2).."  2*1.0="..(2*1.0))
+
+local function bench(name,f)
+	local t=tmr.tick()
+	local r=f(20000)
+	print(name..": "..(tmr.tick()-t).."ms ("..tostring(r)..")")
+end
+bench("integer add/mul",function(n)
+	local s=0
+	for i=1,n do s=s+i*3 end
+	return s
+end)
+bench("float add/mul",function(n)
+	local s=0.0
+	for i=1,n do s=s+i*0.5 end
+	return s
+end)
+bench("integer div/mod",function(n)
+	local s=0
+	for i=1,n do s=s+i/7+i%7 end
+	return s
+end)
+bench("float div",function(n)
+	local s=0.0
+	for i=1,n do s=s+i/7.0 end
+	return s
+end)
+bench("float loop",function(n)
+	local s=0
+	for x=0.0,n/2,0.5 do s=s+1 end
+	return s
+end)
+bench("float sqrt",function(n)
+	local s=0.0
+	for i=1,n do s=s+math.sqrt(i*1.0) end
+	return s
+end)
@@ -0,0 +1,49 @@
+--interpreter benchmark
+print("------vm benchmark------")
+
+--each test runs the interpreter loop on one kind of
+--instruction mix; runs on the board and on a host Lua
+--built from the same sources (os.clock is used there)
+local tick=tmr and tmr.tick or function() return os.clock()*1000 end
+
+local function bench(name,f,n)
+	local t=tick()
+	f(n)
+	print(name..": "..(tick()-t).."ms")
+end
+bench("for loop + add",function(n)
+	local s=0
+	for i=1,n do s=s+i end
+	return s
+end,200000)
+bench("while loop + compare",function(n)
+	local i,s=0,0
+	while i<n do i=i+1 if i%3==0 then s=s+1 end end
+	return s
+end,100000)
+bench("global access",function(n)
+	local s=0
+	for i=1,n do s=s+string.len("x") end
+	return s
+end,20000)
+bench("field access",function(n)
+	local p={x=1,y=2}
+	local s=0
+	for i=1,n do s=s+p.x+p.y end
+	return s
+end,100000)
+bench("method call",function(n)
+	local o={v=0}
+	function o:inc(d) self.v=self.v+d end
+	for i=1,n do o:inc(1) end
+	return o.v
+end,50000)
+local function fib(n) if n<2 then return n end return fib(n-1)+fib(n-2) end
+bench("recursive fib(18)",fib,18)
+bench("table insert/read",function(n)
+	local t={}
+	for i=1,n do t[i]=i end
+	local s=0
+	for i=1,n do s=s+t[i] end
+	return s
+end,20000)
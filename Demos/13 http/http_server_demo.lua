@@ -0,0 +1,38 @@
+--http demo
+print("------http server demo------")
+--requests are parsed in C; files are sent from flash a few pages at a
+--time with an ETag, so a browser asking again gets 304 Not Modified
+cfg={ssid = 'WiFiMCU_Wireless',pwd = ''}
+wifi.startap(cfg)
+cfg=nil
+
+file.open("index.html","w")
+file.write("<h1>Welcome to WiFiMCU!</h1><p><a href='/gpio'>gpio</a> <a href='/led?on=1'>led on</a></p>")
+file.close()
+
+--"/" serves index.html, "/a.css" serves a.css
+http.static("/")
+
+http.on("GET","/led",function(req,method,path,query)
+	local on=query~=nil and query:find("on=1")~=nil
+	gpio.mode(17,gpio.OUTPUT)
+	gpio.write(17,on and gpio.HIGH or gpio.LOW)
+	http.send(req,"led "..(on and "on" or "off"),200,"text/plain")
+end)
+
+--the page goes out in pieces as it is made
+http.on("GET","/gpio",function(req)
+	http.begin(req)
+	http.write(req,"<table>")
+	for i=0,17 do
+		http.write(req,"<tr><td>gpio "..i.."</td><td>"..gpio.read(i).."</td></tr>")
+	end
+	http.write(req,"</table>")
+end)
+
+http.on("POST","/echo",function(req,method,path,query,body)
+	http.send(req,body or "",200,http.header(req,"Content-Type"))
+end)
+
+http.start(80)
+print("http server on port 80, heap: "..mcu.mem())
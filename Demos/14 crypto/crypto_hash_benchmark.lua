@@ -0,0 +1,39 @@
+--crypto hash throughput benchmark
+print("------crypto hash benchmark------")
+
+--hashes 64KB in 1KB chunks with each algorithm and prints bytes/s,
+--then the same as HMAC, CRC-32, and one file read from flash
+local chunk=string.rep("a",1024)
+local rounds=64
+local function bench(h)
+	local t=tmr.tick()
+	for i=1,rounds do h:update(chunk) end
+	h:final()
+	t=tmr.tick()-t
+	if t<1 then t=1 end
+	return math.floor(rounds*1024*1000/t)
+end
+for _,alg in ipairs({"md5","sha1","sha256","sha512","sha3"}) do
+	print(alg..": "..bench(crypto.new(alg)).." bytes/s")
+	print(alg.." hmac: "..bench(crypto.new(alg,"key")).." bytes/s")
+	collectgarbage()
+end
+
+local t=tmr.tick()
+local c=0
+for i=1,rounds do c=crypto.crc32(c,chunk) end
+t=tmr.tick()-t
+if t<1 then t=1 end
+print("crc32: "..math.floor(rounds*1024*1000/t).." bytes/s")
+
+--known answers
+print(crypto.hash("sha256","abc")=="ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+print(crypto.hmac("sha1","key","The quick brown fox jumps over the lazy dog")=="de7c9b85b8b78aa6bc8a7a36f70a90701c9db4d9")
+
+file.open("hash.bin","w+")
+for i=1,16 do file.write(chunk) end
+file.close()
+local t=tmr.tick()
+local d=crypto.new("sha256"):file("hash.bin"):final()
+print("sha256 of a 16KB file: "..(tmr.tick()-t).."ms "..d)
+file.remove("hash.bin")
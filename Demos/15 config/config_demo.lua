@@ -0,0 +1,18 @@
+--config demo
+print("------config demo------")
+
+--values survive a restart, numbers come back as strings
+local boots=tonumber(config.get("boots") or "0")+1
+config.set("boots",boots)
+print("boot count: "..boots)
+
+config.set("greeting","hello")
+print("greeting: "..config.get("greeting"))
+config.set("greeting",nil)
+print("greeting removed: "..tostring(config.get("greeting")))
+
+--a save appends one record, most saves erase nothing
+local t=tmr.tick()
+for i=1,100 do config.set("counter",i) end
+t=tmr.tick()-t
+print("100 saves: "..t.." ms")
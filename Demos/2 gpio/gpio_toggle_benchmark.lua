@@ -0,0 +1,24 @@
+--gpio toggle benchmark
+print("------gpio toggle benchmark------")
+print("gpio 17 connect to LED on WiFiMCU board")
+gpio.mode(17,gpio.OUTPUT)
+
+--gpio.write and the bit functions are fast builtins: called with
+--integer arguments the VM runs them directly, other arguments
+--(17.0 below) take the regular C function call
+local function bench(name,pin,n)
+	local w=gpio.write
+	local t=tmr.tick()
+	for i=1,n do
+		w(pin,1)
+		w(pin,0)
+	end
+	print(name..": "..(tmr.tick()-t).."ms for "..n.." toggles")
+end
+bench("fast call",17,20000)
+bench("regular call",17.0,20000)
+
+local t=tmr.tick()
+local s=0
+for i=1,20000 do s=bit.band(s+i,0xff) end
+print("bit.band: "..(tmr.tick()-t).."ms ("..s..")")
@@ -0,0 +1,39 @@
+--net demo
+print("------net demo------")
+print("------webserver strbuf demo------")
+
+--a strbuf collects the page without making a new string for
+--every piece; net.send takes it as it is and on a tcp socket
+--it may be longer than 1024 bytes
+local function page()
+	local sb=strbuf.new("<h1>Welcome to WiFiMCU!</h1><table>")
+	for i=0,17 do
+		sb:append("<tr><td>gpio ",i,"</td><td>",gpio.read(i),"</td></tr>")
+	end
+	sb:append("</table><p>heap ",mcu.mem()," bytes</p>")
+	return sb
+end
+
+local t=tmr.tick()
+local s=""
+for i=1,1000 do s=s..i.."," end
+print(".. : "..(tmr.tick()-t).."ms for "..#s.." bytes")
+t=tmr.tick()
+local sb=strbuf.new()
+for i=1,1000 do sb:append(i,",") end
+print("strbuf: "..(tmr.tick()-t).."ms for "..#sb.." bytes")
+s=nil sb=nil
+
+cfg={ssid = 'WiFiMCU_Wireless',pwd = ''}
+wifi.startap(cfg)
+cfg=nil
+
+skt = net.new(net.TCP,net.SERVER)
+net.on(skt,"accept",function(clt,ip,port)
+print("accept ip:"..ip.." port:"..port.." clt:"..clt)
+local body=page()
+net.send(clt,strbuf.new("HTTP/1.1 200 OK\r\nServer: WiFiMCU\r\n",
+	"Content-Type:text/html\r\nContent-Length: ",#body,
+	"\r\nConnection: close\r\n\r\n",body))
+end)
+net.start(skt,80)
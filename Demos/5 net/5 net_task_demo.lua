@@ -0,0 +1,30 @@
+--net demo
+print("------net task demo------")
+--a task is a function run by task.spawn, in it tmr.sleep,
+--net.receive and net.send wait without blocking the rest:
+--callbacks and other tasks go on meanwhile
+cfg={ssid = 'WiFiMCU_Wireless',pwd = ''}
+wifi.startap(cfg)
+cfg=nil
+
+task.spawn(function()
+	while true do
+		print("tick:"..tmr.tick())
+		tmr.sleep(1000)
+	end
+end)
+
+skt = net.new(net.TCP,net.SERVER)
+net.on(skt,"accept",function(clt,ip,port)
+print("accept ip:"..ip.." port:"..port.." clt:"..clt)
+task.spawn(function()
+	--echo the data back until the client goes
+	while true do
+		local data=net.receive(clt)
+		if data==nil then break end
+		if not net.send(clt,data) then break end
+	end
+	print("closed clt:"..clt)
+end)
+end)
+net.start(skt,8080)
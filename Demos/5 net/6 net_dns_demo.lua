@@ -0,0 +1,15 @@
+--net demo
+print("------net dns demo------")
+--answers are cached by name: the second lookup, and net.start
+--to the same host, need no dns round-trip
+cfg={ssid='Doit',pwd='123456789'}
+wifi.startsta(cfg)
+cfg=nil
+
+tmr.start(1,5000,function()
+	net.dns.resolve("www.baidu.com",function(name,ip)
+		print(name.." : "..tostring(ip))
+		local hits,misses,n=net.dns.stats()
+		print("hits:"..hits.." misses:"..misses.." cached:"..n)
+	end)
+end)
@@ -0,0 +1,23 @@
+--lua flash image demo
+print("------lua flash image demo------")
+
+--modules compiled on the host with Tools/luaimage.c:
+--  luaimage -o lua.img mymodule.lua
+--upload lua.img, then file.flashload("lua.img") writes it
+--to internal flash and restarts the system.
+--require() finds modules of the image before files,
+--their code and strings stay in flash.
+local index=file.flashindex()
+if index==nil then
+	print("no flash image")
+	if file.list()["lua.img"] then file.flashload("lua.img") end
+	return
+end
+for name,size in pairs(index) do
+	print("module "..name..", "..size.." bytes")
+end
+collectgarbage()
+local before=collectgarbage("count")
+for name in pairs(index) do require(name) end
+collectgarbage()
+print("heap used by modules: "..(collectgarbage("count")-before).."KB")
@@ -0,0 +1,17 @@
+--file system wear statistics
+print("------file fsstat------")
+
+--age: erases of the file system since the block was erased
+--erases: erases of the block since boot
+local s=file.fsstat()
+print("block  age  erases  used  deleted  free")
+for i,b in ipairs(s.blocks) do
+	print(string.format("%5d %4d %7d %5d %8d %5d",
+		i-1,b.age,b.erases,b.used,b.deleted,b.free))
+end
+print("free blocks:  "..s.freeblocks)
+print("gc runs:      "..s.gcruns.." inline, "..s.bggcruns.." background")
+print("cache hits:   "..s.cachehit.."% of "..(s.cachehits+s.cachemisses))
+print("written:      "..s.userbytes.." bytes, "..s.flashbytes.." to flash")
+print("write amp:    "..s.wamp.."%")
+print("erases:       "..s.erases)
@@ -0,0 +1,30 @@
+--file system garbage collection benchmark
+print("------file gc benchmark------")
+
+--rewrites some files over and over, so that
+--deleted pages pile up and gc has to run.
+--file.gc(enable) switches the background gc on/off,
+--it returns blocks reclaimed in background, gc runs
+--inside writes and current number of free blocks
+local data=string.rep("x",200)
+local function churn(rounds)
+	local ms=0
+	for i=1,rounds do
+		local t=tmr.tick()
+		file.open("gc"..(i%8)..".txt","w+")
+		for j=1,8 do file.write(data) end
+		file.close()
+		ms=ms+tmr.tick()-t
+		--idle time for the background gc
+		if i%8==0 then tmr.delayms(1500) end
+	end
+	return ms
+end
+for _,bg in ipairs({false,true}) do
+	local bg0,fg0=file.gc(bg)
+	local ms=churn(200)
+	local bg1,fg1,free=file.gc()
+	print("background gc "..tostring(bg)..": writes took "..ms.."ms, "..
+		(bg1-bg0).." background, "..(fg1-fg0).." inline, "..free.." free blocks")
+end
+for i=0,7 do file.remove("gc"..i..".txt") end
@@ -0,0 +1,28 @@
+--dofile load time benchmark
+print("------file load benchmark------")
+
+--writes a script with many functions and loads it
+--with dofile, first compiling the source every time,
+--then with file.memoize(true), which keeps the compiled
+--chunk as bench.lc and loads that while bench.lua is unchanged
+file.open("bench.lua","w+")
+file.writeline("local t={}")
+for i=1,60 do
+	file.writeline("function t.f"..i.."(a,b) local s=0 for j=a,b do s=s+j*"..i.." end return s end")
+end
+file.writeline("return t")
+file.close()
+file.remove("bench.lc")
+local function bench(rounds)
+	local t=tmr.tick()
+	for i=1,rounds do dofile("bench.lua") collectgarbage() end
+	return (tmr.tick()-t)/rounds
+end
+local old=file.memoize(false)
+print("compile source: "..bench(5).."ms per dofile")
+file.memoize(true)
+bench(1) --writes bench.lc
+print("memoized chunk: "..bench(5).."ms per dofile")
+file.memoize(old)
+file.remove("bench.lua")
+file.remove("bench.lc")
@@ -0,0 +1,32 @@
+--append-only log demo
+print("------file log demo------")
+
+--file.logopen(name, maxsize) opens a log for appending,
+--records are kept in RAM until a whole flash page is full.
+--when the log would grow beyond maxsize it is renamed
+--to name..".1" and a new log is started
+file.logopen("sensor.log", 8192)
+
+local n=500
+local t=tmr.tick()
+for i=1,n do
+	file.log("sample "..i.." tick "..tmr.tick())
+end
+--write records still held in RAM
+file.logflush()
+print("file.log:           "..(tmr.tick()-t).."ms for "..n.." records")
+file.logclose()
+
+--the same records, one open/writeline/close each
+t=tmr.tick()
+for i=1,n do
+	file.open("sensor.txt","a+")
+	file.writeline("sample "..i.." tick "..tmr.tick())
+	file.close()
+end
+print("file.writeline:     "..(tmr.tick()-t).."ms for "..n.." records")
+
+for k,v in pairs(file.list()) do 
+	print("name:"..k.."  size(bytes):"..v) 
+end
+file.remove("sensor.txt")
@@ -0,0 +1,17 @@
+--file system mount benchmark
+print("------file mount benchmark------")
+
+--file.remount() unmounts and mounts again,
+--it returns mount time in ms and whether the
+--mount checkpoint was used instead of a full scan
+local n=5
+local ckpt,scan=0,0
+for i=1,n do
+	local ms,fast=file.remount(true)
+	scan=scan+ms
+	ms,fast=file.remount()
+	if not fast then print("checkpoint not used") end
+	ckpt=ckpt+ms
+end
+print("full scan:  "..(scan/n).."ms")
+print("checkpoint: "..(ckpt/n).."ms")
@@ -37,6 +37,7 @@
 #include "StringUtils.h"
 #include "HTTPUtils.h"
 #include "SocketUtils.h"
+#include "CRCUtils.h"
 
 #include "EasyLink.h"
 #include "SoftAp/EasyLinkSoftAP.h"
@@ -522,6 +523,9 @@ OSStatus _FTCRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico_Context
     OSStatus err = kUnknownErr;
     const char *        value;
     size_t              valueSize;
+#ifdef MICO_FLASH_FOR_UPDATE
+    uint32_t            flashAddress;
+#endif
 
     easylink_log_trace();
 
@@ -544,10 +548,28 @@ OSStatus _FTCRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico_Context
         }
 #ifdef MICO_FLASH_FOR_UPDATE
         else if(strnicmpx( value, strlen(kMIMEType_JSON), kMIMEType_MXCHIP_OTA ) == 0){
+          //the application must not reach the Lua image, older bootloaders do not check
+          if(inHeader->contentLength > APPLICATION_FLASH_SIZE)
+            return kSizeErr;
+          //the whole body was read into extraDataPtr, it goes to the update partition
+          if(inHeader->extraDataLen != inHeader->contentLength)
+            return kSizeErr;
           easylink_log("Receive OTA data!");
           mico_rtos_lock_mutex(&inContext->flashContentInRam_mutex);
+          flashAddress = UPDATE_START_ADDRESS;
+          err = MicoFlashInitialize( MICO_FLASH_FOR_UPDATE );
+          if(err == kNoErr)
+            err = MicoFlashErase(MICO_FLASH_FOR_UPDATE, UPDATE_START_ADDRESS, UPDATE_END_ADDRESS);
+          if(err == kNoErr)
+            err = MicoFlashWrite(MICO_FLASH_FOR_UPDATE, &flashAddress, (uint8_t *)inHeader->extraDataPtr, inHeader->contentLength);
+          MicoFlashFinalize(MICO_FLASH_FOR_UPDATE);
+          if(err != kNoErr){
+            mico_rtos_unlock_mutex(&inContext->flashContentInRam_mutex);
+            goto exit;
+          }
           memset(&inContext->flashContentInRam.bootTable, 0, sizeof(boot_table_t));
           inContext->flashContentInRam.bootTable.length = inHeader->contentLength;
+          inContext->flashContentInRam.bootTable.crc32 = CRC32_Update(0, (uint8_t *)inHeader->extraDataPtr, inHeader->contentLength);
           inContext->flashContentInRam.bootTable.start_address = UPDATE_START_ADDRESS;
           inContext->flashContentInRam.bootTable.type = 'A';
           inContext->flashContentInRam.bootTable.upgrade_type = 'U';
@@ -35,8 +35,10 @@
 #include "SocketUtils.h"
 #include "Platform.h"
 #include "HTTPUtils.h"
+#include "HTTPServerUtils.h"
 #include "MICONotificationCenter.h"
 #include "StringUtils.h"
+#include "CRCUtils.h"
 #include "MiCORTOS.h"
 
 #define config_log(M, ...) custom_log("CONFIG SERVER", M, ##__VA_ARGS__)
@@ -51,6 +53,7 @@
 
 typedef struct _configContext_t{
   uint32_t flashStorageAddress;
+  uint32_t otaCRC;            /* CRC-32 of the OTA data so far, checked by the bootloader */
   bool     isFlashLocked;
 } configContext_t;
 
@@ -58,8 +61,8 @@ extern OSStatus     ConfigIncommingJsonMessage( const char *input, mico_Context_
 extern json_object* ConfigCreateReportJsonMessage( mico_Context_t * const inContext );
 
 static void localConfiglistener_thread(void *inContext);
-static void localConfig_thread(void *inFd);
 static mico_Context_t *Context;
+static OSStatus onRequest(HTTPServer_t *server, HTTPConnection_t *conn);
 static OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico_Context_t * const inContext);
 static OSStatus onReceivedData(struct _HTTPHeader_t * httpHeader, uint32_t pos, uint8_t * data, size_t len, void * userContext );
 static void onClearHTTPHeader(struct _HTTPHeader_t * httpHeader, void * userContext );
@@ -72,18 +75,15 @@ extern mico_semaphore_t uap_config_finished_sem;
 extern OSStatus     ConfigIncommingJsonMessageUAP( const char *input, mico_Context_t * const inContext );
 extern void connect_wifi_normal( mico_Context_t * const inContext);
 
-static mico_semaphore_t close_listener_sem = NULL, close_client_sem[ MAX_TCP_CLIENT_PER_SERVER ] = { NULL };
+static mico_semaphore_t close_listener_sem = NULL;
 
 
 
 OSStatus MICOStartConfigServer ( mico_Context_t * const inContext )
 {
-  int i = 0;
   if( is_config_server_established == false ){
     is_config_server_established = true;
     close_listener_sem = NULL;
-    for (; i < MAX_TCP_CLIENT_PER_SERVER; i++)
-      close_client_sem[ i ] = NULL;
     return mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "Config Server", localConfiglistener_thread, STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD, (void*)inContext );
   }
   return kAlreadyInitializedErr;
@@ -91,71 +91,73 @@ OSStatus MICOStartConfigServer ( mico_Context_t * const inContext )
 
 OSStatus MICOStopConfigServer( void )
 {
-  int i = 0;
+  /* The server thread closes its clients on the way out */
   if( close_listener_sem != NULL )
     mico_rtos_set_semaphore( &close_listener_sem );
 
-  for (; i < MAX_TCP_CLIENT_PER_SERVER; i++){
-    if( close_client_sem[ i ] != NULL )
-      mico_rtos_set_semaphore( &close_client_sem[ i ] );
-  }
   is_config_server_established = false;
   
   return kNoErr;
 }
 
+/* One thread serves all the config clients from a pool of MAX_TCP_CLIENT_PER_SERVER connections */
 void localConfiglistener_thread(void *inContext)
 {
   config_log_trace();
   OSStatus err = kUnknownErr;
-  int j;
+  int i, maxFd;
   Context = inContext;
-  struct sockaddr_t addr;
-  int sockaddr_t_size;
   fd_set readfds;
-  char ip_address[16];
+  struct timeval_t t;
+  HTTPServer_t server;
+  HTTPConnection_t *conns = NULL;
+  configContext_t *httpContexts = NULL;
   
-  int localConfiglistener_fd = -1;
   int close_listener_fd = -1;
 
+  memset( &server, 0, sizeof( server ) );
+  server.listenFd = -1;
+
   mico_rtos_init_semaphore( &close_listener_sem, 1);
   close_listener_fd = mico_create_event_fd( close_listener_sem );
 
-  /*Establish a TCP server fd that accept the tcp clients connections*/ 
-  localConfiglistener_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
-  require_action(IsValidSocket( localConfiglistener_fd ), exit, err = kNoResourcesErr );
-  addr.s_ip = INADDR_ANY;
-  addr.s_port = CONFIG_SERVICE_PORT;
-  err = bind(localConfiglistener_fd, &addr, sizeof(addr));
-  require_noerr( err, exit );
+  /* Parser state of all the clients, allocated once */
+  conns = calloc( MAX_TCP_CLIENT_PER_SERVER, sizeof( HTTPConnection_t ) );
+  require_action( conns, exit, err = kNoMemoryErr );
+  httpContexts = calloc( MAX_TCP_CLIENT_PER_SERVER, sizeof( configContext_t ) );
+  require_action( httpContexts, exit, err = kNoMemoryErr );
+  for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ )
+    conns[ i ].userContext = &httpContexts[ i ];
 
-  err = listen(localConfiglistener_fd, 0);
+  /*Establish a TCP server fd that accept the tcp clients connections*/ 
+  server.conns = conns;
+  server.maxConns = MAX_TCP_CLIENT_PER_SERVER;
+  server.onRequest = onRequest;
+  server.onReceivedData = onReceivedData;
+  server.onClear = onClearHTTPHeader;
+  err = HTTPServerStart( &server, CONFIG_SERVICE_PORT );
   require_noerr( err, exit );
 
-  config_log("Config Server established at port: %d, fd: %d", CONFIG_SERVICE_PORT, localConfiglistener_fd);
+  config_log("Config Server established at port: %d, fd: %d", CONFIG_SERVICE_PORT, server.listenFd);
   
   while(1){
     FD_ZERO(&readfds);
-    FD_SET(localConfiglistener_fd, &readfds);
     FD_SET(close_listener_fd, &readfds);
-    select(1, &readfds, NULL, NULL, NULL);
+    maxFd = HTTPServerSetFds( &server, &readfds );
+    if( close_listener_fd > maxFd ) maxFd = close_listener_fd;
+    /* Wake up now and then to close idle clients */
+    t.tv_sec = 1;
+    t.tv_usec = 0;
+    if( select(maxFd + 1, &readfds, NULL, NULL, &t) < 0 )
+      continue;
 
     /* Check close requests */
     if(FD_ISSET(close_listener_fd, &readfds)){
       goto exit;
     }
 
-    /* Check tcp connection requests */
-    if(FD_ISSET(localConfiglistener_fd, &readfds)){
-      sockaddr_t_size = sizeof(struct sockaddr_t);
-      j = accept(localConfiglistener_fd, &addr, &sockaddr_t_size);
-      if (j > 0) {
-        inet_ntoa(ip_address, addr.s_ip );
-        config_log("Config Client %s:%d connected, fd: %d", ip_address, addr.s_port, j);
-        if(kNoErr !=  mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "Config Clients", localConfig_thread, STACK_SIZE_LOCAL_CONFIG_CLIENT_THREAD, &j) )
-          SocketClose(&j);
-      }
-    }
+    /* Read clients, answer complete requests and accept new clients */
+    HTTPServerProcess( &server, &readfds );
   }
 
 exit:
@@ -165,93 +167,18 @@ exit:
       close_listener_sem = NULL;
     };
     config_log("Exit: Local controller exit with err = %d", err);
-    SocketClose( &localConfiglistener_fd );
+    if( conns ) HTTPServerStop( &server );
+    SocketClose( &server.listenFd );
+    if( conns ) free( conns );
+    if( httpContexts ) free( httpContexts );
     mico_rtos_delete_thread(NULL);
     return;
 }
 
-void localConfig_thread(void *inFd)
+static OSStatus onRequest(HTTPServer_t *server, HTTPConnection_t *conn)
 {
-  OSStatus err;
-  int clientFd = *(int *)inFd;
-  int clientFdIsSet;
-  fd_set readfds;
-  struct timeval_t t;
-  HTTPHeader_t *httpHeader = NULL;
-  configContext_t httpContext = {0, false};
-
-  config_log_trace();
-  httpHeader = HTTPHeaderCreateWithCallback(onReceivedData, onClearHTTPHeader, &httpContext);
-  require_action( httpHeader, exit, err = kNoMemoryErr );
-  HTTPHeaderClear( httpHeader );
-
-  t.tv_sec = 60;
-  t.tv_usec = 0;
-  config_log("Free memory %d bytes", MicoGetMemoryInfo()->free_memory) ; 
-
-  while(1){
-    FD_ZERO(&readfds);
-    FD_SET(clientFd, &readfds);
-    clientFdIsSet = 0;
-
-    if(httpHeader->len == 0){
-      require(select(1, &readfds, NULL, NULL, &t) >= 0, exit);
-      clientFdIsSet = FD_ISSET(clientFd, &readfds);
-    }
-  
-    if(clientFdIsSet||httpHeader->len){
-      err = SocketReadHTTPHeader( clientFd, httpHeader );
-
-      switch ( err )
-      {
-        case kNoErr:
-          // Read the rest of the HTTP body if necessary
-          //do{
-          err = SocketReadHTTPBody( clientFd, httpHeader );
-          
-          if(httpHeader->dataEndedbyClose == true){
-            err = _LocalConfigRespondInComingMessage( clientFd, httpHeader, Context );
-            require_noerr(err, exit);
-            err = kConnectionErr;
-            goto exit;
-          }else{
-            require_noerr(err, exit);
-            err = _LocalConfigRespondInComingMessage( clientFd, httpHeader, Context );
-            require_noerr(err, exit);
-          }
-
-          HTTPHeaderClear( httpHeader );
-        break;
-
-        case EWOULDBLOCK:
-            // NO-OP, keep reading
-        break;
-
-        case kNoSpaceErr:
-          config_log("ERROR: Cannot fit HTTPHeader.");
-          goto exit;
-        
-        case kConnectionErr:
-          // NOTE: kConnectionErr from SocketReadHTTPHeader means it's closed
-          config_log("ERROR: Connection closed.");
-          goto exit;
-
-        default:
-          config_log("ERROR: HTTP Header parse internal error: %d", err);
-          goto exit;
-      }
-    }
-  }
-
-exit:
-  config_log("Exit: Client exit with err = %d", err);
-  SocketClose(&clientFd);
-  if(httpHeader) {
-    HTTPHeaderClear( httpHeader );
-    free(httpHeader);
-  }
-  mico_rtos_delete_thread(NULL);
-  return;
+  UNUSED_PARAMETER(server);
+  return _LocalConfigRespondInComingMessage( conn->fd, &conn->header, Context );
 }
 
 static OSStatus onReceivedData(struct _HTTPHeader_t * inHeader, uint32_t inPos, uint8_t * inData, size_t inLen, void * inUserContext )
@@ -261,11 +188,16 @@ static OSStatus onReceivedData(struct _HTTPHeader_t * inHeader, uint32_t inPos,
   size_t          valueSize;
   configContext_t *context = (configContext_t *)inUserContext;
 
-  err = HTTPGetHeaderField( inHeader->buf, inHeader->len, "Content-Type", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( inHeader, "Content-Type", &value, &valueSize );
   if(err == kNoErr && strnicmpx( value, valueSize, kMIMEType_MXCHIP_OTA ) == 0){
     config_log("OTA data %d, %d to: %x", inPos, inLen, context->flashStorageAddress);
 #ifdef MICO_FLASH_FOR_UPDATE  
     if(inPos == 0){
+      //the application must not reach the Lua image, older bootloaders do not check
+      if(inHeader->contentLength > APPLICATION_FLASH_SIZE){
+        config_log("OTA image too large: %d", (int)inHeader->contentLength);
+        return kSizeErr;
+      }
       context->flashStorageAddress = UPDATE_START_ADDRESS;
       mico_rtos_lock_mutex(&Context->flashContentInRam_mutex); //We are write the Flash content, no other write is possiable
       context->isFlashLocked = true;
@@ -275,9 +207,11 @@ static OSStatus onReceivedData(struct _HTTPHeader_t * inHeader, uint32_t inPos,
       require_noerr(err, flashErrExit);
       err = MicoFlashWrite(MICO_FLASH_FOR_UPDATE, &context->flashStorageAddress, (uint8_t *)inData, inLen);
       require_noerr(err, flashErrExit);
+      context->otaCRC = CRC32_Update(0, inData, inLen);
     }else{
       err = MicoFlashWrite(MICO_FLASH_FOR_UPDATE, &context->flashStorageAddress, (uint8_t *)inData, inLen);
       require_noerr(err, flashErrExit);
+      context->otaCRC = CRC32_Update(context->otaCRC, inData, inLen);
     }
 #else
     config_log("OTA storage is not exist");
@@ -383,13 +317,14 @@ else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLWriteByUAP ) == kNoErr){
   }
 #ifdef MICO_FLASH_FOR_UPDATE
   else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLOTA ) == kNoErr){
-    if(inHeader->contentLength > 0){
+    if(inHeader->contentLength > 0 && inHeader->contentLength <= APPLICATION_FLASH_SIZE){
       config_log("Receive OTA data!");
       memset(&inContext->flashContentInRam.bootTable, 0, sizeof(boot_table_t));
       inContext->flashContentInRam.bootTable.length = inHeader->contentLength;
       inContext->flashContentInRam.bootTable.start_address = UPDATE_START_ADDRESS;
       inContext->flashContentInRam.bootTable.type = 'A';
       inContext->flashContentInRam.bootTable.upgrade_type = 'U';
+      inContext->flashContentInRam.bootTable.crc32 = ((configContext_t *)inHeader->userContext)->otaCRC;
       if(inContext->flashContentInRam.micoSystemConfig.configured != allConfigured)
         inContext->flashContentInRam.micoSystemConfig.easyLinkByPass = EASYLINK_SOFT_AP_BYPASS;
       MICOUpdateConfiguration(inContext);
@@ -407,7 +342,7 @@ else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLWriteByUAP ) == kNoErr){
   };
 
  exit:
-  if(inHeader->persistent == false)  //Return an err to close socket and exit the current thread
+  if(inHeader->persistent == false)  //Return an err to close socket
     err = kConnectionErr;
   if(httpResponse)  free(httpResponse);
   if(report)        json_object_put(report);
@@ -55,8 +55,7 @@
 //#define MFG_MODE_AUTO /**< Device enter MFG mode if MICO settings are erased. */
 
 /* Define MICO service thread stack size */
-#define STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD   0x300
-#define STACK_SIZE_LOCAL_CONFIG_CLIENT_THREAD   0x450
+#define STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD   0x750 /* listener 0x300 + JSON handlers 0x450 */
 #define STACK_SIZE_NTP_CLIENT_THREAD            0x450
 #define STACK_SIZE_MICO_SYSTEM_MONITOR_THREAD   0x300
 
@@ -105,7 +104,8 @@ typedef struct  _boot_table_t {
   uint8_t version[8];
   uint8_t type; // B:bootloader, P:boot_table, A:application, D: 8782 driver
   uint8_t upgrade_type; //u:upgrade, 
-  uint8_t reserved[6];
+  uint8_t reserved[2];
+  uint32_t crc32; // CRC-32 of the image, 0: not given
 }boot_table_t;
 
 typedef struct _mico_sys_config_t
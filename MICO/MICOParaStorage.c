@@ -34,23 +34,51 @@
 #include "MICO.h"
 #include "platform_config.h"
 #include "MicoPlatform.h"
+#include "CRCUtils.h"
 
 /* Update seed number every time*/
 static int32_t seedNum = 0;
 
-__weak void appRestoreDefault_callback(mico_Context_t *inContext)
+/* CRC-32 of the configuration, stored right after it. The boot table is left
+   out, the bootloader clears it without knowing the rest of the layout */
+static uint32_t paraCRC(flash_content_t *content)
 {
-
+  return CRC32_Update(0, (uint8_t *)content + sizeof(boot_table_t), sizeof(flash_content_t) - sizeof(boot_table_t));
 }
 
-OSStatus MICORestoreDefault(mico_Context_t *inContext)
-{ 
+static OSStatus paraWrite(flash_content_t *content)
+{
   OSStatus err = kNoErr;
   uint32_t paraStartAddress, paraEndAddress;
+  uint32_t crc = paraCRC(content);
  
   paraStartAddress = PARA_START_ADDRESS;
   paraEndAddress = PARA_END_ADDRESS;
 
+  err = MicoFlashInitialize(MICO_FLASH_FOR_PARA);
+  require_noerr(err, exit);
+  err = MicoFlashErase(MICO_FLASH_FOR_PARA, paraStartAddress, paraEndAddress);
+  require_noerr(err, exit);
+  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, (uint8_t *)content, sizeof(flash_content_t));
+  require_noerr(err, exit);
+  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, (uint8_t *)&crc, sizeof(crc));
+  require_noerr(err, exit);
+  err = MicoFlashFinalize(MICO_FLASH_FOR_PARA);
+  require_noerr(err, exit);
+
+exit:
+  return err;
+}
+
+__weak void appRestoreDefault_callback(mico_Context_t *inContext)
+{
+
+}
+
+OSStatus MICORestoreDefault(mico_Context_t *inContext)
+{ 
+  OSStatus err = kNoErr;
+
   /*wlan configration is not need to change to a default state, use easylink to do that*/
   memset(&inContext->flashContentInRam, 0x0, sizeof(inContext->flashContentInRam));
   sprintf(inContext->flashContentInRam.micoSystemConfig.name, DEFAULT_NAME);
@@ -65,13 +93,7 @@ OSStatus MICORestoreDefault(mico_Context_t *inContext)
   /*Application's default configuration*/
   appRestoreDefault_callback(inContext);
 
-  err = MicoFlashInitialize(MICO_FLASH_FOR_PARA);
-  require_noerr(err, exit);
-  err = MicoFlashErase(MICO_FLASH_FOR_PARA, paraStartAddress, paraEndAddress);
-  require_noerr(err, exit);
-  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, (void *)inContext, sizeof(flash_content_t));
-  require_noerr(err, exit);
-  err = MicoFlashFinalize(MICO_FLASH_FOR_PARA);
+  err = paraWrite(&inContext->flashContentInRam);
   require_noerr(err, exit);
 
 exit:
@@ -82,10 +104,6 @@ exit:
 OSStatus MICORestoreMFG(mico_Context_t *inContext)
 { 
   OSStatus err = kNoErr;
-  uint32_t paraStartAddress, paraEndAddress;
- 
-  paraStartAddress = PARA_START_ADDRESS;
-  paraEndAddress = PARA_END_ADDRESS;
 
   /*wlan configration is not need to change to a default state, use easylink to do that*/
   sprintf(inContext->flashContentInRam.micoSystemConfig.name, DEFAULT_NAME);
@@ -94,13 +112,7 @@ OSStatus MICORestoreMFG(mico_Context_t *inContext)
   /*Application's default configuration*/
   appRestoreDefault_callback(inContext);
 
-  err = MicoFlashInitialize(MICO_FLASH_FOR_PARA);
-  require_noerr(err, exit);
-  err = MicoFlashErase(MICO_FLASH_FOR_PARA, paraStartAddress, paraEndAddress);
-  require_noerr(err, exit);
-  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, (void *)inContext, sizeof(flash_content_t));
-  require_noerr(err, exit);
-  err = MicoFlashFinalize(MICO_FLASH_FOR_PARA);
+  err = paraWrite(&inContext->flashContentInRam);
   require_noerr(err, exit);
 
 exit:
@@ -113,15 +125,19 @@ exit:
 OSStatus MICOReadConfiguration(mico_Context_t *inContext)
 {
   uint32_t configInFlash;
+  uint32_t crc = 0xFFFFFFFF;
   OSStatus err = kNoErr;
   configInFlash = PARA_START_ADDRESS;
   err = MicoFlashInitialize(MICO_FLASH_FOR_PARA);
   require_noerr(err, exit);
   err = MicoFlashRead(MICO_FLASH_FOR_PARA, &configInFlash, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t));
+  MicoFlashRead(MICO_FLASH_FOR_PARA, &configInFlash, (uint8_t *)&crc, sizeof(crc));
   seedNum = inContext->flashContentInRam.micoSystemConfig.seed;
   if(seedNum == -1) seedNum = 0;
 
-  if(inContext->flashContentInRam.appConfig.configDataVer != CONFIGURATION_VERSION){
+  /* Blocks written before the CRC was added have it erased */
+  if(inContext->flashContentInRam.appConfig.configDataVer != CONFIGURATION_VERSION ||
+     (crc != 0xFFFFFFFF && crc != paraCRC(&inContext->flashContentInRam))){
 #ifdef MFG_MODE_AUTO
     err = MICORestoreMFG(inContext);
 #else
@@ -145,19 +161,9 @@ exit:
 OSStatus MICOUpdateConfiguration(mico_Context_t *inContext)
 {
   OSStatus err = kNoErr;
-  uint32_t paraStartAddress, paraEndAddress;
- 
-  paraStartAddress = PARA_START_ADDRESS;
-  paraEndAddress = PARA_END_ADDRESS;
 
   inContext->flashContentInRam.micoSystemConfig.seed = ++seedNum;
-  err = MicoFlashInitialize(MICO_FLASH_FOR_PARA);
-  require_noerr(err, exit);
-  err = MicoFlashErase(MICO_FLASH_FOR_PARA, paraStartAddress, paraEndAddress);
-  require_noerr(err, exit);
-  err = MicoFlashWrite(MICO_FLASH_FOR_PARA, &paraStartAddress, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t));
-  require_noerr(err, exit);
-  err = MicoFlashFinalize(MICO_FLASH_FOR_PARA);
+  err = paraWrite(&inContext->flashContentInRam);
   require_noerr(err, exit);
 
 exit:
@@ -56,8 +56,13 @@
 ******************************************************/
 
 #ifndef STDIO_BUFFER_SIZE
+#ifdef BOOTLOADER
+/* Room for the next YMODEM-1K packet while the last one is programmed */
+#define STDIO_BUFFER_SIZE   2048
+#else
 #define STDIO_BUFFER_SIZE   64
 #endif
+#endif
 
 /******************************************************
 *                   Enumerations
@@ -290,6 +295,23 @@ OSStatus stdio_hardfault( char* data, uint32_t size )
   return kNoErr;
 }
 
+/* Restarts the STDIO UART at another baud rate once the bytes sent so far
+   are out, anything received and not read yet is dropped */
+OSStatus stdio_set_baudrate( uint32_t baud_rate )
+{
+#ifndef MICO_DISABLE_STDIO
+  mico_uart_config_t config = stdio_uart_config;
+
+  config.baud_rate = baud_rate;
+  while ( ( platform_uart_peripherals[ STDIO_UART ].port->SR & USART_SR_TC ) == 0 );
+  platform_uart_deinit( &platform_uart_drivers[STDIO_UART] );
+  ring_buffer_init  ( (ring_buffer_t*)&stdio_rx_buffer, (uint8_t*)stdio_rx_data, STDIO_BUFFER_SIZE );
+  return platform_uart_init( &platform_uart_drivers[STDIO_UART], &platform_uart_peripherals[STDIO_UART], &config, (ring_buffer_t*)&stdio_rx_buffer );
+#else
+  return kUnsupportedErr;
+#endif
+}
+
 /******************************************************
 *            NO-OS Functions
 ******************************************************/
@@ -30,6 +30,7 @@
 */ 
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include "Common.h"
 #include "platform_peripheral.h"
@@ -612,6 +613,24 @@ char *mico_get_bootloader_ver(void)
     return ver;
 }
 
+/* "Vx.y" at the end of a version string as x*1000+y, 0 if there is none */
+static uint32_t bootloader_revision(const char *ver)
+{
+    const char *revision = strrchr(ver, 'V');
+    char *end;
+    uint32_t major;
+
+    if (revision == NULL) return 0;
+    major = strtoul(revision + 1, &end, 10);
+    if (*end != '.') return 0;
+    return major * 1000 + strtoul(end + 1, NULL, 10);
+}
+
+bool mico_bootloader_is_at_least(const char *revision)
+{
+    return bootloader_revision(mico_get_bootloader_ver()) >= bootloader_revision(revision);
+}
+
 #ifdef BOOTLOADER 
 void mico_set_bootload_ver(void)
 {
@@ -39,6 +39,7 @@ void init_memory( void );
 void init_architecture( void) ;
 void init_platform_bootloader( void );
 void startApplication( void );
+OSStatus stdio_set_baudrate( uint32_t baud_rate );
 
 #endif // __PlatformInternal_h__
 
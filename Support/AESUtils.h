@@ -27,7 +27,26 @@
 #include "Debug.h"
 
 #include "SecurityUtils.h"
-#define AES_UTILS_USE_MICO_AES 1
+
+// AES backend, chosen at build time. The default is the MICO library. AES_UTILS_USE_SOFT_AES=1 selects the
+// table driven AES-128 in AESUtils.c, which also provides GCM and does CTR and GCM four blocks at a time.
+
+#if( !defined( AES_UTILS_USE_SOFT_AES ) )
+    #define AES_UTILS_USE_SOFT_AES      0
+#endif
+
+#if( !defined( AES_UTILS_USE_MICO_AES ) )
+    #define AES_UTILS_USE_MICO_AES      !AES_UTILS_USE_SOFT_AES
+#endif
+
+#if( AES_UTILS_USE_SOFT_AES )
+    #undef  TARGET_NO_OPENSSL
+    #define TARGET_NO_OPENSSL           1 // The rijndael-alg-fst API below is implemented by AESUtils.c.
+#endif
+
+#if( !defined( AES_UTILS_HAS_SOFT_GCM ) )
+    #define AES_UTILS_HAS_SOFT_GCM      ( AES_UTILS_USE_SOFT_AES && !AES_UTILS_HAS_COMMON_CRYPTO_GCM )
+#endif
 
 #if( !defined( AES_UTILS_HAS_GLADMAN_GCM ) )
 //    #if( __has_include( "gcm.h" ) )
@@ -38,7 +57,7 @@
     #endif
 #endif
 
-#if( AES_UTILS_HAS_COMMON_CRYPTO_GCM || AES_UTILS_HAS_GLADMAN_GCM )
+#if( AES_UTILS_HAS_COMMON_CRYPTO_GCM || AES_UTILS_HAS_GLADMAN_GCM || AES_UTILS_HAS_SOFT_GCM )
     #define AES_UTILS_HAS_GCM       1
 #endif
 
@@ -59,6 +78,10 @@
     
     // Emulate the OpenSSL API with the rijndael-alg-fst.c API.
     
+    #if( !defined( STATIC_INLINE ) )
+        #define STATIC_INLINE       static inline
+    #endif
+    
     #define AES_ENCRYPT         1
     #define AES_DECRYPT         0
     
@@ -123,6 +146,7 @@
 */
 
 #define kAES_CTR_Size       16
+#define kAES_CTR_Batch      4   // Blocks of keystream made at a time by the software AES.
 
 typedef struct
 {
@@ -324,6 +348,16 @@ typedef struct
     CCCryptorRef        cryptor;
 #elif( AES_UTILS_HAS_GLADMAN_GCM )
     gcm_ctx             ctx;
+#elif( AES_UTILS_HAS_SOFT_GCM )
+    AES_KEY             key;                    //! PRIVATE: Internal AES key.
+    uint64_t            hl[ 16 ];               //! PRIVATE: GHASH table, the 16 multiples of H, low halves.
+    uint64_t            hh[ 16 ];               //! PRIVATE: GHASH table, high halves.
+    uint8_t             ctr[ kAES_CGM_Size ];   //! PRIVATE: Big endian counter of the message.
+    uint8_t             ek0[ kAES_CGM_Size ];   //! PRIVATE: First counter block encrypted, masks the tag.
+    uint8_t             hash[ kAES_CGM_Size ];  //! PRIVATE: GHASH of the AAD and ciphertext so far.
+    uint8_t             buf[ kAES_CGM_Size ];   //! PRIVATE: Keystream buffer.
+    uint64_t            aadLen;                 //! PRIVATE: Bytes of AAD hashed.
+    uint64_t            textLen;                //! PRIVATE: Bytes encrypted or decrypted, the keystream used is textLen % 16.
 #else
     #error "GCM enabled, but no implementation?"
 #endif
@@ -0,0 +1,69 @@
+/**
+******************************************************************************
+* @file    CRCUtils.h
+* @author  WiFiMCU Team
+* @version V1.0.0
+* @date    19-Oct-2026
+* @brief   This header contains function prototypes of the table driven CRCs
+  shared by YMODEM, OTA and parameter storage: CRC16-CCITT, CRC-32 and
+  CRC-32C.
+******************************************************************************
+* <h2><center>&copy; COPYRIGHT 2026 WiFiMCU Team</center></h2>
+******************************************************************************
+*/
+
+#ifndef __CRCUtils_h__
+#define __CRCUtils_h__
+
+#include "Common.h"
+
+// CRC_UTILS_SLICES: Bytes taken per table step, 1, 4 or 8. Each CRC has one
+// table of 256 entries per slice, so slicing by 4 costs 2 KB of flash for
+// CRC16 and 4 KB for each CRC-32. The bootloader has 32 KB in all and takes
+// one byte at a time.
+#if( !defined( CRC_UTILS_SLICES ) )
+  #if( defined( BOOTLOADER ) )
+    #define CRC_UTILS_SLICES            1
+  #else
+    #define CRC_UTILS_SLICES            4
+  #endif
+#endif
+
+#if( CRC_UTILS_SLICES != 1 && CRC_UTILS_SLICES != 4 && CRC_UTILS_SLICES != 8 )
+    #error "CRC_UTILS_SLICES must be 1, 4 or 8"
+#endif
+
+// CRC_UTILS_USE_HW_CRC32: CRC-32 by the STM32 CRC unit, for the whole words
+// of inputs of 16 bytes or more. CRC16 and CRC-32C stay in software. The unit
+// is used with interrupts disabled, a few hundred cycles at a time.
+#if( !defined( CRC_UTILS_USE_HW_CRC32 ) )
+  #if( defined( BOOTLOADER ) )
+    #define CRC_UTILS_USE_HW_CRC32      1
+  #else
+    #define CRC_UTILS_USE_HW_CRC32      0
+  #endif
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  CRC16-CCITT as used by XMODEM/YMODEM: polynomial 0x1021, initial value 0, no reflection.
+
+    @param  inCRC   0 to start, or the result of the previous call to continue.
+*/
+uint16_t    CRC16_CCITT_Update( uint16_t inCRC, const void *inData, size_t inLen );
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  CRC-32 as used by zip, PNG and Ethernet: reflected polynomial 0xEDB88320.
+
+    @param  inCRC   0 to start, or the result of the previous call to continue.
+*/
+uint32_t    CRC32_Update( uint32_t inCRC, const void *inData, size_t inLen );
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  CRC-32C (Castagnoli) as used by iSCSI and ext4: reflected polynomial 0x82F63B78.
+
+    @param  inCRC   0 to start, or the result of the previous call to continue.
+*/
+uint32_t    CRC32C_Update( uint32_t inCRC, const void *inData, size_t inLen );
+
+#endif // __CRCUtils_h__
+
@@ -0,0 +1,202 @@
+/**
+******************************************************************************
+* @file    HTTPServerUtils.c 
+* @author  WiFiMCU Team
+* @version V1.0.0
+* @date    19-Oct-2026
+* @brief   This file contains a HTTP server core. Clients are served from a
+  pool of connections by the thread that calls HTTPServerProcess, so N clients
+  cost N connection structs instead of N thread stacks.
+******************************************************************************
+* <h2><center>&copy; COPYRIGHT 2026 WiFiMCU Team</center></h2>
+******************************************************************************
+*/ 
+
+#include "HTTPServerUtils.h"
+#include "SocketUtils.h"
+#include "Debug.h"
+
+#define http_server_log(M, ...) custom_log("HTTPServer", M, ##__VA_ARGS__)
+#define http_server_log_trace() custom_log_trace("HTTPServer")
+
+OSStatus HTTPServerStart( HTTPServer_t *server, uint16_t port )
+{
+  OSStatus err = kNoErr;
+  struct sockaddr_t addr;
+  HTTPConnection_t *conn;
+  int i;
+
+  require_action( server && server->conns && server->maxConns > 0, exit, err = kParamErr );
+  if( server->idleTimeout == 0 ) server->idleTimeout = kHTTPServerIdleTimeout;
+
+  for( i = 0; i < server->maxConns; i++ ){
+    conn = &server->conns[ i ];
+    conn->fd = -1;
+    conn->busy = false;
+    memset( &conn->header, 0, sizeof( HTTPHeader_t ) );
+    conn->header.onReceivedDataCallback = server->onReceivedData;
+    conn->header.onClearCallback = server->onClear;
+    conn->header.userContext = conn->userContext;
+  }
+
+  server->listenFd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require_action( IsValidSocket( server->listenFd ), exit, err = kNoResourcesErr );
+  addr.s_ip = INADDR_ANY;
+  addr.s_port = port;
+  err = bind( server->listenFd, &addr, sizeof( addr ) );
+  require_noerr( err, exit );
+
+  err = listen( server->listenFd, 0 );
+  require_noerr( err, exit );
+
+exit:
+  if( err != kNoErr && server ) SocketClose( &server->listenFd );
+  return err;
+}
+
+void HTTPServerStop( HTTPServer_t *server )
+{
+  int i;
+
+  for( i = 0; i < server->maxConns; i++ )
+    HTTPServerCloseConnection( server, &server->conns[ i ] );
+  SocketClose( &server->listenFd );
+}
+
+void HTTPServerCloseConnection( HTTPServer_t *server, HTTPConnection_t *conn )
+{
+  UNUSED_PARAMETER( server );
+  if( conn->fd < 0 )
+    return;
+  conn->busy = false;
+  HTTPHeaderClear( &conn->header );
+  conn->header.len = 0;
+  SocketClose( &conn->fd );
+}
+
+int HTTPServerSetFds( HTTPServer_t *server, fd_set *readSet )
+{
+  int i, maxFd = server->listenFd;
+
+  FD_SET( server->listenFd, readSet );
+  for( i = 0; i < server->maxConns; i++ ){
+    if( server->conns[ i ].fd < 0 || server->conns[ i ].busy ) continue;
+    FD_SET( server->conns[ i ].fd, readSet );
+    if( server->conns[ i ].fd > maxFd ) maxFd = server->conns[ i ].fd;
+  }
+  return maxFd;
+}
+
+// A free slot, else the one idle the longest between two messages, else NULL.
+static HTTPConnection_t * HTTPServerFreeConnection( HTTPServer_t *server )
+{
+  HTTPConnection_t *conn, *victim = NULL;
+  int i;
+
+  for( i = 0; i < server->maxConns; i++ ){
+    conn = &server->conns[ i ];
+    if( conn->fd < 0 ) return conn;
+    if( conn->header.len == 0 && !conn->busy && ( victim == NULL || (int32_t)( conn->lastActive - victim->lastActive ) < 0 ) )
+      victim = conn;
+  }
+  if( victim ){
+    http_server_log("Pool full, close idle client, fd: %d", victim->fd);
+    HTTPServerCloseConnection( server, victim );
+  }
+  return victim;
+}
+
+static void HTTPServerAccept( HTTPServer_t *server )
+{
+  struct sockaddr_t addr;
+  int sockaddr_t_size = sizeof( struct sockaddr_t );
+  HTTPConnection_t *conn;
+  int fd;
+  
+  fd = accept( server->listenFd, &addr, &sockaddr_t_size );
+  if( fd < 0 ) return;
+
+  conn = HTTPServerFreeConnection( server );
+  if( conn == NULL ){
+    http_server_log("Pool full, refuse client, fd: %d", fd);
+    SocketClose( &fd );
+    return;
+  }
+  conn->fd = fd;
+  conn->lastActive = mico_get_time();
+}
+
+// Go on to the message pipelined behind the one answered, if any.
+static OSStatus HTTPServerNextMessage( HTTPConnection_t *conn )
+{
+  if( conn->header.persistent == false )
+    return kConnectionErr;
+  HTTPHeaderClear( &conn->header );
+  return HTTPReadBufferedMessage( &conn->header );
+}
+
+// Answer every complete message, err is how the first one was read.
+static void HTTPServerAnswer( HTTPServer_t *server, HTTPConnection_t *conn, OSStatus err )
+{
+  while( err == kNoErr ){
+    err = (server->onRequest)( server, conn );
+    if( err != kNoErr ) break;
+    if( conn->busy ) return;
+    err = HTTPServerNextMessage( conn );
+  }
+
+  switch( err ){
+    case kInProgressErr:
+      return;
+    case kNoErr:
+      break;
+    case kNoSpaceErr:
+      http_server_log("ERROR: Cannot fit HTTPHeader, fd: %d", conn->fd);
+      break;
+    case kConnectionErr:
+      break;
+    default:
+      http_server_log("ERROR: HTTP message error: %d, fd: %d", err, conn->fd);
+      break;
+  }
+  HTTPServerCloseConnection( server, conn );
+}
+
+static void HTTPServerRead( HTTPServer_t *server, HTTPConnection_t *conn )
+{
+  conn->lastActive = mico_get_time();
+  HTTPServerAnswer( server, conn, SocketReadHTTPMessage( conn->fd, &conn->header ) );
+}
+
+void HTTPServerResume( HTTPServer_t *server, HTTPConnection_t *conn )
+{
+  conn->busy = false;
+  conn->lastActive = mico_get_time();
+  HTTPServerAnswer( server, conn, HTTPServerNextMessage( conn ) );
+}
+
+void HTTPServerProcess( HTTPServer_t *server, fd_set *readSet )
+{
+  HTTPConnection_t *conn;
+  uint32_t now;
+  int i;
+
+  for( i = 0; i < server->maxConns; i++ ){
+    conn = &server->conns[ i ];
+    if( conn->fd >= 0 && !conn->busy && FD_ISSET( conn->fd, readSet ) )
+      HTTPServerRead( server, conn );
+  }
+
+  if( FD_ISSET( server->listenFd, readSet ) )
+    HTTPServerAccept( server );
+
+  now = mico_get_time();
+  for( i = 0; i < server->maxConns; i++ ){
+    conn = &server->conns[ i ];
+    if( conn->fd >= 0 && !conn->busy && now - conn->lastActive >= server->idleTimeout ){
+      http_server_log("Idle client closed, fd: %d", conn->fd);
+      HTTPServerCloseConnection( server, conn );
+    }
+  }
+}
+
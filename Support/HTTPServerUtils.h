@@ -0,0 +1,64 @@
+/**
+******************************************************************************
+* @file    HTTPServerUtils.h 
+* @author  WiFiMCU Team
+* @version V1.0.0
+* @date    19-Oct-2026
+* @brief   This header contains function prototypes of a HTTP server core: one
+  thread serves a bounded pool of connections with a select loop.
+******************************************************************************
+* <h2><center>&copy; COPYRIGHT 2026 WiFiMCU Team</center></h2>
+******************************************************************************
+*/ 
+
+
+#ifndef __HTTPServerUtils_h__
+#define __HTTPServerUtils_h__
+
+#include "Common.h"
+#include "MICO.h"
+#include "HTTPUtils.h"
+
+#define kHTTPServerIdleTimeout      (60*1000)   //! ms a connection may stay idle, keep-alive or not.
+
+typedef struct _HTTPConnection_t
+{
+    int                 fd;                 //! Client socket, -1 if the slot is free.
+    uint32_t            lastActive;         //! mico_get_time() of the last data from the client.
+    HTTPHeader_t        header;             //! Parser state, kept across the reads of a message.
+    bool                busy;               //! Answer in progress, not read until HTTPServerResume.
+    void *              userContext;        //! Given to the header callbacks, set before HTTPServerStart.
+} HTTPConnection_t;
+
+typedef struct _HTTPServer_t HTTPServer_t;
+
+//! Called with each complete message in conn->header. An error, or a non persistent message, closes the connection.
+//! Set conn->busy to answer later, e.g. from another thread, and call HTTPServerResume when done.
+typedef OSStatus (*HTTPServerRequestCallback) ( HTTPServer_t *server, HTTPConnection_t *conn );
+
+struct _HTTPServer_t
+{
+    int                         listenFd;
+    HTTPConnection_t *          conns;      //! Connection pool, maxConns slots owned by the caller.
+    int                         maxConns;
+    uint32_t                    idleTimeout;
+    HTTPServerRequestCallback   onRequest;
+    onReceivedDataCallback      onReceivedData;
+    onClearCallback             onClear;
+    void *                      userContext;
+};
+
+OSStatus HTTPServerStart( HTTPServer_t *server, uint16_t port );
+
+void HTTPServerStop( HTTPServer_t *server );
+
+int HTTPServerSetFds( HTTPServer_t *server, fd_set *readSet );
+
+void HTTPServerProcess( HTTPServer_t *server, fd_set *readSet );
+
+void HTTPServerResume( HTTPServer_t *server, HTTPConnection_t *conn );
+
+void HTTPServerCloseConnection( HTTPServer_t *server, HTTPConnection_t *conn );
+
+#endif // __HTTPServerUtils_h__
+
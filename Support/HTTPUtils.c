@@ -36,6 +36,35 @@
 
 #define READ_LENGTH 1500
 
+// Header scanner states, for where the last byte scanned was.
+enum
+{
+  kScanInLine = 0,
+  kScanLineStart,     // after LF
+  kScanLineStartCR,   // after LF CR
+  kScanDone,          // after the empty line
+  kScanBody           // header parsed, reading the body
+};
+
+// Chunked body parser states.
+enum
+{
+  kChunkSizeStart = 0,
+  kChunkSize,
+  kChunkExt,          // chunk extension, skipped
+  kChunkSizeLF,
+  kChunkData,
+  kChunkDataCR,
+  kChunkDataLF,
+  kChunkTrailer,      // start of a trailer line
+  kChunkTrailerLine,
+  kChunkTrailerLF,
+  kChunkDone
+};
+
+static OSStatus HTTPHeaderReceived( HTTPHeader_t *inHeader, char *inHeaderEnd );
+static OSStatus HTTPChunkParse( HTTPHeader_t *inHeader, char *inData, size_t inLen, size_t *outUsed );
+
 OSStatus onReceivedDataCallbackDefault(struct _HTTPHeader_t * httpHeader, uint32_t pos, uint8_t * data, size_t len, void * userContext )
 {
   UNUSED_PARAMETER(httpHeader);
@@ -61,8 +90,10 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
   lim = buf + sizeof( inHeader->buf );
   for( ;; )
   {
+    // Only the bytes read since the last call are scanned.
     if(findHeader( inHeader,  &end ))
       break ;
+    require_action( dst < lim, exit, err = kNoSpaceErr );
     n = read( inSock, dst, (size_t)( lim - dst ) );
     if(      n  > 0 ) len = (size_t) n;
     else  { err = kConnectionErr; goto exit; }
@@ -70,28 +101,56 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
     inHeader->len += len;
   }
   
-  inHeader->len = (size_t)( end - buf );
+  err = HTTPHeaderReceived( inHeader, end );
+  
+exit:
+  return err;
+}
+
+// The header ends at inHeaderEnd, and the bytes after it up to buf + len are the first of the body. Parse the
+// header and start on the body.
+static OSStatus HTTPHeaderReceived( HTTPHeader_t *inHeader, char *inHeaderEnd )
+{
+  OSStatus        err;
+  char *          end = inHeaderEnd;
+  size_t          used;
+  
+  inHeader->extraDataLen = (size_t)( inHeader->buf + inHeader->len - end );
+  inHeader->len = (size_t)( end - inHeader->buf );
   err = HTTPHeaderParse( inHeader );
   require_noerr( err, exit );
-  inHeader->extraDataLen = (size_t)( dst - end );
+  inHeader->scanState = kScanBody;
   if(inHeader->extraDataPtr) {
     free((uint8_t *)inHeader->extraDataPtr);
     inHeader->extraDataPtr = 0;
   }
+  inHeader->nextDataPtr = NULL;
+  inHeader->nextDataLen = 0;
 
-  /* For chunked extra data without content length */
+  /* For chunked extra data without content length, parse it where it is */
   if(inHeader->chunkedData == true){
-    inHeader->chunkedDataBufferLen = (inHeader->extraDataLen > READ_LENGTH)? inHeader->extraDataLen:READ_LENGTH;
-    inHeader->chunkedDataBufferPtr = calloc(inHeader->chunkedDataBufferLen, sizeof(uint8_t)); //Make extra data buffer larger than chunk length
-    require_action(inHeader->chunkedDataBufferPtr, exit, err = kNoMemoryErr);
-    memcpy((uint8_t *)inHeader->chunkedDataBufferPtr, end, inHeader->extraDataLen);
-    inHeader->extraDataPtr = inHeader->chunkedDataBufferPtr;
+    inHeader->chunkState = kChunkSizeStart;
+    inHeader->chunkRemain = 0;
+    inHeader->chunkPos = 0;
+    err = HTTPChunkParse( inHeader, end, inHeader->extraDataLen, &used );
+    require_noerr( err, exit );
+    /* Bytes after the last chunk belong to the next message */
+    if( inHeader->chunkState == kChunkDone ){
+      inHeader->nextDataPtr = end + used;
+      inHeader->nextDataLen = inHeader->extraDataLen - used;
+    }
     return kNoErr;
   }
 
+  /* Bytes after the body belong to the next message */
+  if( inHeader->extraDataLen > inHeader->contentLength ){
+    inHeader->nextDataPtr = end + inHeader->contentLength;
+    inHeader->nextDataLen = inHeader->extraDataLen - (size_t)inHeader->contentLength;
+  }
+
   /* Extra data with content length */
 
-  if (inHeader->contentLength != 0){ //Content length >0, create a memory buffer (Content length) and store extra data
+  if (inHeader->contentLength != 0){ //Content length >0, give the extra data to the callback where it is, or store it
     size_t copyDataLen = (inHeader->contentLength >= inHeader->extraDataLen)? inHeader->extraDataLen : inHeader->contentLength;
     if(inHeader->onReceivedDataCallback && (inHeader->onReceivedDataCallback)(inHeader, 0, (uint8_t *)end, copyDataLen, inHeader->userContext)==kNoErr){
       inHeader->isCallbackSupported = true;
@@ -99,10 +158,11 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
       require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
     }else{
       inHeader->isCallbackSupported = false;
-      inHeader->extraDataPtr = calloc(inHeader->contentLength , sizeof(uint8_t));
+      inHeader->extraDataPtr = calloc(inHeader->contentLength + 1, sizeof(uint8_t)); //+1: body is a C string
       require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
       memcpy((uint8_t *)inHeader->extraDataPtr, end, copyDataLen);
     }
+    inHeader->extraDataLen = copyDataLen;
     err = kNoErr;
   } /* Extra data without content length, data is ended by conntection close */
   // else if(inHeader->extraDataLen != 0){ //Content length =0, but extra data length >0, create a memory buffer (1500)and store extra data
@@ -121,60 +181,257 @@ exit:
   return err;
 }
 
+// Record the header field line that ends at lineEnd (the LF).
+static void HTTPHeaderIndexLine( HTTPHeader_t *inHeader, size_t lineEnd )
+{
+  const char *        buf = inHeader->buf;
+  size_t              start = inHeader->scanLineStart;
+  size_t              end = lineEnd;
+  size_t              value;
+  HTTPHeaderField_t * field;
+  
+  if( ( end > start ) && ( buf[ end - 1 ] == '\r' ) ) --end;
+  if( start == 0 ) return; // Start line.
+  if( inHeader->fieldCount > kHTTPHeaderMaxFields ) return;
+  
+  // A line that begins with white space goes on with the value of the previous one.
+  if( ( end > start ) && ( ( buf[ start ] == ' ' ) || ( buf[ start ] == '\t' ) ) )
+  {
+    if( inHeader->fieldCount == 0 ) return;
+    field = &inHeader->fields[ inHeader->fieldCount - 1 ];
+    field->valueLen = (uint16_t)( end - field->valueOff );
+    return;
+  }
+  if( inHeader->scanColon == 0 ) return;
+  if( inHeader->fieldCount == kHTTPHeaderMaxFields )
+  {
+    ++inHeader->fieldCount; // Index is not complete, lookups scan the header.
+    return;
+  }
+  
+  field = &inHeader->fields[ inHeader->fieldCount++ ];
+  field->nameOff = (uint16_t) start;
+  field->nameLen = (uint16_t)( inHeader->scanColon - start );
+  value = inHeader->scanColon + 1;
+  while( ( value < end ) && ( ( buf[ value ] == ' ' ) || ( buf[ value ] == '\t' ) ) ) ++value;
+  field->valueOff = (uint16_t) value;
+  field->valueLen = (uint16_t)( end - value );
+}
 
 bool findHeader ( HTTPHeader_t *inHeader,  char **  outHeaderEnd)
 {
-  char *dst = inHeader->buf + inHeader->len;
   char *buf = (char *)inHeader->buf;
-  char *src = (char *)inHeader->buf;
-  size_t          len;
+  size_t          i;
+  char            c;
   
   // Check for interleaved binary data (4 byte header that begins with $). See RFC 2326 section 10.12.
-  if( ( ( dst - buf ) >= 4 ) && ( buf[ 0 ] == '$' ) )
+  if( ( inHeader->len >= 4 ) && ( buf[ 0 ] == '$' ) )
   {
     *outHeaderEnd = buf + 4;
     return true;
   }
   
+  if( inHeader->scanState >= kScanDone )
+  {
+    *outHeaderEnd = buf + inHeader->scanLen;
+    return true;
+  }
+  
   // Find an empty line (separates the header and body). The HTTP spec defines it as CRLFCRLF, but some
   // use LFLF or weird combos like CRLFLF so this handles CRLFCRLF, LFLF, and CRLFLF (but not CRCR).
-  *outHeaderEnd = dst;
-  for( ;; )
+  // Scanning goes on from where the last call stopped, and header field lines are indexed on the way.
+  for( i = inHeader->scanLen; i < inHeader->len; ++i )
   {
-    while( ( src < *outHeaderEnd ) && ( *src != '\n' ) ) ++src;
-    if( src >= *outHeaderEnd ) break;
-    
-    len = (size_t)( *outHeaderEnd - src );
-    if( ( len >= 3 ) && ( src[ 1 ] == '\r' ) && ( src[ 2 ] == '\n' ) ) // CRLFCRLF or LFCRLF.
+    c = buf[ i ];
+    if( c == '\n' )
     {
-      *outHeaderEnd = src + 3;
-      return true;
+      if( inHeader->scanState != kScanInLine ) // LFLF, CRLFLF, LFCRLF or CRLFCRLF.
+      {
+        inHeader->scanLen = (uint16_t)( i + 1 );
+        inHeader->scanState = kScanDone;
+        *outHeaderEnd = buf + i + 1;
+        return true;
+      }
+      HTTPHeaderIndexLine( inHeader, i );
+      inHeader->scanState = kScanLineStart;
+      inHeader->scanLineStart = (uint16_t)( i + 1 );
+      inHeader->scanColon = 0;
     }
-    else if( ( len >= 2 ) && ( src[ 1 ] == '\n' ) ) // LFLF or CRLFLF.
+    else if( ( c == '\r' ) && ( inHeader->scanState == kScanLineStart ) )
     {
-      *outHeaderEnd = src + 2;
-      return true;
+      inHeader->scanState = kScanLineStartCR;
     }
-    else if( len <= 1 )
+    else
     {
-      break;
+      if( ( c == ':' ) && ( inHeader->scanColon == 0 ) ) inHeader->scanColon = (uint16_t) i;
+      inHeader->scanState = kScanInLine;
     }
-    ++src;
   }
+  inHeader->scanLen = (uint16_t) i;
   return false;
 }
 
+// Parse chunked body bytes, giving chunk data to the callback where it is. *outUsed is the number of bytes
+// that belong to the body, less than inLen only when the last chunk has been parsed.
+static OSStatus HTTPChunkParse( HTTPHeader_t *inHeader, char *inData, size_t inLen, size_t *outUsed )
+{
+  OSStatus        err = kNoErr;
+  char *          src = inData;
+  char *          end = inData + inLen;
+  size_t          n;
+  char            c;
+  int             x;
+  
+  while( ( src < end ) && ( inHeader->chunkState != kChunkDone ) )
+  {
+    if( inHeader->chunkState == kChunkData )
+    {
+      n = (size_t)( end - src );
+      if( n > inHeader->chunkRemain ) n = inHeader->chunkRemain;
+      (inHeader->onReceivedDataCallback)(inHeader, inHeader->chunkPos, (uint8_t *)src, n, inHeader->userContext);
+      inHeader->chunkPos += n;
+      src += n;
+      inHeader->chunkRemain -= n;
+      if( inHeader->chunkRemain == 0 ) inHeader->chunkState = kChunkDataCR;
+      continue;
+    }
+    
+    c = *src++;
+    switch( inHeader->chunkState )
+    {
+      case kChunkSizeStart:
+      case kChunkSize:
+        if(      ( c >= '0' ) && ( c <= '9' ) ) x = c - '0';
+        else if( ( c >= 'a' ) && ( c <= 'f' ) ) x = c - 'a' + 10;
+        else if( ( c >= 'A' ) && ( c <= 'F' ) ) x = c - 'A' + 10;
+        else x = -1;
+        if( x >= 0 )
+        {
+          require_action( inHeader->chunkRemain < 0x08000000, exit, err = kMalformedErr );
+          inHeader->chunkRemain = ( inHeader->chunkRemain << 4 ) | x;
+          inHeader->chunkState = kChunkSize;
+          break;
+        }
+        require_action( inHeader->chunkState == kChunkSize, exit, err = kMalformedErr );
+        if(      c == '\r' ) inHeader->chunkState = kChunkSizeLF;
+        else if( c == '\n' ) goto sizeDone;
+        else                 inHeader->chunkState = kChunkExt;
+        break;
+      
+      case kChunkExt:
+        if(      c == '\r' ) inHeader->chunkState = kChunkSizeLF;
+        else if( c == '\n' ) goto sizeDone;
+        break;
+      
+      case kChunkSizeLF:
+        require_action( c == '\n', exit, err = kMalformedErr );
+      sizeDone:
+        inHeader->chunkState = inHeader->chunkRemain ? kChunkData : kChunkTrailer;
+        break;
+      
+      case kChunkDataCR: // Chunk data ends with CRLF.
+        if(      c == '\r' ) inHeader->chunkState = kChunkDataLF;
+        else if( c == '\n' ) inHeader->chunkState = kChunkSizeStart;
+        else { err = kMalformedErr; goto exit; }
+        break;
+      
+      case kChunkDataLF:
+        require_action( c == '\n', exit, err = kMalformedErr );
+        inHeader->chunkState = kChunkSizeStart;
+        break;
+      
+      case kChunkTrailer: // Trailer lines end with an empty line.
+        if(      c == '\r' ) inHeader->chunkState = kChunkTrailerLF;
+        else if( c == '\n' ) inHeader->chunkState = kChunkDone;
+        else                 inHeader->chunkState = kChunkTrailerLine;
+        break;
+      
+      case kChunkTrailerLine:
+        if( c == '\n' ) inHeader->chunkState = kChunkTrailer;
+        break;
+      
+      case kChunkTrailerLF:
+        require_action( c == '\n', exit, err = kMalformedErr );
+        inHeader->chunkState = kChunkDone;
+        break;
+    }
+  }
+  
+exit:
+  *outUsed = (size_t)( src - inData );
+  return err;
+}
+
+static bool HTTPBodyComplete( HTTPHeader_t *inHeader )
+{
+  if( inHeader->chunkedData == true )
+    return inHeader->chunkState == kChunkDone;
+  return inHeader->extraDataLen >= inHeader->contentLength;
+}
+
+// Read body data once, the socket should be readable.
+static OSStatus SocketReadHTTPBodyOnce( int inSock, HTTPHeader_t *inHeader )
+{
+  OSStatus err = kNoErr;
+  ssize_t readResult;
+  size_t          readLength;
+  size_t          used;
+
+  /* Chunked data without content length, parsed in one read buffer */
+  if( inHeader->chunkedData == true ){
+    if( inHeader->chunkedDataBufferPtr == NULL ){
+      inHeader->chunkedDataBufferLen = READ_LENGTH;
+      inHeader->chunkedDataBufferPtr = malloc( READ_LENGTH );
+      require_action( inHeader->chunkedDataBufferPtr, exit, err = kNoMemoryErr );
+    }
+    /* Whatever is read past the last chunk has to fit in buf for the next message: the
+       body still holds at least the rest of the current chunk, read no more than that
+       and a buf full */
+    readLength = sizeof( inHeader->buf );
+    if( inHeader->chunkState == kChunkData ) readLength += inHeader->chunkRemain;
+    if( readLength > inHeader->chunkedDataBufferLen ) readLength = inHeader->chunkedDataBufferLen;
+    readResult = read( inSock, inHeader->chunkedDataBufferPtr, readLength );
+    if( readResult  > 0 ) {}
+    else { err = kConnectionErr; goto exit; }
+
+    err = HTTPChunkParse( inHeader, inHeader->chunkedDataBufferPtr, (size_t)readResult, &used );
+    require_noerr( err, exit );
+    /* Bytes after the last chunk belong to the next message */
+    if( inHeader->chunkState == kChunkDone ){
+      inHeader->nextDataPtr = inHeader->chunkedDataBufferPtr + used;
+      inHeader->nextDataLen = (size_t)readResult - used;
+    }
+  }
+  else if(inHeader->isCallbackSupported == true){
+    /* We has extra data, and we give these data to application by onReceivedDataCallback function */
+    readLength = inHeader->contentLength - inHeader->extraDataLen > READ_LENGTH? READ_LENGTH:inHeader->contentLength - inHeader->extraDataLen;
+    readResult = read( inSock,
+                      (uint8_t*)( inHeader->extraDataPtr),
+                      readLength );
+    
+    if( readResult  > 0 ) inHeader->extraDataLen += readResult;
+    else { err = kConnectionErr; goto exit; }      
+    (inHeader->onReceivedDataCallback)(inHeader, inHeader->extraDataLen - readResult, (uint8_t *)inHeader->extraDataPtr, readResult, inHeader->userContext);
+  }else{
+    /* We has extra data and we has a predefined buffer to store the total extra data return when all data has received*/
+    readResult = read( inSock,
+                      (uint8_t*)( inHeader->extraDataPtr + inHeader->extraDataLen ),
+                      ( inHeader->contentLength - inHeader->extraDataLen ) );
+    
+    if( readResult  > 0 ) inHeader->extraDataLen += readResult;
+    else { err = kConnectionErr; goto exit; }
+  }
+
+exit:
+  return err;
+}
+
 OSStatus SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader )
 {
   OSStatus err = kParamErr;
-  ssize_t readResult;
   int selectResult;
   fd_set readSet;
-  size_t    lastChunkLen, chunckheaderLen; 
-  char *nextPackagePtr;
   struct timeval_t t;
-  size_t          readLength;
-  uint32_t pos = 0;
   t.tv_sec = 5;
   t.tv_usec = 0;
   
@@ -184,134 +441,6 @@ OSStatus SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader )
   FD_ZERO( &readSet );
   FD_SET( inSock, &readSet );
 
-  /* Chunked data without content length */
-  if( inHeader->chunkedData == true ){
-    do{
-      /* Find Chunk data length */
-      while ( findChunkedDataLength( inHeader->chunkedDataBufferPtr, inHeader->extraDataLen, &inHeader->extraDataPtr ,"%llu", &inHeader->contentLength ) == false){
-        require_action(inHeader->extraDataLen < inHeader->chunkedDataBufferLen, exit, err=kMalformedErr );
-
-        selectResult = select( inSock + 1, &readSet, NULL, NULL, NULL );
-        require_action( selectResult >= 1, exit, err = kNotReadableErr );
-
-        readResult = read( inSock, inHeader->chunkedDataBufferPtr + inHeader->extraDataLen, (size_t)( inHeader->chunkedDataBufferLen - inHeader->extraDataLen ) );
-
-        if( readResult  > 0 ) inHeader->extraDataLen += readResult;
-        else { err = kConnectionErr; goto exit; }
-      }
-
-      chunckheaderLen = inHeader->extraDataPtr - inHeader->chunkedDataBufferPtr;
-
-      /* Check the last chunk */
-      if(inHeader->contentLength == 0){ 
-        while( findCRLF( inHeader->extraDataPtr, inHeader->extraDataLen - chunckheaderLen, &nextPackagePtr ) == false){ //find CRLF
-          selectResult = select( inSock + 1, &readSet, NULL, NULL, NULL );
-          require_action( selectResult >= 1, exit, err = kNotReadableErr );
-
-          readResult = read( inSock,
-                            (uint8_t *)( inHeader->extraDataPtr + inHeader->extraDataLen - chunckheaderLen ),
-                            256 - inHeader->extraDataLen ); //Assume chunk trailer length is less than 256 (256 is the min chunk buffer, maybe dangerous
-
-          if( readResult  > 0 ) inHeader->extraDataLen += readResult;
-          else { err = kConnectionErr; goto exit; }
-          (inHeader->onReceivedDataCallback)(inHeader, inHeader->extraDataLen - readResult, (uint8_t *)inHeader->extraDataPtr, readResult, inHeader->userContext);
-        }
-
-        err = kNoErr;
-        goto exit;
-      } 
-      else{ // Read chunk data
-        /* Chunk package already exist, callback, move to buffer's head */
-        if( inHeader->extraDataLen >= inHeader->contentLength + chunckheaderLen + 2 ){
-          require_action( *(inHeader->extraDataPtr + inHeader->contentLength ) == '\r' &&
-                          *(inHeader->extraDataPtr + inHeader->contentLength + 1 ) == '\n', 
-                          exit, err = kMalformedErr);
-
-          (inHeader->onReceivedDataCallback)(inHeader,  pos, 
-                                                        (uint8_t *)inHeader->extraDataPtr, 
-                                                        inHeader->contentLength, 
-                                                        inHeader->userContext);
-          pos+=inHeader->contentLength;
-
-          /* Move next chunk to chunked data buffer header point */
-          lastChunkLen = inHeader->extraDataPtr - inHeader->chunkedDataBufferPtr + inHeader->contentLength;
-          if(inHeader->contentLength) lastChunkLen += 2;  //Last chunck data has a CRLF tail
-          memmove( inHeader->chunkedDataBufferPtr, inHeader->chunkedDataBufferPtr + lastChunkLen, inHeader->chunkedDataBufferLen - lastChunkLen  );
-          inHeader->extraDataLen -= lastChunkLen;
-        }
-        /* Chunck exist without the last LF, generate callback abd recv LF */
-        /* Callback , read LF */
-        else if(inHeader->extraDataLen == inHeader->contentLength + chunckheaderLen +1){ //recv CR 
-
-          require_action( *(inHeader->chunkedDataBufferPtr + inHeader->extraDataLen - 1) == '\r' ,
-                          exit, err = kMalformedErr);
-
-          (inHeader->onReceivedDataCallback)(inHeader,  pos, 
-                                                        (uint8_t *)inHeader->extraDataPtr, 
-                                                        inHeader->extraDataLen - chunckheaderLen-1, 
-                                                        inHeader->userContext);
-          pos+=inHeader->extraDataLen - chunckheaderLen-1;
-          selectResult = select( inSock + 1, &readSet, NULL, NULL, NULL );
-          require_action( selectResult >= 1, exit, err = kNotReadableErr );
-
-          readResult = read( inSock, (uint8_t *)inHeader->extraDataPtr, 1);
-
-          if( readResult  > 0 ) {}
-          else { err = kConnectionErr; goto exit; }
-
-          require_action( *(inHeader->extraDataPtr) == '\n', exit, err = kMalformedErr);
-          inHeader->extraDataLen = 0;
-        }
-        else{
-          /* Callback , read , callback , read CRLF */
-          (inHeader->onReceivedDataCallback)(inHeader, pos, 
-                                                       (uint8_t *)inHeader->extraDataPtr, 
-                                                       inHeader->extraDataLen - chunckheaderLen, 
-                                                       inHeader->userContext);
-          pos += inHeader->extraDataLen - chunckheaderLen;
-
-          while ( inHeader->extraDataLen < inHeader->contentLength + chunckheaderLen  ){
-            selectResult = select( inSock + 1, &readSet, NULL, NULL, NULL );
-            require_action( selectResult >= 1, exit, err = kNotReadableErr );
-
-            if( inHeader->contentLength - (inHeader->extraDataLen - chunckheaderLen) > inHeader->chunkedDataBufferLen - chunckheaderLen)
-              //Data needed is greater than valid buffer size
-              readLength = inHeader->chunkedDataBufferLen - chunckheaderLen; 
-            else
-              //Data needed is less than valid buffer size
-              readLength = inHeader->contentLength - (inHeader->extraDataLen - chunckheaderLen) ; 
-
-            readResult = read( inSock, (uint8_t *)inHeader->extraDataPtr, readLength);
-            
-            if( readResult  > 0 ) inHeader->extraDataLen += readResult;
-            else { err = kConnectionErr; goto exit; }
-
-            (inHeader->onReceivedDataCallback)(inHeader, pos, 
-                                                         (uint8_t *)inHeader->extraDataPtr, 
-                                                         readResult, 
-                                                         inHeader->userContext);
-            pos += readResult;
-          } 
-
-          selectResult = select( inSock + 1, &readSet, NULL, NULL, NULL );
-          require_action( selectResult >= 1, exit, err = kNotReadableErr );
-
-          readResult = read( inSock, (uint8_t *)inHeader->extraDataPtr, 2);
-
-          if( readResult  > 0 ) {}
-          else { err = kConnectionErr; goto exit; }
-
-
-          require_action( *(inHeader->extraDataPtr) == '\r' &&
-                          *(inHeader->extraDataPtr+1 ) == '\n', 
-                          exit, err = kMalformedErr);
-
-          inHeader->extraDataLen = 0;
-        }
-      }
-    }while(inHeader->contentLength != 0);
-  }
-
   /* We has extra data but total length is not clear, store them to 1500 bytes buffer 
      return when connection is disconnected by remote server */
   // if( inHeader->dataEndedbyClose == true){ 
@@ -332,30 +461,13 @@ OSStatus SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader )
   // }
   
 
-  while ( inHeader->extraDataLen < inHeader->contentLength )
+  while ( !HTTPBodyComplete( inHeader ) )
   {
     selectResult = select( inSock + 1, &readSet, NULL, NULL, &t );
     require_action( selectResult >= 1, exit, err = kNotReadableErr );
 
-    if(inHeader->isCallbackSupported == true){
-      /* We has extra data, and we give these data to application by onReceivedDataCallback function */
-      readLength = inHeader->contentLength - inHeader->extraDataLen > READ_LENGTH? READ_LENGTH:inHeader->contentLength - inHeader->extraDataLen;
-      readResult = read( inSock,
-                        (uint8_t*)( inHeader->extraDataPtr),
-                        readLength );
-      
-      if( readResult  > 0 ) inHeader->extraDataLen += readResult;
-      else { err = kConnectionErr; goto exit; }      
-      (inHeader->onReceivedDataCallback)(inHeader, inHeader->extraDataLen - readResult, (uint8_t *)inHeader->extraDataPtr, readResult, inHeader->userContext);
-    }else{
-      /* We has extra data and we has a predefined buffer to store the total extra data return when all data has received*/
-      readResult = read( inSock,
-                        (uint8_t*)( inHeader->extraDataPtr + inHeader->extraDataLen ),
-                        ( inHeader->contentLength - inHeader->extraDataLen ) );
-      
-      if( readResult  > 0 ) inHeader->extraDataLen += readResult;
-      else { err = kConnectionErr; goto exit; }
-    }
+    err = SocketReadHTTPBodyOnce( inSock, inHeader );
+    require_noerr( err, exit );
   }
   err = kNoErr;
   
@@ -364,6 +476,64 @@ exit:
   return err;
 }
 
+//===========================================================================================================================
+//  HTTPReadBufferedMessage
+//
+//  Parses the bytes already in the header buffer, e.g. those of the next message left by HTTPHeaderClear. Returns
+//  kNoErr when a whole message is in, kInProgressErr if more has to be read first.
+//===========================================================================================================================
+
+OSStatus HTTPReadBufferedMessage( HTTPHeader_t *inHeader )
+{
+  OSStatus        err;
+  char *          end;
+  
+  if( inHeader->scanState != kScanBody )
+  {
+    if( !findHeader( inHeader, &end ) )
+      return ( inHeader->len < sizeof( inHeader->buf ) ) ? kInProgressErr : kNoSpaceErr;
+    err = HTTPHeaderReceived( inHeader, end );
+    require_noerr( err, exit );
+  }
+  err = HTTPBodyComplete( inHeader ) ? kNoErr : kInProgressErr;
+  
+exit:
+  return err;
+}
+
+//===========================================================================================================================
+//  SocketReadHTTPMessage
+//
+//  Reads once from a socket that select found readable and parses what came, so one thread can serve many sockets
+//  without blocking on any. Returns as HTTPReadBufferedMessage, or kConnectionErr if the socket was closed.
+//===========================================================================================================================
+
+OSStatus SocketReadHTTPMessage( int inSock, HTTPHeader_t *inHeader )
+{
+  OSStatus        err;
+  ssize_t         n;
+  
+  if( inHeader->scanState == kScanBody )
+  {
+    if( !HTTPBodyComplete( inHeader ) )
+    {
+      err = SocketReadHTTPBodyOnce( inSock, inHeader );
+      require_noerr( err, exit );
+    }
+  }
+  else
+  {
+    require_action( inHeader->len < sizeof( inHeader->buf ), exit, err = kNoSpaceErr );
+    n = read( inSock, inHeader->buf + inHeader->len, sizeof( inHeader->buf ) - inHeader->len );
+    require_action( n > 0, exit, err = kConnectionErr );
+    inHeader->len += (size_t) n;
+  }
+  err = HTTPReadBufferedMessage( inHeader );
+  
+exit:
+  return err;
+}
+
 //===========================================================================================================================
 //  HTTPHeader_Parse
 //
@@ -383,6 +553,18 @@ OSStatus HTTPHeaderParse( HTTPHeader_t *ioHeader )
   
   require_action( ioHeader->len < sizeof( ioHeader->buf ), exit, err = kParamErr );
   
+  // Index the header fields if findHeader has not done it for this header.
+  if( ( ioHeader->scanState < kScanDone ) || ( ioHeader->scanLen != ioHeader->len ) )
+  {
+    char *end;
+    ioHeader->scanLen = 0;
+    ioHeader->scanLineStart = 0;
+    ioHeader->scanColon = 0;
+    ioHeader->scanState = kScanInLine;
+    ioHeader->fieldCount = 0;
+    findHeader( ioHeader, &end );
+  }
+  
   // Reset fields up-front to good defaults to simplify handling of unused fields later.
   
   ioHeader->methodPtr         = "";
@@ -483,16 +665,20 @@ OSStatus HTTPHeaderParse( HTTPHeader_t *ioHeader )
   require_action( ptr < end, exit, err = kMalformedErr );
   
   // Determine persistence. Note: HTTP 1.0 defaults to non-persistent if a Connection header field is not present.
-  err = HTTPGetHeaderField( ioHeader->buf, ioHeader->len, "Connection", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( ioHeader, "Connection", &value, &valueSize );
   if( err )   ioHeader->persistent = (Boolean)( strnicmpx( ioHeader->protocolPtr, ioHeader->protocolLen, "HTTP/1.0" ) != 0 );
   else        ioHeader->persistent = (Boolean)( strnicmpx( value, valueSize, "close" ) != 0 );
 
-  err = HTTPGetHeaderField( ioHeader->buf, ioHeader->len, "Transfer-Encoding", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( ioHeader, "Transfer-Encoding", &value, &valueSize );
   if( err )   ioHeader->chunkedData = false;
   else        ioHeader->chunkedData = (Boolean)( strnicmpx( value, valueSize, kTransferrEncodingType_CHUNKED ) == 0 );
   
   // Content-Length is such a common field that we get it here during general parsing.
-  HTTPScanFHeaderValue( ioHeader->buf, ioHeader->len, "Content-Length", "%llu", &ioHeader->contentLength );
+  if( HTTPHeaderGetField( ioHeader, "Content-Length", &value, &valueSize ) == kNoErr )
+  {
+    for( ptr = value; ( ptr < value + valueSize ) && ( ( c = *ptr ) >= '0' ) && ( c <= '9' ); ++ptr )
+      ioHeader->contentLength = ( ioHeader->contentLength * 10 ) + ( c - '0' );
+  }
 
   err = kNoErr;
   
@@ -662,6 +848,33 @@ exit:
   return( n );
 }
 
+//===========================================================================================================================
+//  HTTPHeaderGetField
+//
+//  Finds a header field by name in the index made while the header was read, without scanning the header again.
+//===========================================================================================================================
+
+OSStatus HTTPHeaderGetField( HTTPHeader_t *inHeader, const char *inName, const char **outValuePtr, size_t *outValueLen )
+{
+  const HTTPHeaderField_t *   field;
+  int                         i;
+  
+  if( ( inHeader->scanState < kScanDone ) || ( inHeader->fieldCount > kHTTPHeaderMaxFields ) )
+    return HTTPGetHeaderField( inHeader->buf, inHeader->len, inName, NULL, NULL, outValuePtr, outValueLen, NULL );
+  
+  for( i = 0; i < inHeader->fieldCount; ++i )
+  {
+    field = &inHeader->fields[ i ];
+    if( strnicmpx( inHeader->buf + field->nameOff, field->nameLen, inName ) == 0 )
+    {
+      if( outValuePtr ) *outValuePtr = inHeader->buf + field->valueOff;
+      if( outValueLen ) *outValueLen = field->valueLen;
+      return kNoErr;
+    }
+  }
+  return kNotFoundErr;
+}
+
 OSStatus HTTPHeaderMatchMethod( HTTPHeader_t *inHeader, const char *method )
 {
   if( strnicmpx( inHeader->methodPtr, inHeader->methodLen, method ) == 0 )
@@ -703,50 +916,36 @@ HTTPHeader_t * HTTPHeaderCreateWithCallback( onReceivedDataCallback inRecvFunc,
 
 void HTTPHeaderClear( HTTPHeader_t *inHeader )
 {
-  char *nextPackagePtr;
-  size_t chunckheaderLen = inHeader->extraDataPtr - inHeader->chunkedDataBufferPtr;
-
   if(inHeader->onClearCallback)
     (inHeader->onClearCallback)(inHeader, inHeader->userContext);
 
-  if(inHeader->chunkedData && (uint32_t *)inHeader->chunkedDataBufferPtr){ //chunk data
-    /* Possible to read the header of the next http package */
-    if(findCRLF( inHeader->extraDataPtr, inHeader->extraDataLen - chunckheaderLen, &nextPackagePtr ) ){
-      if( nextPackagePtr <= inHeader->chunkedDataBufferPtr + inHeader->extraDataLen ){ //We get some data belongs to next http package
-        inHeader->len = inHeader->extraDataLen - (nextPackagePtr - inHeader->chunkedDataBufferPtr);
-        if(inHeader->len > 512)
-          inHeader->len = 0;
-        else
-          memcpy(inHeader->buf, nextPackagePtr, inHeader->len);
-      } else
-        inHeader->len = 0;
-    }
-
-    inHeader->extraDataLen = 0;
+  /* We get some data belongs to next http package, move it to the head of the header buffer */
+  if( inHeader->nextDataPtr && inHeader->nextDataLen <= sizeof( inHeader->buf ) ){
+    inHeader->len = inHeader->nextDataLen;
+    memmove(inHeader->buf, inHeader->nextDataPtr, inHeader->len);
+  } else
+    inHeader->len = 0;
+  inHeader->nextDataPtr = NULL;
+  inHeader->nextDataLen = 0;
+
+  inHeader->extraDataLen = 0;
+  if((uint32_t *)inHeader->extraDataPtr) {
+    free((uint32_t *)inHeader->extraDataPtr);
+    inHeader->extraDataPtr = NULL;
+  } 
+  if((uint32_t *)inHeader->chunkedDataBufferPtr){
     free((uint32_t *)inHeader->chunkedDataBufferPtr);
-    inHeader->chunkedDataBufferPtr = NULL;   
-    inHeader->extraDataPtr = NULL;   
-    inHeader->chunkedData = false;
-  }else{
-
-    /* We get some data belongs to next http package, this only could happen two or more
-      packages are received by SocketReadHTTPHeader */ 
-    if( inHeader->extraDataLen > inHeader->contentLength ){ 
-      inHeader->len = inHeader->extraDataLen - inHeader->contentLength;
-      memcpy(inHeader->buf, inHeader->extraDataPtr + inHeader->contentLength, inHeader->len);
-    } else
-      inHeader->len = 0;
-
-    inHeader->extraDataLen = 0;
-    if((uint32_t *)inHeader->extraDataPtr) {
-      free((uint32_t *)inHeader->extraDataPtr);
-      inHeader->extraDataPtr = NULL;
-    } 
-    inHeader->dataEndedbyClose = false;
+    inHeader->chunkedDataBufferPtr = NULL;
   }
-
+  inHeader->chunkedData = false;
+  inHeader->dataEndedbyClose = false;
   inHeader->isCallbackSupported = false;
 
+  inHeader->scanLen = 0;
+  inHeader->scanLineStart = 0;
+  inHeader->scanColon = 0;
+  inHeader->scanState = kScanInLine;
+  inHeader->fieldCount = 0;
 }
 
 OSStatus CreateSimpleHTTPOKMessage( uint8_t **outMessage, size_t *outMessageSize )
@@ -835,6 +1034,8 @@ char * getStatusString(int status)
     return "No Content";
   else if(status == kStatusPartialContent)
     return "Multi0Status";
+  else if(status == kStatusNotModified)
+    return "Not Modified";
   else if(status == kStatusBadRequest)
     return "Bad Request";
   else if(status == kStatusNotFound)
@@ -843,10 +1044,16 @@ char * getStatusString(int status)
     return "Not Allowed";
   else if(status == kStatusForbidden) 
     return "Forbidden";
+  else if(status == kStatusLengthRequired)
+    return "Length Required";
+  else if(status == kStatusPayloadTooLarge)
+    return "Payload Too Large";
   else if(status == kStatusAuthenticationErr)
     return "Authentication Error";
   else if(status == kStatusInternalServerErr)
     return "Internal Server Error";
+  else if(status == kStatusServiceUnavailable)
+    return "Service Unavailable";
   else
     return "OK";
 }
@@ -62,12 +62,16 @@
 #define kStatusOK                   200
 #define kStatusNoConetnt            204
 #define kStatusPartialContent       206
+#define kStatusNotModified          304
 #define kStatusBadRequest           400
 #define kStatusNotFound             404
 #define kStatusMethodNotAllowed     405
 #define kStatusForbidden            403  
+#define kStatusLengthRequired       411
+#define kStatusPayloadTooLarge      413
 #define kStatusAuthenticationErr    470  
 #define kStatusInternalServerErr    500      
+#define kStatusServiceUnavailable   503
 
 #define kMIMEType_Binary                "application/octet-stream"
 #define kMIMEType_DMAP                  "application/x-dmap-tagged"
@@ -85,6 +89,16 @@
 
 #define OTA_Data_Length_per_read        1024
 
+#define kHTTPHeaderMaxFields            16  //! Header fields indexed by the parser, more are found by scanning.
+
+typedef struct
+{
+    uint16_t            nameOff;            //! Offsets into buf.
+    uint16_t            nameLen;
+    uint16_t            valueOff;
+    uint16_t            valueLen;
+} HTTPHeaderField_t;
+
 
 typedef struct _HTTPHeader_t
 {
@@ -115,6 +129,19 @@ typedef struct _HTTPHeader_t
     bool                chunkedData;        //! true=Application should read the next chunked data.
     char *              chunkedDataBufferPtr;     //! Ptr for any extra data beyond the header, it is alloced when http header is received.
     size_t              chunkedDataBufferLen; //! Total buffer length that stores the chunkedData, private use only
+    uint32_t            chunkRemain;        //! Bytes left in the current chunk, private use only
+    uint32_t            chunkPos;           //! Chunk data bytes given to the callback, private use only
+    uint8_t             chunkState;         //! Chunked body parser state, private use only
+
+    char *              nextDataPtr;        //! Bytes of the next message read along with this one, moved to buf by HTTPHeaderClear.
+    size_t              nextDataLen;
+
+    uint16_t            scanLen;            //! Bytes of buf looked at by findHeader, it goes on from here after a read.
+    uint16_t            scanLineStart;      //! Header scanner state, private use only
+    uint16_t            scanColon;
+    uint8_t             scanState;
+    uint8_t             fieldCount;         //! Fields in fields[], kHTTPHeaderMaxFields+1 if there were more.
+    HTTPHeaderField_t   fields[ kHTTPHeaderMaxFields ];
 
     void *              userContext;
     bool                isCallbackSupported;
@@ -143,10 +170,16 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader );
 
 int SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader );
 
+int SocketReadHTTPMessage( int inSock, HTTPHeader_t *inHeader );
+
+int HTTPReadBufferedMessage( HTTPHeader_t *inHeader );
+
 int HTTPHeaderParse( HTTPHeader_t *ioHeader );
 
 int HTTPHeaderMatchMethod( HTTPHeader_t *inHeader, const char *method );
 
+int HTTPHeaderGetField( HTTPHeader_t *inHeader, const char *inName, const char **outValuePtr, size_t *outValueLen );
+
 int HTTPHeaderMatchURL( HTTPHeader_t *inHeader, const char *url );
 
 char* HTTPHeaderMatchPartialURL( HTTPHeader_t *inHeader, const char *url );
@@ -167,6 +200,8 @@ HTTPHeader_t * HTTPHeaderCreateWithCallback( onReceivedDataCallback , onClearCal
 
 void HTTPHeaderClear( HTTPHeader_t *inHeader );
 
+char * getStatusString( int status );
+
 int CreateSimpleHTTPOKMessage( uint8_t **outMessage, size_t *outMessageSize );
 
 OSStatus CreateSimpleHTTPMessage      ( const char *contentType, uint8_t *inData, size_t inDataLen, uint8_t **outMessage, size_t *outMessageSize );
@@ -0,0 +1,454 @@
+/**
+******************************************************************************
+* @file    KVStoreUtils.c
+* @author  WiFiMCU Team
+* @version V1.0.0
+* @date    19-Oct-2026
+* @brief   This file contains the key/value store kept as a journal in two
+  flash sectors.
+******************************************************************************
+* <h2><center>&copy; COPYRIGHT 2026 WiFiMCU Team</center></h2>
+******************************************************************************
+*/
+
+#include "KVStoreUtils.h"
+#include "CRCUtils.h"
+#include "MICORTOS.h"
+#include "MicoPlatform.h"
+#include "platform_config.h"
+
+// Each sector starts with kv_sector_t, the valid one with the highest
+// sequence is active. Records follow it, 4 byte aligned, until the first
+// erased one. A sector takes over only once its header is written, after all
+// records were copied to it.
+#define KV_SECTOR_SIZE          4096
+#define KV_MAGIC                0x31564B4D  // "MKV1"
+#define KV_REMOVED              0xFFFF      // valueLength of a removed key
+#define KV_ALIGN( X )           ( ( (X) + 3 ) & ~3U )
+
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    sequence;
+
+}   kv_sector_t;
+
+// CRC-32 of keyLength, valueLength, the key and the value
+typedef struct
+{
+    uint16_t    keyLength;
+    uint16_t    valueLength;
+    uint32_t    crc;
+
+}   kv_record_t;
+
+static mico_mutex_t     gKVMutex        = NULL;
+static bool             gKVMounted      = false;
+static bool             gKVDirty        = false;    // the journal ends in a damaged record
+static uint32_t         gKVSector       = 0;
+static uint32_t         gKVSequence     = 0;
+static uint32_t         gKVEnd          = 0;
+
+//===========================================================================================================================
+//	Flash
+//===========================================================================================================================
+
+static OSStatus _KVRead( uint32_t inAddress, void *outData, uint32_t inLen )
+{
+    return MicoFlashRead( MICO_FLASH_FOR_KV, &inAddress, (uint8_t *) outData, inLen );
+}
+
+static OSStatus _KVWrite( uint32_t inAddress, const void *inData, uint32_t inLen )
+{
+    return MicoFlashWrite( MICO_FLASH_FOR_KV, &inAddress, (uint8_t *) inData, inLen );
+}
+
+// Bytes of key and value following the record header
+static uint32_t _KVDataLength( const kv_record_t *inRecord )
+{
+    if( inRecord->valueLength == KV_REMOVED ) return( inRecord->keyLength );
+    return( (uint32_t) inRecord->keyLength + inRecord->valueLength );
+}
+
+static uint32_t _KVRecordLength( const kv_record_t *inRecord )
+{
+    return( KV_ALIGN( sizeof( kv_record_t ) + _KVDataLength( inRecord ) ) );
+}
+
+// Compares inLen bytes of flash with inData, or sums them into ioCRC when inData is NULL
+static OSStatus _KVScan( uint32_t inAddress, const uint8_t *inData, uint32_t inLen, uint32_t *ioCRC, bool *outSame )
+{
+    OSStatus        err = kNoErr;
+    uint8_t         buf[ 64 ];
+    uint32_t        len;
+
+    if( outSame ) *outSame = true;
+    while( inLen > 0 )
+    {
+        len = ( inLen > sizeof( buf ) ) ? sizeof( buf ) : inLen;
+        err = _KVRead( inAddress, buf, len );
+        require_noerr( err, exit );
+        if( inData )
+        {
+            if( memcmp( buf, inData, len ) != 0 )
+            {
+                *outSame = false;
+                goto exit;
+            }
+            inData += len;
+        }
+        else
+        {
+            *ioCRC = CRC32_Update( *ioCRC, buf, len );
+        }
+        inAddress += len;
+        inLen -= len;
+    }
+
+exit:
+    return( err );
+}
+
+//===========================================================================================================================
+//	Journal
+//===========================================================================================================================
+
+// kNotFoundErr at the erased end of the journal, kChecksumErr for a damaged record
+static OSStatus _KVCheckRecord( uint32_t inAddress, kv_record_t *outRecord )
+{
+    OSStatus        err;
+    uint32_t        crc;
+
+    err = _KVRead( inAddress, outRecord, sizeof( kv_record_t ) );
+    require_noerr( err, exit );
+    require_action_quiet( outRecord->keyLength != 0xFFFF, exit, err = kNotFoundErr );
+
+    require_action_quiet( outRecord->keyLength > 0 && outRecord->keyLength <= KV_STORE_KEY_MAX, exit, err = kChecksumErr );
+    require_action_quiet( outRecord->valueLength <= KV_STORE_VALUE_MAX || outRecord->valueLength == KV_REMOVED, exit, err = kChecksumErr );
+    require_action_quiet( inAddress + _KVRecordLength( outRecord ) <= gKVSector + KV_SECTOR_SIZE, exit, err = kChecksumErr );
+
+    crc = CRC32_Update( 0, outRecord, 4 );
+    err = _KVScan( inAddress + sizeof( kv_record_t ), NULL, _KVDataLength( outRecord ), &crc, NULL );
+    require_noerr( err, exit );
+    require_action_quiet( crc == outRecord->crc, exit, err = kChecksumErr );
+
+exit:
+    return( err );
+}
+
+static OSStatus _KVMount( void )
+{
+    OSStatus        err = kNoErr;
+    kv_sector_t     sector[ 2 ];
+    kv_record_t     record;
+    int             i, active = -1;
+
+#ifdef KV_BOOTLOADER_REVISION
+    // the sectors are in the update partition of older bootloaders, which erase it at boot
+    require_action_quiet( mico_bootloader_is_at_least( KV_BOOTLOADER_REVISION ), exit, err = kUnsupportedErr );
+#endif
+
+    for( i = 0; i < 2; ++i )
+    {
+        err = _KVRead( KV_START_ADDRESS + i * KV_SECTOR_SIZE, &sector[ i ], sizeof( kv_sector_t ) );
+        require_noerr( err, exit );
+        if( sector[ i ].magic != KV_MAGIC ) continue;
+        if( active < 0 || sector[ i ].sequence > sector[ active ].sequence ) active = i;
+    }
+    if( active < 0 )
+    {
+        active = 0;
+        sector[ 0 ].magic = KV_MAGIC;
+        sector[ 0 ].sequence = 1;
+        err = MicoFlashErase( MICO_FLASH_FOR_KV, KV_START_ADDRESS, KV_START_ADDRESS + KV_SECTOR_SIZE - 1 );
+        require_noerr( err, exit );
+        err = _KVWrite( KV_START_ADDRESS, &sector[ 0 ], sizeof( kv_sector_t ) );
+        require_noerr( err, exit );
+    }
+
+    gKVSector   = KV_START_ADDRESS + active * KV_SECTOR_SIZE;
+    gKVSequence = sector[ active ].sequence;
+    gKVEnd      = gKVSector + sizeof( kv_sector_t );
+    gKVDirty    = false;
+    while( gKVEnd + sizeof( kv_record_t ) <= gKVSector + KV_SECTOR_SIZE )
+    {
+        err = _KVCheckRecord( gKVEnd, &record );
+        if( err == kNotFoundErr ) break;
+        if( err == kChecksumErr )
+        {
+            gKVDirty = true;
+            break;
+        }
+        require_noerr( err, exit );
+        gKVEnd += _KVRecordLength( &record );
+    }
+    err = kNoErr;
+    gKVMounted = true;
+
+exit:
+    return( err );
+}
+
+// Address of the latest record of a key, 0 when there is none
+static OSStatus _KVFind( const char *inKey, uint32_t *outAddress, kv_record_t *outRecord )
+{
+    OSStatus        err = kNoErr;
+    kv_record_t     record;
+    uint32_t        address;
+    size_t          keyLen = strlen( inKey );
+    bool            same;
+
+    *outAddress = 0;
+    for( address = gKVSector + sizeof( kv_sector_t ); address < gKVEnd; address += _KVRecordLength( &record ) )
+    {
+        err = _KVRead( address, &record, sizeof( kv_record_t ) );
+        require_noerr( err, exit );
+        if( record.keyLength != keyLen ) continue;
+        err = _KVScan( address + sizeof( kv_record_t ), (const uint8_t *) inKey, keyLen, NULL, &same );
+        require_noerr( err, exit );
+        if( !same ) continue;
+        *outAddress = address;
+        *outRecord = record;
+    }
+
+exit:
+    return( err );
+}
+
+// Whether the record at inOffset of a sector image is the latest one of its key
+static bool _KVIsLatest( const uint8_t *inImage, uint32_t inOffset, uint32_t inEnd )
+{
+    const kv_record_t * record = (const kv_record_t *)( inImage + inOffset );
+    const kv_record_t * later;
+    uint32_t            offset;
+
+    for( offset = inOffset + _KVRecordLength( record ); offset < inEnd; offset += _KVRecordLength( later ) )
+    {
+        later = (const kv_record_t *)( inImage + offset );
+        if( ( later->keyLength == record->keyLength ) &&
+            ( memcmp( later + 1, record + 1, record->keyLength ) == 0 ) ) return( false );
+    }
+    return( true );
+}
+
+static OSStatus _KVWriteRecord( uint32_t inAddress, const kv_record_t *inRecord, const char *inKey, const void *inValue )
+{
+    OSStatus        err;
+
+    err = _KVWrite( inAddress, inRecord, sizeof( kv_record_t ) );
+    require_noerr( err, exit );
+    inAddress += sizeof( kv_record_t );
+    err = _KVWrite( inAddress, inKey, inRecord->keyLength );
+    require_noerr( err, exit );
+    inAddress += inRecord->keyLength;
+    if( inRecord->valueLength != KV_REMOVED && inRecord->valueLength > 0 )
+    {
+        err = _KVWrite( inAddress, inValue, inRecord->valueLength );
+        require_noerr( err, exit );
+    }
+
+exit:
+    return( err );
+}
+
+// Copies the latest record of each other key and then inRecord to the other
+// sector and makes it active. A removed key is dropped. kNoSpaceErr, before
+// anything is erased, when that does not fit in a sector.
+static OSStatus _KVCompact( const char *inKey, const kv_record_t *inRecord, const void *inValue )
+{
+    OSStatus            err;
+    uint8_t *           image;
+    uint32_t            other, out, in, end, size;
+    const kv_record_t * record;
+    kv_sector_t         sector;
+
+    image = (uint8_t *) malloc( KV_SECTOR_SIZE );
+    require_action( image, exit, err = kNoMemoryErr );
+    err = _KVRead( gKVSector, image, KV_SECTOR_SIZE );
+    require_noerr( err, exit );
+
+    // the superseded record of inKey frees its room, the latest record of every other key is kept
+    end = gKVEnd - gKVSector;
+    size = sizeof( kv_sector_t );
+    if( inRecord->valueLength != KV_REMOVED ) size += _KVRecordLength( inRecord );
+    for( in = sizeof( kv_sector_t ); in < end; in += _KVRecordLength( record ) )
+    {
+        record = (const kv_record_t *)( image + in );
+        if( record->valueLength == KV_REMOVED || !_KVIsLatest( image, in, end ) ) continue;
+        if( ( record->keyLength == inRecord->keyLength ) &&
+            ( memcmp( record + 1, inKey, record->keyLength ) == 0 ) ) continue;
+        size += _KVRecordLength( record );
+    }
+    require_action_quiet( size <= KV_SECTOR_SIZE, exit, err = kNoSpaceErr );
+
+    // the magic is cleared first, a sector cut off while being erased does not come back
+    other = ( gKVSector == KV_START_ADDRESS ) ? KV_START_ADDRESS + KV_SECTOR_SIZE : KV_START_ADDRESS;
+    memset( &sector, 0, sizeof( sector ) );
+    err = _KVWrite( other, &sector.magic, sizeof( sector.magic ) );
+    require_noerr( err, exit );
+    err = MicoFlashErase( MICO_FLASH_FOR_KV, other, other + KV_SECTOR_SIZE - 1 );
+    require_noerr( err, exit );
+
+    out = other + sizeof( kv_sector_t );
+    for( in = sizeof( kv_sector_t ); in < end; in += _KVRecordLength( record ) )
+    {
+        record = (const kv_record_t *)( image + in );
+        if( record->valueLength == KV_REMOVED || !_KVIsLatest( image, in, end ) ) continue;
+        if( ( record->keyLength == inRecord->keyLength ) &&
+            ( memcmp( record + 1, inKey, record->keyLength ) == 0 ) ) continue;
+
+        err = _KVWrite( out, record, _KVRecordLength( record ) );
+        require_noerr( err, exit );
+        out += _KVRecordLength( record );
+    }
+    if( inRecord->valueLength != KV_REMOVED )
+    {
+        err = _KVWriteRecord( out, inRecord, inKey, inValue );
+        require_noerr( err, exit );
+        out += _KVRecordLength( inRecord );
+    }
+
+    sector.magic = KV_MAGIC;
+    sector.sequence = gKVSequence + 1;
+    err = _KVWrite( other, &sector, sizeof( sector ) );
+    require_noerr( err, exit );
+
+    gKVSector   = other;
+    gKVSequence = sector.sequence;
+    gKVEnd      = out;
+    gKVDirty    = false;
+
+exit:
+    if( image ) free( image );
+    return( err );
+}
+
+static OSStatus _KVAppend( const char *inKey, const void *inValue, uint16_t inLen )
+{
+    OSStatus        err;
+    kv_record_t     record;
+
+    record.keyLength = (uint16_t) strlen( inKey );
+    record.valueLength = inLen;
+    record.crc = CRC32_Update( 0, &record, 4 );
+    record.crc = CRC32_Update( record.crc, inKey, record.keyLength );
+    if( inLen != KV_REMOVED ) record.crc = CRC32_Update( record.crc, inValue, inLen );
+
+    // the record goes to the other sector together with the live ones when
+    // it does not fit here, a failed compaction leaves this sector as it was
+    if( gKVDirty || ( gKVEnd + _KVRecordLength( &record ) > gKVSector + KV_SECTOR_SIZE ) )
+    {
+        err = _KVCompact( inKey, &record, inValue );
+        goto exit;
+    }
+
+    err = _KVWriteRecord( gKVEnd, &record, inKey, inValue );
+    require_noerr( err, exit );
+    gKVEnd += _KVRecordLength( &record );
+
+exit:
+    // a failed write leaves a damaged record, the next write starts over in the other sector
+    if( err && err != kNoSpaceErr && err != kNoMemoryErr ) gKVDirty = true;
+    return( err );
+}
+
+static OSStatus _KVLock( const char *inKey )
+{
+    OSStatus        err = kNoErr;
+    size_t          keyLen = strlen( inKey );
+
+    require_action( keyLen > 0 && keyLen <= KV_STORE_KEY_MAX, exit, err = kParamErr );
+    require_action( gKVMutex != NULL, exit, err = kNotInitializedErr );
+    mico_rtos_lock_mutex( &gKVMutex );
+    if( !gKVMounted )
+    {
+        err = _KVMount();
+        if( err ) mico_rtos_unlock_mutex( &gKVMutex );
+    }
+
+exit:
+    return( err );
+}
+
+//===========================================================================================================================
+//	API
+//===========================================================================================================================
+
+OSStatus KVStoreInit( void )
+{
+    if( gKVMutex != NULL ) return( kNoErr );
+    return( mico_rtos_init_mutex( &gKVMutex ) );
+}
+
+OSStatus KVStoreGet( const char *inKey, void *outValue, size_t inMaxLen, size_t *outLen )
+{
+    OSStatus        err;
+    kv_record_t     record;
+    uint32_t        address;
+
+    err = _KVLock( inKey );
+    require_noerr( err, exit );
+
+    err = _KVFind( inKey, &address, &record );
+    require_noerr( err, exit_unlock );
+    require_action_quiet( address && record.valueLength != KV_REMOVED, exit_unlock, err = kNotFoundErr );
+
+    if( outLen ) *outLen = record.valueLength;
+    if( record.valueLength > 0 && inMaxLen > 0 )
+    {
+        err = _KVRead( address + sizeof( kv_record_t ) + record.keyLength, outValue,
+                       ( record.valueLength < inMaxLen ) ? record.valueLength : inMaxLen );
+        require_noerr( err, exit_unlock );
+    }
+    if( record.valueLength > inMaxLen ) err = kSizeErr;
+
+exit_unlock:
+    mico_rtos_unlock_mutex( &gKVMutex );
+exit:
+    return( err );
+}
+
+OSStatus KVStoreSet( const char *inKey, const void *inValue, size_t inLen )
+{
+    OSStatus        err;
+    kv_record_t     record;
+    uint32_t        address;
+    bool            same = false;
+
+    require_action( inLen <= KV_STORE_VALUE_MAX, exit, err = kSizeErr );
+    err = _KVLock( inKey );
+    require_noerr( err, exit );
+
+    err = _KVFind( inKey, &address, &record );
+    require_noerr( err, exit_unlock );
+    if( address && record.valueLength == inLen )
+    {
+        err = _KVScan( address + sizeof( kv_record_t ) + record.keyLength, (const uint8_t *) inValue, inLen, NULL, &same );
+        require_noerr( err, exit_unlock );
+    }
+    if( !same ) err = _KVAppend( inKey, inValue, (uint16_t) inLen );
+
+exit_unlock:
+    mico_rtos_unlock_mutex( &gKVMutex );
+exit:
+    return( err );
+}
+
+OSStatus KVStoreRemove( const char *inKey )
+{
+    OSStatus        err;
+    kv_record_t     record;
+    uint32_t        address;
+
+    err = _KVLock( inKey );
+    require_noerr( err, exit );
+
+    err = _KVFind( inKey, &address, &record );
+    require_noerr( err, exit_unlock );
+    if( address && record.valueLength != KV_REMOVED ) err = _KVAppend( inKey, NULL, KV_REMOVED );
+
+exit_unlock:
+    mico_rtos_unlock_mutex( &gKVMutex );
+exit:
+    return( err );
+}
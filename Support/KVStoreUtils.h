@@ -0,0 +1,55 @@
+/**
+******************************************************************************
+* @file    KVStoreUtils.h
+* @author  WiFiMCU Team
+* @version V1.0.0
+* @date    19-Oct-2026
+* @brief   This header contains function prototypes of the key/value store
+  kept as a journal in the two KV flash sectors, see KV_START_ADDRESS in
+  platform_config.h.
+******************************************************************************
+* <h2><center>&copy; COPYRIGHT 2026 WiFiMCU Team</center></h2>
+******************************************************************************
+*/
+
+#ifndef __KVStoreUtils_h__
+#define __KVStoreUtils_h__
+
+#include "Common.h"
+
+// Every write appends a record with its own CRC to the active sector. When
+// that is full, the latest record of each key is copied to the other sector,
+// which takes over once all of them are there. A write cut by a power loss
+// leaves the previous value. With a bootloader older than
+// KV_BOOTLOADER_REVISION every call returns kUnsupportedErr.
+#define KV_STORE_KEY_MAX        32
+#define KV_STORE_VALUE_MAX      1024
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  Creates the lock of the store. Call it once at startup, before any other task can use the store.
+
+    @return The other calls return kNotInitializedErr until it has succeeded.
+*/
+OSStatus    KVStoreInit( void );
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  Reads the value of a key.
+
+    @param  outValue    Receives up to inMaxLen bytes of the value, may be NULL when inMaxLen is 0.
+    @param  outLen      Receives the length of the value, may be NULL.
+
+    @return kNotFoundErr when the key has no value, kSizeErr when the value is longer than inMaxLen.
+*/
+OSStatus    KVStoreGet( const char *inKey, void *outValue, size_t inMaxLen, size_t *outLen );
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  Sets the value of a key, up to KV_STORE_VALUE_MAX bytes. Nothing is written when it is unchanged.
+*/
+OSStatus    KVStoreSet( const char *inKey, const void *inValue, size_t inLen );
+
+//---------------------------------------------------------------------------------------------------------------------------
+/*! @brief  Removes a key. Removing a key that has no value is not an error.
+*/
+OSStatus    KVStoreRemove( const char *inKey );
+
+#endif // __KVStoreUtils_h__
@@ -44,6 +44,24 @@ int SHA1_Update_compat( SHA_CTX_compat *ctx, const void *inData, size_t inLen );
 int SHA1_Final_compat( unsigned char *outDigest, SHA_CTX_compat *ctx );
 unsigned char * SHA1_compat( const void *inData, size_t inLen, unsigned char *outDigest );
 
+//===========================================================================================================================
+//  SHA-256
+//===========================================================================================================================
+
+typedef struct
+{
+    uint64_t        length;
+    uint32_t        state[ 8 ];
+    uint32_t        curlen;
+    uint8_t         buf[ 64 ];
+    
+}   SHA256_CTX_compat;
+
+int SHA256_Init_compat( SHA256_CTX_compat *ctx );
+int SHA256_Update_compat( SHA256_CTX_compat *ctx, const void *inData, size_t inLen );
+int SHA256_Final_compat( unsigned char *outDigest, SHA256_CTX_compat *ctx );
+unsigned char * SHA256_compat( const void *inData, size_t inLen, unsigned char *outDigest );
+
 //===========================================================================================================================
 //  SHA-512
 //===========================================================================================================================
@@ -82,7 +100,8 @@ typedef struct
 
 int SHA3_Init_compat( SHA3_CTX_compat *ctx );
 int SHA3_Update_compat( SHA3_CTX_compat *ctx, const void *inData, size_t inLen );
-int SHA3_Final_compat( unsigned char *outDigest, SHA3_CTX_compat *ctx );
+int SHA3_Final_compat( unsigned char *outDigest, SHA3_CTX_compat *ctx );        // Keccak padding, as submitted.
+int SHA3_512_Final_compat( unsigned char *outDigest, SHA3_CTX_compat *ctx );    // FIPS 202 padding, SHA3-512.
 uint8_t *   SHA3_compat( const void *inData, size_t inLen, uint8_t outDigest[ 64 ] );
 
 #endif // __SHAUtils_h_
@@ -0,0 +1,162 @@
+/**
+ * aesbench.c
+ *
+ * Benchmark of Support/AESUtils.c, prints cycles/byte of ECB, CBC, CTR and
+ * GCM (when the backend has it) for a few message sizes. Build it once per
+ * AES backend and compare the runs.
+ *
+ * host, software AES against OpenSSL's AES_encrypt as the reference:
+ *   INC="-I../include -I../Support -I../Board/MiCOKit-3165 -I../Platform/Cortex-M4"
+ *   gcc -O2 -DAES_UTILS_USE_SOFT_AES=1 $INC -o aesbench aesbench.c ../Support/AESUtils.c
+ *   gcc -O2 -DAES_UTILS_USE_MICO_AES=0 $INC -o aesbench_ssl aesbench.c ../Support/AESUtils.c -lcrypto
+ * Debug.h includes MicoRTOS.h, on a case sensitive file system it needs a
+ * link to include/MICORTOS.h.
+ *
+ * target, software AES against the MICO library: add this file to the
+ * project, call aesbench_run() once the system is up (it prints with
+ * printf, counts with the DWT cycle counter and takes about a second), and
+ * build with and without AES_UTILS_USE_SOFT_AES=1 in the preprocessor
+ * defines.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "AESUtils.h"
+
+#if defined(__ICCARM__) || defined(__arm__)
+#define AESBENCH_TARGET   1
+#else
+#define AESBENCH_TARGET   0
+#endif
+
+#if AESBENCH_TARGET
+#define DEMCR             (*(volatile uint32_t *)0xE000EDFC)
+#define DWT_CTRL          (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT        (*(volatile uint32_t *)0xE0001004)
+#define BENCH_BUF         2048
+#define BENCH_BYTES       (64*1024)   /* per mode and size */
+
+static void cycles_init(void)
+{
+  DEMCR |= 1u << 24;     /* TRCENA */
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 1;         /* CYCCNTENA */
+}
+
+static uint64_t cycles(void) { return DWT_CYCCNT; }  /* 32 bits, 44 s at 96 MHz */
+#else
+#include <time.h>
+#define BENCH_BUF         16384
+#define BENCH_BYTES       (16*1024*1024)
+
+static void cycles_init(void) {}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles(void) { return __rdtsc(); }
+#else
+/* no cycle counter, nanoseconds are printed instead */
+static uint64_t cycles(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+#endif
+
+#if AES_UTILS_USE_SOFT_AES
+#define BACKEND   "soft"
+#elif AES_UTILS_USE_MICO_AES
+#define BACKEND   "mico"
+#else
+#define BACKEND   "openssl"
+#endif
+
+static uint8_t buf[BENCH_BUF];
+static const uint8_t key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const uint8_t iv[16]  = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                                 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff };
+
+enum { MODE_ECB, MODE_CBC, MODE_CTR, MODE_GCM };
+static const char *mode_name[] = { "ECB", "CBC", "CTR", "GCM" };
+
+/* encrypts BENCH_BYTES in messages of len bytes, returns cycles */
+static uint64_t bench(int mode, size_t len)
+{
+  size_t n = BENCH_BYTES / len;
+  uint64_t start;
+  AES_ECB_Context ecb;
+  AES_CBCFrame_Context cbc;
+  AES_CTR_Context ctr;
+#if AES_UTILS_HAS_GCM
+  AES_GCM_Context gcm;
+  uint8_t tag[16];
+#endif
+
+  AES_ECB_Init(&ecb, kAES_ECB_Mode_Encrypt, key);
+  AES_CBCFrame_Init(&cbc, key, iv, true);
+  AES_CTR_Init(&ctr, key, iv);
+#if AES_UTILS_HAS_GCM
+  AES_GCM_Init(&gcm, key, iv);
+#endif
+  start = cycles();
+  while (n-- > 0) {
+    switch (mode) {
+      case MODE_ECB: AES_ECB_Update(&ecb, buf, len, buf); break;
+      case MODE_CBC: AES_CBCFrame_Update(&cbc, buf, len, buf); break;
+      case MODE_CTR: AES_CTR_Update(&ctr, buf, len, buf); break;
+#if AES_UTILS_HAS_GCM
+      case MODE_GCM:
+        AES_GCM_InitMessage(&gcm, kAES_CGM_Nonce_Auto);
+        AES_GCM_AddAAD(&gcm, iv, 13);
+        AES_GCM_Encrypt(&gcm, buf, len, buf);
+        AES_GCM_FinalizeMessage(&gcm, tag);
+        break;
+#endif
+    }
+  }
+  start = cycles() - start;
+  AES_ECB_Final(&ecb);
+  AES_CBCFrame_Final(&cbc);
+  AES_CTR_Final(&ctr);
+#if AES_UTILS_HAS_GCM
+  AES_GCM_Final(&gcm);
+#endif
+  return start;
+}
+
+void aesbench_run(void)
+{
+  static const size_t sizes[] = { 16, 64, 256, 1024, BENCH_BUF };
+#if AES_UTILS_HAS_GCM
+  int modes = 4;
+#else
+  int modes = 3;
+#endif
+
+  cycles_init();
+  memset(buf, 0x5a, sizeof(buf));
+  printf("%-8s %-4s %6s %12s\r\n", "backend", "mode", "bytes", "cycles/byte");
+  for (int m = 0; m < modes; m++) {
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+      size_t len = sizes[i];
+      uint64_t c = bench(m, len);
+      size_t total = BENCH_BYTES / len * len;
+      /* two decimals without printing floats, the target printf has none */
+      uint64_t cpb = c * 100 / total;
+      printf("%-8s %-4s %6u %9u.%02u\r\n", BACKEND, mode_name[m], (unsigned)len,
+             (unsigned)(cpb / 100), (unsigned)(cpb % 100));
+    }
+  }
+}
+
+#if !AESBENCH_TARGET
+int main(void)
+{
+  aesbench_run();
+  return 0;
+}
+#endif
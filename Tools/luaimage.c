@@ -0,0 +1,274 @@
+/**
+ * luaimage.c
+ *
+ * Host tool, compiles Lua scripts into one flash image for WiFiMCU. The
+ * image is uploaded like any other file and written to internal flash by
+ * file.flashload("lua.img"). After the restart, require("name") loads
+ * module name.lua from the image: its code, line info and constant
+ * strings are used from flash instead of being copied to RAM.
+ *
+ * Chunks are compiled for the target, 32 bit little endian with integral
+ * lua_Number; fractional constants are kept as float constants.
+ *
+ * build: gcc -I../lua -o luaimage luaimage.c ../lua/lapi.c ../lua/lcode.c
+ *        ../lua/ldebug.c ../lua/ldo.c ../lua/ldump.c ../lua/legc.c
+ *        ../lua/lfunc.c ../lua/lgc.c ../lua/llex.c ../lua/lmem.c
+ *        ../lua/lobject.c ../lua/lopcodes.c ../lua/lparser.c
+ *        ../lua/lrotable.c ../lua/lstate.c ../lua/lstring.c ../lua/ltable.c
+ *        ../lua/ltm.c ../lua/lundump.c ../lua/lvm.c ../lua/lzio.c -lm
+ * usage: luaimage [-s] [-o lua.img] script.lua ...
+ *        -s strips debug information
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lobject.h"
+#include "lstate.h"
+#include "lundump.h"
+#include "lrotable.h"
+#include "limage.h"
+
+/* same as lua_flash_image() accepts, see LUA_IMAGE_FLASH_SIZE */
+#define IMAGE_MAX_SIZE      (128*1024)
+#define IMAGE_MAX_MODULES   64
+
+/* no rom tables are needed for compiling */
+const luaR_table lua_rotable[] = {{NULL, NULL}};
+
+/* referenced by lrotable.c and lstate.c, lauxlib.c is not linked */
+const char *luaL_checklstring(lua_State *L, int narg, size_t *len) {
+  return lua_tolstring(L, narg, len);
+}
+
+lua_State *luaL_newstate(void) {
+  return NULL;
+}
+
+/* referenced by lvm.c, lbaselib.c is not linked */
+int luaB_index(lua_State *L) {
+  (void)L;
+  return 0;
+}
+
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t alloc;
+} Buffer;
+
+static void buffer_add(Buffer *b, const void *p, size_t size) {
+  if (b->size + size > b->alloc) {
+    b->alloc = (b->size + size) * 2;
+    b->buf = realloc(b->buf, b->alloc);
+    if (b->buf == NULL) {
+      printf("out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(b->buf + b->size, p, size);
+  b->size += size;
+}
+
+static int writer(lua_State *L, const void *p, size_t size, void *u) {
+  (void)L;
+  buffer_add((Buffer *)u, p, size);
+  return 0;
+}
+
+static const char *reader(lua_State *L, void *ud, size_t *size) {
+  Buffer *b = (Buffer *)ud;
+  (void)L;
+  if (size == NULL) return NULL;  /* direct mode check */
+  if (b->size == 0) return NULL;
+  *size = b->size;
+  b->size = 0;
+  return b->buf;
+}
+
+static void *l_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+  (void)ud;
+  (void)osize;
+  if (nsize == 0) {
+    free(ptr);
+    return NULL;
+  }
+  return realloc(ptr, nsize);
+}
+
+static char *read_file(const char *fname, size_t *size) {
+  FILE *f = fopen(fname, "rb");
+  char *s;
+  long len;
+  if (f == NULL) return NULL;
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  s = malloc(len + 1);
+  if (s == NULL || fread(s, 1, len, f) != (size_t)len) {
+    fclose(f);
+    free(s);
+    return NULL;
+  }
+  fclose(f);
+  /* blank out a `#!' line, keeping line numbers */
+  if (len > 0 && s[0] == '#') {
+    long i;
+    for (i = 0; i < len && s[i] != '\n'; i++) s[i] = ' ';
+  }
+  *size = len;
+  return s;
+}
+
+/* module name is the file name without directory and extension */
+static int module_name(const char *fname, char *name) {
+  const char *p = strrchr(fname, '/');
+  const char *dot;
+  size_t len;
+  p = p ? p + 1 : fname;
+  dot = strrchr(p, '.');
+  len = dot ? (size_t)(dot - p) : strlen(p);
+  if (len == 0 || len >= LUA_IMAGE_NAME_LEN) return 0;
+  memset(name, 0, LUA_IMAGE_NAME_LEN);
+  memcpy(name, p, len);
+  return 1;
+}
+
+static uint32_t crc32(uint32_t crc, const unsigned char *p, size_t len) {
+  int i;
+  while (len--) {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : (crc >> 1);
+    }
+  }
+  return crc;
+}
+
+int main(int argc, char **argv) {
+  const char *out = "lua.img";
+  int strip = 0;
+  int i, j, count = 0;
+  LuaImageHeader h;
+  LuaImageEntry e[IMAGE_MAX_MODULES];
+  Buffer chunks = {NULL, 0, 0};
+  Buffer image = {NULL, 0, 0};
+  DumpTargetInfo target;
+  lua_State *L;
+  FILE *f;
+
+  target.little_endian = 1;
+  target.sizeof_int = 4;
+  target.sizeof_strsize_t = 4;
+  target.sizeof_lua_Number = 4;
+  target.lua_Number_integral = 1;
+  target.is_arm_fpa = 0;
+
+  L = lua_newstate(l_alloc, NULL);
+  if (L == NULL) {
+    printf("cannot create lua state\n");
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++) {
+    const char *fname = argv[i];
+    char chunkname[LUA_IMAGE_NAME_LEN + 1];
+    Buffer src;
+    int res;
+    static const char zero[4] = {0};
+
+    if (strcmp(fname, "-s") == 0) {
+      strip = 1;
+      continue;
+    }
+    if (strcmp(fname, "-o") == 0 && i + 1 < argc) {
+      out = argv[++i];
+      continue;
+    }
+    if (count == IMAGE_MAX_MODULES) {
+      printf("too many modules\n");
+      return 1;
+    }
+    if (!module_name(fname, e[count].name)) {
+      printf("%s: module name too long\n", fname);
+      return 1;
+    }
+    for (j = 0; j < count; j++) {
+      if (strcmp(e[j].name, e[count].name) == 0) {
+        printf("%s: module %s given twice\n", fname, e[count].name);
+        return 1;
+      }
+    }
+    src.buf = read_file(fname, &src.size);
+    if (src.buf == NULL) {
+      printf("cannot read %s\n", fname);
+      return 1;
+    }
+    /* chunk name as luaL_loadfile on the target gives it */
+    snprintf(chunkname, sizeof(chunkname), "@%s", e[count].name);
+    if (lua_load(L, reader, &src, chunkname) != 0) {
+      printf("%s\n", lua_tostring(L, -1));
+      return 1;
+    }
+    free(src.buf);
+
+    e[count].offset = chunks.size;
+    res = luaU_dump_crosscompile(L, clvalue(L->top - 1)->l.p, writer,
+        &chunks, strip, target);
+    if (res == LUA_ERR_CC_INTOVERFLOW) {
+      printf("%s: value too big or small for target integer type\n", fname);
+      return 1;
+    }
+    if (res == LUA_ERR_CC_NOTINTEGER) {
+      printf("%s: target lua_Number is integral but fractional value found\n", fname);
+      return 1;
+    }
+    e[count].size = chunks.size - e[count].offset;
+    /* next chunk starts 4 byte aligned */
+    buffer_add(&chunks, zero, (4 - chunks.size % 4) % 4);
+    lua_pop(L, 1);
+    count++;
+  }
+  lua_close(L);
+  if (count == 0) {
+    printf("usage: %s [-s] [-o lua.img] script.lua ...\n", argv[0]);
+    return 1;
+  }
+
+  memset(&h, 0, sizeof(h));
+  h.magic = LUA_IMAGE_MAGIC;
+  h.version = LUA_IMAGE_VERSION;
+  h.count = count;
+  h.size = sizeof(h) + count * sizeof(LuaImageEntry) + chunks.size;
+  if (h.size > IMAGE_MAX_SIZE) {
+    printf("image is %u bytes, only %u fit in flash\n", h.size, IMAGE_MAX_SIZE);
+    return 1;
+  }
+  for (j = 0; j < count; j++) {
+    e[j].offset += sizeof(h) + count * sizeof(LuaImageEntry);
+  }
+  buffer_add(&image, &h, sizeof(h));
+  buffer_add(&image, e, count * sizeof(LuaImageEntry));
+  buffer_add(&image, chunks.buf, chunks.size);
+  h.crc = ~crc32(0xffffffff, (unsigned char *)image.buf + sizeof(h),
+      image.size - sizeof(h));
+  memcpy(image.buf, &h, sizeof(h));
+
+  f = fopen(out, "wb");
+  if (f == NULL || fwrite(image.buf, 1, image.size, f) != image.size) {
+    printf("cannot write %s\n", out);
+    return 1;
+  }
+  fclose(f);
+
+  for (j = 0; j < count; j++) {
+    printf("  %-32s %u\n", e[j].name, e[j].size);
+  }
+  printf("%s: %i modules, %u bytes\n", out, count, h.size);
+  free(chunks.buf);
+  free(image.buf);
+  return 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * otadiff.c
+ *
+ * Host tool, makes a delta OTA image from the image a device runs now and
+ * the new one. The delta image is sent and stored like a full image (type
+ * 'A', 'B' or 'D' in the boot table); the bootloader sees its header,
+ * rebuilds the new image from it and the old one in the destination, and
+ * writes that. A delta image made against any other old image is dropped
+ * and the old image keeps running.
+ *
+ * Matches are found as bsdiff does, from a suffix array of the old image.
+ * Between the matches the difference is stored as bytes to add, which are
+ * mostly zero when code only moved, and those zeros take no room. The
+ * format is described in Bootloader/Update_for_OTA.c. The bootloader
+ * builds the new image in the update partition behind the delta image,
+ * so a delta that leaves no room for it is refused here.
+ *
+ * build: gcc -O2 -I../include -I../Support -I../Board/MiCOKit-3165
+ *        -I../Platform/Cortex-M4 -o otadiff otadiff.c ../Support/CRCUtils.c
+ * usage: otadiff old.bin new.bin delta.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CRCUtils.h"
+#include "platform_config.h"
+
+#define DELTA_MAGIC     0x314C444D  /* "MDL1" */
+
+static const uint8_t *old, *new;
+static int32_t oldsize, newsize;
+
+static uint8_t *out;
+static size_t outlen, outsize;
+
+static void *xmalloc(size_t size)
+{
+  void *p = malloc(size ? size : 1);
+  if (p == NULL) {
+    fprintf(stderr, "otadiff: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static uint8_t *readfile(const char *name, int32_t *size)
+{
+  FILE *f = fopen(name, "rb");
+  uint8_t *buf;
+  long n;
+
+  if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < 0) {
+    fprintf(stderr, "otadiff: cannot read %s\n", name);
+    exit(1);
+  }
+  rewind(f);
+  buf = xmalloc(n);
+  if (fread(buf, 1, n, f) != (size_t)n) {
+    fprintf(stderr, "otadiff: cannot read %s\n", name);
+    exit(1);
+  }
+  fclose(f);
+  *size = (int32_t)n;
+  return buf;
+}
+
+/* ------------------------------------------------------------------------ */
+/* suffix array of old, by prefix doubling; I[0] is the empty suffix         */
+
+static int32_t *rank, *tmp;
+static int32_t step;
+
+static int32_t rank_at(int32_t i)
+{
+  return (i <= oldsize) ? rank[i] : -1;
+}
+
+static int cmp_suffix(const void *a, const void *b)
+{
+  int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+  if (rank[x] != rank[y]) return rank[x] < rank[y] ? -1 : 1;
+  x = rank_at(x + step);
+  y = rank_at(y + step);
+  return (x > y) - (x < y);
+}
+
+static int32_t *suffix_sort(void)
+{
+  int32_t *I = xmalloc((oldsize + 1) * sizeof(int32_t));
+  int32_t i;
+
+  rank = xmalloc((oldsize + 1) * sizeof(int32_t));
+  tmp = xmalloc((oldsize + 1) * sizeof(int32_t));
+  for (i = 0; i <= oldsize; i++) {
+    I[i] = i;
+    rank[i] = (i < oldsize) ? old[i] : -1;
+  }
+  for (step = 1; ; step *= 2) {
+    qsort(I, oldsize + 1, sizeof(int32_t), cmp_suffix);
+    tmp[I[0]] = 0;
+    for (i = 1; i <= oldsize; i++)
+      tmp[I[i]] = tmp[I[i-1]] + (cmp_suffix(&I[i-1], &I[i]) < 0);
+    memcpy(rank, tmp, (oldsize + 1) * sizeof(int32_t));
+    if (rank[I[oldsize]] == oldsize) break;
+  }
+  free(rank);
+  free(tmp);
+  return I;
+}
+
+static int32_t matchlen(const uint8_t *a, int32_t alen, const uint8_t *b, int32_t blen)
+{
+  int32_t i;
+  for (i = 0; i < alen && i < blen; i++)
+    if (a[i] != b[i]) break;
+  return i;
+}
+
+/* longest match of new[scan..] in old, by binary search of the suffix array */
+static int32_t search(const int32_t *I, int32_t scan, int32_t st, int32_t en, int32_t *pos)
+{
+  int32_t x, y;
+  const uint8_t *s = new + scan;
+  int32_t slen = newsize - scan;
+
+  while (en - st >= 2) {
+    x = st + (en - st) / 2;
+    y = oldsize - I[x];
+    if (memcmp(old + I[x], s, y < slen ? y : slen) < 0) st = x;
+    else en = x;
+  }
+  x = matchlen(old + I[st], oldsize - I[st], s, slen);
+  y = matchlen(old + I[en], oldsize - I[en], s, slen);
+  if (x > y) { *pos = I[st]; return x; }
+  *pos = I[en];
+  return y;
+}
+
+/* ------------------------------------------------------------------------ */
+/* output                                                                    */
+
+static void put(const void *p, size_t n)
+{
+  if (outlen + n > outsize) {
+    outsize = (outlen + n) * 2;
+    out = realloc(out, outsize);
+    if (out == NULL) {
+      fprintf(stderr, "otadiff: out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(out + outlen, p, n);
+  outlen += n;
+}
+
+static void put32(uint32_t v)
+{
+  uint8_t b[4] = { v, v >> 8, v >> 16, v >> 24 };
+  put(b, 4);
+}
+
+static void putvarint(uint32_t v)
+{
+  uint8_t b;
+  do {
+    b = v & 0x7F;
+    v >>= 7;
+    if (v) b |= 0x80;
+    put(&b, 1);
+  } while (v);
+}
+
+/* new[n..n+len) as old[o..o+len) plus bytes to add; runs of three or more
+   unchanged bytes become a copy token, the rest literal add bytes */
+static void putdiff(int32_t n, int32_t o, int32_t len)
+{
+  int32_t i = 0, j, z;
+  uint8_t d;
+
+  while (i < len) {
+    for (j = i; j < len && new[n+j] == old[o+j]; j++) ;
+    if (j - i > 0 && (j - i >= 3 || j == len)) {
+      putvarint((uint32_t)(j - i) << 1);
+      i = j;
+      continue;
+    }
+    for (j = i; j < len; j++) {
+      for (z = j; z < len && z - j < 3 && new[n+z] == old[o+z]; z++) ;
+      if (z - j == 3 || (z == len && z > j)) break;
+    }
+    putvarint(((uint32_t)(j - i) << 1) | 1);
+    for (; i < j; i++) {
+      d = new[n+i] - old[o+i];
+      put(&d, 1);
+    }
+  }
+}
+
+static void putrecord(int32_t n, int32_t o, int32_t difflen, int32_t extralen, int32_t seek)
+{
+  putvarint(difflen);
+  putvarint(extralen);
+  putvarint(seek < 0 ? ((uint32_t)~seek << 1) | 1 : (uint32_t)seek << 1);
+  putdiff(n, o, difflen);
+  put(new + n + difflen, extralen);
+}
+
+/* ------------------------------------------------------------------------ */
+/* bsdiff                                                                    */
+
+static void diff(void)
+{
+  int32_t *I = suffix_sort();
+  int32_t scan = 0, len = 0, pos = 0, lastscan = 0, lastpos = 0, lastoffset = 0;
+  int32_t oldscore, scsc, s, Sf, lenf, Sb, lenb, overlap, Ss, lens, i;
+
+  while (scan < newsize) {
+    oldscore = 0;
+    for (scsc = scan += len; scan < newsize; scan++) {
+      len = search(I, scan, 0, oldsize, &pos);
+      for (; scsc < scan + len; scsc++)
+        if (scsc + lastoffset < oldsize && old[scsc + lastoffset] == new[scsc])
+          oldscore++;
+      if ((len == oldscore && len != 0) || len > oldscore + 8) break;
+      if (scan + lastoffset < oldsize && old[scan + lastoffset] == new[scan])
+        oldscore--;
+    }
+    if (len == oldscore && scan != newsize) continue;
+
+    /* extend the last match forward and this one backward */
+    s = 0; Sf = 0; lenf = 0;
+    for (i = 0; lastscan + i < scan && lastpos + i < oldsize; ) {
+      if (old[lastpos + i] == new[lastscan + i]) s++;
+      i++;
+      if (s * 2 - i > Sf * 2 - lenf) { Sf = s; lenf = i; }
+    }
+    lenb = 0;
+    if (scan < newsize) {
+      s = 0; Sb = 0;
+      for (i = 1; scan >= lastscan + i && pos >= i; i++) {
+        if (old[pos - i] == new[scan - i]) s++;
+        if (s * 2 - i > Sb * 2 - lenb) { Sb = s; lenb = i; }
+      }
+    }
+    if (lastscan + lenf > scan - lenb) {
+      overlap = (lastscan + lenf) - (scan - lenb);
+      s = 0; Ss = 0; lens = 0;
+      for (i = 0; i < overlap; i++) {
+        if (new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) s++;
+        if (new[scan - lenb + i] == old[pos - lenb + i]) s--;
+        if (s > Ss) { Ss = s; lens = i + 1; }
+      }
+      lenf += lens - overlap;
+      lenb -= lens;
+    }
+
+    putrecord(lastscan, lastpos, lenf, (scan - lenb) - (lastscan + lenf),
+              (pos - lenb) - (lastpos + lenf));
+    lastscan = scan - lenb;
+    lastpos = pos - lenb;
+    lastoffset = pos - scan;
+  }
+  free(I);
+}
+
+/* ------------------------------------------------------------------------ */
+/* the bootloader's side, to check the delta image before it is shipped     */
+
+static uint32_t getvarint(size_t *p)
+{
+  uint32_t v = 0;
+  int shift = 0;
+  while (*p < outlen && shift < 35) {
+    uint8_t b = out[(*p)++];
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return v;
+    shift += 7;
+  }
+  return 0xFFFFFFFF;
+}
+
+static int check(void)
+{
+  uint8_t *img = xmalloc(newsize);
+  size_t p = 20;
+  uint32_t o = 0, n = 0, difflen, extralen, seek, t, k;
+
+  while (n < (uint32_t)newsize) {
+    difflen = getvarint(&p);
+    extralen = getvarint(&p);
+    seek = getvarint(&p);
+    if (n + difflen + extralen > (uint32_t)newsize) return 0;
+    while (difflen > 0) {
+      t = getvarint(&p);
+      if ((t >> 1) > difflen || o + (t >> 1) > (uint32_t)oldsize) return 0;
+      for (k = 0; k < (t >> 1); k++)
+        img[n++] = old[o++] + ((t & 1) ? out[p++] : 0);
+      difflen -= t >> 1;
+    }
+    if (p + extralen > outlen) return 0;
+    memcpy(img + n, out + p, extralen);
+    n += extralen;
+    p += extralen;
+    o += (seek & 1) ? ~(seek >> 1) : (seek >> 1);
+  }
+  t = p == outlen && memcmp(img, new, newsize) == 0;
+  free(img);
+  return t;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *f;
+
+  if (argc != 4) {
+    fprintf(stderr, "usage: otadiff old.bin new.bin delta.bin\n");
+    return 1;
+  }
+  old = readfile(argv[1], &oldsize);
+  new = readfile(argv[2], &newsize);
+
+  put32(DELTA_MAGIC);
+  put32(oldsize);
+  put32(CRC32_Update(0, old, oldsize));
+  put32(newsize);
+  put32(CRC32_Update(0, new, newsize));
+  diff();
+  if (!check()) {
+    fprintf(stderr, "otadiff: delta image does not rebuild %s\n", argv[2]);
+    return 1;
+  }
+  /* the new image goes on the 4K sector after the delta image */
+  if (((outlen + 0xFFF) & ~(size_t)0xFFF) + (size_t)newsize > UPDATE_FLASH_SIZE) {
+    fprintf(stderr, "otadiff: delta image and %s need %u bytes, the update partition has %u\n",
+            argv[2], (unsigned)(((outlen + 0xFFF) & ~(size_t)0xFFF) + newsize),
+            (unsigned)UPDATE_FLASH_SIZE);
+    return 1;
+  }
+
+  f = fopen(argv[3], "wb");
+  if (f == NULL || fwrite(out, 1, outlen, f) != outlen || fclose(f) != 0) {
+    fprintf(stderr, "otadiff: cannot write %s\n", argv[3]);
+    return 1;
+  }
+  printf("%s: %u bytes, %u%% of %s\n", argv[3], (unsigned)outlen,
+         (unsigned)(outlen * 100 / (newsize ? newsize : 1)), argv[2]);
+  return 0;
+}
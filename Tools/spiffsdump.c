@@ -0,0 +1,148 @@
+/**
+ * spiffsdump.c
+ *
+ * Host tool, prints wear statistics of a WiFiMCU file system image.
+ * The image is a dump of the SPI flash, either the whole flash or only
+ * the file system area.
+ *
+ * spiffs does not keep an erase count per block. Each block is stamped
+ * with the file system wide erase counter when erased, so the age of a
+ * block is the number of erases done since it was last erased. Blocks
+ * with a large age hold data that does not change.
+ *
+ * build: gcc -I../spiffs -o spiffsdump spiffsdump.c ../spiffs/spiffs_*.c
+ * usage: spiffsdump <image> [offset]
+ *        offset of the file system in image, 0xC0000 for a whole flash dump
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+
+/* same layout as lua/exlibs/file.c */
+#define LOG_PAGE_SIZE       256
+#define LUA_FLASH_SIZE      (1024*(1024+256))
+
+static u8_t *image;
+static u32_t image_size;
+static u8_t spiffs_work_buf[LOG_PAGE_SIZE*2];
+static u8_t spiffs_fds[32*4];
+static u8_t spiffs_cache_buf[(LOG_PAGE_SIZE+32)*4];
+static spiffs fs;
+
+void lspiffs_lock(void) {}
+void lspiffs_unlock(void) {}
+
+static s32_t dump_read(u32_t addr, u32_t size, u8_t *dst) {
+  if (addr + size > image_size) return SPIFFS_ERR_INTERNAL;
+  memcpy(dst, &image[addr], size);
+  return SPIFFS_OK;
+}
+
+/* image is never changed */
+static s32_t dump_write(u32_t addr, u32_t size, u8_t *src) {
+  return SPIFFS_ERR_INTERNAL;
+}
+
+static s32_t dump_erase(u32_t addr, u32_t size) {
+  return SPIFFS_ERR_INTERNAL;
+}
+
+int main(int argc, char **argv) {
+  FILE *f;
+  long len;
+  u32_t offset = 0;
+  spiffs_config cfg;
+  spiffs_block_stat bs;
+  spiffs_block_ix bix;
+  spiffs_DIR d;
+  struct spiffs_dirent e;
+  struct spiffs_dirent *pe = &e;
+  u32_t age, age_max = 0;
+  u32_t used = 0, deleted = 0, free_pages = 0;
+
+  if (argc < 2) {
+    printf("usage: %s <image> [offset]\n", argv[0]);
+    return 1;
+  }
+  if (argc > 2) offset = strtoul(argv[2], NULL, 0);
+
+  f = fopen(argv[1], "rb");
+  if (f == NULL) {
+    printf("cannot open %s\n", argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  if (len <= (long)offset) {
+    printf("offset beyond image\n");
+    return 1;
+  }
+  image_size = len - offset;
+  if (image_size > LUA_FLASH_SIZE) image_size = LUA_FLASH_SIZE;
+  image = malloc(image_size);
+  fseek(f, offset, SEEK_SET);
+  if (image == NULL || fread(image, 1, image_size, f) != image_size) {
+    printf("cannot read %s\n", argv[1]);
+    return 1;
+  }
+  fclose(f);
+
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.phys_size = image_size;
+  cfg.phys_addr = 0;
+  cfg.phys_erase_block = 65536/2;
+  cfg.log_block_size = 65536;
+  cfg.log_page_size = LOG_PAGE_SIZE;
+  cfg.hal_read_f = dump_read;
+  cfg.hal_write_f = dump_write;
+  cfg.hal_erase_f = dump_erase;
+  if (SPIFFS_mount(&fs, &cfg, spiffs_work_buf, spiffs_fds, sizeof(spiffs_fds),
+      spiffs_cache_buf, sizeof(spiffs_cache_buf), 0) != SPIFFS_OK) {
+    printf("no file system found, error %i\n", SPIFFS_errno(&fs));
+    return 1;
+  }
+
+  printf("block  stamp    age   used  deleted  free\n");
+  for (bix = 0; bix < fs.block_count; bix++) {
+    if (SPIFFS_block_stat(&fs, bix, &bs) < 0) {
+      printf("%5i  read error %i\n", bix, SPIFFS_errno(&fs));
+      continue;
+    }
+    if (bs.erase_count == (spiffs_obj_id)-1) {
+      printf("%5i    N/A    N/A", bix);
+    } else {
+      /* same wrap as spiffs_gc_find_candidate */
+      if (fs.max_erase_count > bs.erase_count) {
+        age = fs.max_erase_count - bs.erase_count;
+      } else {
+        age = SPIFFS_OBJ_ID_FREE - (bs.erase_count - fs.max_erase_count);
+      }
+      printf("%5i  %5i  %5i", bix, bs.erase_count, age);
+      if (age > age_max) age_max = age;
+    }
+    printf("  %5i  %7i  %4i\n", bs.used, bs.deleted, bs.free);
+    used += bs.used;
+    deleted += bs.deleted;
+    free_pages += bs.free;
+  }
+
+  printf("\nblocks:      %i, %i free\n", fs.block_count, fs.free_blocks);
+  printf("pages:       %i used, %i deleted, %i free\n", used, deleted, free_pages);
+  printf("erases:      about %i since format, %i per block, oldest block age %i\n",
+      fs.max_erase_count, fs.max_erase_count / fs.block_count, age_max);
+
+  printf("\nfiles:\n");
+  SPIFFS_opendir(&fs, "/", &d);
+  while ((pe = SPIFFS_readdir(&d, pe))) {
+    printf("  %-32s %i\n", pe->name, pe->size);
+  }
+  SPIFFS_closedir(&d);
+
+  SPIFFS_unmount(&fs);
+  free(image);
+  return 0;
+}
@@ -137,6 +137,9 @@ bool MicoShouldEnterMFGMode(void);
 bool MicoShouldEnterBootloader(void);
 
 char *mico_get_bootloader_ver(void);
+
+/* true if the installed bootloader is revision "Vx.y" or newer */
+bool mico_bootloader_is_at_least(const char *revision);
 #ifdef BOOTLOADER 
 void mico_set_bootload_ver(void);
 #endif
@@ -19,40 +19,58 @@ typedef size_t lua_UInteger;
 #define TOBIT(L, n)                             \
   (luaL_checkinteger((L), (n)))
 
+/* Each operation also gets a fast version for the VM, see lrotable.h;
+   the variadic ones take the fast path when called with 2 arguments */
+#ifdef LUA_USE_FASTFUNC
+#define FAST(name, expr)                        \
+  static int fbit_ ## name(lua_Integer *res, lua_Integer a, \
+                           lua_Integer b, lua_Integer c) { \
+    *res = (expr);                              \
+    return 0;                                   \
+  }                                             \
+  LUA_FASTFUNC(bit_ ## name, fbit_ ## name);
+#else
+#define FAST(name, expr)
+#endif
+
 #define MONADIC(name, op)                       \
   static int bit_ ## name(lua_State *L) {       \
     lua_pushinteger(L, op TOBIT(L, 1));         \
     return 1;                                   \
-  }
+  }                                             \
+  FAST(name, op a)
 
 #define VARIADIC(name, op)                      \
   static int bit_ ## name(lua_State *L) {       \
     int n = lua_gettop(L), i;                   \
     lua_Integer w = TOBIT(L, 1);                \
     for (i = 2; i <= n; i++)                    \
-      w op TOBIT(L, i);                         \
+      w = w op TOBIT(L, i);                     \
     lua_pushinteger(L, w);                      \
     return 1;                                   \
-  }
+  }                                             \
+  FAST(name, (a op b))
 
 #define LOGICAL_SHIFT(name, op)                 \
   static int bit_ ## name(lua_State *L) {       \
   lua_pushinteger(L, (lua_UInteger)TOBIT(L, 1) op \
       (unsigned)luaL_checknumber(L, 2));        \
   return 1;                                     \
-  }
+  }                                             \
+  FAST(name, (lua_UInteger)a op (unsigned)b)
 
 #define ARITHMETIC_SHIFT(name, op)              \
   static int bit_ ## name(lua_State *L) {       \
     lua_pushinteger(L, (lua_Integer)TOBIT(L, 1) op \
                           (unsigned)luaL_checknumber(L, 2)); \
     return 1;                                   \
-  }
+  }                                             \
+  FAST(name, (lua_Integer)a op (unsigned)b)
 
 MONADIC(bnot,  ~)
-VARIADIC(band, &=)
-VARIADIC(bor,  |=)
-VARIADIC(bxor, ^=)
+VARIADIC(band, &)
+VARIADIC(bor,  |)
+VARIADIC(bxor, ^)
 ARITHMETIC_SHIFT(lshift,  <<)
 LOGICAL_SHIFT(rshift,     >>)
 ARITHMETIC_SHIFT(arshift, >>)
@@ -63,6 +81,7 @@ static int bit_bit( lua_State* L )
   lua_pushinteger( L, ( lua_Integer )( 1 << luaL_checkinteger( L, 1 ) ) );
   return 1;
 }
+FAST(bit, ( lua_Integer )( 1 << a ))
 // Lua: res = isset( value, position )
 static int bit_isset( lua_State* L )
 {
@@ -109,14 +128,14 @@ static int bit_clear( lua_State* L )
 #include "lrodefs.h"
 const LUA_REG_TYPE bit_map[] =
 {
-  { LSTRKEY( "bnot" ),    LFUNCVAL( bit_bnot )},
-  { LSTRKEY( "band" ),    LFUNCVAL( bit_band )},
-  { LSTRKEY( "bor" ),     LFUNCVAL( bit_bor )},
-  { LSTRKEY( "bxor" ),    LFUNCVAL( bit_bxor )},
-  { LSTRKEY( "lshift" ),  LFUNCVAL( bit_lshift )},
-  { LSTRKEY( "rshift" ),  LFUNCVAL( bit_rshift )},
-  { LSTRKEY( "arshift" ), LFUNCVAL( bit_arshift )},
-  { LSTRKEY( "bit" ),     LFUNCVAL( bit_bit )},
+  { LSTRKEY( "bnot" ),    LFASTFUNCVAL( bit_bnot, 1, 1 )},
+  { LSTRKEY( "band" ),    LFASTFUNCVAL( bit_band, 2, 1 )},
+  { LSTRKEY( "bor" ),     LFASTFUNCVAL( bit_bor, 2, 1 )},
+  { LSTRKEY( "bxor" ),    LFASTFUNCVAL( bit_bxor, 2, 1 )},
+  { LSTRKEY( "lshift" ),  LFASTFUNCVAL( bit_lshift, 2, 1 )},
+  { LSTRKEY( "rshift" ),  LFASTFUNCVAL( bit_rshift, 2, 1 )},
+  { LSTRKEY( "arshift" ), LFASTFUNCVAL( bit_arshift, 2, 1 )},
+  { LSTRKEY( "bit" ),     LFASTFUNCVAL( bit_bit, 1, 1 )},
   { LSTRKEY( "set" ),     LFUNCVAL( bit_set )},
   { LSTRKEY( "clear" ),   LFUNCVAL( bit_clear )},
   { LSTRKEY( "isset" ),   LFUNCVAL( bit_isset )},
@@ -0,0 +1,90 @@
+/**
+ * config.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "user_config.h"
+
+#include "KVStoreUtils.h"
+
+/* config.get(key): the value saved under key, nil when there is none */
+static int lconfig_get(lua_State *L)
+{
+  const char *key = luaL_checkstring(L, 1);
+  size_t len = 0;
+  char *value;
+  OSStatus err;
+
+  luaL_argcheck(L, strlen(key) > 0 && strlen(key) <= KV_STORE_KEY_MAX, 1, "bad key length");
+  err = KVStoreGet(key, NULL, 0, &len);
+  if (err == kNotFoundErr) {
+    lua_pushnil(L);
+    return 1;
+  }
+  if (err == kUnsupportedErr)
+    return luaL_error(L, "config needs a newer bootloader");
+  if (err != kNoErr && err != kSizeErr)
+    return luaL_error(L, "config read failed: %d", err);
+
+  value = (char *)malloc(len ? len : 1);
+  if (value == NULL)
+    return luaL_error(L, "not enough memory");
+  err = KVStoreGet(key, value, len, NULL);
+  if (err == kNoErr)
+    lua_pushlstring(L, value, len);
+  free(value);
+  if (err != kNoErr)
+    return luaL_error(L, "config read failed: %d", err);
+  return 1;
+}
+
+/* config.set(key, value): saves a string or a number under key, nil removes
+   it. Unchanged values are not written again */
+static int lconfig_set(lua_State *L)
+{
+  const char *key = luaL_checkstring(L, 1);
+  const char *value;
+  size_t len;
+  OSStatus err;
+
+  luaL_argcheck(L, strlen(key) > 0 && strlen(key) <= KV_STORE_KEY_MAX, 1, "bad key length");
+  if (lua_isnoneornil(L, 2)) {
+    err = KVStoreRemove(key);
+  } else {
+    value = luaL_checklstring(L, 2, &len);
+    luaL_argcheck(L, len <= KV_STORE_VALUE_MAX, 2, "value too long");
+    err = KVStoreSet(key, value, len);
+  }
+  if (err == kNoSpaceErr)
+    return luaL_error(L, "config is full");
+  if (err == kUnsupportedErr)
+    return luaL_error(L, "config needs a newer bootloader");
+  if (err != kNoErr)
+    return luaL_error(L, "config write failed: %d", err);
+  return 0;
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE config_map[] =
+{
+  { LSTRKEY( "get" ), LFUNCVAL( lconfig_get )},
+  { LSTRKEY( "set" ), LFUNCVAL( lconfig_set )},
+  {LNILKEY, LNILVAL}
+};
+
+LUALIB_API int luaopen_config(lua_State *L)
+{
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else
+  luaL_register( L, LUA_CONFIGLIBNAME, config_map );
+  return 1;
+#endif
+}
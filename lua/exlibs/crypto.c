@@ -0,0 +1,346 @@
+/**
+ * crypto.c
+ */
+
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "user_config.h"
+
+#include "MicoAlgorithm.h"
+#include "SHAUtils.h"
+#include "CRCUtils.h"
+#include "strbuf.h"
+
+#include <spiffs.h>
+#include <spiffs_nucleus.h>
+
+extern spiffs fs;
+
+#define CRYPTO_HANDLE       "crypto.hash"
+#define CRYPTO_MAX_BLOCK    128   /* sha512 */
+#define CRYPTO_MAX_DIGEST   64
+#define CRYPTO_FILE_CHUNK   256   /* a spiffs page */
+
+typedef union {
+  md5_context md5;
+  SHA_CTX_compat sha1;
+  SHA256_CTX_compat sha256;
+  SHA512_CTX_compat sha512;
+  SHA3_CTX_compat sha3;
+} crypto_ctx_t;
+
+typedef struct {
+  const char *name;
+  size_t digest;
+  size_t block;
+  void (*init)(crypto_ctx_t *c);
+  void (*update)(crypto_ctx_t *c, const void *p, size_t len);
+  void (*final)(crypto_ctx_t *c, uint8_t *out);
+} crypto_alg_t;
+
+static void md5_init(crypto_ctx_t *c) { InitMd5(&c->md5); }
+static void md5_update(crypto_ctx_t *c, const void *p, size_t len) { Md5Update(&c->md5, (unsigned char *)p, len); }
+static void md5_final(crypto_ctx_t *c, uint8_t *out) { Md5Final(&c->md5, out); }
+static void sha1_init(crypto_ctx_t *c) { SHA1_Init_compat(&c->sha1); }
+static void sha1_update(crypto_ctx_t *c, const void *p, size_t len) { SHA1_Update_compat(&c->sha1, p, len); }
+static void sha1_final(crypto_ctx_t *c, uint8_t *out) { SHA1_Final_compat(out, &c->sha1); }
+static void sha256_init(crypto_ctx_t *c) { SHA256_Init_compat(&c->sha256); }
+static void sha256_update(crypto_ctx_t *c, const void *p, size_t len) { SHA256_Update_compat(&c->sha256, p, len); }
+static void sha256_final(crypto_ctx_t *c, uint8_t *out) { SHA256_Final_compat(out, &c->sha256); }
+static void sha512_init(crypto_ctx_t *c) { SHA512_Init_compat(&c->sha512); }
+static void sha512_update(crypto_ctx_t *c, const void *p, size_t len) { SHA512_Update_compat(&c->sha512, p, len); }
+static void sha512_final(crypto_ctx_t *c, uint8_t *out) { SHA512_Final_compat(out, &c->sha512); }
+static void sha3_init(crypto_ctx_t *c) { SHA3_Init_compat(&c->sha3); }
+static void sha3_update(crypto_ctx_t *c, const void *p, size_t len) { SHA3_Update_compat(&c->sha3, p, len); }
+static void sha3_final(crypto_ctx_t *c, uint8_t *out) { SHA3_512_Final_compat(out, &c->sha3); }
+
+static const crypto_alg_t crypto_algs[] = {
+  { "md5",    16, 64,              md5_init,    md5_update,    md5_final },
+  { "sha1",   20, 64,              sha1_init,   sha1_update,   sha1_final },
+  { "sha256", 32, 64,              sha256_init, sha256_update, sha256_final },
+  { "sha512", 64, 128,             sha512_init, sha512_update, sha512_final },
+  { "sha3",   64, SHA3_BLOCK_SIZE, sha3_init,   sha3_update,   sha3_final },   /* SHA3-512 */
+  { NULL, 0, 0, NULL, NULL, NULL }
+};
+
+/* a digest in progress; for HMAC the inner hash, with the outer key pad kept
+   to finish it. Lives in a userdata or, for the one-shot helpers, on the
+   C stack, so digests never share state */
+typedef struct {
+  const crypto_alg_t *alg;
+  bool hmac;
+  uint8_t opad[CRYPTO_MAX_BLOCK];
+  crypto_ctx_t ctx;
+} crypto_hash_t;
+
+static const char crypto_hex[] = "0123456789abcdef";
+
+#define tohash(L)   ((crypto_hash_t *)luaL_checkudata(L, 1, CRYPTO_HANDLE))
+
+static const crypto_alg_t *crypto_checkalg(lua_State *L, int narg)
+{
+  const char *name = luaL_checkstring(L, narg);
+  const crypto_alg_t *a;
+  for (a = crypto_algs; a->name != NULL; a++)
+    if (strcmp(a->name, name) == 0) return a;
+  luaL_argerror(L, narg, "unknown algorithm");
+  return NULL;
+}
+
+static void crypto_start(crypto_hash_t *h)
+{
+  uint8_t ipad[CRYPTO_MAX_BLOCK];
+  size_t i;
+  h->alg->init(&h->ctx);
+  if (!h->hmac) return;
+  for (i = 0; i < h->alg->block; i++)
+    ipad[i] = h->opad[i] ^ (0x5c ^ 0x36);
+  h->alg->update(&h->ctx, ipad, h->alg->block);
+  memset(ipad, 0, sizeof(ipad));
+}
+
+/* key==NULL: plain hash */
+static void crypto_init(crypto_hash_t *h, const crypto_alg_t *alg, const char *key, size_t keylen)
+{
+  size_t i;
+  h->alg = alg;
+  h->hmac = key != NULL;
+  if (h->hmac) {
+    memset(h->opad, 0, sizeof(h->opad));
+    if (keylen > alg->block) {
+      alg->init(&h->ctx);
+      alg->update(&h->ctx, key, keylen);
+      alg->final(&h->ctx, h->opad);
+    }
+    else
+      memcpy(h->opad, key, keylen);
+    for (i = 0; i < alg->block; i++)
+      h->opad[i] ^= 0x5c;
+  }
+  crypto_start(h);
+}
+
+/* writes the digest to out and starts over with the same key */
+static size_t crypto_finish(crypto_hash_t *h, uint8_t *out)
+{
+  const crypto_alg_t *a = h->alg;
+  a->final(&h->ctx, out);
+  if (h->hmac) {
+    a->init(&h->ctx);
+    a->update(&h->ctx, h->opad, a->block);
+    a->update(&h->ctx, out, a->digest);
+    a->final(&h->ctx, out);
+  }
+  crypto_start(h);
+  return a->digest;
+}
+
+static int crypto_writer(const char *p, size_t len, void *ud)
+{
+  crypto_hash_t *h = (crypto_hash_t *)ud;
+  h->alg->update(&h->ctx, p, len);
+  return 0;
+}
+
+/* hashes arguments from..top, strings or buffers */
+static void crypto_addargs(lua_State *L, crypto_hash_t *h, int from)
+{
+  int top = lua_gettop(L), i;
+  for (i = from; i <= top; i++)
+    strbuf_write(L, i, crypto_writer, h);
+}
+
+static void crypto_pushdigest(lua_State *L, const uint8_t *d, size_t len, bool raw)
+{
+  char s[CRYPTO_MAX_DIGEST*2];
+  size_t i;
+  if (raw) {
+    lua_pushlstring(L, (const char *)d, len);
+    return;
+  }
+  for (i = 0; i < len; i++) {
+    s[i*2] = crypto_hex[d[i] >> 4];
+    s[i*2+1] = crypto_hex[d[i] & 0x0f];
+  }
+  lua_pushlstring(L, s, len*2);
+}
+
+//h = crypto.new("md5"|"sha1"|"sha256"|"sha512"|"sha3"[, key])
+//with a key the digest is an HMAC
+static int lcrypto_new( lua_State* L )
+{
+  const crypto_alg_t *alg = crypto_checkalg(L, 1);
+  size_t keylen = 0;
+  const char *key = luaL_optlstring(L, 2, NULL, &keylen);
+  crypto_hash_t *h = (crypto_hash_t *)lua_newuserdata(L, sizeof(crypto_hash_t));
+  crypto_init(h, alg, key, keylen);
+  luaL_getmetatable(L, CRYPTO_HANDLE);
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+//h:update(s1, ...), strings or strbufs, returns h
+static int lcrypto_update( lua_State* L )
+{
+  crypto_hash_t *h = tohash(L);
+  crypto_addargs(L, h, 2);
+  lua_settop(L, 1);
+  return 1;
+}
+
+//h:file("name"[, offset[, len]]), hashes the file a page at a time,
+//returns h, or nil if the file can't be opened or is shorter than offset;
+//a read error raises an error
+static int lcrypto_file( lua_State* L )
+{
+  crypto_hash_t *h = tohash(L);
+  const char *name = luaL_checkstring(L, 2);
+  int offset = luaL_optint(L, 3, 0);
+  int left = luaL_optint(L, 4, -1);
+  uint8_t page[CRYPTO_FILE_CHUNK];
+  spiffs_file fh;
+  spiffs_stat s;
+  int n;
+  if (offset < 0) return luaL_error( L, "wrong arg range" );
+  fh = SPIFFS_open(&fs, (char *)name, SPIFFS_RDONLY, 0);
+  if (fh < 0) {
+    lua_pushnil(L);
+    return 1;
+  }
+  if (SPIFFS_fstat(&fs, fh, &s) < 0 || offset > (int)s.size ||
+      (offset > 0 && SPIFFS_lseek(&fs, fh, offset, SPIFFS_SEEK_SET) < 0)) {
+    SPIFFS_close(&fs, fh);
+    lua_pushnil(L);
+    return 1;
+  }
+  if (left < 0 || left > (int)s.size - offset) left = s.size - offset;
+  while (left > 0) {
+    n = left < CRYPTO_FILE_CHUNK ? left : CRYPTO_FILE_CHUNK;
+    n = SPIFFS_read(&fs, fh, page, n);
+    if (n <= 0) {
+      n = SPIFFS_errno(&fs);
+      SPIFFS_close(&fs, fh);
+      return luaL_error( L, "read failed: %d", n );
+    }
+    h->alg->update(&h->ctx, page, n);
+    left -= n;
+  }
+  SPIFFS_close(&fs, fh);
+  lua_settop(L, 1);
+  return 1;
+}
+
+//h:final([raw]), the digest as hex, or as a binary string if raw is
+//true; h starts over, with the same key
+static int lcrypto_final( lua_State* L )
+{
+  crypto_hash_t *h = tohash(L);
+  uint8_t d[CRYPTO_MAX_DIGEST];
+  size_t len = crypto_finish(h, d);
+  crypto_pushdigest(L, d, len, lua_toboolean(L, 2));
+  return 1;
+}
+
+//crypto.hash("sha256", s1, ...), hex digest of the strings or strbufs
+static int lcrypto_hash( lua_State* L )
+{
+  crypto_hash_t h;
+  uint8_t d[CRYPTO_MAX_DIGEST];
+  crypto_init(&h, crypto_checkalg(L, 1), NULL, 0);
+  crypto_addargs(L, &h, 2);
+  crypto_pushdigest(L, d, crypto_finish(&h, d), false);
+  return 1;
+}
+
+//crypto.hmac("sha256", key, s1, ...), hex HMAC of the strings or strbufs
+static int lcrypto_hmac( lua_State* L )
+{
+  crypto_hash_t h;
+  uint8_t d[CRYPTO_MAX_DIGEST];
+  size_t keylen;
+  const char *key = luaL_checklstring(L, 2, &keylen);
+  crypto_init(&h, crypto_checkalg(L, 1), key, keylen);
+  crypto_addargs(L, &h, 3);
+  crypto_pushdigest(L, d, crypto_finish(&h, d), false);
+  memset(&h, 0, sizeof(h));
+  return 1;
+}
+
+//crypto.tohex(s)
+static int lcrypto_tohex( lua_State* L )
+{
+  size_t len, i;
+  const uint8_t *s = (const uint8_t *)luaL_checklstring(L, 1, &len);
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  for (i = 0; i < len; i++) {
+    luaL_addchar(&b, crypto_hex[s[i] >> 4]);
+    luaL_addchar(&b, crypto_hex[s[i] & 0x0f]);
+  }
+  luaL_pushresult(&b);
+  return 1;
+}
+
+static int crypto_crcwriter(const char *p, size_t len, void *ud)
+{
+  uint32_t *crc = (uint32_t *)ud;
+  *crc = CRC32_Update(*crc, p, len);
+  return 0;
+}
+
+//crypto.crc32([crc,] s1, ...), CRC-32 of the strings or strbufs, going on
+//from crc if given; like the bit module, values from 2^31 are negative
+static int lcrypto_crc32( lua_State* L )
+{
+  uint32_t crc = 0;
+  int top = lua_gettop(L), i = 1;
+  if (lua_type(L, 1) == LUA_TNUMBER)
+    crc = (uint32_t)lua_tointeger(L, i++);
+  for (; i <= top; i++)
+    strbuf_write(L, i, crypto_crcwriter, &crc);
+  lua_pushinteger(L, (lua_Integer)crc);
+  return 1;
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE crypto_method_map[] =
+{
+  { LSTRKEY( "update" ), LFUNCVAL( lcrypto_update )},
+  { LSTRKEY( "file" ), LFUNCVAL( lcrypto_file )},
+  { LSTRKEY( "final" ), LFUNCVAL( lcrypto_final )},
+  {LNILKEY, LNILVAL}
+};
+
+const LUA_REG_TYPE crypto_map[] =
+{
+  { LSTRKEY( "new" ), LFUNCVAL( lcrypto_new )},
+  { LSTRKEY( "hash" ), LFUNCVAL( lcrypto_hash )},
+  { LSTRKEY( "hmac" ), LFUNCVAL( lcrypto_hmac )},
+  { LSTRKEY( "crc32" ), LFUNCVAL( lcrypto_crc32 )},
+  { LSTRKEY( "tohex" ), LFUNCVAL( lcrypto_tohex )},
+  {LNILKEY, LNILVAL}
+};
+
+LUALIB_API int luaopen_crypto(lua_State *L)
+{
+  luaL_newmetatable(L, CRYPTO_HANDLE);
+#if LUA_OPTIMIZE_MEMORY > 0
+  lua_pushrotable(L, (void*)crypto_method_map);
+#else
+  lua_newtable(L);
+  luaL_register(L, NULL, crypto_method_map);
+#endif
+  lua_setfield(L, -2, "__index");
+  lua_pop(L, 1);
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else
+  luaL_register( L, LUA_CRYPTOLIBNAME, crypto_map );
+  return 1;
+#endif
+}
@@ -0,0 +1,291 @@
+/**
+ * dns.c
+ */
+
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "user_config.h"
+
+#include "MICODefine.h"
+#include "MICORTOS.h"
+#include "SocketUtils.h"
+#include "task.h"
+#include "dns.h"
+
+extern mico_queue_t os_queue;
+
+typedef struct {
+  char name[DNS_CACHE_NAME];  /* "" if free */
+  uint32_t ip;                /* 0: not found */
+  uint32_t expires;           /* mico_get_time() */
+} dns_entry_t;
+
+typedef struct {
+  bool busy;
+  char name[DNS_NAMELEN+1];
+  dns_found_fn fn;            /* NULL: answer goes to Lua */
+  int arg;
+  lua_State *L;
+  int ref;                    /* callback, or task if task is set */
+  bool task;
+  uint32_t ip;
+} dns_req_t;
+
+static dns_entry_t dns_cache[DNS_CACHE_SIZE];
+static dns_req_t dns_req[DNS_MAX_REQ];
+static uint32_t dns_hits = 0, dns_misses = 0;
+static mico_mutex_t dns_mutex;
+static mico_queue_t dns_queue;
+static bool dns_thread_is_started = false;
+
+static bool dns_cache_get(const char *name, uint32_t *ip)
+{
+  uint32_t now = mico_get_time();
+  bool found = false;
+  mico_rtos_lock_mutex(&dns_mutex);
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    dns_entry_t *e = &dns_cache[i];
+    if (e->name[0] != 0 && strcmp(e->name, name) == 0) {
+      if ((int32_t)(e->expires - now) > 0) {
+        *ip = e->ip;
+        found = true;
+      }
+      break;
+    }
+  }
+  mico_rtos_unlock_mutex(&dns_mutex);
+  return found;
+}
+
+/* the entry of the name, else a free one, else the one expiring first */
+static void dns_cache_put(const char *name, uint32_t ip)
+{
+  dns_entry_t *e = NULL;
+  if (strlen(name) >= DNS_CACHE_NAME) return;
+  mico_rtos_lock_mutex(&dns_mutex);
+  for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+    dns_entry_t *c = &dns_cache[i];
+    if (c->name[0] != 0 && strcmp(c->name, name) == 0) { e = c; break; }
+    if (e == NULL || (e->name[0] != 0 &&
+        (c->name[0] == 0 || (int32_t)(c->expires - e->expires) < 0)))
+      e = c;
+  }
+  strcpy(e->name, name);
+  e->ip = ip;
+  e->expires = mico_get_time() + (ip != 0 ? DNS_TTL : DNS_NEG_TTL);
+  mico_rtos_unlock_mutex(&dns_mutex);
+}
+
+static bool dns_lookup(const char *name, uint32_t *ip)
+{
+  if (dns_cache_get(name, ip)) {
+    dns_hits++;
+    return true;
+  }
+  dns_misses++;
+  return false;
+}
+
+static void dns_free(int idx)
+{
+  mico_rtos_lock_mutex(&dns_mutex);
+  dns_req[idx].busy = false;
+  mico_rtos_unlock_mutex(&dns_mutex);
+}
+
+static void dns_thread(void *inContext)
+{
+  (void)inContext;
+  int idx;
+  while (1)
+  {
+    if (mico_rtos_pop_from_queue(&dns_queue, &idx, MICO_WAIT_FOREVER) != kNoErr)
+      continue;
+    dns_req_t *r = &dns_req[idx];
+    uint32_t ip;
+    /* a lookup queued behind another of the same name is answered here */
+    if (!dns_cache_get(r->name, &ip)) {
+      char pIPstr[16] = {0};
+      if (gethostbyname(r->name, (uint8_t *)pIPstr, 16) == kNoErr)
+        ip = inet_addr(pIPstr);
+      else
+        ip = 0;
+      dns_cache_put(r->name, ip);
+    }
+    if (r->fn != NULL) {
+      r->fn(r->arg, ip);
+      dns_free(idx);
+    }
+    else {
+      queue_msg_t msg;
+      r->ip = ip;
+      msg.L = r->L;
+      msg.source = DNS;
+      msg.para1 = 0;
+      msg.para2 = idx;
+      mico_rtos_push_to_queue(&os_queue, &msg, MICO_WAIT_FOREVER);
+    }
+  }
+}
+
+static int dns_request(const char *name, dns_found_fn fn, int arg,
+                       lua_State *L, int ref, bool task)
+{
+  int idx;
+  mico_rtos_lock_mutex(&dns_mutex);
+  for (idx = 0; idx < DNS_MAX_REQ; idx++)
+    if (!dns_req[idx].busy) break;
+  if (idx < DNS_MAX_REQ) {
+    dns_req_t *r = &dns_req[idx];
+    r->busy = true;
+    strcpy(r->name, name);
+    r->fn = fn;
+    r->arg = arg;
+    r->L = L;
+    r->ref = ref;
+    r->task = task;
+  }
+  mico_rtos_unlock_mutex(&dns_mutex);
+  if (idx == DNS_MAX_REQ) return -1;
+
+  /* dns_resolve may be called from any thread */
+  mico_rtos_lock_mutex(&dns_mutex);
+  if (!dns_thread_is_started) {
+    dns_thread_is_started = true;
+    mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "dns", dns_thread, 0x400, NULL);
+  }
+  mico_rtos_unlock_mutex(&dns_mutex);
+  /* the queue holds DNS_MAX_REQ, as many as there are busy requests */
+  mico_rtos_push_to_queue(&dns_queue, &idx, 0);
+  return idx;
+}
+
+void dns_init(void)
+{
+  static bool inited = false;
+  if (inited) return;
+  inited = true;
+  memset(dns_cache, 0, sizeof(dns_cache));
+  memset(dns_req, 0, sizeof(dns_req));
+  mico_rtos_init_mutex(&dns_mutex);
+  mico_rtos_init_queue(&dns_queue, "dns", sizeof(int), DNS_MAX_REQ);
+}
+
+int dns_resolve(const char *name, dns_found_fn fn, int arg)
+{
+  uint32_t ip;
+  if (dns_lookup(name, &ip)) {
+    fn(arg, ip);
+    return 1;
+  }
+  return dns_request(name, fn, arg, NULL, LUA_NOREF, false) < 0 ? -1 : 0;
+}
+
+static void dns_puship(lua_State *L, uint32_t ip)
+{
+  char s[17] = {0};
+  if (ip == 0) {
+    lua_pushnil(L);
+    return;
+  }
+  inet_ntoa(s, ip);
+  lua_pushstring(L, s);
+}
+
+void dns_deliver(lua_State *L, int idx)
+{
+  dns_req_t *r = &dns_req[idx];
+  int ref = r->ref;
+  if (r->task) {
+    dns_puship(L, r->ip);
+    dns_free(idx);
+    task_resume(L, ref, 1);
+    return;
+  }
+  lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+  luaL_unref(L, LUA_REGISTRYINDEX, ref);
+  lua_pushstring(L, r->name);
+  dns_puship(L, r->ip);
+  dns_free(idx);
+  lua_call(L, 2, 0);
+}
+
+//net.dns.resolve("name",function(name,ip)), ip is nil if not found
+//a cached answer calls back at once; in a task without a function it
+//waits and returns ip
+static int ldns_resolve( lua_State* L )
+{
+  size_t len;
+  uint32_t ip;
+  const char *name = luaL_checklstring( L, 1, &len );
+  bool task = false;
+  int ref;
+  if (len > DNS_NAMELEN)
+    return luaL_error( L, "name too long" );
+  if (lua_type(L, 2) != LUA_TFUNCTION && lua_type(L, 2) != LUA_TLIGHTFUNCTION) {
+    if (!task_running(L))
+      return luaL_error( L, "function needed" );
+    task = true;
+  }
+  if (dns_lookup(name, &ip)) {
+    if (task) {
+      dns_puship(L, ip);
+      return 1;
+    }
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, 1);
+    dns_puship(L, ip);
+    lua_call(L, 2, 0);
+    return 0;
+  }
+  if (task)
+    ref = task_wait(L);
+  else {
+    lua_pushvalue(L, 2);
+    ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+  if (dns_request(name, NULL, 0, task_main(L), ref, task) < 0) {
+    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    return luaL_error( L, "too many dns requests" );
+  }
+  return task ? lua_yield(L, 0) : 0;
+}
+
+//hits,misses,entries = net.dns.stats()
+static int ldns_stats( lua_State* L )
+{
+  uint32_t now = mico_get_time();
+  int n = 0;
+  mico_rtos_lock_mutex(&dns_mutex);
+  for (int i = 0; i < DNS_CACHE_SIZE; i++)
+    if (dns_cache[i].name[0] != 0 && (int32_t)(dns_cache[i].expires - now) > 0)
+      n++;
+  mico_rtos_unlock_mutex(&dns_mutex);
+  lua_pushinteger(L, dns_hits);
+  lua_pushinteger(L, dns_misses);
+  lua_pushinteger(L, n);
+  return 3;
+}
+
+//net.dns.flush(), forgets the cached answers
+static int ldns_flush( lua_State* L )
+{
+  mico_rtos_lock_mutex(&dns_mutex);
+  memset(dns_cache, 0, sizeof(dns_cache));
+  mico_rtos_unlock_mutex(&dns_mutex);
+  return 0;
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE dns_map[] =
+{
+  { LSTRKEY( "resolve" ), LFUNCVAL( ldns_resolve )},
+  { LSTRKEY( "stats" ), LFUNCVAL( ldns_stats )},
+  { LSTRKEY( "flush" ), LFUNCVAL( ldns_flush )},
+  {LNILKEY, LNILVAL}
+};
@@ -0,0 +1,33 @@
+/**
+ * dns.h
+ *
+ * Name resolver for net: one worker thread takes lookups from a queue,
+ * and answers, found or not, are cached by host name for a while, so
+ * connecting again to the same host costs no DNS round-trip.
+ */
+
+#ifndef __DNS_H__
+#define __DNS_H__
+
+#include <stdint.h>
+#include "lua.h"
+
+#define DNS_NAMELEN     128   /* longest host name */
+#define DNS_CACHE_SIZE  8
+#define DNS_CACHE_NAME  48    /* longer names are resolved but not cached */
+#define DNS_MAX_REQ     4     /* lookups queued at a time */
+#define DNS_TTL         (300*1000)  /* ms an address is kept */
+#define DNS_NEG_TTL     (10*1000)   /* ms a failed lookup is kept */
+
+/* called with the address, 0 if the name was not found; from the
+   caller of dns_resolve on a cache hit, else from the worker thread */
+typedef void (*dns_found_fn)(int arg, uint32_t ip);
+
+void dns_init(void);
+/* 1 if answered from the cache, 0 if queued, -1 if the queue is full */
+int dns_resolve(const char *name, dns_found_fn fn, int arg);
+/* hand the answer of lookup idx to its Lua callback or task, on the
+   thread of the event queue */
+void dns_deliver(lua_State *L, int idx);
+
+#endif  /* __DNS_H__ */
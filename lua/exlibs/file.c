@@ -9,6 +9,7 @@
 
 #include "MicoPlatform.h"
 #include "user_config.h"
+#include "strbuf.h"
 
 #include "MicoWlan.h"
 #include "MICO.h"
@@ -29,6 +30,47 @@ static volatile int file_fd = FILE_NOT_OPENED;
 #define LUA_START_ADDRESS       (uint32_t)0x00C0000 
 #define LUA_FLASH_SIZE          (uint32_t)1024*(1024+256) 
 
+/* mount checkpoint lives in internal flash sector 2, which is unused apart
+   from the RF driver copy tag in its first byte, see platform.c */
+#define MICO_FLASH_FOR_LUA_CKPT MICO_INTERNAL_FLASH
+#define LUA_CKPT_SECTOR_ADDRESS (uint32_t)0x08008000
+#define LUA_CKPT_START_ADDRESS  (LUA_CKPT_SECTOR_ADDRESS + 0x10)
+#define LUA_CKPT_SIZE           (uint32_t)(0x4000 - 0x10)
+static uint32_t mount_time_ms = 0;
+
+/* spiffs api is entered from lua and from the background gc thread */
+#define LUA_SPIFFS_GC_PRIORITY  (MICO_APPLICATION_PRIORITY+1)
+#define LUA_SPIFFS_GC_INTERVAL  500   //ms between background gc steps
+#define LUA_SPIFFS_GC_IDLE      1000  //ms without file access before gc runs
+static mico_mutex_t spiffs_mutex = NULL;
+static volatile uint32_t spiffs_last_access = 0;
+static volatile bool spiffs_gc_enabled = true;
+static bool spiffs_gc_started = false;
+static mico_thread_t spiffs_gc_thread = NULL;
+
+void lspiffs_lock(void) {
+    if(spiffs_mutex==NULL) mico_rtos_init_mutex(&spiffs_mutex);
+    mico_rtos_lock_mutex(&spiffs_mutex);
+  }
+
+void lspiffs_unlock(void) {
+    //only use from other tasks keeps the gc waiting
+    if(spiffs_gc_thread==NULL || !mico_rtos_is_current_thread(&spiffs_gc_thread))
+      spiffs_last_access = mico_get_time();
+    mico_rtos_unlock_mutex(&spiffs_mutex);
+  }
+
+//reclaim one block at a time while the file system is idle
+static void lspiffs_gc_thread(void* arg) {
+    UNUSED_PARAMETER(arg);
+    while(1){
+      mico_thread_msleep(LUA_SPIFFS_GC_INTERVAL);
+      if(!spiffs_gc_enabled || SPIFFS_mounted(&fs)==false) continue;
+      if(mico_get_time() - spiffs_last_access < LUA_SPIFFS_GC_IDLE) continue;
+      SPIFFS_gc_background(&fs);
+    }
+  }
+
 static s32_t lspiffs_read(u32_t addr, u32_t size, u8_t *dst) {
     MicoFlashRead(MICO_FLASH_FOR_LUA,&addr,dst,size);
     return SPIFFS_OK;
@@ -39,14 +81,39 @@ static s32_t lspiffs_write(u32_t addr, u32_t size, u8_t *src) {
     return SPIFFS_OK;
   }
 
+/* spiffs only stamps blocks with a global erase counter, so erases of
+   each block are counted here since boot, see file.fsstat() */
+static uint16_t block_erases[LUA_FLASH_SIZE/65536];
+
 static s32_t lspiffs_erase(u32_t addr, u32_t size) {
+    if((addr-LUA_START_ADDRESS)%65536==0)
+      block_erases[(addr-LUA_START_ADDRESS)/65536]++;
     MicoFlashErase(MICO_FLASH_FOR_LUA,addr,addr+size-1);
     MicoWdgReload();//in case wathdog
     return SPIFFS_OK;
   } 
 
+static s32_t lspiffs_ckpt_read(u32_t addr, u32_t size, u8_t *dst) {
+    MicoFlashRead(MICO_FLASH_FOR_LUA_CKPT,&addr,dst,size);
+    return SPIFFS_OK;
+  }
+
+static s32_t lspiffs_ckpt_write(u32_t addr, u32_t size, u8_t *src) {
+    if(MicoFlashWrite(MICO_FLASH_FOR_LUA_CKPT,&addr,src,size)!=kNoErr)
+      return SPIFFS_ERR_INTERNAL;
+    return SPIFFS_OK;
+  }
+
+static s32_t lspiffs_ckpt_erase(u32_t addr, u32_t size) {
+    //whole sector is erased, including the (unset) RF driver copy tag
+    MicoFlashErase(MICO_FLASH_FOR_LUA_CKPT,LUA_CKPT_SECTOR_ADDRESS,addr+size-1);
+    MicoWdgReload();//in case wathdog
+    return SPIFFS_OK;
+  }
+
 void lua_spiffs_mount() {
     spiffs_config cfg;    
+    memset(&cfg, 0, sizeof(cfg));
     cfg.phys_size = LUA_FLASH_SIZE;
     cfg.phys_addr = LUA_START_ADDRESS; // start spiffs at start of spi flash
     cfg.phys_erase_block = 65536/2; // according to datasheet
@@ -57,10 +124,18 @@ void lua_spiffs_mount() {
     cfg.hal_write_f = lspiffs_write;
     cfg.hal_erase_f = lspiffs_erase;
     
+    cfg.hal_ckpt_read_f = lspiffs_ckpt_read;
+    cfg.hal_ckpt_write_f = lspiffs_ckpt_write;
+    cfg.hal_ckpt_erase_f = lspiffs_ckpt_erase;
+    cfg.ckpt_addr = LUA_CKPT_START_ADDRESS;
+    cfg.ckpt_size = LUA_CKPT_SIZE;
+    
     MicoFlashInitialize(MICO_FLASH_FOR_LUA);
+    MicoFlashInitialize(MICO_FLASH_FOR_LUA_CKPT);
     
     if(SPIFFS_mounted(&fs)) return;
     
+    uint32_t t = mico_get_time();
     int res = SPIFFS_mount(&fs,
       &cfg,
       spiffs_work_buf,
@@ -69,6 +144,90 @@ void lua_spiffs_mount() {
       spiffs_cache_buf,
       sizeof(spiffs_cache_buf),
       0);
+    mount_time_ms = mico_get_time() - t;
+    
+    if(res==SPIFFS_OK && !spiffs_gc_started){
+      spiffs_gc_started = true;
+      mico_rtos_create_thread(&spiffs_gc_thread, LUA_SPIFFS_GC_PRIORITY, "spiffs_gc", lspiffs_gc_thread, 0x400, NULL);
+    }
+}
+
+/* append-only log, see file.logopen(). Records are gathered in RAM and
+   only whole data pages are written, so the object index header is
+   rewritten once per page instead of once per record. */
+static volatile int log_fd = FILE_NOT_OPENED;
+static char log_name[SPIFFS_OBJ_NAME_LEN];
+static u8_t log_buf[LOG_PAGE_SIZE];
+static u32_t log_pos = 0;       //end of data in current data page
+static u32_t log_committed = 0; //part of current data page already in flash
+static u32_t log_size = 0;      //file size including buffered data
+static u32_t log_max = 0;       //rotate at this size, 0 for no limit
+
+static int log_commit(void) {
+    if(log_pos==log_committed) return SPIFFS_OK;
+    if(SPIFFS_write(&fs,log_fd,&log_buf[log_committed],log_pos-log_committed)<0)
+      return -1;
+    log_committed = log_pos;
+    if(log_pos==SPIFFS_DATA_PAGE_SIZE(&fs))
+      log_pos = log_committed = 0;
+    return SPIFFS_OK;
+}
+
+static int log_append(const char *data, u32_t len) {
+    while(len>0){
+      u32_t n = MIN(len, SPIFFS_DATA_PAGE_SIZE(&fs)-log_pos);
+      memcpy(&log_buf[log_pos],data,n);
+      log_pos += n;
+      log_size += n;
+      data += n;
+      len -= n;
+      if(log_pos==SPIFFS_DATA_PAGE_SIZE(&fs) && log_commit()<0)
+        return -1;
+    }
+    return SPIFFS_OK;
+}
+
+static int log_open(void) {
+    spiffs_stat s;
+    log_fd = SPIFFS_open(&fs,log_name,SPIFFS_WRONLY|SPIFFS_CREAT|SPIFFS_APPEND|SPIFFS_DIRECT,0);
+    if(log_fd < FILE_NOT_OPENED){
+      log_fd = FILE_NOT_OPENED;
+      return -1;
+    }
+    if(SPIFFS_fstat(&fs,log_fd,&s)<0){
+      SPIFFS_close(&fs,log_fd);
+      log_fd = FILE_NOT_OPENED;
+      return -1;
+    }
+    //continue in the free part of the last data page
+    log_size = s.size;
+    log_pos = log_committed = log_size % SPIFFS_DATA_PAGE_SIZE(&fs);
+    return SPIFFS_OK;
+}
+
+static void log_close(void) {
+    if(FILE_NOT_OPENED==log_fd) return;
+    log_commit();
+    SPIFFS_close(&fs,log_fd);
+    log_fd = FILE_NOT_OPENED;
+}
+
+//the full log is renamed to <name>.1, no data is copied
+static int log_rotate(void) {
+    char old[SPIFFS_OBJ_NAME_LEN];
+    log_close();
+    sprintf(old,"%s.1",log_name);
+    SPIFFS_remove(&fs,old);
+    SPIFFS_rename(&fs,log_name,old);
+    return log_open();
+}
+
+//flush cached writes and leave a mount checkpoint, e.g. before reboot
+void lua_spiffs_unmount() {
+    if(SPIFFS_mounted(&fs)==false) return;
+    log_close();
+    file_fd = FILE_NOT_OPENED;
+    SPIFFS_unmount(&fs);
 }
 
 int mode2flag(char *mode){
@@ -132,7 +291,7 @@ static int file_format( lua_State* L )
 {
   if(SPIFFS_mounted(&fs)==false) lua_spiffs_mount();
    
-  SPIFFS_unmount(&fs);
+  lua_spiffs_unmount();
   
   int ret = SPIFFS_format(&fs);
   if(ret==SPIFFS_OK)
@@ -145,6 +304,36 @@ static int file_format( lua_State* L )
   return 0;
 }
 
+//ms, fromcheckpoint = file.remount([fullscan])
+static int file_remount( lua_State* L )
+{
+  bool fullscan = false;
+  if( lua_isboolean( L, 1 ) )
+    fullscan = lua_toboolean( L, 1 );
+  lua_spiffs_unmount();
+  if(fullscan){
+    //drop the checkpoint written by unmount
+    lspiffs_ckpt_erase(LUA_CKPT_START_ADDRESS, LUA_CKPT_SIZE);
+  }
+  lua_spiffs_mount();
+  if(SPIFFS_mounted(&fs)==false)
+    return luaL_error(L, "mount failed");
+  lua_pushinteger(L, mount_time_ms);
+  lua_pushboolean(L, fs.ckpt_mounted);
+  return 2;
+}
+
+//bgruns, gcruns, freeblocks = file.gc([enable])
+static int file_gc( lua_State* L )
+{
+  if( lua_isboolean( L, 1 ) )
+    spiffs_gc_enabled = lua_toboolean( L, 1 );
+  lua_pushinteger(L, fs.stats_gc_bg_runs);
+  lua_pushinteger(L, fs.stats_gc_runs);
+  lua_pushinteger(L, fs.free_blocks);
+  return 3;
+}
+
 // file.open(filename, mode)
 static int file_open( lua_State* L )
 {
@@ -178,14 +367,18 @@ static int file_close( lua_State* L )
   return 0;  
 }
 
-// file.write("string")
+static int file_write_piece(const char *p, size_t len, void *ud)
+{
+  (void)ud;
+  return SPIFFS_write(&fs,file_fd, (char*)p, len)<0;
+}
+
+// file.write("string" or strbuf)
 static int file_write( lua_State* L )
 {
   if(FILE_NOT_OPENED==file_fd)
     return luaL_error(L, "open a file first");
-  size_t len;
-  const char *s = luaL_checklstring(L, 1, &len);
-  if(SPIFFS_write(&fs,file_fd, (char*)s, len)<0)
+  if(strbuf_write(L, 1, file_write_piece, NULL))
   {//failed
     SPIFFS_close(&fs,file_fd);
     file_fd = FILE_NOT_OPENED;
@@ -195,14 +388,12 @@ static int file_write( lua_State* L )
     lua_pushboolean(L, true);
   return 1;
 }
-// file.writeline("string")
+// file.writeline("string" or strbuf)
 static int file_writeline( lua_State* L )
 {
   if(FILE_NOT_OPENED==file_fd)
     return luaL_error(L, "open a file first");
-  size_t len;
-  const char *s = luaL_checklstring(L, 1, &len);
-  if(SPIFFS_write(&fs,file_fd, (char*)s, len)<0)
+  if(strbuf_write(L, 1, file_write_piece, NULL))
   {//failed
     lua_pushnil(L);
     SPIFFS_close(&fs,file_fd);
@@ -325,6 +516,17 @@ static int file_flush( lua_State* L )
     lua_pushnil(L);
   return 1;
 }
+//file.sync(), writes cached data of all files and a mount checkpoint, so
+//that mounting after a power loss is fast until the next change
+static int file_sync( lua_State* L )
+{
+  if(FILE_NOT_OPENED!=log_fd) log_commit();
+  if(SPIFFS_sync(&fs) == SPIFFS_OK)
+    lua_pushboolean(L, 1);
+  else
+    lua_pushnil(L);
+  return 1;
+}
 // file.remove(filename)
 static int file_remove( lua_State* L )
 {
@@ -333,6 +535,8 @@ static int file_remove( lua_State* L )
   if( len > SPIFFS_OBJ_NAME_LEN )
     return luaL_error(L, "filename too long");
   file_close(L);
+  if(FILE_NOT_OPENED!=log_fd && strcmp(fname, log_name)==0)
+    log_close();
   SPIFFS_remove(&fs, (char *)fname);
   return 0;  
 }
@@ -376,6 +580,81 @@ static int file_info( lua_State* L )
   lua_pushinteger(L, total);
   return 3;
 }
+//table = file.fsstat()
+static int file_fsstat( lua_State* L )
+{
+  spiffs_block_stat bs;
+  spiffs_block_ix bix;
+  uint32_t age;
+  if(SPIFFS_mounted(&fs)==false)
+    return luaL_error(L, "file system not mounted");
+
+  lua_newtable( L );
+  lua_newtable( L );
+  for(bix=0; bix<fs.block_count; bix++){
+    if(SPIFFS_block_stat(&fs, bix, &bs)<0)
+      return luaL_error(L, "file system error");
+    lua_newtable( L );
+    //erases of the file system since this block was erased
+    if(bs.erase_count==(spiffs_obj_id)-1)
+      age = 0;
+    else if(fs.max_erase_count > bs.erase_count)
+      age = fs.max_erase_count - bs.erase_count;
+    else
+      age = SPIFFS_OBJ_ID_FREE - (bs.erase_count - fs.max_erase_count);
+    lua_pushinteger(L, age);
+    lua_setfield( L, -2, "age" );
+    lua_pushinteger(L, block_erases[bix]);
+    lua_setfield( L, -2, "erases" );
+    lua_pushinteger(L, bs.used);
+    lua_setfield( L, -2, "used" );
+    lua_pushinteger(L, bs.deleted);
+    lua_setfield( L, -2, "deleted" );
+    lua_pushinteger(L, bs.free);
+    lua_setfield( L, -2, "free" );
+    lua_rawseti( L, -2, bix+1 );
+  }
+  lua_setfield( L, -2, "blocks" );
+
+  lua_pushinteger(L, fs.max_erase_count);
+  lua_setfield( L, -2, "maxerase" );
+  lua_pushinteger(L, fs.free_blocks);
+  lua_setfield( L, -2, "freeblocks" );
+  lua_pushinteger(L, fs.stats_gc_runs);
+  lua_setfield( L, -2, "gcruns" );
+  lua_pushinteger(L, fs.stats_gc_bg_runs);
+  lua_setfield( L, -2, "bggcruns" );
+  lua_pushinteger(L, fs.cache_hits);
+  lua_setfield( L, -2, "cachehits" );
+  lua_pushinteger(L, fs.cache_misses);
+  lua_setfield( L, -2, "cachemisses" );
+  //percentages, lua numbers are integers
+  lua_pushinteger(L, fs.cache_hits+fs.cache_misses==0 ? 0 :
+    (uint32_t)((uint64_t)fs.cache_hits*100/(fs.cache_hits+fs.cache_misses)));
+  lua_setfield( L, -2, "cachehit" );
+  lua_pushinteger(L, fs.stats_wr_user);
+  lua_setfield( L, -2, "userbytes" );
+  lua_pushinteger(L, fs.stats_wr_phys);
+  lua_setfield( L, -2, "flashbytes" );
+  lua_pushinteger(L, fs.stats_erases);
+  lua_setfield( L, -2, "erases" );
+  lua_pushinteger(L, fs.stats_wr_user==0 ? 0 :
+    (uint32_t)((uint64_t)fs.stats_wr_phys*100/fs.stats_wr_user));
+  lua_setfield( L, -2, "wamp" );
+  return 1;
+}
+
+//enabled = file.memoize([enable])
+static int file_memoize( lua_State* L )
+{
+  int enable = -1;
+  if( lua_isboolean( L, 1 ) )
+    enable = lua_toboolean( L, 1 );
+  luaL_memoizelc( enable );
+  lua_pushboolean(L, luaL_memoizelc( -1 ));
+  return 1;
+}
+
 //file.state()
 static int file_state( lua_State* L )
 {
@@ -390,6 +669,66 @@ static int file_state( lua_State* L )
   return 2;
 }
 
+//file.logopen(filename[, maxsize])
+static int file_logopen( lua_State* L )
+{
+  size_t len;
+  const char *fname = luaL_checklstring( L, 1, &len );
+  if( len + 2 >= SPIFFS_OBJ_NAME_LEN )//room for ".1" when rotated
+    return luaL_error(L, "filename too long");
+  unsigned max = luaL_optinteger( L, 2, 0 );
+  
+  log_close();
+  strcpy(log_name, fname);
+  log_max = max;
+  if(log_open()<0)
+    lua_pushnil(L);
+  else
+    lua_pushboolean(L, true);
+  return 1;
+}
+
+//file.log("record"), record is appended with "\r\n"
+static int file_log( lua_State* L )
+{
+  if(FILE_NOT_OPENED==log_fd)
+    return luaL_error(L, "open a log first");
+  size_t len;
+  const char *s = luaL_checklstring(L, 1, &len);
+  if(log_max>0 && log_size>0 && log_size+len+2>log_max && log_rotate()<0)
+  {//reopen failed
+    lua_pushnil(L);
+    return 1;
+  }
+  if(log_append(s, len)<0 || log_append("\r\n", 2)<0)
+  {//failed
+    log_close();
+    lua_pushnil(L);
+  }
+  else//success
+    lua_pushboolean(L, true);
+  return 1;
+}
+
+//file.logflush(), writes buffered records
+static int file_logflush( lua_State* L )
+{
+  if(FILE_NOT_OPENED==log_fd)
+    return luaL_error(L, "open a log first");
+  if(log_commit() == SPIFFS_OK)
+    lua_pushboolean(L, 1);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+//file.logclose()
+static int file_logclose( lua_State* L )
+{
+  log_close();
+  return 0;
+}
+
 #include "ldo.h"
 #include "lfunc.h"
 #include "lmem.h"
@@ -462,6 +801,101 @@ static int file_compile( lua_State* L )
   return 0;
 }
 
+#include "limage.h"
+#include "CRCUtils.h"
+static bool flash_image_checked = false;
+static const LuaImageHeader *flash_image = NULL;
+
+static bool flash_image_header_ok(const LuaImageHeader *h)
+{
+  return h->magic == LUA_IMAGE_MAGIC && h->version == LUA_IMAGE_VERSION &&
+    h->size <= LUA_IMAGE_FLASH_SIZE &&
+    h->size >= sizeof(LuaImageHeader) + h->count*sizeof(LuaImageEntry);
+}
+
+//checked once, the image only changes by file.flashload() which restarts
+const LuaImageHeader *lua_flash_image(void)
+{
+  const LuaImageHeader *h = (const LuaImageHeader *)LUA_IMAGE_START_ADDRESS;
+  if(!flash_image_checked){
+    flash_image_checked = true;
+    if(flash_image_header_ok(h) &&
+       CRC32_Update(0, h+1, h->size-sizeof(LuaImageHeader)) == h->crc)
+      flash_image = h;
+  }
+  return flash_image;
+}
+
+//file.flashload("lua.img"), writes image to internal flash and restarts
+static int file_flashload( lua_State* L )
+{
+  LuaImageHeader h;
+  uint8_t buf[LOG_PAGE_SIZE];
+  uint32_t crc = 0;
+  uint32_t addr, left, n;
+  int fd;
+  const char *fname = luaL_checkstring( L, 1 );
+  if( fname == NULL || strlen(fname)>SPIFFS_OBJ_NAME_LEN )
+    return luaL_error(L, "filename invalid");
+  //older bootloaders may write an application over sector 7
+  if(!mico_bootloader_is_at_least(LUA_IMAGE_BOOTLOADER_REVISION))
+    return luaL_error(L, "flash image needs bootloader %s", LUA_IMAGE_BOOTLOADER_REVISION);
+
+  fd = SPIFFS_open(&fs, (char*)fname, SPIFFS_RDONLY, 0);
+  if(fd < FILE_NOT_OPENED)
+    return luaL_error(L, "cannot open %s", fname);
+  //verify all of the new image before the old one is erased
+  if(SPIFFS_read(&fs, fd, &h, sizeof(h)) != sizeof(h) || !flash_image_header_ok(&h)){
+    SPIFFS_close(&fs, fd);
+    return luaL_error(L, "not a flash image");
+  }
+  for(left=h.size-sizeof(h); left>0; left-=n){
+    n = left<sizeof(buf) ? left : sizeof(buf);
+    if(SPIFFS_read(&fs, fd, buf, n) != n) break;
+    crc = CRC32_Update(crc, buf, n);
+  }
+  if(left>0 || crc != h.crc){
+    SPIFFS_close(&fs, fd);
+    return luaL_error(L, "flash image is corrupt");
+  }
+
+  //functions of the old image are still referenced from lua, the system
+  //is restarted once the new image is written
+  SPIFFS_lseek(&fs, fd, 0, SPIFFS_SEEK_SET);
+  MicoFlashInitialize(MICO_FLASH_FOR_LUA_IMAGE);
+  MicoWdgReload();
+  MicoFlashErase(MICO_FLASH_FOR_LUA_IMAGE, LUA_IMAGE_START_ADDRESS, LUA_IMAGE_END_ADDRESS);
+  MicoWdgReload();
+  addr = LUA_IMAGE_START_ADDRESS;
+  for(left=h.size; left>0; left-=n){
+    n = left<sizeof(buf) ? left : sizeof(buf);
+    if(SPIFFS_read(&fs, fd, buf, n) != n ||
+       MicoFlashWrite(MICO_FLASH_FOR_LUA_IMAGE, &addr, buf, n) != kNoErr) break;
+    MicoWdgReload();
+  }
+  SPIFFS_close(&fs, fd);
+  //if writing failed, the crc check leaves the image unused after restart
+  MicoSystemReboot();
+  return 0;
+}
+
+//table = file.flashindex(), module name and size of each chunk in the image
+static int file_flashindex( lua_State* L )
+{
+  const LuaImageHeader *h = lua_flash_image();
+  uint32_t i;
+  if(h==NULL){
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_newtable( L );
+  for(i=0; i<h->count; i++){
+    lua_pushinteger(L, LUA_IMAGE_ENTRY(h, i)->size);
+    lua_setfield( L, -2, LUA_IMAGE_ENTRY(h, i)->name );
+  }
+  return 1;
+}
+
 #define MIN_OPT_LEVEL   2
 #include "lrodefs.h"
 const LUA_REG_TYPE file_map[] =
@@ -478,10 +912,21 @@ const LUA_REG_TYPE file_map[] =
   { LSTRKEY( "remove" ), LFUNCVAL( file_remove ) },
   { LSTRKEY( "seek" ), LFUNCVAL( file_seek ) },
   { LSTRKEY( "flush" ), LFUNCVAL( file_flush ) },
+  { LSTRKEY( "sync" ), LFUNCVAL( file_sync ) },
   { LSTRKEY( "rename" ), LFUNCVAL( file_rename ) },
   { LSTRKEY( "info" ), LFUNCVAL( file_info ) },
   { LSTRKEY( "state" ), LFUNCVAL( file_state ) },
+  { LSTRKEY( "fsstat" ), LFUNCVAL( file_fsstat ) },
+  { LSTRKEY( "memoize" ), LFUNCVAL( file_memoize ) },
   { LSTRKEY( "compile" ), LFUNCVAL( file_compile ) },
+  { LSTRKEY( "flashload" ), LFUNCVAL( file_flashload ) },
+  { LSTRKEY( "flashindex" ), LFUNCVAL( file_flashindex ) },
+  { LSTRKEY( "remount" ), LFUNCVAL( file_remount ) },
+  { LSTRKEY( "gc" ), LFUNCVAL( file_gc ) },
+  { LSTRKEY( "logopen" ), LFUNCVAL( file_logopen ) },
+  { LSTRKEY( "log" ), LFUNCVAL( file_log ) },
+  { LSTRKEY( "logflush" ), LFUNCVAL( file_logflush ) },
+  { LSTRKEY( "logclose" ), LFUNCVAL( file_logclose ) },
 #if LUA_OPTIMIZE_MEMORY > 0
 #endif  
   {LNILKEY, LNILVAL}
@@ -138,14 +138,48 @@ static int lgpio_mode( lua_State* L )
   return 0;  
 }
 
+// Fast versions, called by the VM with integer arguments (lrotable.h)
+static int fgpio_read( lua_Integer *res, lua_Integer pin, lua_Integer b, lua_Integer c )
+{
+  if( !platform_gpio_exists( pin ) )
+    return 1;
+  *res = MicoGpioInputGet( (mico_gpio_t)wifimcu_gpio_map[pin] );
+  return 0;
+}
+
+static int fgpio_write( lua_Integer *res, lua_Integer pin, lua_Integer level, lua_Integer c )
+{
+  if( !platform_gpio_exists( pin ) )
+    return 1;
+  if ( level!=HIGH && level!=LOW && level!=1 && level!=0 )
+    return 2;
+  if( level == HIGH || level == 1)
+    MicoGpioOutputHigh( (mico_gpio_t)wifimcu_gpio_map[pin] );
+  else
+    MicoGpioOutputLow( (mico_gpio_t)wifimcu_gpio_map[pin] );
+  return 0;
+}
+
+static int fgpio_toggle( lua_Integer *res, lua_Integer pin, lua_Integer b, lua_Integer c )
+{
+  if( !platform_gpio_exists( pin ) )
+    return 1;
+  pin = wifimcu_gpio_map[pin];
+  if(MicoGpioInputGet( (mico_gpio_t)pin ))
+    MicoGpioOutputLow( (mico_gpio_t)pin );
+  else
+    MicoGpioOutputHigh( (mico_gpio_t)pin );
+  return 0;
+}
+
 // Lua: read( pin )
 static int lgpio_read( lua_State* L )
 {
+  lua_Integer level;
   unsigned pin=0;  
   pin = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( gpio, pin );
-  pin = wifimcu_gpio_map[pin];
-  unsigned level = MicoGpioInputGet( (mico_gpio_t)pin );
+  fgpio_read( &level, pin, 0, 0 );
   lua_pushinteger( L, level );
   return 1; 
 }
@@ -157,14 +191,9 @@ static int lgpio_write( lua_State* L )
   unsigned pin;
   pin = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( gpio, pin );
-  pin = wifimcu_gpio_map[pin];
   level = luaL_checkinteger( L, 2 );
-  if ( level!=HIGH && level!=LOW && level!=1 && level!=0 )
+  if ( fgpio_write( NULL, pin, level, 0 ) )
     return luaL_error( L, "wrong arg type" );
-  if( level == HIGH || level == 1)
-    MicoGpioOutputHigh( (mico_gpio_t)pin );
-  else
-    MicoGpioOutputLow( (mico_gpio_t)pin );
   return 0;  
 }
 
@@ -173,22 +202,24 @@ static int lgpio_toggle( lua_State* L )
   unsigned pin=0;
   pin = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( gpio, pin );
-  pin = wifimcu_gpio_map[pin];
-  if(MicoGpioInputGet( (mico_gpio_t)pin ))
-    MicoGpioOutputLow( (mico_gpio_t)pin );
-  else
-    MicoGpioOutputHigh( (mico_gpio_t)pin );
+  fgpio_toggle( NULL, pin, 0, 0 );
   return 0;  
 }
 
+#ifdef LUA_USE_FASTFUNC
+LUA_FASTFUNC( lgpio_read, fgpio_read );
+LUA_FASTFUNC( lgpio_write, fgpio_write );
+LUA_FASTFUNC( lgpio_toggle, fgpio_toggle );
+#endif
+
 #define MIN_OPT_LEVEL  2
 #include "lrodefs.h"
 const LUA_REG_TYPE gpio_map[] =
 {
   { LSTRKEY( "mode" ), LFUNCVAL( lgpio_mode ) },
-  { LSTRKEY( "read" ), LFUNCVAL( lgpio_read ) },
-  { LSTRKEY( "write" ), LFUNCVAL( lgpio_write ) },
-  { LSTRKEY( "toggle" ), LFUNCVAL( lgpio_toggle ) },
+  { LSTRKEY( "read" ), LFASTFUNCVAL( lgpio_read, 1, 1 ) },
+  { LSTRKEY( "write" ), LFASTFUNCVAL( lgpio_write, 2, 0 ) },
+  { LSTRKEY( "toggle" ), LFASTFUNCVAL( lgpio_toggle, 1, 0 ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "INPUT" ), LNUMVAL( INPUT ) },
   { LSTRKEY( "INPUT_PULL_UP" ), LNUMVAL( INPUT_PULL_UP ) },
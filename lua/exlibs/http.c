@@ -0,0 +1,657 @@
+/**
+ * http.c
+ */
+
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "user_config.h"
+
+#include "MICO.h"
+#include "MICORTOS.h"
+#include "SocketUtils.h"
+#include "StringUtils.h"
+#include "HTTPServerUtils.h"
+#include "strbuf.h"
+#include "http.h"
+
+#include <spiffs.h>
+#include <spiffs_nucleus.h>
+
+extern mico_queue_t os_queue;
+extern spiffs fs;
+
+#define HTTP_CHUNKED    -1    /* http_send_head len: body sent in chunks */
+#define HTTP_NOBODY     -2    /* http_send_head len: no body at all */
+#define HTTP_TYPE_LEN   48    /* longest content type from Lua */
+
+typedef struct {
+  char method[HTTP_METHOD_LEN+1];   /* "" for any */
+  char path[HTTP_ROUTE_LEN+1];      /* ending with '*' matches the prefix */
+  int ref;                          /* handler, LUA_NOREF if free */
+} http_route_t;
+
+typedef struct {
+  int route;              /* route of the request given to Lua, -1 if none */
+  spiffs_file file;       /* file being sent, 0 if none */
+  uint32_t left;          /* bytes of it still to send */
+  bool started;           /* response head sent */
+  bool chunked;           /* response body sent in chunks */
+  bool failed;            /* a send failed, the connection goes */
+  volatile bool answered; /* handler done, the http thread goes on */
+} http_conn_t;
+
+typedef struct {
+  HTTPServer_t server;
+  HTTPConnection_t conns[HTTP_MAX_CONN];
+  http_conn_t state[HTTP_MAX_CONN];
+  char page[HTTP_SEND_LEN];
+} http_t;
+
+static http_t *http = NULL;       /* while the server runs */
+static int http_gen = 0;          /* events of an older server are dropped */
+static int http_current = -1;     /* request of the running handler */
+static volatile bool http_running = false, http_stopping = false;
+static mico_semaphore_t http_sem = NULL;
+static mico_mutex_t http_mutex = NULL;
+static lua_State *http_L = NULL;
+/* routes and the static url are set by Lua and read by the http thread */
+static http_route_t http_routes[HTTP_MAX_ROUTES];
+static char http_static_url[HTTP_ROUTE_LEN+1];
+static char http_static_dir[SPIFFS_OBJ_NAME_LEN];
+static bool http_static_on = false;
+
+static bool http_send(HTTPConnection_t *conn, const char *p, size_t len)
+{
+  http_conn_t *c = conn->userContext;
+  if (!c->failed && len > 0 && SocketSend(conn->fd, (const uint8_t *)p, len) != kNoErr)
+    c->failed = true;
+  return !c->failed;
+}
+
+/* status line and header fields, len is the Content-Length or one of
+   HTTP_CHUNKED and HTTP_NOBODY */
+static bool http_send_head(HTTPConnection_t *conn, int status, const char *type,
+                           const char *etag, int len)
+{
+  char head[200];
+  int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\n", status, getStatusString(status));
+  if (type != NULL)
+    n += snprintf(head+n, sizeof(head)-n, "Content-Type: %s\r\n", type);
+  if (etag != NULL)
+    n += snprintf(head+n, sizeof(head)-n, "ETag: %s\r\n", etag);
+  if (len == HTTP_CHUNKED)
+    n += snprintf(head+n, sizeof(head)-n, "Transfer-Encoding: chunked\r\n");
+  else if (len >= 0)
+    n += snprintf(head+n, sizeof(head)-n, "Content-Length: %d\r\n", len);
+  if (!conn->header.persistent)
+    n += snprintf(head+n, sizeof(head)-n, "Connection: close\r\n");
+  n += snprintf(head+n, sizeof(head)-n, "\r\n");
+  ((http_conn_t *)conn->userContext)->started = true;
+  return http_send(conn, head, n);
+}
+
+static const char *http_mime(const char *name)
+{
+  static const char *const types[] = {
+    "html", kMIMEType_TextHTML, "htm", kMIMEType_TextHTML,
+    "css", "text/css", "js", "application/javascript",
+    "json", kMIMEType_JSON, "txt", kMIMEType_TextPlain,
+    "png", "image/png", "jpg", "image/jpeg", "gif", "image/gif",
+    "ico", "image/x-icon", "svg", "image/svg+xml", NULL
+  };
+  const char *ext = strrchr(name, '.');
+  if (ext != NULL)
+    for (int i = 0; types[i] != NULL; i += 2)
+      if (strnicmpx(ext+1, strlen(ext+1), types[i]) == 0)
+        return types[i+1];
+  return kMIMEType_Binary;
+}
+
+/* true if If-None-Match lists etag, or is "*" */
+static bool http_etag_match(HTTPHeader_t *h, const char *etag)
+{
+  const char *v;
+  size_t vl, n = strlen(etag);
+  if (HTTPHeaderGetField(h, "If-None-Match", &v, &vl) != kNoErr)
+    return false;
+  if (vl == 1 && v[0] == '*')
+    return true;
+  for (; vl >= n; v++, vl--)
+    if (memcmp(v, etag, n) == 0)
+      return true;
+  return false;
+}
+
+/* answer with the file, false if there is no such file; the body is sent
+   by the http thread once the connection is no longer with Lua */
+static bool http_file_start(HTTPConnection_t *conn, const char *name)
+{
+  http_conn_t *c = conn->userContext;
+  spiffs_stat s;
+  spiffs_fd *fd;
+  char etag[28];
+  spiffs_file fh = SPIFFS_open(&fs, (char *)name, SPIFFS_RDONLY, 0);
+  if (fh < 0)
+    return false;
+  if (SPIFFS_fstat(&fs, fh, &s) < 0 || spiffs_fd_get(&fs, fh, &fd) < 0) {
+    SPIFFS_close(&fs, fh);
+    return false;
+  }
+  /* the index header goes to a new page whenever the file is written */
+  snprintf(etag, sizeof(etag), "\"%x-%x-%x\"", (unsigned)s.obj_id,
+           (unsigned)fd->objix_hdr_pix, (unsigned)s.size);
+  if (http_etag_match(&conn->header, etag))
+    http_send_head(conn, kStatusNotModified, NULL, etag, HTTP_NOBODY);
+  else if (http_send_head(conn, kStatusOK, http_mime(name), etag, s.size) &&
+           s.size > 0 && HTTPHeaderMatchMethod(&conn->header, "HEAD") != kNoErr) {
+    c->file = fh;
+    c->left = s.size;
+    return true;
+  }
+  SPIFFS_close(&fs, fh);
+  return true;
+}
+
+/* the response is complete, or failed */
+static void http_done(HTTPConnection_t *conn)
+{
+  if (((http_conn_t *)conn->userContext)->failed)
+    HTTPServerCloseConnection(&http->server, conn);
+  else
+    HTTPServerResume(&http->server, conn);
+}
+
+/* send the next pages of the file, the socket is writable */
+static void http_file_send(HTTPConnection_t *conn)
+{
+  http_conn_t *c = conn->userContext;
+  s32_t n = c->left < HTTP_SEND_LEN ? c->left : HTTP_SEND_LEN;
+  n = SPIFFS_read(&fs, c->file, http->page, n);
+  if (n <= 0)
+    c->failed = true;
+  else if (http_send(conn, http->page, n))
+    c->left -= n;
+  conn->lastActive = mico_get_time();
+  if (c->failed || c->left == 0) {
+    SPIFFS_close(&fs, c->file);
+    c->file = 0;
+    http_done(conn);
+  }
+}
+
+static int http_match(HTTPHeader_t *h)
+{
+  int i, found = -1;
+  mico_rtos_lock_mutex(&http_mutex);
+  for (i = 0; i < HTTP_MAX_ROUTES && found < 0; i++) {
+    http_route_t *r = &http_routes[i];
+    size_t n = strlen(r->path);
+    if (r->ref == LUA_NOREF)
+      continue;
+    if (r->method[0] != 0 && strnicmpx(h->methodPtr, h->methodLen, r->method) != 0)
+      continue;
+    if (n > 0 && r->path[n-1] == '*') {
+      if (h->url.pathLen >= n-1 && memcmp(h->url.pathPtr, r->path, n-1) == 0)
+        found = i;
+    }
+    else if (h->url.pathLen == n && memcmp(h->url.pathPtr, r->path, n) == 0)
+      found = i;
+  }
+  mico_rtos_unlock_mutex(&http_mutex);
+  return found;
+}
+
+/* file name of a GET or HEAD under the static url, false if it is not */
+static bool http_static_name(HTTPHeader_t *h, char *name)
+{
+  const char *p = h->url.pathPtr;
+  size_t n, d, rest;
+  const char *index;
+  bool ok = false;
+  if (HTTPHeaderMatchMethod(h, "GET") != kNoErr && HTTPHeaderMatchMethod(h, "HEAD") != kNoErr)
+    return false;
+  mico_rtos_lock_mutex(&http_mutex);
+  n = strlen(http_static_url);
+  d = strlen(http_static_dir);
+  if (http_static_on && h->url.pathLen >= n && memcmp(p, http_static_url, n) == 0) {
+    p += n;
+    rest = h->url.pathLen - n;
+    if (rest > 0 && p[0] == '/') {
+      p++;
+      rest--;
+    }
+    else if (rest > 0 && n > 0 && http_static_url[n-1] != '/')
+      rest = SPIFFS_OBJ_NAME_LEN;   /* "/wwwx" is not under "/www" */
+    index = (rest == 0 || p[rest-1] == '/') ? "index.html" : "";
+    if (d + rest + strlen(index) < SPIFFS_OBJ_NAME_LEN) {
+      memcpy(name, http_static_dir, d);
+      memcpy(name + d, p, rest);
+      strcpy(name + d + rest, index);
+      ok = true;
+    }
+  }
+  mico_rtos_unlock_mutex(&http_mutex);
+  return ok;
+}
+
+/* bodies too long to keep, and chunked ones, are dropped as they come */
+static OSStatus http_body(HTTPHeader_t *h, uint32_t pos, uint8_t *data, size_t len, void *ctx)
+{
+  (void)pos; (void)data; (void)len; (void)ctx;
+  return (h->chunkedData || h->contentLength > HTTP_MAX_BODY) ? kNoErr : kUnsupportedErr;
+}
+
+/* on the http thread: routes go to Lua, files under the static url are
+   sent from here */
+static OSStatus http_request(HTTPServer_t *server, HTTPConnection_t *conn)
+{
+  http_conn_t *c = conn->userContext;
+  HTTPHeader_t *h = &conn->header;
+  char name[SPIFFS_OBJ_NAME_LEN];
+  queue_msg_t msg;
+  (void)server;
+
+  c->started = c->chunked = c->failed = false;
+  if (h->chunkedData)
+    http_send_head(conn, kStatusLengthRequired, NULL, NULL, 0);
+  else if (h->isCallbackSupported)
+    http_send_head(conn, kStatusPayloadTooLarge, NULL, NULL, 0);
+  else if ((c->route = http_match(h)) >= 0) {
+    msg.L = http_L;
+    msg.source = HTTP;
+    msg.para1 = http_gen;
+    msg.para2 = conn - http->conns;
+    conn->busy = true;
+    if (mico_rtos_push_to_queue(&os_queue, &msg, 0) == kNoErr)
+      return kNoErr;
+    conn->busy = false;
+    c->route = -1;
+    http_send_head(conn, kStatusServiceUnavailable, NULL, NULL, 0);
+  }
+  else if (!http_static_name(h, name) || !http_file_start(conn, name))
+    http_send_head(conn, kStatusNotFound, NULL, NULL, 0);
+  else if (c->file != 0)
+    conn->busy = true;
+  return c->failed ? kConnectionErr : kNoErr;
+}
+
+static void http_thread(void *inContext)
+{
+  (void)inContext;
+  fd_set readSet, writeSet;
+  struct timeval_t t;
+  HTTPConnection_t *conn;
+  http_conn_t *c;
+  int i, maxFd;
+  int event_fd = mico_create_event_fd(http_sem);
+
+  while (!http_stopping)
+  {
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_SET(event_fd, &readSet);
+    maxFd = HTTPServerSetFds(&http->server, &readSet);
+    if (event_fd > maxFd) maxFd = event_fd;
+    for (i = 0; i < HTTP_MAX_CONN; i++) {
+      conn = &http->conns[i];
+      if (conn->fd >= 0 && http->state[i].file != 0 && http->state[i].route < 0) {
+        FD_SET(conn->fd, &writeSet);
+        if (conn->fd > maxFd) maxFd = conn->fd;
+      }
+    }
+    /* wake up now and then to close idle clients */
+    t.tv_sec = 1;
+    t.tv_usec = 0;
+    if (select(maxFd + 1, &readSet, &writeSet, NULL, &t) < 0)
+      continue;
+
+    /* handlers that are done */
+    if (FD_ISSET(event_fd, &readSet)) {
+      mico_rtos_get_semaphore(&http_sem, 0);
+      for (i = 0; i < HTTP_MAX_CONN; i++) {
+        conn = &http->conns[i];
+        c = &http->state[i];
+        if (!c->answered) continue;
+        c->answered = false;
+        c->route = -1;
+        if (c->file == 0)
+          http_done(conn);
+      }
+    }
+    for (i = 0; i < HTTP_MAX_CONN; i++) {
+      conn = &http->conns[i];
+      c = &http->state[i];
+      if (conn->fd >= 0 && c->file != 0 && c->route < 0 && FD_ISSET(conn->fd, &writeSet))
+        http_file_send(conn);
+    }
+    HTTPServerProcess(&http->server, &readSet);
+  }
+
+  for (i = 0; i < HTTP_MAX_CONN; i++)
+    if (http->state[i].file != 0)
+      SPIFFS_close(&fs, http->state[i].file);
+  HTTPServerStop(&http->server);
+  mico_delete_event_fd(event_fd);
+  free(http);
+  http = NULL;
+  http_running = false;
+  mico_rtos_delete_thread(NULL);
+}
+
+void http_deliver(lua_State *L, int gen, int idx)
+{
+  HTTPConnection_t *conn;
+  http_conn_t *c;
+  HTTPHeader_t *h;
+  int ref;
+  if (http == NULL || gen != http_gen)
+    return;
+  conn = &http->conns[idx];
+  c = &http->state[idx];
+  h = &conn->header;
+  if (!conn->busy || c->route < 0)
+    return;
+  mico_rtos_lock_mutex(&http_mutex);
+  ref = http_routes[c->route].ref;
+  mico_rtos_unlock_mutex(&http_mutex);
+
+  if (ref == LUA_NOREF)  /* removed since */
+    http_send_head(conn, kStatusNotFound, NULL, NULL, 0);
+  else {
+    http_current = idx;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    lua_pushinteger(L, idx);
+    lua_pushlstring(L, h->methodPtr, h->methodLen);
+    lua_pushlstring(L, h->url.pathPtr, h->url.pathLen);
+    if (h->url.queryPtr != NULL)
+      lua_pushlstring(L, h->url.queryPtr, h->url.queryLen);
+    else
+      lua_pushnil(L);
+    if (h->extraDataPtr != NULL && h->contentLength > 0)
+      lua_pushlstring(L, h->extraDataPtr, h->extraDataLen);
+    else
+      lua_pushnil(L);
+    if (lua_pcall(L, 5, 0, 0) != 0) {
+      const char *msg = lua_tostring(L, -1);
+      l_message("http", msg != NULL ? msg : "(error object is not a string)");
+      lua_pop(L, 1);
+      if (!c->started)
+        http_send_head(conn, kStatusInternalServerErr, NULL, NULL, 0);
+      else if (c->chunked)  /* the end chunk would pass it off as whole */
+        c->failed = true;
+    }
+    http_current = -1;
+  }
+  if (!c->started)
+    http_send_head(conn, kStatusNoConetnt, NULL, NULL, HTTP_NOBODY);
+  else if (c->chunked)
+    http_send(conn, "0\r\n\r\n", 5);
+  c->answered = true;
+  mico_rtos_set_semaphore(&http_sem);
+}
+
+static http_conn_t *http_check(lua_State *L, HTTPConnection_t **conn)
+{
+  int idx = luaL_checkinteger(L, 1);
+  if (http == NULL || idx != http_current)
+    luaL_error(L, "no such request");
+  *conn = &http->conns[idx];
+  return &http->state[idx];
+}
+
+static const char *http_opttype(lua_State *L, int narg)
+{
+  size_t len;
+  const char *type = luaL_optlstring(L, narg, kMIMEType_TextHTML, &len);
+  luaL_argcheck(L, len <= HTTP_TYPE_LEN, narg, "type too long");
+  return type;
+}
+
+static int http_piece(const char *p, size_t len, void *ud)
+{
+  return !http_send((HTTPConnection_t *)ud, p, len);
+}
+
+static int http_chunk_piece(const char *p, size_t len, void *ud)
+{
+  HTTPConnection_t *conn = ud;
+  char size[12];
+  if (len == 0)  /* an empty chunk ends the body */
+    return 0;
+  snprintf(size, sizeof(size), "%x\r\n", (unsigned)len);
+  return !(http_send(conn, size, strlen(size)) && http_send(conn, p, len) &&
+           http_send(conn, "\r\n", 2));
+}
+
+//http.start([port]), port 80 by default
+static int lhttp_start( lua_State* L )
+{
+  int port = luaL_optinteger( L, 1, 80 );
+  int i;
+  if (http_running)
+    return luaL_error( L, "http is running" );
+  http = calloc(1, sizeof(http_t));
+  if (http == NULL)
+    return luaL_error( L, "not enough memory" );
+  for (i = 0; i < HTTP_MAX_CONN; i++) {
+    http->conns[i].userContext = &http->state[i];
+    http->state[i].route = -1;
+  }
+  http->server.conns = http->conns;
+  http->server.maxConns = HTTP_MAX_CONN;
+  http->server.onRequest = http_request;
+  http->server.onReceivedData = http_body;
+  if (HTTPServerStart(&http->server, port) != kNoErr) {
+    free(http);
+    http = NULL;
+    return luaL_error( L, "can't listen on port %d", port );
+  }
+  mico_rtos_init_semaphore(&http_sem, 1);
+  http_gen++;
+  http_stopping = false;
+  http_running = true;
+  if (mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "http", http_thread,
+                              HTTP_STACK_SIZE, NULL) != kNoErr) {
+    HTTPServerStop(&http->server);
+    mico_rtos_deinit_semaphore(&http_sem);
+    free(http);
+    http = NULL;
+    http_running = false;
+    return luaL_error( L, "can't start http" );
+  }
+  return 0;
+}
+
+//http.stop(), closes the server and its clients
+static int lhttp_stop( lua_State* L )
+{
+  if (!http_running)
+    return 0;
+  if (http_current >= 0)
+    return luaL_error( L, "http.stop in a handler" );
+  http_stopping = true;
+  mico_rtos_set_semaphore(&http_sem);
+  while (http_running)
+    mico_thread_msleep(10);
+  mico_rtos_deinit_semaphore(&http_sem);
+  return 0;
+}
+
+//http.on("GET","/path",function(req,method,path,query,body)), "*" for any
+//method, a path ending with '*' matches the paths it starts; nil removes
+static int lhttp_on( lua_State* L )
+{
+  size_t ml, pl;
+  const char *method = luaL_checklstring( L, 1, &ml );
+  const char *path = luaL_checklstring( L, 2, &pl );
+  int i, slot = -1, ref = LUA_NOREF, old;
+  luaL_argcheck(L, ml <= HTTP_METHOD_LEN, 1, "method too long");
+  luaL_argcheck(L, pl <= HTTP_ROUTE_LEN, 2, "path too long");
+  if (strcmp(method, "*") == 0)
+    method = "";
+  for (i = 0; i < HTTP_MAX_ROUTES; i++) {
+    http_route_t *r = &http_routes[i];
+    if (r->ref == LUA_NOREF) {
+      if (slot < 0) slot = i;
+    }
+    else if (strcmp(r->method, method) == 0 && strcmp(r->path, path) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (lua_type(L, 3) == LUA_TFUNCTION || lua_type(L, 3) == LUA_TLIGHTFUNCTION) {
+    if (slot < 0)
+      return luaL_error( L, "too many routes" );
+    lua_pushvalue(L, 3);
+    ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+  else if (!lua_isnoneornil(L, 3))
+    return luaL_argerror( L, 3, "function or nil expected" );
+  if (slot < 0)
+    return 0;
+  mico_rtos_lock_mutex(&http_mutex);
+  old = http_routes[slot].ref;
+  strcpy(http_routes[slot].method, method);
+  strcpy(http_routes[slot].path, path);
+  http_routes[slot].ref = ref;
+  mico_rtos_unlock_mutex(&http_mutex);
+  if (old != LUA_NOREF)
+    luaL_unref(L, LUA_REGISTRYINDEX, old);
+  return 0;
+}
+
+//http.static("/url",["prefix"]), files prefix..rest of path are served
+//for GET and HEAD under url, index.html for directories; nil stops it
+static int lhttp_static( lua_State* L )
+{
+  size_t ul, dl;
+  const char *url, *dir;
+  if (lua_isnoneornil(L, 1)) {
+    mico_rtos_lock_mutex(&http_mutex);
+    http_static_on = false;
+    mico_rtos_unlock_mutex(&http_mutex);
+    return 0;
+  }
+  url = luaL_checklstring( L, 1, &ul );
+  dir = luaL_optlstring( L, 2, "", &dl );
+  luaL_argcheck(L, ul <= HTTP_ROUTE_LEN, 1, "url too long");
+  luaL_argcheck(L, dl < SPIFFS_OBJ_NAME_LEN, 2, "prefix too long");
+  mico_rtos_lock_mutex(&http_mutex);
+  strcpy(http_static_url, url);
+  strcpy(http_static_dir, dir);
+  http_static_on = true;
+  mico_rtos_unlock_mutex(&http_mutex);
+  return 0;
+}
+
+//value = http.header(req,"name"), a field of the request, nil if none
+static int lhttp_header( lua_State* L )
+{
+  HTTPConnection_t *conn;
+  const char *v;
+  size_t vl;
+  http_check(L, &conn);
+  if (HTTPHeaderGetField(&conn->header, luaL_checkstring( L, 2 ), &v, &vl) != kNoErr)
+    lua_pushnil(L);
+  else
+    lua_pushlstring(L, v, vl);
+  return 1;
+}
+
+//http.send(req,"data" or strbuf,[status],[type]), the whole response
+static int lhttp_send( lua_State* L )
+{
+  HTTPConnection_t *conn;
+  http_conn_t *c = http_check(L, &conn);
+  size_t len = strbuf_checklen(L, 2);
+  int status = luaL_optinteger( L, 3, kStatusOK );
+  const char *type = http_opttype(L, 4);
+  if (c->started)
+    return luaL_error( L, "response already started" );
+  if (http_send_head(conn, status, type, NULL, (int)len))
+    strbuf_write(L, 2, http_piece, conn);
+  lua_pushboolean(L, !c->failed);
+  return 1;
+}
+
+//http.begin(req,[status],[type]), starts a response sent by http.write
+static int lhttp_begin( lua_State* L )
+{
+  HTTPConnection_t *conn;
+  http_conn_t *c = http_check(L, &conn);
+  int status = luaL_optinteger( L, 2, kStatusOK );
+  const char *type = http_opttype(L, 3);
+  if (c->started)
+    return luaL_error( L, "response already started" );
+  c->chunked = true;
+  lua_pushboolean(L, http_send_head(conn, status, type, NULL, HTTP_CHUNKED));
+  return 1;
+}
+
+//http.write(req,"data" or strbuf), sends a piece of the response at once,
+//which is 200 text/html if http.begin was not called
+static int lhttp_write( lua_State* L )
+{
+  HTTPConnection_t *conn;
+  http_conn_t *c = http_check(L, &conn);
+  strbuf_checklen(L, 2);
+  if (!c->started) {
+    c->chunked = true;
+    http_send_head(conn, kStatusOK, kMIMEType_TextHTML, NULL, HTTP_CHUNKED);
+  }
+  else if (!c->chunked)
+    return luaL_error( L, "response already sent" );
+  strbuf_write(L, 2, http_chunk_piece, conn);
+  lua_pushboolean(L, !c->failed);
+  return 1;
+}
+
+//http.file(req,"name"), answers with the file, false if there is none
+static int lhttp_file( lua_State* L )
+{
+  HTTPConnection_t *conn;
+  http_conn_t *c = http_check(L, &conn);
+  size_t len;
+  const char *name = luaL_checklstring( L, 2, &len );
+  if (len >= SPIFFS_OBJ_NAME_LEN)
+    return luaL_error( L, "filename too long" );
+  if (c->started)
+    return luaL_error( L, "response already started" );
+  lua_pushboolean(L, http_file_start(conn, name));
+  return 1;
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE http_map[] =
+{
+  { LSTRKEY( "start" ), LFUNCVAL( lhttp_start )},
+  { LSTRKEY( "stop" ), LFUNCVAL( lhttp_stop )},
+  { LSTRKEY( "on" ), LFUNCVAL( lhttp_on )},
+  { LSTRKEY( "static" ), LFUNCVAL( lhttp_static )},
+  { LSTRKEY( "header" ), LFUNCVAL( lhttp_header )},
+  { LSTRKEY( "send" ), LFUNCVAL( lhttp_send )},
+  { LSTRKEY( "begin" ), LFUNCVAL( lhttp_begin )},
+  { LSTRKEY( "write" ), LFUNCVAL( lhttp_write )},
+  { LSTRKEY( "file" ), LFUNCVAL( lhttp_file )},
+  {LNILKEY, LNILVAL}
+};
+
+LUALIB_API int luaopen_http(lua_State *L)
+{
+  http_L = L;
+  for (int i = 0; i < HTTP_MAX_ROUTES; i++)
+    http_routes[i].ref = LUA_NOREF;
+  if (http_mutex == NULL)
+    mico_rtos_init_mutex(&http_mutex);
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else
+  luaL_register( L, LUA_HTTPLIBNAME, http_map );
+  return 1;
+#endif
+}
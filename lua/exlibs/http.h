@@ -0,0 +1,28 @@
+/**
+ * http.h
+ *
+ * HTTP server for Lua on the HTTPServerUtils core: one thread parses the
+ * requests of a pool of connections. Files are streamed from spiffs by
+ * that thread, a few pages at a time, and never enter the Lua heap;
+ * requests routed to Lua go over the event queue and are answered by
+ * their handler on the Lua thread.
+ */
+
+#ifndef __HTTP_H__
+#define __HTTP_H__
+
+#include "lua.h"
+
+#define HTTP_MAX_CONN     4
+#define HTTP_MAX_ROUTES   8
+#define HTTP_ROUTE_LEN    32    /* longest route path */
+#define HTTP_METHOD_LEN   7
+#define HTTP_MAX_BODY     2048  /* longer request bodies get 413 */
+#define HTTP_SEND_LEN     (4*256) /* bytes of a file sent at a time, 4 spiffs pages */
+#define HTTP_STACK_SIZE   0x800
+
+/* run the handler of request idx of server generation gen, on the thread
+   of the event queue */
+void http_deliver(lua_State *L, int gen, int idx);
+
+#endif  /* __HTTP_H__ */
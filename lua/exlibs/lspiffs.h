@@ -0,0 +1,18 @@
+/**
+ * lspiffs.h
+ *
+ * spiffs settings of the lua port, included by spiffs_config.h through
+ * SPIFFS_PORT_HEADER. The api is entered from lua and from the background
+ * gc thread, see file.c.
+ */
+
+#ifndef __LSPIFFS_H__
+#define __LSPIFFS_H__
+
+void lspiffs_lock(void);
+void lspiffs_unlock(void);
+
+#define SPIFFS_LOCK(fs)                 lspiffs_lock()
+#define SPIFFS_UNLOCK(fs)               lspiffs_unlock()
+
+#endif
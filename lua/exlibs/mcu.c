@@ -34,8 +34,10 @@ static int mcu_wifiinfo( lua_State* L )
   return 3;
 }
 
+extern void lua_spiffs_unmount();
 static int mcu_reboot( lua_State* L )
 {
+   lua_spiffs_unmount();//leave a checkpoint for fast mount
    MicoSystemReboot();
     return 0;
 }
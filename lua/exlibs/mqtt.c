@@ -7,6 +7,7 @@
 #include "lualib.h"
 #include "lrotable.h"
 #include "user_config.h"
+#include "strbuf.h"
    
 #include "platform.h"
 #include "MICOPlatform.h"
@@ -41,6 +42,7 @@ typedef struct {
   char *pTopic;
   char *pData;
   size_t pDataLen;
+  char *pDataBuf;//copy of a strbuf payload, freed once published
   int cb_ref_connect;
   int cb_ref_offline;
   int cb_ref_message;
@@ -98,6 +100,7 @@ static void closeMqtt(int id)
    if(pmqtt[id]->cb_ref_message != LUA_NOREF)
       luaL_unref(gL, LUA_REGISTRYINDEX, pmqtt[id]->cb_ref_message); 
    pmqtt[id]->cb_ref_message = LUA_NOREF;
+   free(pmqtt[id]->pDataBuf);
    free(pmqtt[id]);
    pmqtt[id]=NULL;
 }
@@ -186,13 +189,16 @@ MQTT_start:
       if(pmqtt[i] ==NULL) continue;
       if(pmqtt[i]->reqPublish==true)
       {
+        char *pDataBuf = pmqtt[i]->pDataBuf;
+        pmqtt[i]->pDataBuf = NULL;
         pmqtt[i]->reqPublish = false;
-        if(pmqtt[i]->pTopic == NULL || pmqtt[i]->pDataLen <= 0) continue;
+        if(pmqtt[i]->pTopic == NULL || pmqtt[i]->pDataLen <= 0) {free(pDataBuf);continue;}
         MQTTMessage publishData =  MQTTMessage_publishData_initializer;
         publishData.qos = (enum QoS)(pmqtt[i]->qos);
         publishData.payload = (void*)pmqtt[i]->pData;
         publishData.payloadlen = pmqtt[i]->pDataLen;
         rc = MQTTPublish(&(pmqtt[i]->c), pmqtt[i]->pTopic,&publishData);
+        free(pDataBuf);
         if(MQTT_SUCCESS == rc)
           mqtt_log("MQTT client publish OK!\r\n");
         else
@@ -313,6 +319,7 @@ static int lmqtt_new( lua_State* L )
   pmqtt[k]->qos = QOS0;
   pmqtt[k]->pTopic = NULL;
   pmqtt[k]->pData = NULL;
+  pmqtt[k]->pDataBuf = NULL;
   pmqtt[k]->reqSucrible = false;
   pmqtt[k]->requnSucrible = false;
   pmqtt[k]->reqPublish = false;
@@ -417,7 +424,7 @@ static int lmqtt_unsubscribe( lua_State* L )
   pmqtt[mqttClt]->requnSucrible = true;
   return 0;
 }
-//mqtt.publish(mqttClt,topic,QoS, data)
+//mqtt.publish(mqttClt,topic,QoS, data), data is a string or strbuf
 static int lmqtt_publish( lua_State* L )
 {
   unsigned mqttClt = luaL_checkinteger( L, 1);
@@ -431,13 +438,30 @@ static int lmqtt_publish( lua_State* L )
   if (!(qos == QOS0 || qos == QOS1 ||qos == QOS2))
       return luaL_error( L, "QoS wrong arg type" );
     
-  char const *data = luaL_checklstring( L, 4, &sl );
-  if (data == NULL) return luaL_error( L, "wrong arg type" );
+  char const *data;
+  char *pDataBuf = NULL;
+  strbuf *sb = strbuf_test( L, 4 );
+  if (pmqtt[mqttClt]->reqPublish && pmqtt[mqttClt]->pDataBuf != NULL)
+    return luaL_error( L, "previous publish is pending" );
+  if (sb != NULL)
+  {//the packet needs the payload in one piece: copy it, not interned
+    sl = sb->len;
+    pDataBuf = (char*)malloc(sl);
+    if (pDataBuf == NULL && sl > 0) return luaL_error( L, "memery allocated failed" );
+    strbuf_copy(sb, pDataBuf);
+    data = pDataBuf;
+  }
+  else
+  {
+    data = luaL_checklstring( L, 4, &sl );
+    if (data == NULL) return luaL_error( L, "wrong arg type" );
+  }
   
   pmqtt[mqttClt]->pTopic = (char*)topic;
   pmqtt[mqttClt]->qos = qos;
   pmqtt[mqttClt]->pData = (char*)data;
   pmqtt[mqttClt]->pDataLen = sl;
+  pmqtt[mqttClt]->pDataBuf = pDataBuf;
   pmqtt[mqttClt]->reqPublish = true;
   return 0;
 }
@@ -6,6 +6,9 @@
 #include "lauxlib.h"
 #include "lualib.h"
 #include "lrotable.h"
+#include "strbuf.h"
+#include "task.h"
+#include "dns.h"
 
 #include "platform.h"
 #include "MICODefine.h"
@@ -30,11 +33,20 @@ enum _req_actions{
   REQ_ACTION_DISCONNECT,
   REQ_ACTION_CONNECT
 };
+//data of a socket read by net.receive
+typedef struct {
+  bool in_task;//read by net.receive, not receive_cb
+  int task;//task waiting in net.receive
+  char *data;//came while no task was waiting, the next net.receive gets it
+  int len;
+}recv_state_t;
 //for server-client
 typedef struct {
   int client;//socket type
   uint8_t clientFlag;//sent or disconnect
   struct sockaddr_t addr;//ip and port 
+  recv_state_t recv;
+  int sent_task;//task waiting in net.send
 }_lsvrCltsocket_t;
 //for server
 typedef struct {
@@ -60,14 +72,15 @@ typedef struct _lcltsocket{
   int sent_cb;
   int disconnect_cb;
   uint8_t clientFlag;//sent or disconnect or got ip
+  recv_state_t recv;
+  int sent_task;//task waiting in net.send
+  int dns_id;//lookup started by net.start, 0 if none
 }cltsockt_t;
 cltsockt_t *pcltsockt[MAX_CLT_SOCKET];
 
 static lua_State *gL = NULL;
-static char *pDomain4Dns=NULL;
 #define MAX_RECV_LEN 1024
 static char recvBuf[MAX_RECV_LEN];
-static int clientIndexK=0;
 static bool net_thread_is_started=false;
 
 // socket=net.new(net.TCP/UDP,net.SERVER/net.CLIENT)
@@ -126,6 +139,11 @@ static int lnet_new( lua_State* L )
     pcltsockt[k]->sent_cb = LUA_NOREF;
     pcltsockt[k]->disconnect_cb = LUA_NOREF;
     pcltsockt[k]->clientFlag = NO_ACTION;   
+    pcltsockt[k]->recv.in_task = false;
+    pcltsockt[k]->recv.task = LUA_NOREF;
+    pcltsockt[k]->recv.data = NULL;
+    pcltsockt[k]->sent_task = LUA_NOREF;
+    pcltsockt[k]->dns_id = 0;
   }
   
    if(socketHandle==INVALID_HANDLE)
@@ -174,7 +192,7 @@ static bool getsocketIndex(int socketHandle, int *type,int *out1,int *out2)
   }
   return false;
 }
-static void closeSocket(lua_State*L, int socketHandle)
+static void freeSocket(lua_State*L, int socketHandle)
 {
   //if socketHandle is server or serverclient
     int k=0,m=0;
@@ -190,6 +208,7 @@ static void closeSocket(lua_State*L, int socketHandle)
           if(psvrsockt[k]->type==TCP&&
              psvrsockt[k]->psvrCltsocket[m]->client !=INVALID_HANDLE)
               close(psvrsockt[k]->psvrCltsocket[m]->client);
+          free(psvrsockt[k]->psvrCltsocket[m]->recv.data);
           free(psvrsockt[k]->psvrCltsocket[m]);
           psvrsockt[k]->psvrCltsocket[m]=NULL;
         }
@@ -218,6 +237,7 @@ static void closeSocket(lua_State*L, int socketHandle)
         //free memery
           if(psvrsockt[k]->type==TCP)
             close(socketHandle);
+          free(psvrsockt[k]->psvrCltsocket[m]->recv.data);
           free(psvrsockt[k]->psvrCltsocket[m]);
           psvrsockt[k]->psvrCltsocket[m] = NULL;
           return ;
@@ -248,32 +268,60 @@ static void closeSocket(lua_State*L, int socketHandle)
         pcltsockt[k]->disconnect_cb = LUA_NOREF;
         pcltsockt[k]->clientFlag = NO_ACTION;
         close(socketHandle);
+        free(pcltsockt[k]->recv.data);
         free(pcltsockt[k]);
         pcltsockt[k] = NULL;
         return ;
       }
     }
 }
-static void lgethostbyname_thread(void *inContext)
+static int takeTasks(int *waiting, int *recv_task, int *sent_task)
 {
-  (void)inContext;
-  int k = clientIndexK;
-  char pIPstr[16]={0};
-  //MCU_DBG("lgethostbyname_thread called:%d",k);
-  
-  if(pDomain4Dns ==NULL) goto exit;
-
-  gethostbyname((char *)pDomain4Dns, (uint8_t *)pIPstr, 16);
-  free(pDomain4Dns);pDomain4Dns=NULL;
-  
-  if(pcltsockt[k] !=NULL)
+  int n=0;
+  if(*recv_task!=LUA_NOREF) waiting[n++]=*recv_task;
+  if(*sent_task!=LUA_NOREF) waiting[n++]=*sent_task;
+  *recv_task = LUA_NOREF;
+  *sent_task = LUA_NOREF;
+  return n;
+}
+//the tasks waiting on the socket (or its clients) go on with nil
+static void closeSocket(lua_State*L, int socketHandle)
+{
+  int waiting[MAX_SVRCLT_SOCKET*2];
+  int n=0,type=0,k=0,m=0;
+  if(getsocketIndex(socketHandle,&type,&k,&m))
+  {
+    if(type==SOCKET_TYPE_SERVER)
+    {
+      for(m=0;m<MAX_SVRCLT_SOCKET;m++){
+        _lsvrCltsocket_t *clt = psvrsockt[k]->psvrCltsocket[m];
+        if(clt!=NULL) n += takeTasks(waiting+n, &clt->recv.task, &clt->sent_task);
+      }
+    }
+    else if(type==SOCKET_TYPE_SVRCLT)
+    {
+      _lsvrCltsocket_t *clt = psvrsockt[k]->psvrCltsocket[m];
+      n += takeTasks(waiting+n, &clt->recv.task, &clt->sent_task);
+    }
+    else
+      n += takeTasks(waiting+n, &pcltsockt[k]->recv.task, &pcltsockt[k]->sent_task);
+  }
+  freeSocket(L, socketHandle);
+  for(int i=0;i<n;i++)
+    task_resume(L, waiting[i], 0);
+}
+//called by the resolver, the socket may have been closed meanwhile and
+//its handle reused, so the lookup is told by its id, not by the handle
+static void netDnsFound(int dns_id, uint32_t ip)
+{
+  for(int k=0;k<MAX_CLT_SOCKET;k++)
   {
+    if(pcltsockt[k]==NULL || pcltsockt[k]->dns_id!=dns_id) continue;
+    pcltsockt[k]->dns_id = 0;
+    pcltsockt[k]->addr.s_ip = ip;
     pcltsockt[k]->clientFlag = REQ_ACTION_GOTIP;
-    pcltsockt[k]->addr.s_ip = inet_addr(pIPstr);
+    break;
   }
-
-exit:
-  mico_rtos_delete_thread(NULL);
 }
 
 //net.close(socket)
@@ -300,6 +348,47 @@ void _micoNotify_TCPClientConnectedHandler(int fd)
   lua_pushinteger(gL,pcltsockt[k]->socket);//para1
   lua_call(gL, 1, 0); lua_gc(gL, LUA_GCCOLLECT, 0);*/
 }
+//a task waiting in net.send goes on with true
+static bool netSentTask(int *sent_task)
+{
+  int ref = *sent_task;
+  if(ref == LUA_NOREF) return false;
+  *sent_task = LUA_NOREF;
+  lua_pushboolean(gL, 1);
+  task_resume(gL, ref, 1);
+  lua_gc(gL, LUA_GCCOLLECT, 0);
+  return true;
+}
+//data in recvBuf goes to the task waiting in net.receive, or is kept for
+//the next net.receive, or goes to receive_cb
+static void netReceived(recv_state_t *recv, int receive_cb, int socketHandle, int recv_len)
+{
+  int ref = recv->task;
+  if(ref != LUA_NOREF)
+  {
+    recv->task = LUA_NOREF;
+    lua_pushlstring(gL, recvBuf, recv_len);
+    task_resume(gL, ref, 1);
+  }
+  else if(recv->in_task)
+  {//the socket is not selected until net.receive takes it
+    char *data = (char*)malloc(recv_len);
+    if(data == NULL) { l_message(NULL, "memery allocated failed" ); return; }
+    memcpy(data, recvBuf, recv_len);
+    recv->len = recv_len;
+    recv->data = data;
+    return;
+  }
+  else if(receive_cb != LUA_NOREF)
+  {
+    lua_rawgeti(gL, LUA_REGISTRYINDEX, receive_cb);//function
+    lua_pushinteger(gL, socketHandle);//para1
+    lua_pushlstring(gL, recvBuf, recv_len);//para2
+    lua_call(gL, 2, 0);
+  }
+  else return;
+  lua_gc(gL, LUA_GCCOLLECT, 0);
+}
 /*
   step1:check if ACTION required  gotip/connect/disconnect
   step2:check if event is set
@@ -328,6 +417,7 @@ static bool _thread_net_handle(void)
             //REQ_ACTION_SENT or REQ_ACTION_DISCONNECT
             if(psvrsockt[k]->psvrCltsocket[m]->clientFlag==REQ_ACTION_SENT){
               psvrsockt[k]->psvrCltsocket[m]->clientFlag=NO_ACTION;
+              if(netSentTask(&psvrsockt[k]->psvrCltsocket[m]->sent_task)) continue;
               if(psvrsockt[k]->sent_cb == LUA_NOREF) continue;
               lua_rawgeti(gL, LUA_REGISTRYINDEX,psvrsockt[k]->sent_cb);//function
               lua_pushinteger(gL,psvrsockt[k]->psvrCltsocket[m]->client);//para1
@@ -352,6 +442,7 @@ static bool _thread_net_handle(void)
         //REQ_ACTION_SENT or REQ_ACTION_DISCONNECT or REQ_ACTION_GOTIP
         if(pcltsockt[k]->clientFlag==REQ_ACTION_SENT){
           pcltsockt[k]->clientFlag=NO_ACTION;
+          if(netSentTask(&pcltsockt[k]->sent_task)) continue;
           if(pcltsockt[k]->sent_cb == LUA_NOREF) continue;
           lua_rawgeti(gL, LUA_REGISTRYINDEX,pcltsockt[k]->sent_cb);//function
           lua_pushinteger(gL,pcltsockt[k]->socket);//para1
@@ -414,6 +505,9 @@ static bool _thread_net_handle(void)
                psvrsockt[k]->type==UDP||
                psvrsockt[k]->psvrCltsocket[m]->client==INVALID_HANDLE) 
               continue;
+            //data read for net.receive is waiting, a close is seen after it
+            if(psvrsockt[k]->psvrCltsocket[m]->recv.data != NULL)
+              continue;
             if (psvrsockt[k]->psvrCltsocket[m]->client > maxfd) 
               maxfd = psvrsockt[k]->psvrCltsocket[m]->client;
             FD_SET(psvrsockt[k]->psvrCltsocket[m]->client, &readset);
@@ -424,6 +518,8 @@ static bool _thread_net_handle(void)
     if(pcltsockt[k] ==NULL) continue;
     if(pcltsockt[k]->socket != INVALID_HANDLE){
     //tcp client/udp client: recieve or disconnect
+       if(pcltsockt[k]->recv.data != NULL)
+         continue;
        if (pcltsockt[k]->socket > maxfd) 
            maxfd = pcltsockt[k]->socket;
          FD_SET(pcltsockt[k]->socket, &readset);
@@ -459,6 +555,10 @@ static bool _thread_net_handle(void)
                 psvrsockt[k]->psvrCltsocket[mi]->addr.s_ip= clientaddr.s_ip;
                 psvrsockt[k]->psvrCltsocket[mi]->addr.s_port= clientaddr.s_port;
                 psvrsockt[k]->psvrCltsocket[mi]->clientFlag= NO_ACTION;
+                psvrsockt[k]->psvrCltsocket[mi]->recv.in_task= false;
+                psvrsockt[k]->psvrCltsocket[mi]->recv.task= LUA_NOREF;
+                psvrsockt[k]->psvrCltsocket[mi]->recv.data= NULL;
+                psvrsockt[k]->psvrCltsocket[mi]->sent_task= LUA_NOREF;
                 
                 if(psvrsockt[k]->accept_cb != LUA_NOREF){
                   lua_rawgeti(gL, LUA_REGISTRYINDEX,psvrsockt[k]->accept_cb);//function
@@ -511,6 +611,10 @@ static bool _thread_net_handle(void)
               psvrsockt[k]->psvrCltsocket[mi]->addr.s_ip= clientaddr.s_ip;
               psvrsockt[k]->psvrCltsocket[mi]->addr.s_port= clientaddr.s_port;
               psvrsockt[k]->psvrCltsocket[mi]->clientFlag= NO_ACTION;
+              psvrsockt[k]->psvrCltsocket[mi]->recv.in_task= false;
+              psvrsockt[k]->psvrCltsocket[mi]->recv.task= LUA_NOREF;
+              psvrsockt[k]->psvrCltsocket[mi]->recv.data= NULL;
+              psvrsockt[k]->psvrCltsocket[mi]->sent_task= LUA_NOREF;
            doUdpRecieve://call recieve_cb
              if(psvrsockt[k]->receive_cb != LUA_NOREF) {
                   lua_rawgeti(gL, LUA_REGISTRYINDEX,psvrsockt[k]->receive_cb);//function
@@ -537,13 +641,9 @@ static bool _thread_net_handle(void)
                 continue;
               }//else success call recieve_cb
               recvBuf[recv_len]=0x00;
-              if(psvrsockt[k]->receive_cb != LUA_NOREF) {        
-                lua_rawgeti(gL, LUA_REGISTRYINDEX,psvrsockt[k]->receive_cb);//function
-                lua_pushinteger(gL,psvrsockt[k]->psvrCltsocket[m]->client);//para1
-                lua_pushlstring(gL, recvBuf,recv_len);                     //para2
-                lua_call(gL, 2, 0); 
-                lua_gc(gL, LUA_GCCOLLECT, 0);
-              }
+              netReceived(&psvrsockt[k]->psvrCltsocket[m]->recv,
+                          psvrsockt[k]->receive_cb,
+                          psvrsockt[k]->psvrCltsocket[m]->client, recv_len);
             }//if(FD_ISSET...
          }
        }
@@ -565,12 +665,8 @@ static bool _thread_net_handle(void)
                 continue;
               }//else success call recieve_cb
               recvBuf[recv_len]=0x00;
-          if(pcltsockt[k]->receive_cb != LUA_NOREF){
-                lua_rawgeti(gL, LUA_REGISTRYINDEX,pcltsockt[k]->receive_cb);//function
-                lua_pushinteger(gL,pcltsockt[k]->socket);       //para1
-                lua_pushlstring(gL,recvBuf,recv_len);                     //para2
-                lua_call(gL, 2, 0); lua_gc(gL, LUA_GCCOLLECT, 0);
-            }
+          netReceived(&pcltsockt[k]->recv, pcltsockt[k]->receive_cb,
+                      pcltsockt[k]->socket, recv_len);
         }
         else if(pcltsockt[k]->type==UDP)
         {//udp client: recieve or disconnect
@@ -588,12 +684,8 @@ static bool _thread_net_handle(void)
                 continue;
               }
              recvBuf[recv_len]=0x00;
-             if(pcltsockt[k]->receive_cb != LUA_NOREF){
-                lua_rawgeti(gL, LUA_REGISTRYINDEX,pcltsockt[k]->receive_cb);//function
-                lua_pushinteger(gL,pcltsockt[k]->socket);//para1
-                lua_pushlstring(gL,recvBuf,recv_len);              //para2
-                lua_call(gL, 2, 0); lua_gc(gL, LUA_GCCOLLECT, 0);
-             }
+             netReceived(&pcltsockt[k]->recv, pcltsockt[k]->receive_cb,
+                         pcltsockt[k]->socket, recv_len);
         }
       }
     }
@@ -640,7 +732,7 @@ static int lnet_start( lua_State* L )
   if(type==SOCKET_TYPE_SVRCLT)
     return luaL_error( L, "socket is not valid" );
 
-  gL = L;
+  gL = task_main(L);
 
   if(type==SOCKET_TYPE_SERVER)
   {//server
@@ -661,15 +753,9 @@ static int lnet_start( lua_State* L )
   else
   {//client
     size_t len=0;
-    if( pDomain4Dns !=NULL) {free( pDomain4Dns);pDomain4Dns=NULL;}
     const char *domain = luaL_checklstring( L, 3, &len );
-    if (len>128 || domain == NULL)
+    if (len>DNS_NAMELEN || domain == NULL)
       return luaL_error( L, "domain needed or its length < 128" );
-    
-    pDomain4Dns=(char*)malloc(len);
-    if(pDomain4Dns==NULL) 
-       return luaL_error( L, "memory allocated failed" );
-    strcpy(pDomain4Dns,domain);
     //if assgiend local port
     if(lua_gettop(L)>=4)
     {
@@ -683,9 +769,12 @@ static int lnet_start( lua_State* L )
     pcltsockt[k]->addr.s_port = port;
     uint32_t opt=0;
     setsockopt(socketHandle,0,SO_BLOCKMODE,&opt,4);//non block
-    clientIndexK = k;
-    //setup a thread to get ip address arg:socketHandle
-    mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "gethostip", lgethostbyname_thread, 0x300,NULL);
+    //ip address from the cache, or later from the resolver thread
+    static int dns_seq = 0;
+    if(++dns_seq<=0) dns_seq = 1;
+    pcltsockt[k]->dns_id = dns_seq;
+    if(dns_resolve(domain, netDnsFound, dns_seq)<0)
+      return luaL_error( L, "too many dns requests" );
     startNetThread();
     MICOAddNotification( mico_notify_TCP_CLIENT_CONNECTED, (void *)_micoNotify_TCPClientConnectedHandler );
   }
@@ -798,7 +887,25 @@ static int lnet_on( lua_State* L )
   return 0;
 }
 
-//net.send(socket,"data",[function_cb])
+#define MAX_SEND_LEN 1024
+
+static int net_send_piece(const char *p, size_t len, void *ud)
+{
+  int socketHandle = *(int*)ud;
+  while(len>0)
+  {//tcp is a stream, long strbuf chunks go out in parts
+    size_t n = len>MAX_SEND_LEN ? MAX_SEND_LEN : len;
+    if(send(socketHandle,p,n,0) != n) return 1;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+//net.send(socket,"data" or strbuf,[function_cb])
+//on tcp sockets a strbuf may be longer than 1024, it is sent chunk by chunk
+//in a task it waits for the sent event and returns true (nil if closed),
+//if another task already waits on the socket it returns false and an error
 static int lnet_send( lua_State* L )
 {
   int socketHandle = luaL_checkinteger( L, 1 );
@@ -808,10 +915,19 @@ static int lnet_send( lua_State* L )
   if(type==SOCKET_TYPE_SERVER)
     return luaL_error( L, "socket is not valid" );
   
-  size_t len=0;
-  const char *data = luaL_checklstring( L, 2, &len );
-  if (len>1024 || data == NULL)
+  bool tcp = (type==SOCKET_TYPE_SVRCLT ? psvrsockt[k]->type : pcltsockt[k]->type)==TCP;
+  strbuf *sb = strbuf_test(L, 2);
+  size_t len = strbuf_checklen(L, 2);
+  if (len>MAX_SEND_LEN && (sb==NULL || !tcp))
     return luaL_error( L, "data length must <= 1024" );  
+  int *sent_task = type==SOCKET_TYPE_SVRCLT ?
+    &psvrsockt[k]->psvrCltsocket[m]->sent_task : &pcltsockt[k]->sent_task;
+  if(*sent_task!=LUA_NOREF && task_running(L))
+  {//nothing is sent, the caller may try again
+    lua_pushboolean(L, 0);
+    lua_pushliteral(L, "another task is sending");
+    return 2;
+  }
 
   if (lua_type(L, 3) == LUA_TFUNCTION|| lua_type(L, 3)==LUA_TLIGHTFUNCTION)
   {
@@ -829,66 +945,82 @@ static int lnet_send( lua_State* L )
       pcltsockt[k]->sent_cb = luaL_ref(L, LUA_REGISTRYINDEX);
     }
   }
-  if(type==SOCKET_TYPE_SVRCLT)
-  {//tcp or udp
-    int s=0;
-    if(psvrsockt[k]->type==TCP)
+  bool sent;
+  if(tcp)
+    sent = strbuf_write(L, 2, net_send_piece, &socketHandle)==0;
+  else
+  {//udp sends the datagram in one piece
+    const char *data;
+    char *tmp = NULL;
+    struct sockaddr_t *paddr;
+    int udpsocket;
+    if(sb==NULL)
+      data = lua_tostring(L, 2);
+    else if(sb->head==sb->tail)
+      data = sb->head!=NULL ? sb->head->data : "";
+    else
     {
-      s = send(socketHandle,data,len,0);
-      if(s ==len)
-        {//send sucess call function_cb
-          psvrsockt[k]->psvrCltsocket[m]->clientFlag=REQ_ACTION_SENT;
-        }
-        else
-        {//send failed call function_cb
-          psvrsockt[k]->psvrCltsocket[m]->clientFlag=REQ_ACTION_DISCONNECT; 
-        }
+      tmp = (char*)malloc(len);
+      if(tmp==NULL) return luaL_error( L, "not enough memory" );
+      strbuf_copy(sb, tmp);
+      data = tmp;
     }
-    else
+    if(type==SOCKET_TYPE_SVRCLT)
     {//if its udp server: socketHandle=psvrsockt->psvrCltsocket->client = 32767-index     sentto(s,addr_from) 
-      struct sockaddr_t *paddr =&(psvrsockt[k]->psvrCltsocket[m]->addr);
-      s = sendto(psvrsockt[k]->socket,data,len,0,paddr,sizeof(*paddr));
-      if(s ==len)
-        {//send sucess call function_cb
-          psvrsockt[k]->psvrCltsocket[m]->clientFlag=REQ_ACTION_SENT;
-        }
-        else
-        {//send failed call function_cb
-          psvrsockt[k]->psvrCltsocket[m]->clientFlag=REQ_ACTION_DISCONNECT; 
-        }
-    }
-  }
-  else
-  {//tcp or udp
-    int s=0;
-    if(pcltsockt[k]->type==TCP)
-    {
-      s = send(socketHandle,data,len,0);
-      if(s ==len)
-        {//send sucess call function_cb
-          pcltsockt[k]->clientFlag=REQ_ACTION_SENT;
-        }
-        else
-        {//send failed call function_cb
-          pcltsockt[k]->clientFlag=REQ_ACTION_DISCONNECT; 
-        }
+      paddr = &(psvrsockt[k]->psvrCltsocket[m]->addr);
+      udpsocket = psvrsockt[k]->socket;
     }
     else
     {//if its udp client
-      struct sockaddr_t *paddr = &(pcltsockt[k]->addr);
-      s = sendto(socketHandle,data,len,0,paddr,sizeof(*paddr));
-      if(s ==len)
-        {//send sucess call function_cb
-          pcltsockt[k]->clientFlag=REQ_ACTION_SENT;
-        }
-        else
-        {//send failed call function_cb
-          pcltsockt[k]->clientFlag=REQ_ACTION_DISCONNECT; 
-        }
+      paddr = &(pcltsockt[k]->addr);
+      udpsocket = socketHandle;
     }
+    sent = sendto(udpsocket,data,len,0,paddr,sizeof(*paddr)) == len;
+    free(tmp);
   }
+  bool wait = sent && task_running(L);
+  if(wait)//before the flag, the net thread may see it at once
+    *sent_task = task_wait(L);
+  //send sucess call function_cb, failed disconnect
+  if(type==SOCKET_TYPE_SVRCLT)
+    psvrsockt[k]->psvrCltsocket[m]->clientFlag = sent ? REQ_ACTION_SENT : REQ_ACTION_DISCONNECT;
+  else
+    pcltsockt[k]->clientFlag = sent ? REQ_ACTION_SENT : REQ_ACTION_DISCONNECT;
+  if(wait)
+    return lua_yield(L, 0);
   return 0;
 }
+//data = net.receive(socket), in a task: waits for data, nil if closed
+//once called, the socket's data no longer goes to the receive callback
+static int lnet_receive( lua_State* L )
+{
+  int socketHandle = luaL_checkinteger( L, 1 );
+  int type=0,k=0,m=0;
+  if(false == getsocketIndex(socketHandle,&type,&k,&m))
+    return luaL_error( L, "socket is not valid" );
+  if(type==SOCKET_TYPE_SERVER ||
+     (type==SOCKET_TYPE_SVRCLT && psvrsockt[k]->type==UDP))
+    return luaL_error( L, "socket is not valid" );
+  
+  recv_state_t *recv;
+  if(type==SOCKET_TYPE_SVRCLT)
+    recv = &psvrsockt[k]->psvrCltsocket[m]->recv;
+  else
+    recv = &pcltsockt[k]->recv;
+  if(recv->task != LUA_NOREF)
+    return luaL_error( L, "socket is being received by another task" );
+  recv->in_task = true;
+  if(recv->data != NULL)
+  {//came in since the last call, the net thread selects the socket again
+    char *data = recv->data;
+    lua_pushlstring(L, data, recv->len);
+    recv->data = NULL;
+    free(data);
+    return 1;
+  }
+  recv->task = task_wait(L);
+  return lua_yield(L, 0);
+}
 //ip,port = net.getip(clientSocket)
 static int lnet_getip( lua_State* L )
 {
@@ -930,15 +1062,18 @@ static int lnet_getip( lua_State* L )
 
 #define MIN_OPT_LEVEL   2
 #include "lrodefs.h"
+extern const LUA_REG_TYPE dns_map[];
 const LUA_REG_TYPE net_map[] =
 {
   {LSTRKEY("new"), LFUNCVAL(lnet_new)},
   {LSTRKEY("start"), LFUNCVAL(lnet_start)},
   {LSTRKEY("on"), LFUNCVAL(lnet_on)},
   {LSTRKEY("send"), LFUNCVAL(lnet_send)},
+  {LSTRKEY("receive"), LFUNCVAL(lnet_receive)},
   {LSTRKEY("close"), LFUNCVAL(lnet_close)},
   {LSTRKEY("getip"), LFUNCVAL(lnet_getip)},
 #if LUA_OPTIMIZE_MEMORY > 0
+  {LSTRKEY("dns"), LROVAL(dns_map)},
    { LSTRKEY( "TCP" ), LNUMVAL( TCP ) },
    { LSTRKEY( "UDP" ), LNUMVAL( UDP ) },
    { LSTRKEY( "SERVER" ), LNUMVAL( SOCKET_SERVER ) },
@@ -960,6 +1095,7 @@ LUALIB_API int luaopen_net(lua_State *L)
     pcltsockt[i] = NULL;
     
   set_tcp_keepalive(3, 60);
+  dns_init();
 #if LUA_OPTIMIZE_MEMORY > 0
     return 0;
 #else  
@@ -969,6 +1105,10 @@ LUALIB_API int luaopen_net(lua_State *L)
   MOD_REG_NUMBER( L, "UDP", UDP );
   MOD_REG_NUMBER( L, "SERVER", SOCKET_SERVER);
   MOD_REG_NUMBER( L, "CLIENT", SOCKET_CLIENT);
+
+  lua_newtable( L );
+  luaL_register( L, NULL, dns_map );
+  lua_setfield( L, -2, "dns" );
   return 1;
 #endif
 }
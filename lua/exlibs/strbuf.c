@@ -0,0 +1,251 @@
+/**
+ * strbuf.c
+ */
+
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "user_config.h"
+
+#include "strbuf.h"
+
+#define tostrbuf(L)   ((strbuf *)luaL_checkudata(L, 1, STRBUF_HANDLE))
+
+strbuf *strbuf_test(lua_State *L, int idx)
+{
+  strbuf *sb = (strbuf *)lua_touserdata(L, idx);
+  if (sb == NULL || !lua_getmetatable(L, idx)) return NULL;
+  lua_getfield(L, LUA_REGISTRYINDEX, STRBUF_HANDLE);
+  if (!lua_rawequal(L, -1, -2)) sb = NULL;
+  lua_pop(L, 2);
+  return sb;
+}
+
+static void strbuf_typeerror(lua_State *L, int narg)
+{
+  luaL_typerror(L, narg, "string or " STRBUF_HANDLE);
+}
+
+size_t strbuf_checklen(lua_State *L, int narg)
+{
+  strbuf *sb = strbuf_test(L, narg);
+  size_t len;
+  if (sb != NULL) return sb->len;
+  if (lua_tolstring(L, narg, &len) == NULL) strbuf_typeerror(L, narg);
+  return len;
+}
+
+int strbuf_write(lua_State *L, int narg, strbuf_writer w, void *ud)
+{
+  strbuf *sb = strbuf_test(L, narg);
+  strbuf_chunk *c;
+  const char *s;
+  size_t len;
+  int res;
+  if (sb == NULL) {
+    s = lua_tolstring(L, narg, &len);
+    if (s == NULL) strbuf_typeerror(L, narg);
+    return w(s, len, ud);
+  }
+  for (c = sb->head; c != NULL; c = c->next) {
+    if (c->len > 0 && (res = w(c->data, c->len, ud)) != 0) return res;
+  }
+  return 0;
+}
+
+void strbuf_copy(const strbuf *sb, char *dst)
+{
+  strbuf_chunk *c;
+  for (c = sb->head; c != NULL; c = c->next) {
+    memcpy(dst, c->data, c->len);
+    dst += c->len;
+  }
+}
+
+/* chunks are userdata kept alive by the buffer's environment table, so
+   the collector counts them; the buffer is at index sbidx */
+static void strbuf_reset(lua_State *L, strbuf *sb, int sbidx)
+{
+  lua_newtable(L);
+  lua_setfenv(L, sbidx);
+  sb->head = sb->tail = NULL;
+  sb->len = 0;
+  sb->nchunks = 0;
+}
+
+/* new chunk after the tail, as large as the buffer is long (bounded) */
+static strbuf_chunk *strbuf_grow(lua_State *L, strbuf *sb, int sbidx, size_t need)
+{
+  size_t size = sb->len > need ? sb->len : need;
+  strbuf_chunk *c;
+  if (size < STRBUF_MINCHUNK) size = STRBUF_MINCHUNK;
+  if (size > STRBUF_MAXCHUNK) size = STRBUF_MAXCHUNK;
+  lua_getfenv(L, sbidx);
+  c = (strbuf_chunk *)lua_newuserdata(L, sizeof(strbuf_chunk) + size - 1);
+  lua_rawseti(L, -2, ++sb->nchunks);
+  lua_pop(L, 1);
+  c->next = NULL;
+  c->len = 0;
+  c->size = size;
+  if (sb->tail != NULL) sb->tail->next = c;
+  else sb->head = c;
+  sb->tail = c;
+  return c;
+}
+
+static void strbuf_addlstring(lua_State *L, strbuf *sb, int sbidx, const char *s, size_t len)
+{
+  while (len > 0) {
+    strbuf_chunk *c = sb->tail;
+    size_t n;
+    if (c == NULL || c->len == c->size) c = strbuf_grow(L, sb, sbidx, len);
+    n = c->size - c->len;
+    if (n > len) n = len;
+    memcpy(c->data + c->len, s, n);
+    c->len += n;
+    sb->len += n;
+    s += n;
+    len -= n;
+  }
+}
+
+/* contents of `from' as they are now, `from' may be sb itself */
+static void strbuf_addbuffer(lua_State *L, strbuf *sb, int sbidx, const strbuf *from)
+{
+  size_t left = from->len;
+  strbuf_chunk *c;
+  for (c = from->head; left > 0; c = c->next) {
+    size_t n = c->len < left ? c->len : left;
+    strbuf_addlstring(L, sb, sbidx, c->data, n);
+    left -= n;
+  }
+}
+
+/* raise the error for the first argument from..to that can't be appended,
+   before anything is */
+static void strbuf_checkargs(lua_State *L, int from, int to)
+{
+  int i;
+  for (i = from; i <= to; i++) {
+    if (!lua_isstring(L, i) && strbuf_test(L, i) == NULL)
+      strbuf_typeerror(L, i);
+  }
+}
+
+/* append arguments from..to, strings, numbers or buffers */
+static void strbuf_addargs(lua_State *L, strbuf *sb, int sbidx, int from, int to)
+{
+  int i;
+  for (i = from; i <= to; i++) {
+    strbuf *other = strbuf_test(L, i);
+    if (other != NULL)
+      strbuf_addbuffer(L, sb, sbidx, other);
+    else {
+      size_t len;
+      const char *s = lua_tolstring(L, i, &len);
+      strbuf_addlstring(L, sb, sbidx, s, len);
+    }
+  }
+}
+
+//strbuf.new([s1, ...])
+static int lstrbuf_new( lua_State* L )
+{
+  int n = lua_gettop(L);
+  strbuf *sb;
+  strbuf_checkargs(L, 1, n);
+  sb = (strbuf *)lua_newuserdata(L, sizeof(strbuf));
+  luaL_getmetatable(L, STRBUF_HANDLE);
+  lua_setmetatable(L, -2);
+  strbuf_reset(L, sb, n + 1);
+  strbuf_addargs(L, sb, n + 1, 1, n);
+  return 1;
+}
+
+//sb:append(s1, ...), returns sb
+static int lstrbuf_append( lua_State* L )
+{
+  strbuf *sb = tostrbuf(L);
+  int n = lua_gettop(L);
+  strbuf_checkargs(L, 2, n);
+  strbuf_addargs(L, sb, 1, 2, n);
+  lua_settop(L, 1);
+  return 1;
+}
+
+//sb:tostring(), the only copy that is interned
+static int lstrbuf_tostring( lua_State* L )
+{
+  strbuf *sb = tostrbuf(L);
+  strbuf_chunk *c;
+  luaL_Buffer b;
+  if (sb->head == NULL) lua_pushliteral(L, "");
+  else if (sb->head->next == NULL) lua_pushlstring(L, sb->head->data, sb->len);
+  else {
+    luaL_buffinit(L, &b);
+    for (c = sb->head; c != NULL; c = c->next)
+      luaL_addlstring(&b, c->data, c->len);
+    luaL_pushresult(&b);
+  }
+  return 1;
+}
+
+//sb:len()
+static int lstrbuf_len( lua_State* L )
+{
+  strbuf *sb = tostrbuf(L);
+  lua_pushinteger(L, sb->len);
+  return 1;
+}
+
+//sb:clear(), drops the chunks
+static int lstrbuf_clear( lua_State* L )
+{
+  strbuf_reset(L, tostrbuf(L), 1);
+  lua_settop(L, 1);
+  return 1;
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE strbuf_method_map[] =
+{
+  { LSTRKEY( "append" ), LFUNCVAL( lstrbuf_append )},
+  { LSTRKEY( "tostring" ), LFUNCVAL( lstrbuf_tostring )},
+  { LSTRKEY( "len" ), LFUNCVAL( lstrbuf_len )},
+  { LSTRKEY( "clear" ), LFUNCVAL( lstrbuf_clear )},
+  {LNILKEY, LNILVAL}
+};
+
+const LUA_REG_TYPE strbuf_map[] =
+{
+  { LSTRKEY( "new" ), LFUNCVAL( lstrbuf_new )},
+  {LNILKEY, LNILVAL}
+};
+
+LUALIB_API int luaopen_strbuf(lua_State *L)
+{
+  /* metatable is a ram table, rotables can't be metatables in this build */
+  luaL_newmetatable(L, STRBUF_HANDLE);
+#if LUA_OPTIMIZE_MEMORY > 0
+  lua_pushrotable(L, (void*)strbuf_method_map);
+#else
+  lua_newtable(L);
+  luaL_register(L, NULL, strbuf_method_map);
+#endif
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, lstrbuf_len);
+  lua_setfield(L, -2, "__len");
+  lua_pushcfunction(L, lstrbuf_tostring);
+  lua_setfield(L, -2, "__tostring");
+  lua_pop(L, 1);
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else
+  luaL_register( L, LUA_STRBUFLIBNAME, strbuf_map );
+  return 1;
+#endif
+}
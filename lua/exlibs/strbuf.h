@@ -0,0 +1,46 @@
+/**
+ * strbuf.h
+ *
+ * Mutable string buffers for Lua: text is appended to a list of chunks
+ * that are neither interned nor copied again, so building a response
+ * piece by piece costs time linear in its length. Output functions
+ * (file.write, net.send, uart.send, mqtt.publish) take a buffer in place
+ * of a string and write it chunk by chunk.
+ */
+
+#ifndef __STRBUF_H__
+#define __STRBUF_H__
+
+#include "lua.h"
+
+#define STRBUF_HANDLE       "strbuf"
+#define STRBUF_MINCHUNK     64    /* chunk sizes grow with the buffer */
+#define STRBUF_MAXCHUNK     1024
+
+typedef struct strbuf_chunk {
+  struct strbuf_chunk *next;
+  size_t len;   /* bytes used */
+  size_t size;  /* bytes allocated for data */
+  char data[1];
+} strbuf_chunk;
+
+typedef struct {
+  strbuf_chunk *head;
+  strbuf_chunk *tail;
+  size_t len;   /* total length */
+  int nchunks;  /* chunks in the environment table */
+} strbuf;
+
+/* called for each piece of a string or buffer, nonzero stops writing */
+typedef int (*strbuf_writer)(const char *p, size_t len, void *ud);
+
+/* buffer at index idx, or NULL if it is something else */
+strbuf *strbuf_test(lua_State *L, int idx);
+/* length of the string or buffer argument narg */
+size_t strbuf_checklen(lua_State *L, int narg);
+/* write string or buffer argument narg, returns the writer's result */
+int strbuf_write(lua_State *L, int narg, strbuf_writer w, void *ud);
+/* copy buffer contents to dst, which holds sb->len bytes */
+void strbuf_copy(const strbuf *sb, char *dst);
+
+#endif  /* __STRBUF_H__ */
@@ -0,0 +1,154 @@
+/**
+ * task.c
+ */
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lrotable.h"
+#include "lstate.h"
+#include "user_config.h"
+
+#include "MICORTOS.h"
+#include "task.h"
+
+extern mico_queue_t os_queue;
+static lua_State *task_L = NULL;
+static mico_semaphore_t task_sem = NULL;  /* set when a task yields or ends */
+
+lua_State *task_main(lua_State *L)
+{
+  return task_L != NULL ? task_L : L;
+}
+
+int task_running(lua_State *L)
+{
+  int r;
+  if (lua_pushthread(L)) {  /* main thread */
+    lua_pop(L, 1);
+    return 0;
+  }
+  lua_getfield(L, LUA_REGISTRYINDEX, TASK_SET);
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 2);
+    return 0;
+  }
+  lua_pushvalue(L, -2);
+  lua_rawget(L, -2);
+  r = lua_toboolean(L, -1);
+  lua_pop(L, 3);
+  return r;
+}
+
+int task_wait(lua_State *L)
+{
+  if (!task_running(L))
+    luaL_error(L, "attempt to wait outside a task");
+  if (L->nCcalls > L->baseCcalls)  /* lua_yield would fail, with a ref out */
+    luaL_error(L, "attempt to wait across metamethod/C-call boundary");
+  lua_pushthread(L);
+  return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+static void task_error(lua_State *co)
+{
+  const char *msg = lua_tostring(co, -1);
+  l_message("task", msg != NULL ? msg : "(error object is not a string)");
+}
+
+void task_resume(lua_State *L, int ref, int nargs)
+{
+  lua_State *co;
+  lua_Debug ar;
+  lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+  co = lua_tothread(L, -1);
+  /* the event may come from another thread before the task has yielded,
+     task_wait is the last thing before lua_yield so this is short */
+  while (co != NULL && lua_status(co) == 0 && lua_getstack(co, 0, &ar))
+    mico_rtos_get_semaphore(&task_sem, MICO_WAIT_FOREVER);
+  luaL_unref(L, LUA_REGISTRYINDEX, ref);
+  if (co == NULL || lua_status(co) != LUA_YIELD || !lua_checkstack(co, nargs)) {
+    lua_pop(L, nargs + 1);
+    return;
+  }
+  lua_insert(L, -(nargs + 1));  /* the thread stays on L while it runs */
+  lua_xmove(L, co, nargs);
+  if (lua_resume(co, nargs) > LUA_YIELD)
+    task_error(co);
+  lua_settop(co, 0);
+  mico_rtos_set_semaphore(&task_sem);
+  lua_pop(L, 1);
+}
+
+int task_wake(int ref)
+{
+  queue_msg_t msg;
+  msg.L = task_L;
+  msg.source = TASK;
+  msg.para1 = 0;
+  msg.para2 = ref;
+  return mico_rtos_push_to_queue(&os_queue, &msg, 0) == kNoErr;
+}
+
+//task.spawn(function, ...), runs it until it waits or ends, returns the task
+static int ltask_spawn( lua_State* L )
+{
+  int n = lua_gettop(L);
+  lua_State *co;
+  if (lua_type(L, 1) != LUA_TFUNCTION && lua_type(L, 1) != LUA_TLIGHTFUNCTION)
+    return luaL_error( L, "function needed" );
+  co = lua_newthread(L);
+  if (!lua_checkstack(co, n))
+    return luaL_error( L, "too many arguments" );
+  lua_getfield(L, LUA_REGISTRYINDEX, TASK_SET);
+  lua_pushvalue(L, -2);
+  lua_pushboolean(L, 1);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+  lua_insert(L, 1);
+  lua_xmove(L, co, n);
+  if (lua_resume(co, n - 1) > LUA_YIELD)
+    task_error(co);
+  lua_settop(co, 0);
+  mico_rtos_set_semaphore(&task_sem);
+  return 1;
+}
+
+//task.yield(), lets the other tasks and callbacks run first
+static int ltask_yield( lua_State* L )
+{
+  int ref = task_wait(L);
+  if (!task_wake(ref)) {  /* queue full, go on */
+    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    return 0;
+  }
+  return lua_yield(L, 0);
+}
+
+#define MIN_OPT_LEVEL   2
+#include "lrodefs.h"
+const LUA_REG_TYPE task_map[] =
+{
+  { LSTRKEY( "spawn" ), LFUNCVAL( ltask_spawn )},
+  { LSTRKEY( "yield" ), LFUNCVAL( ltask_yield )},
+  {LNILKEY, LNILVAL}
+};
+
+LUALIB_API int luaopen_task(lua_State *L)
+{
+  task_L = L;
+  if (task_sem == NULL)
+    mico_rtos_init_semaphore(&task_sem, 1);
+  lua_newtable(L);  /* set of tasks, they go when they end */
+  lua_newtable(L);
+  lua_pushliteral(L, "k");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_setfield(L, LUA_REGISTRYINDEX, TASK_SET);
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else
+  luaL_register( L, LUA_TASKLIBNAME, task_map );
+  return 1;
+#endif
+}
@@ -0,0 +1,31 @@
+/**
+ * task.h
+ *
+ * Tasks are coroutines started by task.spawn that run on the one
+ * lua_State. Blocking calls (tmr.sleep, net.receive, net.send) suspend
+ * the running task with task_wait and return lua_yield; whoever sees the
+ * event resumes it with task_resume, or from any RTOS thread posts it to
+ * the event queue with task_wake.
+ */
+
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include "lua.h"
+
+#define TASK_SET      "task"    /* registry: tasks, weak keys */
+
+/* main thread, for resuming tasks from outside of them */
+lua_State *task_main(lua_State *L);
+/* nonzero if L is a task */
+int task_running(lua_State *L);
+/* ref to the running task, which yields next; errors outside a task */
+int task_wait(lua_State *L);
+/* resume a waiting task with the nargs values on top of L, which must be
+   another thread; waits for the task to yield if it has not yet */
+void task_resume(lua_State *L, int ref, int nargs);
+/* resume a waiting task with no values from the event queue; returns 0 if
+   the queue is full */
+int task_wake(int ref);
+
+#endif  /* __TASK_H__ */
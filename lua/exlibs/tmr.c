@@ -12,9 +12,11 @@
 #include "platform_peripheral.h"
 #include "MicoDrivers/MICODriverNanoSecond.h"
 #include "MICORTOS.h"
+#include "task.h"
 
 extern mico_queue_t os_queue;
 #define NUM_TMR 16
+#define NUM_SLEEP 8
 
 extern void _watchdog_reload_timer_handler( void* arg );
 
@@ -27,6 +29,8 @@ static int tmr_cb_ref[NUM_TMR];
 static lua_State* gL = NULL;
 static mico_timer_t _timer[NUM_TMR];
 static bool tmr_is_started[NUM_TMR];
+static int sleep_task_ref[NUM_SLEEP];//LUA_NOREF if free
+static mico_timer_t _sleep_timer[NUM_SLEEP];
 
 //tmr.tick()
 static int ltmr_tick( lua_State* L )
@@ -69,7 +73,7 @@ static int ltmr_stopall( lua_State* L )
 //tmr.delayms()
 static int ltmr_delayms( lua_State* L )
 {
-  uint32_t ms = luaL_checkinteger( L, 1 );
+  lua_Integer ms = luaL_checkinteger( L, 1 );
   if ( ms <= 0 ) return luaL_error( L, "wrong arg range" );
 
   mico_thread_msleep(ms);
@@ -78,13 +82,47 @@ static int ltmr_delayms( lua_State* L )
 //tmr.delayus()
 static int ltmr_delayus( lua_State* L )
 {
-  uint32_t us = luaL_checkinteger( L, 1 );
+  lua_Integer us = luaL_checkinteger( L, 1 );
   if ( us <= 0 ) return luaL_error( L, "wrong arg range" );
 
-  MicoNanosendDelay(us*1000);
+  MicoNanosendDelay((uint64_t)us*1000);
   return 0;
 }
 
+static void _sleep_handler( void* arg )
+{
+  unsigned i = (unsigned)arg;
+  //queue full: the timer fires again after the same interval
+  if(i<NUM_SLEEP && task_wake(sleep_task_ref[i]))
+  {
+    mico_stop_timer(&_sleep_timer[i]);
+    sleep_task_ref[i] = LUA_NOREF;
+  }
+}
+//tmr.sleep(ms)
+//in a task it yields and the other tasks and callbacks run meanwhile,
+//elsewhere it is tmr.delayms()
+static int ltmr_sleep( lua_State* L )
+{
+  lua_Integer ms = luaL_checkinteger( L, 1 );
+  if ( ms <= 0 ) return luaL_error( L, "wrong arg range" );
+  if(!task_running(L))
+  {
+    mico_thread_msleep(ms);
+    return 0;
+  }
+  unsigned i;
+  for(i=0;i<NUM_SLEEP;i++)
+    if(sleep_task_ref[i]==LUA_NOREF) break;
+  if(i==NUM_SLEEP)
+    return luaL_error( L, "too many tasks sleeping" );
+  sleep_task_ref[i] = task_wait(L);
+  mico_deinit_timer( &_sleep_timer[i] );
+  mico_init_timer(&_sleep_timer[i], ms, _sleep_handler, (void*)i);
+  mico_start_timer(&_sleep_timer[i]);
+  return lua_yield(L, 0);
+}
+
 //tmr.wdclr()
 static int ltmr_wdclr( lua_State* L )
 {
@@ -123,7 +161,7 @@ static int ltmr_start( lua_State* L )
     {
       luaL_unref(L, LUA_REGISTRYINDEX, tmr_cb_ref[id]);
     }
-    gL = L;
+    gL = task_main(L);
     tmr_cb_ref[id] = luaL_ref(L, LUA_REGISTRYINDEX);
     
     mico_stop_timer(&_timer[id]);
@@ -145,6 +183,7 @@ const LUA_REG_TYPE tmr_map[] =
   { LSTRKEY( "tick" ), LFUNCVAL( ltmr_tick ) },
   { LSTRKEY( "delayms" ), LFUNCVAL( ltmr_delayms ) },
   { LSTRKEY( "delayus" ), LFUNCVAL( ltmr_delayus ) },
+  { LSTRKEY( "sleep" ), LFUNCVAL( ltmr_sleep ) },
   { LSTRKEY( "start" ), LFUNCVAL( ltmr_start ) },
   { LSTRKEY( "stop" ), LFUNCVAL( ltmr_stop ) },
   { LSTRKEY( "stopall" ), LFUNCVAL( ltmr_stopall ) },
@@ -160,6 +199,8 @@ LUALIB_API int luaopen_tmr(lua_State *L)
     tmr_cb_ref[i] = LUA_NOREF;
     tmr_is_started[i] = false;
   }
+  for(int i=0;i<NUM_SLEEP;i++)
+    sleep_task_ref[i] = LUA_NOREF;
 #if LUA_OPTIMIZE_MEMORY > 0
     return 0;
 #else
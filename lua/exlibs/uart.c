@@ -7,6 +7,7 @@
 #include "lualib.h"
 #include "lrotable.h"
 #include "MicoPlatform.h"
+#include "strbuf.h"
 
 static lua_State *gL = NULL;
 static int usr_uart_cb_ref = LUA_NOREF;
@@ -169,13 +170,19 @@ static int uart_on( lua_State* L )
   }
   return 0;
 }
-//uart.send(1,string1,number,...[stringn])
+static int uart_send_piece(const char *p, size_t len, void *ud)
+{
+  (void)ud;
+  MicoUartSend( LUA_USR_UART, p, len);
+  return 0;
+}
+
+//uart.send(1,string1,number,...[stringn]), strings may be strbufs
 static int uart_send( lua_State* L )
 {
   uint16_t id = luaL_checkinteger( L, 1 );
   MOD_CHECK_ID( uart, id );
   
-  const char* buf;
   size_t len;
   int total = lua_gettop( L ), s;
   
@@ -188,11 +195,7 @@ static int uart_send( lua_State* L )
       MicoUartSend( LUA_USR_UART,(char*)len,1);
     }
     else
-    {
-      luaL_checktype( L, s, LUA_TSTRING );
-      buf = lua_tolstring( L, s, &len );
-      MicoUartSend( LUA_USR_UART, buf,len);
-    }
+      strbuf_write( L, s, uart_send_piece, NULL );
   }
   return 0;
 }
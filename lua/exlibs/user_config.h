@@ -21,6 +21,11 @@
 #define USE_SENSOR_MODULE
 #define USE_OLED_MODULE
 #define USE_MQTT_MODULE
+#define USE_STRBUF_MODULE
+#define USE_TASK_MODULE
+#define USE_HTTP_MODULE
+#define USE_CRYPTO_MODULE
+#define USE_CONFIG_MODULE
 
 #define MOD_REG_NUMBER( L, name, val )\
   lua_pushnumber( L, val );\
@@ -339,6 +339,25 @@ LUA_API lua_Integer lua_tointeger (lua_State *L, int idx) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+LUA_API int lua_isfloat (lua_State *L, int idx) {
+  TValue n;
+  const TValue *o = index2adr(L, idx);
+  return tonumber(o, &n) && ttisfloat(o);
+}
+
+
+LUA_API lua_Float lua_tofloat (lua_State *L, int idx) {
+  TValue n;
+  const TValue *o = index2adr(L, idx);
+  if (tonumber(o, &n))
+    return nfltvalue(o);
+  else
+    return 0;
+}
+#endif
+
+
 LUA_API int lua_toboolean (lua_State *L, int idx) {
   const TValue *o = index2adr(L, idx);
   return !l_isfalse(o);
@@ -451,6 +470,16 @@ LUA_API void lua_pushinteger (lua_State *L, lua_Integer n) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+LUA_API void lua_pushfloat (lua_State *L, lua_Float n) {
+  lua_lock(L);
+  setfltvalue(L->top, n);
+  api_incr_top(L);
+  lua_unlock(L);
+}
+#endif
+
+
 LUA_API void lua_pushlstring (lua_State *L, const char *s, size_t len) {
   lua_lock(L);
   luaC_checkGC(L);
@@ -980,6 +1009,11 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
         res = 1; /* gc is block so we need to pretend that the collection cycle finished. */
         break;
       }
+      if (g->gckind == KGC_GEN) {
+        luaC_youngcollect(L);
+        res = 1;  /* each step is a whole collection */
+        break;
+      }
       lu_mem a = (cast(lu_mem, data) << 10);
       if (a <= g->totalbytes)
         g->GCthreshold = g->totalbytes - a;
@@ -994,6 +1028,23 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       }
       break;
     }
+    case LUA_GCGEN: {
+      res = (g->gckind == KGC_GEN) ? LUA_GCGEN : LUA_GCINC;
+      luaC_changemode(L, KGC_GEN);
+      break;
+    }
+    case LUA_GCINC: {
+      res = (g->gckind == KGC_GEN) ? LUA_GCGEN : LUA_GCINC;
+      luaC_changemode(L, KGC_NORMAL);
+      break;
+    }
+    case LUA_GCYOUNG: {
+      if (g->gckind == KGC_GEN)
+        luaC_youngcollect(L);
+      else
+        luaC_fullgc(L);
+      break;
+    }
     case LUA_GCSETPAUSE: {
       res = g->gcpause;
       g->gcpause = data;
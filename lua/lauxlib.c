@@ -28,6 +28,7 @@
 #include "lgc.h"
 #include "ldo.h"
 #include "lobject.h"
+#include "limage.h"
 #include "lstate.h"
 #include "legc.h"
 
@@ -680,12 +681,33 @@ LUALIB_API int luaL_loadfile (lua_State *L, const char *filename) {
 #include <spiffs_nucleus.h>
 #define FILE_NOT_OPENED 0
 extern spiffs fs;
+
+/* files are read ahead in whole spiffs data pages */
+#define LOADF_BUFFERSIZE (LUAL_BUFFERSIZE*2)
+#define LOADF_READSIZE \
+  ((LOADF_BUFFERSIZE / SPIFFS_DATA_PAGE_SIZE(&fs)) * SPIFFS_DATA_PAGE_SIZE(&fs))
+
 typedef struct LoadFSF {
   int extraline;
   int f;
-  char buff[LUAL_BUFFERSIZE];
+  const char *p;  /* next unread byte in buff */
+  size_t n;  /* number of unread bytes in buff */
+  char buff[LOADF_BUFFERSIZE];
 } LoadFSF;
 
+static size_t fillFSF (LoadFSF *lf) {
+  s32_t res = SPIFFS_read(&fs, lf->f, lf->buff, LOADF_READSIZE);
+  lf->p = lf->buff;
+  lf->n = (res > 0) ? res : 0;
+  return lf->n;
+}
+
+static int getcFSF (LoadFSF *lf) {
+  if (lf->n == 0 && fillFSF(lf) == 0) return EOF;
+  lf->n--;
+  return (unsigned char)*lf->p++;
+}
+
 static const char *getFSF (lua_State *L, void *ud, size_t *size) {
   LoadFSF *lf = (LoadFSF *)ud;
   (void)L;
@@ -699,67 +721,159 @@ static const char *getFSF (lua_State *L, void *ud, size_t *size) {
     return "\n";
   }
 
-  if (SPIFFS_eof(&fs,lf->f)) return NULL;
-  *size = SPIFFS_read(&fs,lf->f, lf->buff, sizeof(lf->buff));
-
-  return (*size > 0) ? lf->buff : NULL;
+  if (lf->n == 0 && fillFSF(lf) == 0) return NULL;
+  *size = lf->n;
+  lf->n = 0;
+  return lf->p;
 }
 
 
 static int errfsfile (lua_State *L, const char *what, int fnameindex) {
   const char *filename = lua_tostring(L, fnameindex) + 1;
   lua_pushfstring(L, "cannot %s %s", what, filename);
-  lua_remove(L, fnameindex);
   return LUA_ERRFILE;
 }
 
-static int mySPIFFS_getc( int fd ){
-  unsigned char c = 0xFF;
-  int res;
-  if(!SPIFFS_eof(&fs,fd)){
-    res = SPIFFS_read(&fs, (spiffs_file)fd, &c, 1);
-    if (res != 1) {
-      //MCU_DBG("getc errno %i\n", SPIFFS_errno(&fs));
-      return (int)EOF;
-    } else {
-      return (int)c;
-    }
+/* loads filename as chunk named by the string at fnameindex, the read
+   ahead buffer is only allocated while loading */
+static int loadfsfile (lua_State *L, const char *filename, int fnameindex) {
+  LoadFSF *lf;
+  void *ud;
+  lua_Alloc allocf = lua_getallocf(L, &ud);
+  int status;
+  int c;
+  lf = (LoadFSF *)allocf(ud, NULL, 0, sizeof(LoadFSF));
+  if (lf == NULL) {
+    lua_pushliteral(L, "not enough memory");
+    return LUA_ERRMEM;
+  }
+  lf->extraline = 0;
+  lf->n = 0;
+  lf->f = SPIFFS_open(&fs,(char*)filename, SPIFFS_RDONLY,0);
+  if (lf->f < FILE_NOT_OPENED) {
+    allocf(ud, lf, sizeof(LoadFSF), 0);
+    return errfsfile(L, "open", fnameindex);
+  }
+  /* text and binary are told apart in the read ahead buffer,
+     the file is opened only once */
+  c = getcFSF(lf);
+  if (c == '#') {  /* Unix exec. file? */
+    lf->extraline = 1;
+    while ((c = getcFSF(lf)) != EOF && c != '\n') ;  /* skip first line */
+    if (c == '\n') c = getcFSF(lf);
+  }
+  if (c == LUA_SIGNATURE[0]) {  /* binary file? */
+    lf->extraline = 0;
   }
-  return (int)EOF;
+  if (c != EOF) {  /* ungetc */
+    lf->p--;
+    lf->n++;
+  }
+  status = lua_load(L, getFSF, lf, lua_tostring(L, fnameindex));
+  SPIFFS_close(&fs,lf->f);  /* close file (even in case of errors) */
+  allocf(ud, lf, sizeof(LoadFSF), 0);
+  return status;
+}
+
+/*
+** Memoized bytecode: when loading "x.lua", a "x.lc" dumped from an earlier
+** load is used if its trailer matches the spiffs object of the source.
+** Writing the source moves its index header page, so object id, header page
+** and size tell a changed source without reading it. Only an in place change
+** beyond the pages the header indexes (large file, "r+", same size) is
+** missed. The trailer is behind the bytecode, so "x.lc" still loads with
+** dofile.
+*/
+#define LCMEMO_MAGIC 0x6f6d6c63  /* "clmo" */
+
+typedef struct LCMemo {
+  unsigned long magic;
+  unsigned long size;
+  unsigned long obj_id;
+  unsigned long pix;  /* index header page of the source */
+} LCMemo;
+
+static int lcmemo_enabled = LUA_LOADFILE_MEMOIZE;
+
+LUALIB_API int luaL_memoizelc (int enable) {
+  int old = lcmemo_enabled;
+  if (enable >= 0) lcmemo_enabled = enable;
+  return old;
+}
+
+static int lcmemo_source (const char *filename, LCMemo *m) {
+  spiffs_stat s;
+  if (SPIFFS_stat(&fs, (char*)filename, &s) != SPIFFS_OK) return 0;
+  m->magic = LCMEMO_MAGIC;
+  m->size = s.size;
+  m->obj_id = s.obj_id;
+  m->pix = s.pix;
+  return 1;
+}
+
+static int lcmemo_valid (const char *lcname, const LCMemo *m) {
+  LCMemo t;
+  spiffs_stat s;
+  int ok = 0;
+  int f = SPIFFS_open(&fs,(char*)lcname, SPIFFS_RDONLY,0);
+  if (f < FILE_NOT_OPENED) return 0;
+  if (SPIFFS_fstat(&fs, f, &s) == SPIFFS_OK && s.size > sizeof(LCMemo) &&
+      SPIFFS_lseek(&fs, f, s.size - sizeof(LCMemo), SPIFFS_SEEK_SET) == 0 &&
+      SPIFFS_read(&fs, f, &t, sizeof(LCMemo)) == sizeof(LCMemo))
+    ok = (memcmp(&t, m, sizeof(LCMemo)) == 0);
+  SPIFFS_close(&fs,f);
+  return ok;
+}
+
+static int lcmemo_writer (lua_State *L, const void *p, size_t size, void *u) {
+  (void)L;
+  if (size == 0) return 0;
+  return SPIFFS_write(&fs, *(int *)u, (void *)p, size) != (s32_t)size;
+}
+
+/* dumps function on top of the stack, debug info is kept for tracebacks */
+static void lcmemo_save (lua_State *L, const char *lcname, LCMemo *m) {
+  int ok;
+  int f = SPIFFS_open(&fs,(char*)lcname,
+      SPIFFS_WRONLY|SPIFFS_CREAT|SPIFFS_TRUNC,0);
+  if (f < FILE_NOT_OPENED) return;
+  ok = (lua_dump(L, lcmemo_writer, &f) == 0 &&
+        SPIFFS_write(&fs, f, m, sizeof(LCMemo)) == sizeof(LCMemo));
+  SPIFFS_close(&fs,f);
+  if (!ok) SPIFFS_remove(&fs,(char*)lcname);
 }
 
 LUALIB_API int luaL_loadfile (lua_State *L, const char *filename) {
-  static LoadFSF lf;//doit
   int status;
-  int c;
   int fnameindex = lua_gettop(L) + 1;  /* index of filename on the stack */
-  lf.extraline = 0;
+  size_t len;
   if (filename == NULL) {
     return luaL_error(L, "filename is NULL");
   }
-  else {
-    lua_pushfstring(L, "@%s", filename);
-    lf.f = SPIFFS_open(&fs,(char*)filename, SPIFFS_RDONLY,0);
-    if (lf.f < FILE_NOT_OPENED) return errfsfile(L, "open", fnameindex);
-  }
-  c = mySPIFFS_getc(lf.f);
-  if (c == '#') {  /* Unix exec. file? */
-    lf.extraline = 1;
-    while ((c = mySPIFFS_getc(lf.f)) != EOF && c != '\n') ;  /* skip first line */
-    if (c == '\n') c = mySPIFFS_getc(lf.f);
-  }
-  if (c == LUA_SIGNATURE[0] && filename) {  /* binary file? */
-    SPIFFS_close(&fs,lf.f);
-    lf.f = SPIFFS_open(&fs,(char*)filename, SPIFFS_RDONLY,0);  /* reopen in binary mode */
-    if (lf.f < FILE_NOT_OPENED) return errfsfile(L, "reopen", fnameindex);
-    /* skip eventual `#!...' */
-   while ((c = mySPIFFS_getc(lf.f)) != EOF && c != LUA_SIGNATURE[0]) ;
-    lf.extraline = 0;
+  lua_pushfstring(L, "@%s", filename);
+  len = strlen(filename);
+  if (lcmemo_enabled && len > 4 && len < SPIFFS_OBJ_NAME_LEN &&
+      strcmp(filename + len - 4, ".lua") == 0) {
+    char lcname[SPIFFS_OBJ_NAME_LEN];
+    LCMemo m;
+    strcpy(lcname, filename);
+    strcpy(lcname + len - 4, ".lc");
+    if (lcmemo_source(filename, &m)) {
+      if (lcmemo_valid(lcname, &m)) {
+        status = loadfsfile(L, lcname, fnameindex);
+        if (status == 0) {
+          lua_remove(L, fnameindex);
+          return status;
+        }
+        lua_pop(L, 1);  /* error message, compile source instead */
+      }
+      status = loadfsfile(L, filename, fnameindex);
+      if (status == 0) lcmemo_save(L, lcname, &m);
+      lua_remove(L, fnameindex);
+      return status;
+    }
   }
-  //fs_ungetc(c, lf.f);
-  SPIFFS_lseek(&fs, lf.f, -1, SEEK_CUR);
-  status = lua_load(L, getFSF, &lf, lua_tostring(L, -1));
-  if (filename) SPIFFS_close(&fs,lf.f);  /* close file (even in case of errors) */
+  status = loadfsfile(L, filename, fnameindex);
   lua_remove(L, fnameindex);
   return status;
 }
@@ -796,6 +910,37 @@ LUALIB_API int (luaL_loadstring) (lua_State *L, const char *s) {
 }
 
 
+/* chunks of the flash image are used where they are, see limage.h */
+static const char *getI (lua_State *L, void *ud, size_t *size) {
+  LoadS *ls = (LoadS *)ud;
+  if (L == NULL && size == NULL) // direct mode check
+    return ls->s;
+  if (ls->size == 0) return NULL;
+  *size = ls->size;
+  ls->size = 0;
+  return ls->s;
+}
+
+
+LUALIB_API int luaL_loadimage (lua_State *L, const char *name) {
+  const LuaImageHeader *h = lua_flash_image();
+  uint32_t i;
+  if (h != NULL) {
+    for (i = 0; i < h->count; i++) {
+      const LuaImageEntry *e = LUA_IMAGE_ENTRY(h, i);
+      if (strcmp(e->name, name) == 0) {
+        LoadS ls;
+        ls.s = (const char *)h + e->offset;
+        ls.size = e->size;
+        return lua_load(L, getI, &ls, name);
+      }
+    }
+  }
+  lua_pushfstring(L, "no module " LUA_QS " in flash image", name);
+  return LUA_ERRFILE;
+}
+
+
 
 /* }====================================================== */
 
@@ -807,7 +952,13 @@ static int l_check_memlimit(lua_State *L, size_t needbytes) {
   /* don't allow allocation if it requires more memory then the total limit. */
   if (needbytes > g->memlimit) return 1;
   /* make sure the GC is not disabled. */
-  if (!is_block_gc(L)) {
+  if (!is_block_gc(L) && g->gckind == KGC_GEN) {
+    /* collections are not incremental: try a young one first */
+    luaC_youngcollect(L);
+    if (g->totalbytes >= limit)
+      luaC_fullgc(L);
+  }
+  else if (!is_block_gc(L)) {
     while (g->totalbytes >= limit) {
       /* only allow the GC to finished atleast 1 full cycle. */
       if (g->gcstate == GCSpause && ++cycle_count > 1) break;
@@ -66,6 +66,12 @@ static int luaB_tonumber (lua_State *L) {
   int base = luaL_optint(L, 2, 10);
   if (base == 10) {  /* standard conversion */
     luaL_checkany(L, 1);
+#if defined LUA_NUMBER_HYBRID
+    if (lua_isfloat(L, 1)) {
+      lua_pushfloat(L, lua_tofloat(L, 1));
+      return 1;
+    }
+#endif
     if (lua_isnumber(L, 1)) {
       lua_pushnumber(L, lua_tonumber(L, 1));
       return 1;
@@ -204,10 +210,11 @@ static int luaB_gcinfo (lua_State *L) {
 
 static int luaB_collectgarbage (lua_State *L) {
   static const char *const opts[] = {"stop", "restart", "collect",
-    "count", "step", "setpause", "setstepmul","setmemlimit","getmemlimit", NULL};
+    "count", "step", "setpause", "setstepmul","setmemlimit","getmemlimit",
+    "generational", "incremental", NULL};
   static const int optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
     LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL,
-		LUA_GCSETMEMLIMIT,LUA_GCGETMEMLIMIT};
+		LUA_GCSETMEMLIMIT,LUA_GCGETMEMLIMIT,LUA_GCGEN,LUA_GCINC};
   int o = luaL_checkoption(L, 1, "collect", opts);
   int ex = luaL_optint(L, 2, 0);
   int res = lua_gc(L, optsnum[o], ex);
@@ -221,6 +228,10 @@ static int luaB_collectgarbage (lua_State *L) {
       lua_pushboolean(L, res);
       return 1;
     }
+    case LUA_GCGEN: case LUA_GCINC: {  /* previous mode */
+      lua_pushstring(L, res == LUA_GCGEN ? "generational" : "incremental");
+      return 1;
+    }
     default: {
       lua_pushnumber(L, res);
       return 1;
@@ -494,7 +505,8 @@ const LUA_REG_TYPE base_funcs_list[] = {
 #endif
 
 
-static int luaB_index(lua_State *L) {
+/* not static: lvm.c caches what it finds, see cachedglobal */
+int luaB_index(lua_State *L) {
 #if LUA_OPTIMIZE_MEMORY == 2
   int fres;
   if ((fres = luaR_findfunction(L, base_funcs_list)) != 0)
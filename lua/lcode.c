@@ -226,12 +226,19 @@ static void freeexp (FuncState *fs, expdesc *e) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+/* 2 and 2.0 are one key in `fs->h' but two different constants */
+#define samek(fs,idx,v)	((fs)->f->k[cast_int(nvalue(idx))].tt == (v)->tt)
+#else
+#define samek(fs,idx,v)	1
+#endif
+
 static int addk (FuncState *fs, TValue *k, TValue *v) {
   lua_State *L = fs->L;
   TValue *idx = luaH_set(L, fs->h, k);
   Proto *f = fs->f;
   int oldsize = f->sizek;
-  if (ttisnumber(idx)) {
+  if (ttisnumber(idx) && samek(fs, idx, v)) {
     lua_assert(luaO_rawequalObj(&fs->f->k[cast_int(nvalue(idx))], v));
     return cast_int(nvalue(idx));
   }
@@ -261,6 +268,15 @@ int luaK_numberK (FuncState *fs, lua_Number r) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+int luaK_floatK (FuncState *fs, lua_Float r) {
+  TValue o;
+  setfltvalue(&o, r);
+  return addk(fs, &o, &o);
+}
+#endif
+
+
 static int boolK (FuncState *fs, int b) {
   TValue o;
   setbvalue(&o, b);
@@ -234,6 +234,7 @@ LUA_API int lua_getinfo (lua_State *L, const char *what, lua_Debug *ar) {
   Closure *f = NULL;
   CallInfo *ci = NULL;
   void *plight = NULL;
+  StkId lfunc = NULL;  /* keeps the tag of a light function */
   lua_lock(L);
   if (*what == '>') {
     StkId func = L->top - 1;
@@ -241,8 +242,10 @@ LUA_API int lua_getinfo (lua_State *L, const char *what, lua_Debug *ar) {
     what++;  /* skip the '>' */
     if (ttisfunction(func))
       f = clvalue(func);
-    else
+    else {
       plight = fvalue(func);
+      lfunc = func;
+    }
     L->top--;  /* pop function */
   }
   else if (ar->i_ci != 0) {  /* no tail call? */
@@ -250,15 +253,17 @@ LUA_API int lua_getinfo (lua_State *L, const char *what, lua_Debug *ar) {
     lua_assert(ttisfunction(ci->func) || ttislightfunction(ci->func));
     if (ttisfunction(ci->func))
       f = clvalue(ci->func);
-    else
+    else {
       plight = fvalue(ci->func);
+      lfunc = ci->func;
+    }
   }
   status = auxgetinfo(L, what, ar, f, plight, ci);
   if (strchr(what, 'f')) {
     if (f != NULL) 
       setclvalue(L, L->top, f)
     else if (plight != NULL)
-      setfvalue(L->top, plight)
+      setobj2s(L, L->top, lfunc)
     else
       setnilvalue(L->top);
     incr_top(L);
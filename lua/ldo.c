@@ -22,6 +22,7 @@
 #include "lobject.h"
 #include "lopcodes.h"
 #include "lparser.h"
+#include "lrotable.h"
 #include "lstate.h"
 #include "lstring.h"
 #include "ltable.h"
@@ -332,6 +333,10 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
     lua_unlock(L);
     if (ttisfunction(ci->func))
       n = (*curr_func(L)->c.f)(L);  /* do the actual call */
+#ifndef LUA_PACK_VALUE
+    else if (ttisfastfunc(ci->func))  /* regular version of a fast builtin */
+      n = (*((const luaR_fastfunc *)fvalue(ci->func))->f)(L);
+#endif
     else
       n = ((lua_CFunction)fvalue(ci->func))(L);  /* do the actual call */
     lua_lock(L);
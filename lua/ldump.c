@@ -203,6 +203,17 @@ static void DumpConstants(const Proto* f, DumpState* D)
  for (i=0; i<n; i++)
  {
   const TValue* o=&f->k[i];
+#if defined LUA_NUMBER_HYBRID
+  if (ttisfloat(o))
+  {
+   /* the variant tag, then a single precision float on every target */
+   float y=fltvalue(o);
+   DumpChar(LUA_TNUMFLT,D);
+   MaybeByteSwap((char*)&y,4,D);
+   DumpVar(y,D);
+   continue;
+  }
+#endif
   DumpChar(ttype(o),D);
   switch (ttype(o))
   {
@@ -116,6 +116,7 @@ Proto *luaF_newproto (lua_State *L) {
   Proto *f = luaM_new(L, Proto);
   luaC_link(L, obj2gco(f), LUA_TPROTO);
   f->k = NULL;
+  f->kcache = NULL;
   f->sizek = 0;
   f->p = NULL;
   f->sizep = 0;
@@ -141,6 +142,8 @@ Proto *luaF_newproto (lua_State *L) {
 void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->p, f->sizep, Proto *);
   luaM_freearray(L, f->k, f->sizek, TValue);
+  if (f->kcache != NULL)
+    luaM_freearray(L, f->kcache, f->sizek, KCache);
   luaM_freearray(L, f->locvars, f->sizelocvars, struct LocVar);
   luaM_freearray(L, f->upvalues, f->sizeupvalues, TString *);
   if (!proto_is_readonly(f)) {
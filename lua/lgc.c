@@ -129,8 +129,9 @@ size_t luaC_separateudata (lua_State *L, int all) {
   global_State *g = G(L);
   size_t deadmem = 0;
   GCObject **p = &g->mainthread->next;
+  GCObject *stop = all ? NULL : g->oldudata;  /* old udata are not dead */
   GCObject *curr;
-  while ((curr = *p) != NULL) {
+  while ((curr = *p) != stop) {
     if (!(iswhite(curr) || all) || isfinalized(gco2u(curr)))
       p = &curr->gch.next;  /* don't bother with them */
     else if (fasttm(L, gco2u(curr)->metatable, TM_GC) == NULL) {
@@ -314,6 +315,7 @@ static l_mem propagatemark (global_State *g) {
       traverseproto(g, p);
       return sizeof(Proto) + sizeof(Proto *) * p->sizep +
                              sizeof(TValue) * p->sizek + 
+                             (p->kcache ? sizeof(KCache) * p->sizek : 0) +
                              sizeof(LocVar) * p->sizelocvars +
                              sizeof(TString *) * p->sizeupvalues +
                              (proto_is_readonly(p) ? 0 : sizeof(Instruction) * p->sizecode +
@@ -391,7 +393,8 @@ static void freeobj (lua_State *L, GCObject *o) {
       break;
     }
     case LUA_TSTRING: {
-      G(L)->strt.nuse--;
+      if (!luaS_islong(rawgco2ts(o)))  /* long strings are not in `strt' */
+        G(L)->strt.nuse--;
       luaM_freemem(L, o, sizestring(gco2ts(o)));
       break;
     }
@@ -430,6 +433,28 @@ static GCObject **sweeplist (lua_State *L, GCObject **p, lu_mem count) {
 }
 
 
+/*
+** Generational mode: free the dead objects of list `p' up to `stop'.
+** The others keep their marks, so that survivors stay black (strings
+** gray) from then on: they are old.
+*/
+static void sweepgen (lua_State *L, GCObject **p, GCObject *stop) {
+  GCObject *curr;
+  global_State *g = G(L);
+  int deadmask = otherwhite(g);
+  while ((curr = *p) != stop) {
+    if (curr->gch.tt == LUA_TTHREAD)  /* sweep open upvalues of each thread */
+      sweepgen(L, &gco2th(curr)->openupval, NULL);
+    if ((curr->gch.marked ^ WHITEBITS) & deadmask)  /* not dead? */
+      p = &curr->gch.next;
+    else {  /* must erase `curr' */
+      *p = curr->gch.next;
+      freeobj(L, curr);
+    }
+  }
+}
+
+
 static void checkSizes (lua_State *L) {
   global_State *g = G(L);
   /* check size of string hash */
@@ -615,11 +640,104 @@ static l_mem singlestep (lua_State *L) {
 }
 
 
+/*
+** Generational mode. Survivors of a collection are not made white
+** again, and between collections the collector waits in GCSpropagate,
+** so the write barriers go on catching old (black) objects that get a
+** young (white) one stored in them: the young object is marked, or the
+** table goes to `grayagain'. New objects are linked at the head of
+** `rootgc' and of the userdata list, before `oldgc' and `oldudata'.
+**
+** A young collection propagates what the barriers marked and runs
+** `atomic', which also traverses the threads and weak tables kept in
+** `grayagain' and `weak' since the previous collection. It then sweeps
+** the young part of the lists only (and all strings, which are not
+** ordered by age), so its cost follows what was allocated since the
+** previous collection rather than the size of the heap. A major
+** collection, a full one keeping the marks, runs when memory in use
+** has grown LUAI_GCMAJORINC percent since the last one.
+*/
+
+/* end a collection in generational mode, after `atomic' */
+static void gensweep (lua_State *L, int major) {
+  global_State *g = G(L);
+  int i;
+  g->gcstate = GCSpropagate;  /* keep barriers working from now on */
+  for (i = 0; i < g->strt.size; i++)
+    sweepgen(L, &g->strt.hash[i], NULL);
+  sweepgen(L, &g->rootgc, g->oldgc);  /* up to main thread and udata */
+  if (!major)
+    sweepgen(L, &g->mainthread->next, g->oldudata);
+  checkSizes(L);
+  g->oldgc = g->rootgc;
+  g->oldudata = g->mainthread->next;
+  while (g->tmudata)
+    GCTM(L);
+  g->estimate = g->totalbytes;
+  if (major)
+    g->lastmajor = g->totalbytes;
+  setthreshold(g);
+}
+
+
+static void fullgc (lua_State *L) {
+  global_State *g = G(L);
+  if (g->gcstate <= GCSpropagate) {
+    /* reset sweep marks to sweep all elements (returning them to white) */
+    g->sweepstrgc = 0;
+    g->sweepgc = &g->rootgc;
+    /* reset other collector lists */
+    g->gray = NULL;
+    g->grayagain = NULL;
+    g->weak = NULL;
+    g->gcstate = GCSsweepstring;
+  }
+  lua_assert(g->gcstate != GCSpause && g->gcstate != GCSpropagate);
+  /* finish any pending sweep phase */
+  while (g->gcstate != GCSfinalize) {
+    lua_assert(g->gcstate == GCSsweepstring || g->gcstate == GCSsweep);
+    singlestep(L);
+  }
+  markroot(L);
+  if (g->gckind == KGC_GEN) {
+    g->oldgc = NULL;  /* everything is young */
+    g->oldudata = NULL;
+    while (g->gcstate != GCSsweepstring)  /* mark, up to `atomic' */
+      singlestep(L);
+    gensweep(L, 1);
+    return;
+  }
+  while (g->gcstate != GCSpause) {
+    singlestep(L);
+  }
+  setthreshold(g);
+}
+
+
+static void genstep (lua_State *L) {
+  global_State *g = G(L);
+  if (g->oldgc == NULL ||  /* not running in generational mode yet? */
+      g->totalbytes > (g->lastmajor / 100) * LUAI_GCMAJORINC)
+    fullgc(L);
+  else {
+    lua_assert(g->gcstate == GCSpropagate);
+    propagateall(g);  /* objects marked by barriers */
+    atomic(L);
+    gensweep(L, 0);
+  }
+}
+
+
 void luaC_step (lua_State *L) {
   global_State *g = G(L);
   if(is_block_gc(L)) return;
   set_block_gc(L);
   l_mem lim = (GCSTEPSIZE/100) * g->gcstepmul;
+  if (g->gckind == KGC_GEN) {
+    genstep(L);
+    unset_block_gc(L);
+    return;
+  }
   if (lim == 0)
     lim = (MAX_LUMEM-1)/2;  /* no limit */
   g->gcdept += g->totalbytes - g->GCthreshold;
@@ -655,34 +773,37 @@ int luaC_sweepstrgc (lua_State *L) {
 }
 
 void luaC_fullgc (lua_State *L) {
-  global_State *g = G(L);
   if(is_block_gc(L)) return;
   set_block_gc(L);
-  if (g->gcstate <= GCSpropagate) {
-    /* reset sweep marks to sweep all elements (returning them to white) */
-    g->sweepstrgc = 0;
-    g->sweepgc = &g->rootgc;
-    /* reset other collector lists */
-    g->gray = NULL;
-    g->grayagain = NULL;
-    g->weak = NULL;
-    g->gcstate = GCSsweepstring;
-  }
-  lua_assert(g->gcstate != GCSpause && g->gcstate != GCSpropagate);
-  /* finish any pending sweep phase */
-  while (g->gcstate != GCSfinalize) {
-    lua_assert(g->gcstate == GCSsweepstring || g->gcstate == GCSsweep);
-    singlestep(L);
-  }
-  markroot(L);
-  while (g->gcstate != GCSpause) {
-    singlestep(L);
-  }
-  setthreshold(g);
+  fullgc(L);
   unset_block_gc(L);
 }
 
 
+/* collect what was allocated since the previous collection */
+void luaC_youngcollect (lua_State *L) {
+  lua_assert(G(L)->gckind == KGC_GEN);
+  if(is_block_gc(L)) return;
+  set_block_gc(L);
+  genstep(L);
+  unset_block_gc(L);
+}
+
+
+/*
+** The collector waiting between generational collections is in a valid
+** incremental state (no black object refers to a white one), so modes
+** can be changed at any time; generational mode starts with a major
+** collection.
+*/
+void luaC_changemode (lua_State *L, int mode) {
+  global_State *g = G(L);
+  g->gckind = cast_byte(mode);
+  g->oldgc = NULL;
+  g->oldudata = NULL;
+}
+
+
 void luaC_barrierf (lua_State *L, GCObject *o, GCObject *v) {
   global_State *g = G(L);
   lua_assert(isblack(o) && iswhite(v) && !isdead(g, v) && !isdead(g, o));
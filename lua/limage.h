@@ -0,0 +1,45 @@
+/*
+** Lua flash image
+** A set of precompiled chunks, built on the host by Tools/luaimage.c and
+** placed in internal flash by file.flashload(). Chunks are loaded in
+** direct mode, so code, line info and constant strings are not copied
+** to RAM.
+*/
+
+#ifndef limage_h
+#define limage_h
+
+#include <stdint.h>
+
+#define LUA_IMAGE_MAGIC		0x474d494c	/* "LIMG" */
+#define LUA_IMAGE_VERSION	1
+
+/* module name length, same as SPIFFS_OBJ_NAME_LEN */
+#define LUA_IMAGE_NAME_LEN	32
+
+/*
+** Layout: header, `count' entries, chunks. All fields are little endian,
+** chunks start at 4 byte aligned offsets so that instructions can be
+** executed from where they are.
+*/
+typedef struct LuaImageHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;	/* bytes of the whole image */
+  uint32_t count;	/* number of entries */
+  uint32_t crc;		/* crc32 of the bytes after the header */
+} LuaImageHeader;
+
+typedef struct LuaImageEntry {
+  char name[LUA_IMAGE_NAME_LEN];	/* module name, zero terminated */
+  uint32_t offset;	/* of the chunk, from start of image */
+  uint32_t size;	/* of the chunk */
+} LuaImageEntry;
+
+#define LUA_IMAGE_ENTRY(h,i) \
+	((const LuaImageEntry *)((const char *)(h) + sizeof(LuaImageHeader)) + (i))
+
+/* image in flash, NULL if there is no valid one; from exlibs/file.c */
+const LuaImageHeader *lua_flash_image (void);
+
+#endif
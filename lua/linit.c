@@ -184,6 +184,21 @@ extern const luaR_entry sensor_map[];
 #ifdef USE_MQTT_MODULE
 extern const luaR_entry mqtt_map[];
 #endif
+#ifdef USE_STRBUF_MODULE
+extern const luaR_entry strbuf_map[];
+#endif
+#ifdef USE_TASK_MODULE
+extern const luaR_entry task_map[];
+#endif
+#ifdef USE_HTTP_MODULE
+extern const luaR_entry http_map[];
+#endif
+#ifdef USE_CRYPTO_MODULE
+extern const luaR_entry crypto_map[];
+#endif
+#ifdef USE_CONFIG_MODULE
+extern const luaR_entry config_map[];
+#endif
 
 
 const luaR_table lua_rotable[] = 
@@ -234,6 +249,21 @@ const luaR_table lua_rotable[] =
 #ifdef USE_MQTT_MODULE
     {LUA_MQTTLIBNAME, mqtt_map},
 #endif    
+#ifdef USE_STRBUF_MODULE
+    {LUA_STRBUFLIBNAME, strbuf_map},
+#endif
+#ifdef USE_TASK_MODULE
+    {LUA_TASKLIBNAME, task_map},
+#endif
+#ifdef USE_HTTP_MODULE
+    {LUA_HTTPLIBNAME, http_map},
+#endif
+#ifdef USE_CRYPTO_MODULE
+    {LUA_CRYPTOLIBNAME, crypto_map},
+#endif
+#ifdef USE_CONFIG_MODULE
+    {LUA_CONFIGLIBNAME, config_map},
+#endif
     
 #if defined(LUA_PLATFORM_LIBS_ROM) && LUA_OPTIMIZE_MEMORY == 2
 #undef _ROM
@@ -308,5 +338,25 @@ LUALIB_API void luaL_openlibs (lua_State *L) {
 #ifdef USE_MQTT_MODULE
   luaopen_mqtt(L);
 #endif
+
+#ifdef USE_STRBUF_MODULE
+  luaopen_strbuf(L);
+#endif
+
+#ifdef USE_TASK_MODULE
+  luaopen_task(L);
+#endif
+
+#ifdef USE_HTTP_MODULE
+  luaopen_http(L);
+#endif
+
+#ifdef USE_CRYPTO_MODULE
+  luaopen_crypto(L);
+#endif
+
+#ifdef USE_CONFIG_MODULE
+  luaopen_config(L);
+#endif
 }
 
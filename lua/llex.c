@@ -40,7 +40,7 @@ const char *const luaX_tokens [] = {
     "in", "local", "nil", "not", "or", "repeat",
     "return", "then", "true", "until", "while",
     "..", "...", "==", ">=", "<=", "~=",
-    "<number>", "<name>", "<string>", "<eof>",
+    "<number>", "<number>", "<name>", "<string>", "<eof>",
     NULL
 };
 
@@ -84,6 +84,7 @@ static const char *txtToken (LexState *ls, int token) {
     case TK_NAME:
     case TK_STRING:
     case TK_NUMBER:
+    case TK_FLOAT:
       save(ls, '\0');
       return luaZ_buffer(ls->buff);
     default:
@@ -109,7 +110,7 @@ void luaX_syntaxerror (LexState *ls, const char *msg) {
 
 TString *luaX_newstring (LexState *ls, const char *str, size_t l) {
   lua_State *L = ls->L;
-  TString *ts = luaS_newlstr(L, str, l);
+  TString *ts = luaS_internlstr(L, str, l);
   TValue *o = luaH_setstr(L, ls->fs->h, ts);  /* entry for `str' */
   if (ttisnil(o)) {
     setbvalue(o, 1);  /* make sure `str' will not be collected */
@@ -169,22 +170,44 @@ static void buffreplace (LexState *ls, char from, char to) {
 }
 
 
-static void trydecpoint (LexState *ls, SemInfo *seminfo) {
+#if defined LUA_NUMBER_HYBRID
+/* converts the numeral in the buffer, returns its token or 0 */
+static int buff2num (LexState *ls, SemInfo *seminfo) {
+  TValue o;
+  if (!luaO_str2n(luaZ_buffer(ls->buff), &o))
+    return 0;
+  if (ttisfloat(&o)) {
+    seminfo->f = fltvalue(&o);
+    return TK_FLOAT;
+  }
+  seminfo->r = ivalue(&o);
+  return TK_NUMBER;
+}
+#else
+#define buff2num(ls,seminfo) \
+	(luaO_str2d(luaZ_buffer((ls)->buff), &(seminfo)->r) ? TK_NUMBER : 0)
+#endif
+
+
+static int trydecpoint (LexState *ls, SemInfo *seminfo) {
   /* format error: try to update decimal point separator */
   struct lconv *cv = localeconv();
   char old = ls->decpoint;
+  int token;
   ls->decpoint = (cv ? cv->decimal_point[0] : '.');
   buffreplace(ls, old, ls->decpoint);  /* try updated decimal separator */
-  if (!luaO_str2d(luaZ_buffer(ls->buff), &seminfo->r)) {
+  if ((token = buff2num(ls, seminfo)) == 0) {
     /* format error with correct decimal point: no more options */
     buffreplace(ls, ls->decpoint, '.');  /* undo change (for error message) */
     luaX_lexerror(ls, "malformed number", TK_NUMBER);
   }
+  return token;
 }
 
 
 /* LUA_NUMBER */
-static void read_numeral (LexState *ls, SemInfo *seminfo) {
+static int read_numeral (LexState *ls, SemInfo *seminfo) {
+  int token;
   lua_assert(isdigit(ls->current));
   do {
     save_and_next(ls);
@@ -195,8 +218,9 @@ static void read_numeral (LexState *ls, SemInfo *seminfo) {
     save_and_next(ls);
   save(ls, '\0');
   buffreplace(ls, '.', ls->decpoint);  /* follow locale for decimal point */
-  if (!luaO_str2d(luaZ_buffer(ls->buff), &seminfo->r))  /* format error? */
-    trydecpoint(ls, seminfo); /* try to update decimal point separator */
+  if ((token = buff2num(ls, seminfo)) == 0)  /* format error? */
+    token = trydecpoint(ls, seminfo); /* try to update decimal point separator */
+  return token;
 }
 
 
@@ -394,10 +418,8 @@ static int llex (LexState *ls, SemInfo *seminfo) {
           else return TK_CONCAT;   /* .. */
         }
         else if (!isdigit(ls->current)) return '.';
-        else {
-          read_numeral(ls, seminfo);
-          return TK_NUMBER;
-        }
+        else
+          return read_numeral(ls, seminfo);
       }
       case EOZ: {
         return TK_EOS;
@@ -408,10 +430,8 @@ static int llex (LexState *ls, SemInfo *seminfo) {
           next(ls);
           continue;
         }
-        else if (isdigit(ls->current)) {
-          read_numeral(ls, seminfo);
-          return TK_NUMBER;
-        }
+        else if (isdigit(ls->current))
+          return read_numeral(ls, seminfo);
         else if (isalpha(ls->current) || ls->current == '_') {
           /* identifier or reserved word */
           TString *ts;
@@ -29,7 +29,7 @@ enum RESERVED {
   TK_RETURN, TK_THEN, TK_TRUE, TK_UNTIL, TK_WHILE,
   /* other terminal symbols */
   TK_CONCAT, TK_DOTS, TK_EQ, TK_GE, TK_LE, TK_NE, TK_NUMBER,
-  TK_NAME, TK_STRING, TK_EOS
+  TK_FLOAT, TK_NAME, TK_STRING, TK_EOS
 };
 
 /* number of reserved words */
@@ -42,6 +42,9 @@ LUAI_DATA const char *const luaX_tokens [];
 
 typedef union {
   lua_Number r;
+#if defined LUA_NUMBER_HYBRID
+  lua_Float f;
+#endif
   TString *ts;
 } SemInfo;  /* semantics information */
 
@@ -26,6 +26,12 @@
 static int math_abs (lua_State *L) {
 #ifdef LUA_NUMBER_INTEGRAL
   lua_Number x = luaL_checknumber(L, 1);
+#if defined LUA_NUMBER_HYBRID
+  if (lua_isfloat(L, 1)) {
+    lua_pushfloat(L, fabsf(lua_tofloat(L, 1)));
+    return 1;
+  }
+#endif
   if (x < 0) x = -x;	//fails for -2^31
   lua_pushnumber(L, x);
 #else
@@ -121,9 +127,29 @@ static int math_identity (lua_State *L) {
   return 1;
 }
 
+#if defined LUA_NUMBER_HYBRID
+// Floats are rounded to an integer, integers stay as they are.
+
+static int math_floor (lua_State *L) {
+  if (lua_isfloat(L, 1)) {
+    lua_pushnumber(L, (lua_Number)floorf(lua_tofloat(L, 1)));
+    return 1;
+  }
+  return math_identity(L);
+}
+
+static int math_ceil (lua_State *L) {
+  if (lua_isfloat(L, 1)) {
+    lua_pushnumber(L, (lua_Number)ceilf(lua_tofloat(L, 1)));
+    return 1;
+  }
+  return math_identity(L);
+}
+#endif
+
 #endif // #ifndef LUA_NUMBER_INTEGRAL
 
-#ifdef LUA_NUMBER_INTEGRAL
+#if defined LUA_NUMBER_INTEGRAL && !defined LUA_NUMBER_HYBRID
 // Integer square root for integer version
 static lua_Number isqrt(lua_Number x)
 {
@@ -148,7 +174,10 @@ static lua_Number isqrt(lua_Number x)
 #endif
 
 static int math_sqrt (lua_State *L) {
-#ifdef LUA_NUMBER_INTEGRAL
+#if defined LUA_NUMBER_HYBRID
+  luaL_checknumber(L, 1);
+  lua_pushfloat(L, sqrtf(lua_tofloat(L, 1)));
+#elif defined LUA_NUMBER_INTEGRAL
   lua_Number x = luaL_checknumber(L, 1);
   luaL_argcheck(L, 0<=x, 1, "negative");
   lua_pushnumber(L, isqrt(x));
@@ -164,7 +193,13 @@ extern LUA_NUMBER luai_ipow(LUA_NUMBER a, LUA_NUMBER b);
 #endif
 
 static int math_pow (lua_State *L) {
+#if defined LUA_NUMBER_HYBRID
+  luaL_checknumber(L, 1);
+  luaL_checknumber(L, 2);
+  lua_pushfloat(L, powf(lua_tofloat(L, 1), lua_tofloat(L, 2)));
+#else
   lua_pushnumber(L, pow(luaL_checknumber(L, 1), luaL_checknumber(L, 2)));
+#endif
   return 1;
 }
 
@@ -212,8 +247,63 @@ static int math_ldexp (lua_State *L) {
   return 1;
 }
 
+#elif defined LUA_NUMBER_HYBRID
+// sqrt, pow and these give floats for integer arguments too, as in Lua 5.3.
+
+static int math_log (lua_State *L) {
+  luaL_checknumber(L, 1);
+  lua_pushfloat(L, logf(lua_tofloat(L, 1)));
+  return 1;
+}
+
+static int math_log10 (lua_State *L) {
+  luaL_checknumber(L, 1);
+  lua_pushfloat(L, log10f(lua_tofloat(L, 1)));
+  return 1;
+}
+
+static int math_exp (lua_State *L) {
+  luaL_checknumber(L, 1);
+  lua_pushfloat(L, expf(lua_tofloat(L, 1)));
+  return 1;
+}
+
 #endif // #ifdef LUA_NUMBER_INTEGRAL
 
+#if defined LUA_NUMBER_HYBRID
+// min and max return the argument itself, integer or float.
+
+static int math_min (lua_State *L) {
+  int n = lua_gettop(L);  /* number of arguments */
+  int imin = 1;
+  int i;
+  luaL_checknumber(L, 1);
+  for (i=2; i<=n; i++) {
+    luaL_checknumber(L, i);
+    if (lua_lessthan(L, i, imin))
+      imin = i;
+  }
+  lua_pushvalue(L, imin);
+  return 1;
+}
+
+
+static int math_max (lua_State *L) {
+  int n = lua_gettop(L);  /* number of arguments */
+  int imax = 1;
+  int i;
+  luaL_checknumber(L, 1);
+  for (i=2; i<=n; i++) {
+    luaL_checknumber(L, i);
+    if (lua_lessthan(L, imax, i))
+      imax = i;
+  }
+  lua_pushvalue(L, imax);
+  return 1;
+}
+
+#else
+
 static int math_min (lua_State *L) {
   int n = lua_gettop(L);  /* number of arguments */
   lua_Number dmin = luaL_checknumber(L, 1);
@@ -241,6 +331,8 @@ static int math_max (lua_State *L) {
   return 1;
 }
 
+#endif
+
 
 #ifdef LUA_NUMBER_INTEGRAL
 
@@ -312,8 +404,16 @@ static int math_randomseed (lua_State *L) {
 const LUA_REG_TYPE math_map[] = {
 #ifdef LUA_NUMBER_INTEGRAL
   {LSTRKEY("abs"),   LFUNCVAL(math_abs)},
+#if defined LUA_NUMBER_HYBRID
+  {LSTRKEY("ceil"),  LFUNCVAL(math_ceil)},
+  {LSTRKEY("exp"),   LFUNCVAL(math_exp)},
+  {LSTRKEY("floor"), LFUNCVAL(math_floor)},
+  {LSTRKEY("log10"), LFUNCVAL(math_log10)},
+  {LSTRKEY("log"),   LFUNCVAL(math_log)},
+#else
   {LSTRKEY("ceil"),  LFUNCVAL(math_identity)},
   {LSTRKEY("floor"), LFUNCVAL(math_identity)},
+#endif
   {LSTRKEY("max"),   LFUNCVAL(math_max)},
   {LSTRKEY("min"),   LFUNCVAL(math_min)},
   {LSTRKEY("pow"),   LFUNCVAL(math_pow)},
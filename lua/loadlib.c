@@ -450,6 +450,19 @@ static int loader_preload (lua_State *L) {
 }
 
 
+static int loader_flash (lua_State *L) {
+  const char *name = luaL_checkstring(L, 1);
+  int status = luaL_loadimage(L, name);
+  if (status == LUA_ERRFILE) {  /* not found? */
+    lua_pop(L, 1);
+    lua_pushfstring(L, "\n\tno module " LUA_QS " in flash image", name);
+  }
+  else if (status != 0)
+    loaderror(L, "flash image");
+  return 1;
+}
+
+
 static const int sentinel_ = 0;
 #define sentinel	((void *)&sentinel_)
 
@@ -635,7 +648,7 @@ static const luaL_Reg ll_funcs[] = {
 
 
 static const lua_CFunction loaders[] =
-  {loader_preload, loader_Lua, loader_C, loader_Croot, NULL};
+  {loader_preload, loader_flash, loader_Lua, loader_C, loader_Croot, NULL};
 
 #if LUA_OPTIMIZE_MEMORY > 0
 //const luaR_entry lmt[] = {
@@ -75,13 +75,19 @@ int luaO_rawequalObj (const TValue *t1, const TValue *t2) {
     case LUA_TNIL:
       return 1;
     case LUA_TNUMBER:
+#if defined LUA_NUMBER_HYBRID
+      return luaO_numeq(t1, t2);
+#else
       return luai_numeq(nvalue(t1), nvalue(t2));
+#endif
     case LUA_TBOOLEAN:
       return bvalue(t1) == bvalue(t2);  /* boolean true must be 1 !! */
     case LUA_TLIGHTUSERDATA:
     case LUA_TROTABLE:
     case LUA_TLIGHTFUNCTION:
       return pvalue(t1) == pvalue(t2);
+    case LUA_TSTRING:
+      return eqstr(rawtsvalue(t1), rawtsvalue(t2));
     default:
       lua_assert(iscollectable(t1));
       return gcvalue(t1) == gcvalue(t2);
@@ -102,6 +108,51 @@ int luaO_str2d (const char *s, lua_Number *result) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+/*
+** equality of numbers of any subtype; an integer equals a float only
+** if the float has exactly its value
+*/
+int luaO_numeq (const TValue *t1, const TValue *t2) {
+  if (ttisint(t1) && ttisint(t2))
+    return luai_numeq(ivalue(t1), ivalue(t2));
+  else if (ttisfloat(t1) && ttisfloat(t2))
+    return luai_numeq(fltvalue(t1), fltvalue(t2));
+  else {
+    const TValue *i = ttisint(t1) ? t1 : t2;
+    lua_Float f = ttisint(t1) ? fltvalue(t2) : fltvalue(t1);
+    lua_Number n;
+    if (!fltfitsnum(f))  /* also NaN */
+      return 0;
+    n = cast_num(f);
+    return luai_numeq(cast(lua_Float, n), f) && luai_numeq(n, ivalue(i));
+  }
+}
+
+
+/*
+** numerals with a decimal point or an exponent become floats, all
+** others go through luaO_str2d and become integers
+*/
+int luaO_str2n (const char *s, TValue *result) {
+  if (strpbrk(s, ".eE") != NULL && strpbrk(s, "xXnN") == NULL) {
+    char *endptr;
+    lua_Float f = lua_str2float(s, &endptr);
+    if (endptr == s) return 0;  /* conversion failed */
+    while (isspace(cast(unsigned char, *endptr))) endptr++;
+    if (*endptr != '\0') return 0;  /* invalid trailing characters? */
+    setfltvalue(result, f);
+  }
+  else {
+    lua_Number n;
+    if (!luaO_str2d(s, &n)) return 0;
+    setnvalue(result, n);
+  }
+  return 1;
+}
+#endif
+
+
 
 static void pushstr (lua_State *L, const char *str) {
   setsvalue2s(L, L->top, luaS_new(L, str));
@@ -33,6 +33,24 @@
 #define LUA_TDEADKEY	(LAST_TAG+3)
 
 
+#if defined LUA_NUMBER_HYBRID && defined LUA_PACK_VALUE
+#error "LUA_NUMBER_HYBRID does not work with LUA_PACK_VALUE"
+#endif
+
+#ifndef LUA_PACK_VALUE
+/*
+** Variant tags: ttype() masks the bits above LUA_TMASK, so a variant
+** is its basic type everywhere the variant does not matter.
+*/
+#define LUA_TMASK	0x0F
+/* float subtype of numbers */
+#define LUA_TNUMFLT	(LUA_TNUMBER | (1 << 4))
+/* fast builtin, with its number of arguments and results (lrotable.h) */
+#define LUA_TFASTFUNC(nargs,nres) \
+	(LUA_TLIGHTFUNCTION | (1 << 4) | ((nargs) << 5) | ((nres) << 7))
+#endif
+
+
 /*
 ** Union of all collectable objects
 */
@@ -77,6 +95,9 @@ typedef union {
   GCObject *gc;
   void *p;
   lua_Number n;
+#if defined LUA_NUMBER_HYBRID
+  lua_Float f;
+#endif
   int b;
 } Value;
 #endif // #if defined( LUA_PACK_VALUE ) && defined( ELUA_ENDIAN_BIG )
@@ -141,6 +162,13 @@ typedef TValuefields TValue;
 #define ttislightuserdata(o)	(ttype(o) == LUA_TLIGHTUSERDATA)
 #define ttisrotable(o) (ttype(o) == LUA_TROTABLE)
 #define ttislightfunction(o)  (ttype(o) == LUA_TLIGHTFUNCTION)
+#if defined LUA_NUMBER_HYBRID
+#define ttisint(o)	((o)->tt == LUA_TNUMBER)
+#define ttisfloat(o)	((o)->tt == LUA_TNUMFLT)
+#endif
+#define ttisfastfunc(o)	(((o)->tt & 0x1F) == LUA_TFASTFUNC(0, 0))
+#define fastnargs(o)	(((o)->tt >> 5) & 3)
+#define fastnres(o)	(((o)->tt >> 7) & 1)
 #else // #ifndef LUA_PACK_VALUE
 #define ttisnil(o) (ttype_sig(o) == add_sig(LUA_TNIL))
 #define ttisnumber(o)  ((o)->_t.sig != LUA_NOTNUMBER_SIG)
@@ -157,7 +185,7 @@ typedef TValuefields TValue;
 
 /* Macros to access values */
 #ifndef LUA_PACK_VALUE
-#define ttype(o)	((o)->tt)
+#define ttype(o)	((o)->tt & LUA_TMASK)
 #else // #ifndef LUA_PACK_VALUE
 #define ttype(o)	((o)->_t.sig == LUA_NOTNUMBER_SIG ? (o)->_t.tt : LUA_TNUMBER)
 #define ttype_sig(o)	((o)->_ts.tt_sig)
@@ -166,7 +194,28 @@ typedef TValuefields TValue;
 #define pvalue(o)	check_exp(ttislightuserdata(o), (o)->value.p)
 #define rvalue(o)	check_exp(ttisrotable(o), (o)->value.p)
 #define fvalue(o) check_exp(ttislightfunction(o), (o)->value.p)
+#if defined LUA_NUMBER_HYBRID
+/*
+** floats in [-FLTNUMLIM, FLTNUMLIM) convert to lua_Number; converting
+** any other one is undefined, so flt2num saturates them and takes NaN as 0
+*/
+#define FLTNUMLIM	(cast(lua_Float, cast_num(1) << (sizeof(lua_Number)*CHAR_BIT-2)) * 2)
+#define NUMMAX		((cast_num(1) << (sizeof(lua_Number)*CHAR_BIT-2)) - 1 + \
+	(cast_num(1) << (sizeof(lua_Number)*CHAR_BIT-2)))
+#define fltfitsnum(f)	((f) >= -FLTNUMLIM && (f) < FLTNUMLIM)
+#define flt2num(f)	(fltfitsnum(f) ? cast_num(f) : \
+	(f) > 0 ? NUMMAX : (f) < 0 ? -NUMMAX-1 : 0)
+
+/* nvalue truncates floats, nfltvalue converts integers */
+#define ivalue(o)	check_exp(ttisint(o), (o)->value.n)
+#define fltvalue(o)	check_exp(ttisfloat(o), (o)->value.f)
+#define nvalue(o)	check_exp(ttisnumber(o), \
+	(ttisfloat(o) ? flt2num((o)->value.f) : (o)->value.n))
+#define nfltvalue(o)	check_exp(ttisnumber(o), \
+	(ttisfloat(o) ? (o)->value.f : cast(lua_Float, (o)->value.n)))
+#else
 #define nvalue(o)	check_exp(ttisnumber(o), (o)->value.n)
+#endif
 #define rawtsvalue(o)	check_exp(ttisstring(o), &(o)->value.gc->ts)
 #define tsvalue(o)	(&rawtsvalue(o)->tsv)
 #define rawuvalue(o)	check_exp(ttisuserdata(o), &(o)->value.gc->u)
@@ -204,6 +253,11 @@ typedef TValuefields TValue;
 #define setnvalue(obj,x) \
   { lua_Number i_x = (x); TValue *i_o=(obj); i_o->value.n=i_x; i_o->tt=LUA_TNUMBER; }
 
+#if defined LUA_NUMBER_HYBRID
+#define setfltvalue(obj,x) \
+  { lua_Float i_x = (x); TValue *i_o=(obj); i_o->value.f=i_x; i_o->tt=LUA_TNUMFLT; }
+#endif
+
 #define setpvalue(obj,x) \
   { void *i_x = (x); TValue *i_o=(obj); i_o->value.p=i_x; i_o->tt=LUA_TLIGHTUSERDATA; }
   
@@ -336,7 +390,7 @@ typedef TValuefields TValue;
 #define setsvalue2n	setsvalue
 
 #ifndef LUA_PACK_VALUE
-#define setttype(obj, tt) (ttype(obj) = (tt))
+#define setttype(obj, _tt) ((obj)->tt = (_tt))
 #else // #ifndef LUA_PACK_VALUE
 /* considering it used only in lgc to set LUA_TDEADKEY */
 /* we could define it this way */
@@ -381,12 +435,23 @@ typedef union Udata {
 
 
 
+/*
+** Inline cache entry, for a constant key of a function (see lvm.c)
+*/
+typedef struct KCache {
+  const void *t;  /* table or rotable where the key was last found */
+  const void *v;  /* its value there */
+  lu_int32 era;  /* global_State.romera when a ROM global was cached */
+} KCache;
+
+
 /*
 ** Function Prototypes
 */
 typedef struct Proto {
   CommonHeader;
   TValue *k;  /* constants used by the function */
+  KCache *kcache;  /* one per constant, NULL until the function runs */
   Instruction *code;
   struct Proto **p;  /* functions defined inside the function */
   int *lineinfo;  /* map from opcodes to source lines */
@@ -515,6 +580,12 @@ typedef struct Table {
   int sizearray;  /* size of `array' array */
 } Table;
 
+/*
+** bit of Table.flags above the fast tag methods: no key was set in the
+** table since global_State.romera last changed for it (see lvm.c)
+*/
+#define TABLE_ROMGLOBALS	(1u<<7)
+
 
 /*
 ** `module' operation for hashing (size is always a power of 2)
@@ -538,6 +609,10 @@ LUAI_FUNC int luaO_int2fb (unsigned int x);
 LUAI_FUNC int luaO_fb2int (int x);
 LUAI_FUNC int luaO_rawequalObj (const TValue *t1, const TValue *t2);
 LUAI_FUNC int luaO_str2d (const char *s, lua_Number *result);
+#if defined LUA_NUMBER_HYBRID
+LUAI_FUNC int luaO_numeq (const TValue *t1, const TValue *t2);
+LUAI_FUNC int luaO_str2n (const char *s, TValue *result);
+#endif
 LUAI_FUNC const char *luaO_pushvfstring (lua_State *L, const char *fmt,
                                                        va_list argp);
 LUAI_FUNC const char *luaO_pushfstring (lua_State *L, const char *fmt, ...);
@@ -737,6 +737,12 @@ static void simpleexp (LexState *ls, expdesc *v) {
       v->u.nval = ls->t.seminfo.r;
       break;
     }
+#if defined LUA_NUMBER_HYBRID
+    case TK_FLOAT: {  /* no constant folding for floats */
+      init_exp(v, VK, luaK_floatK(ls->fs, ls->t.seminfo.f));
+      break;
+    }
+#endif
     case TK_STRING: {
       codestring(ls, v, ls->t.seminfo.ts);
       break;
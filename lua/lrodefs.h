@@ -5,6 +5,7 @@
 #undef LNILKEY
 #undef LNUMKEY
 #undef LFUNCVAL
+#undef LFASTFUNCVAL
 #undef LNUMVAL
 #undef LROVAL
 #undef LNILVAL
@@ -16,6 +17,7 @@
 #define LNUMKEY                     LRO_NUMKEY
 #define LNILKEY                     LRO_NILKEY
 #define LFUNCVAL                    LRO_FUNCVAL
+#define LFASTFUNCVAL                LRO_FASTFUNCVAL
 #define LNUMVAL                     LRO_NUMVAL
 #define LROVAL                      LRO_ROVAL
 #define LNILVAL                     LRO_NILVAL
@@ -26,6 +28,7 @@
 #define LSTRKEY(x)                  x
 #define LNILKEY                     NULL
 #define LFUNCVAL(x)                 x
+#define LFASTFUNCVAL(x, nargs, nres) x
 #define LNILVAL                     NULL
 #define LREGISTER(L, name, table)\
   luaL_register(L, name, table);\
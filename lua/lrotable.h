@@ -15,6 +15,8 @@
 #define LRO_NUMVAL(v)   {{.n = v}, LUA_TNUMBER}
 #define LRO_ROVAL(v)    {{.p = (void*)v}, LUA_TROTABLE}
 #define LRO_NILVAL      {{.p = NULL}, LUA_TNIL}
+#define LRO_FASTFUNCVAL(v, nargs, nres)\
+  {{.p = (void*)&v##_fast}, LUA_TFASTFUNC(nargs, nres)}
 #else // #ifndef LUA_PACK_VALUE
 #define LRO_NUMVAL(v)   {.value.n = v}
 #ifdef ELUA_ENDIAN_LITTLE
@@ -26,12 +28,48 @@
 #define LRO_ROVAL(v)    {{add_sig(LUA_TROTABLE), (int)v}}
 #define LRO_NILVAL      {{add_sig(LUA_TNIL), 0}}
 #endif // #ifdef ELUA_ENDIAN_LITTLE
+#define LRO_FASTFUNCVAL(v, nargs, nres)  LRO_FUNCVAL(v)
 #endif // #ifndef LUA_PACK_VALUE
 
 #define LRO_STRKEY(k)   {LUA_TSTRING, {.strkey = k}}
 #define LRO_NUMKEY(k)   {LUA_TNUMBER, {.numkey = k}}
 #define LRO_NILKEY      {LUA_TNIL, {.strkey=NULL}}
 
+/* Fast builtins: a C function that takes a fixed number (up to 3) of
+   integer arguments and returns at most one integer can come with a
+   second version, which the VM calls directly with the unboxed
+   arguments instead of going through the Lua stack:
+
+     static int fgpio_write(lua_Integer *res, lua_Integer pin,
+                            lua_Integer level, lua_Integer unused);
+     LUA_FASTFUNC(lgpio_write, fgpio_write);
+     { LSTRKEY("write"), LFASTFUNCVAL(lgpio_write, 2, 0) },
+
+   The fast version stores its result in *res and returns 0. It must
+   not touch the Lua state; for arguments it does not accept it returns
+   nonzero before doing anything, and the regular function is called
+   to report the error. Calls with other arguments, from C, or with a
+   call or return hook set always use the regular function.
+
+   Only rotables keep the fast version, so LUA_USE_FASTFUNC is defined
+   when there are any; the fast versions and LUA_FASTFUNC go inside
+   #ifdef LUA_USE_FASTFUNC. */
+#if !defined(LUA_PACK_VALUE) && (LUA_OPTIMIZE_MEMORY >= 2)
+#define LUA_USE_FASTFUNC
+#endif
+
+typedef int (*luaR_fastfunction)(lua_Integer *res, lua_Integer a,
+                                 lua_Integer b, lua_Integer c);
+
+typedef struct
+{
+  lua_CFunction f;
+  luaR_fastfunction ff;
+} luaR_fastfunc;
+
+#define LUA_FASTFUNC(f, ff)\
+  static const luaR_fastfunc f##_fast = {f, ff}
+
 /* Maximum length of a rotable name and of a string key*/
 #define LUA_MAX_ROTABLE_NAME      32
 
@@ -69,6 +107,8 @@ const TValue* luaR_findentry(void *data, const char *strkey, luaR_numkey numkey,
 void luaR_getcstr(char *dest, const TString *src, size_t maxsize);
 void luaR_next(lua_State *L, void *data, TValue *key, TValue *val);
 void* luaR_getmeta(void *data);
+/* __index of the globals table, finds ROM modules and base functions */
+int luaB_index(lua_State *L);
 #ifdef LUA_META_ROTABLES
 int luaR_isrotable(void *p);
 #else
@@ -186,11 +186,20 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->grayagain = NULL;
   g->weak = NULL;
   g->tmudata = NULL;
+  g->oldgc = NULL;
+  g->oldudata = NULL;
+#if defined LUAI_GCGEN
+  g->gckind = KGC_GEN;  /* first collection is a major one */
+#else
+  g->gckind = KGC_NORMAL;
+#endif
+  g->lastmajor = 0;
   g->totalbytes = sizeof(LG);
   g->memlimit = 0;
   g->gcpause = LUAI_GCPAUSE;
   g->gcstepmul = LUAI_GCMUL;
   g->gcdept = 0;
+  g->romera = 0;
 #ifdef EGC_INITIAL_MODE
   g->egcmode = EGC_INITIAL_MODE;
 #else
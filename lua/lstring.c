@@ -80,13 +80,19 @@ static TString *newlstr (lua_State *L, const char *str, size_t l,
 }
 
 
-static TString *luaS_newlstr_helper (lua_State *L, const char *str, size_t l, int readonly) {
-  GCObject *o;
+static unsigned int hashlstr (const char *str, size_t l) {
   unsigned int h = cast(unsigned int, l);  /* seed */
   size_t step = (l>>5)+1;  /* if string is too long, don't hash all its chars */
   size_t l1;
   for (l1=l; l1>=step; l1-=step)  /* compute hash */
     h = h ^ ((h<<5)+(h>>2)+cast(unsigned char, str[l1-1]));
+  return h;
+}
+
+
+static TString *internlstr (lua_State *L, const char *str, size_t l,
+                                          unsigned int h, int readonly) {
+  GCObject *o;
   for (o = G(L)->strt.hash[lmod(h, G(L)->strt.size)];
        o != NULL;
        o = o->gch.next) {
@@ -100,6 +106,54 @@ static TString *luaS_newlstr_helper (lua_State *L, const char *str, size_t l, in
   return newlstr(L, str, l, h, readonly);  /* not found */
 }
 
+
+static TString *luaS_newlstr_helper (lua_State *L, const char *str, size_t l, int readonly) {
+  return internlstr(L, str, l, hashlstr(str, l), readonly);
+}
+
+
+/*
+** a long string is not in the string table; its hash is computed when
+** it is first needed and kept in `hash' (0 while not computed)
+*/
+static TString *newlongstr (lua_State *L, const char *str, size_t l) {
+  TString *ts;
+  if (l+1 > (MAX_SIZET - sizeof(TString))/sizeof(char))
+    luaM_toobig(L);
+  ts = cast(TString *, luaM_malloc(L, (l+1)*sizeof(char)+sizeof(TString)));
+  ts->tsv.len = l;
+  ts->tsv.hash = 0;
+  memcpy(ts+1, str, l*sizeof(char));
+  ((char *)(ts+1))[l] = '\0';  /* ending 0 */
+  luaC_link(L, obj2gco(ts), LUA_TSTRING);
+  l_setbit(ts->tsv.marked, LONGSTRBIT);
+  return ts;
+}
+
+
+unsigned int luaS_hashlongstr (TString *ts) {
+  lua_assert(luaS_islong(ts));
+  if (ts->tsv.hash == 0)
+    ts->tsv.hash = hashlstr(getstr(ts), ts->tsv.len);
+  return ts->tsv.hash;
+}
+
+
+/* interned string equal to long string `ts' */
+TString *luaS_intern (lua_State *L, TString *ts) {
+  lua_assert(luaS_islong(ts));
+  return internlstr(L, getstr(ts), ts->tsv.len, luaS_hashlongstr(ts),
+                    LUAS_REGULAR_STRING);
+}
+
+
+int luaS_eqlngstr (TString *a, TString *b) {
+  size_t len = a->tsv.len;
+  return (luaS_islong(a) || luaS_islong(b)) &&  /* else only a == b */
+         len == b->tsv.len && memcmp(getstr(a), getstr(b), len) == 0;
+}
+
+
 extern char stext;
 extern char etext;
 
@@ -116,11 +170,19 @@ TString *luaS_newlstr (lua_State *L, const char *str, size_t l) {
   // create it as a read-only string instead
   if(lua_is_ptr_in_ro_area(str) && l+1 > sizeof(char**) && l == strlen(str))
     return luaS_newlstr_helper(L, str, l, LUAS_READONLY_STRING);
+  else if (l > LUAI_MAXSHORTLEN)
+    return newlongstr(L, str, l);
   else
     return luaS_newlstr_helper(L, str, l, LUAS_REGULAR_STRING);
 }
 
 
+/* always interned, for names and constants of the parser and undump */
+TString *luaS_internlstr (lua_State *L, const char *str, size_t l) {
+  return luaS_newlstr_helper(L, str, l, LUAS_REGULAR_STRING);
+}
+
+
 LUAI_FUNC TString *luaS_newrolstr (lua_State *L, const char *str, size_t l) {
   if(l+1 > sizeof(char**) && l == strlen(str))
     return luaS_newlstr_helper(L, str, l, LUAS_READONLY_STRING);
@@ -25,10 +25,18 @@
 #define luaS_fix(s)	l_setbit((s)->tsv.marked, FIXEDBIT)
 #define luaS_readonly(s) l_setbit((s)->tsv.marked, READONLYBIT)
 #define luaS_isreadonly(s) testbit((s)->marked, READONLYBIT)
+#define luaS_islong(s)	testbit((s)->tsv.marked, LONGSTRBIT)
+
+/* interned strings are equal only if they are the same object */
+#define eqstr(a,b)	((a) == (b) || luaS_eqlngstr(a, b))
 
 LUAI_FUNC void luaS_resize (lua_State *L, int newsize);
 LUAI_FUNC Udata *luaS_newudata (lua_State *L, size_t s, Table *e);
 LUAI_FUNC TString *luaS_newlstr (lua_State *L, const char *str, size_t l);
 LUAI_FUNC TString *luaS_newrolstr (lua_State *L, const char *str, size_t l);
+LUAI_FUNC TString *luaS_internlstr (lua_State *L, const char *str, size_t l);
+LUAI_FUNC TString *luaS_intern (lua_State *L, TString *ts);
+LUAI_FUNC unsigned int luaS_hashlongstr (TString *ts);
+LUAI_FUNC int luaS_eqlngstr (TString *a, TString *b);
 
 #endif
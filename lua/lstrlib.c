@@ -789,7 +789,14 @@ static int str_format (lua_State *L) {
           sprintf(buff, form, (unsigned LUA_INTFRM_T)luaL_checknumber(L, arg));
           break;
         }
-#if !defined LUA_NUMBER_INTEGRAL        
+#if defined LUA_NUMBER_HYBRID
+        case 'e':  case 'E': case 'f':
+        case 'g': case 'G': {
+          luaL_checknumber(L, arg);
+          sprintf(buff, form, (double)lua_tofloat(L, arg));
+          break;
+        }
+#elif !defined LUA_NUMBER_INTEGRAL        
         case 'e':  case 'E': case 'f':
         case 'g': case 'G': {
           sprintf(buff, form, (double)luaL_checknumber(L, arg));
@@ -829,12 +836,14 @@ static int str_format (lua_State *L) {
 
 #include "MicoAlgorithm.h"
 //doit
-md5_context *pctx=NULL;
+//one md5 stream for string.md5calc/string.md5, crypto.new("md5") gives
+//independent ones
+static md5_context *pctx=NULL;
 static int str_md5(lua_State *L){
   if(pctx!=NULL)
   {
     uint8_t md5_calc[16];
-    char md5_ret[32];
+    char md5_ret[33];
     Md5Final( pctx, md5_calc);
     free(pctx);
     pctx = NULL;
@@ -855,24 +864,20 @@ static int str_md5Calc(lua_State *L)
   size_t len;
   int total = lua_gettop( L ), s;  
   for( s = 1; s <= total; s++ )
-  {
-    if( lua_type( L, s ) == LUA_TSTRING )
-    {
-       luaL_checktype( L, s, LUA_TSTRING );
-      buf = lua_tolstring( L, s, &len );
-    }
-    else
-    {
+    if( lua_type( L, s ) != LUA_TSTRING )
       return luaL_error( L, "wrong arg type" );
-    }
-  }
 
   if(pctx==NULL)
    {
       pctx = malloc(sizeof(md5_context));
+      if(pctx==NULL) return luaL_error( L, "not enough memory" );
       InitMd5(pctx); 
    }
-  Md5Update( pctx, (uint8_t *)buf, len);
+  for( s = 1; s <= total; s++ )
+  {
+    buf = lua_tolstring( L, s, &len );
+    Md5Update( pctx, (uint8_t *)buf, len);
+  }
   return 0;
 }
 
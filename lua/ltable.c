@@ -32,6 +32,7 @@
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
+#include "lstring.h"
 #include "ltable.h"
 #include "lrotable.h"
 
@@ -49,7 +50,8 @@
 
 #define hashpow2(t,n)      (gnode(t, lmod((n), sizenode(t))))
   
-#define hashstr(t,str)  hashpow2(t, (str)->tsv.hash)
+#define hashstr(t,str)  hashpow2(t, luaS_islong(str) ? \
+                                 luaS_hashlongstr(str) : (str)->tsv.hash)
 #define hashboolean(t,p)        hashpow2(t, p)
 
 
@@ -92,6 +94,34 @@ static Node *hashnum (const Table *t, lua_Number n) {
 }
 
 
+#if defined LUA_NUMBER_HYBRID
+/*
+** a float with an integral value is the same key as that integer; such
+** keys are stored as integers (see luaH_set), so only integers go to
+** the array part and to hashnum; floats out of the integer range stay
+** floats, nvalue would saturate them onto the largest integer
+*/
+#define numkeyisint(key) \
+  (ttisint(key) || (fltfitsnum(fltvalue(key)) && \
+   luai_numeq(cast(lua_Float, nvalue(key)), fltvalue(key))))
+
+#define ttisintkey(key)	ttisint(key)
+
+/*
+** hash for floats with a fraction
+*/
+static Node *hashflt (const Table *t, lua_Float n) {
+  unsigned int a;
+  lua_assert(sizeof(a) == sizeof(n));
+  memcpy(&a, &n, sizeof(a));
+  return hashmod(t, a);
+}
+#else
+#define numkeyisint(key)	1
+#define ttisintkey(key)	ttisnumber(key)
+#endif
+
+
 
 /*
 ** returns the `main' position of an element in a table (that is, the index
@@ -100,6 +130,10 @@ static Node *hashnum (const Table *t, lua_Number n) {
 static Node *mainposition (const Table *t, const TValue *key) {
   switch (ttype(key)) {
     case LUA_TNUMBER:
+#if defined LUA_NUMBER_HYBRID
+      if (!numkeyisint(key))
+        return hashflt(t, fltvalue(key));
+#endif
       return hashnum(t, nvalue(key));
     case LUA_TSTRING:
       return hashstr(t, rawtsvalue(key));
@@ -120,7 +154,7 @@ static Node *mainposition (const Table *t, const TValue *key) {
 ** the array part of the table, -1 otherwise.
 */
 static int arrayindex (const TValue *key) {
-  if (ttisnumber(key)) {
+  if (ttisnumber(key) && numkeyisint(key)) {
     lua_Number n = nvalue(key);
     int k;
     lua_number2int(k, n);
@@ -373,7 +407,8 @@ static int move_number (lua_State *L, Table *t, Node *node) {
   int key;
   lua_Number n = nvalue(key2tval(node));
   lua_number2int(key, n);
-  if (luai_numeq(cast_num(key), nvalue(key2tval(node)))) {/* index is int? */
+  if (luai_numeq(cast_num(key), nvalue(key2tval(node))) &&
+      numkeyisint(key2tval(node))) {/* index is int? */
     /* (1 <= key && key <= t->sizearray) */
     if (cast(unsigned int, key-1) < cast(unsigned int, t->sizearray)) {
       setobjt2t(L, &t->array[key-1], gval(node));
@@ -495,7 +530,7 @@ Table *luaH_new (lua_State *L, int narray, int nhash) {
   sethvalue2s(L, L->top, t); /* put table on stack */
   incr_top(L);
   t->metatable = NULL;
-  t->flags = cast_byte(~0);
+  t->flags = cast_byte(~TABLE_ROMGLOBALS);
   /* temporary values (kept only if some malloc fails) */
   t->array = NULL;
   t->sizearray = 0;
@@ -524,8 +559,13 @@ void luaH_free (lua_State *L, Table *t) {
 ** put new key in its main position; otherwise (colliding node is in its main 
 ** position), new key goes to an empty position. 
 */
+static TValue *newlongkey (lua_State *L, Table *t, const TValue *key);
+
 static TValue *newkey (lua_State *L, Table *t, const TValue *key) {
-  Node *mp = mainposition(t, key);
+  Node *mp;
+  if (ttisstring(key) && luaS_islong(rawtsvalue(key)))
+    return newlongkey(L, t, key);
+  mp = mainposition(t, key);
   if (!ttisnil(gval(mp)) || mp == dummynode) {
     Node *othern;
     Node *n = getfreepos(t);  /* get a free place */
@@ -557,6 +597,28 @@ static TValue *newkey (lua_State *L, Table *t, const TValue *key) {
 }
 
 
+/*
+** keys are always interned strings, so that looking up an interned
+** string only compares pointers. The interned copy is fixed while the
+** key goes in, as growing the table may run the collector.
+*/
+static TValue *newlongkey (lua_State *L, Table *t, const TValue *key) {
+  TString *ts = luaS_intern(L, rawtsvalue(key));
+  int fixed = testbit(ts->tsv.marked, FIXEDBIT);
+  TValue k;
+  TValue *v;
+  luaS_fix(ts);
+  setsvalue(L, &k, ts);
+  v = newkey(L, t, &k);
+  if (!fixed) {
+    resetbit(ts->tsv.marked, FIXEDBIT);
+    if (isdead(G(L), obj2gco(ts)))  /* a collection kept it as fixed only */
+      changewhite(obj2gco(ts));
+  }
+  return v;
+}
+
+
 /*
 ** search function for integers
 */
@@ -568,7 +630,7 @@ const TValue *luaH_getnum (Table *t, int key) {
     lua_Number nk = cast_num(key);
     Node *n = hashnum(t, nk);
     do {  /* check whether `key' is somewhere in the chain */
-      if (ttisnumber(gkey(n)) && luai_numeq(nvalue(gkey(n)), nk))
+      if (ttisintkey(gkey(n)) && luai_numeq(nvalue(gkey(n)), nk))
         return gval(n);  /* that's it */
       else n = gnext(n);
     } while (n);
@@ -588,6 +650,14 @@ const TValue *luaH_getnum_ro (void *t, int key) {
 */
 const TValue *luaH_getstr (Table *t, TString *key) {
   Node *n = hashstr(t, key);
+  if (luaS_islong(key)) {  /* keys are interned, compare contents */
+    do {
+      if (ttisstring(gkey(n)) && eqstr(rawtsvalue(gkey(n)), key))
+        return gval(n);
+      else n = gnext(n);
+    } while (n);
+    return luaO_nilobject;
+  }
   do {  /* check whether `key' is somewhere in the chain */
     if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key)
       return gval(n);  /* that's it */
@@ -619,7 +689,8 @@ const TValue *luaH_get (Table *t, const TValue *key) {
       int k;
       lua_Number n = nvalue(key);
       lua_number2int(k, n);
-      if (luai_numeq(cast_num(k), nvalue(key))) /* index is int? */
+      if (luai_numeq(cast_num(k), nvalue(key)) &&
+          numkeyisint(key)) /* index is int? */
         return luaH_getnum(t, k);  /* use specialized version */
       /* else go through */
     }
@@ -644,7 +715,8 @@ const TValue *luaH_get_ro (void *t, const TValue *key) {
       int k;
       lua_Number n = nvalue(key);
       lua_number2int(k, n);
-      if (luai_numeq(cast_num(k), nvalue(key))) /* index is int? */
+      if (luai_numeq(cast_num(k), nvalue(key)) &&
+          numkeyisint(key)) /* index is int? */
         return luaH_getnum_ro(t, k);  /* use specialized version */
       /* else go through */
     }
@@ -664,6 +736,17 @@ TValue *luaH_set (lua_State *L, Table *t, const TValue *key) {
     if (ttisnil(key)) luaG_runerror(L, "table index is nil");
     else if (ttisnumber(key) && luai_numisnan(nvalue(key)))
       luaG_runerror(L, "table index is NaN");
+#if defined LUA_NUMBER_HYBRID
+    else if (ttisfloat(key)) {
+      if (luai_numisnan(fltvalue(key)))
+        luaG_runerror(L, "table index is NaN");
+      if (numkeyisint(key)) {  /* store 2.0 as 2 */
+        TValue k;
+        setnvalue(&k, nvalue(key));
+        return newkey(L, t, &k);
+      }
+    }
+#endif
     return newkey(L, t, key);
   }
 }
@@ -683,6 +766,7 @@ TValue *luaH_setnum (lua_State *L, Table *t, int key) {
 
 TValue *luaH_setstr (lua_State *L, Table *t, TString *key) {
   const TValue *p = luaH_getstr(t, key);
+  t->flags &= cast_byte(~TABLE_ROMGLOBALS);
   if (p != luaO_nilobject)
     return cast(TValue *, p);
   else {
@@ -102,6 +102,11 @@ typedef LUA_NUMBER lua_Number;
 /* type for integer functions */
 typedef LUA_INTEGER lua_Integer;
 
+#if defined LUA_NUMBER_HYBRID
+/* type of the float subtype of numbers */
+typedef LUA_FLOAT lua_Float;
+#endif
+
 
 
 /*
@@ -145,6 +150,10 @@ LUA_API int            (lua_lessthan) (lua_State *L, int idx1, int idx2);
 
 LUA_API lua_Number      (lua_tonumber) (lua_State *L, int idx);
 LUA_API lua_Integer     (lua_tointeger) (lua_State *L, int idx);
+#if defined LUA_NUMBER_HYBRID
+LUA_API int             (lua_isfloat) (lua_State *L, int idx);
+LUA_API lua_Float       (lua_tofloat) (lua_State *L, int idx);
+#endif
 LUA_API int             (lua_toboolean) (lua_State *L, int idx);
 LUA_API const char     *(lua_tolstring) (lua_State *L, int idx, size_t *len);
 LUA_API size_t          (lua_objlen) (lua_State *L, int idx);
@@ -160,6 +169,9 @@ LUA_API const void     *(lua_topointer) (lua_State *L, int idx);
 LUA_API void  (lua_pushnil) (lua_State *L);
 LUA_API void  (lua_pushnumber) (lua_State *L, lua_Number n);
 LUA_API void  (lua_pushinteger) (lua_State *L, lua_Integer n);
+#if defined LUA_NUMBER_HYBRID
+LUA_API void  (lua_pushfloat) (lua_State *L, lua_Float n);
+#endif
 LUA_API void  (lua_pushlstring) (lua_State *L, const char *s, size_t l);
 LUA_API void  (lua_pushrolstring) (lua_State *L, const char *s, size_t l);
 LUA_API void  (lua_pushstring) (lua_State *L, const char *s);
@@ -231,6 +243,9 @@ LUA_API int  (lua_status) (lua_State *L);
 #define LUA_GCSETSTEPMUL	7
 #define LUA_GCSETMEMLIMIT	8
 #define LUA_GCGETMEMLIMIT	9
+#define LUA_GCGEN		10
+#define LUA_GCINC		11
+#define LUA_GCYOUNG		12
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
@@ -374,6 +389,9 @@ enum{
   TMR=0,
   GPIO,
   WIFI,
+  TASK,
+  DNS,
+  HTTP,
 };
 
 typedef struct _msg
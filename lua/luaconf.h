@@ -374,6 +374,19 @@
 #define LUAI_GCMUL	200 /* GC runs 'twice the speed' of memory allocation */
 
 
+/*
+@@ LUAI_GCGEN makes the collector start in generational mode: objects
+@* that survive a collection become old, and young collections only
+** traverse and sweep what was allocated since the previous one. A
+** major collection runs when memory in use has grown LUAI_GCMAJORINC
+** percent since the last major one. Both can be changed at run time
+** with collectgarbage("generational") and ("incremental").
+** CHANGE it (undefining it) to start with the incremental collector.
+*/
+#define LUAI_GCGEN
+#define LUAI_GCMAJORINC	200  /* major collection when in-use memory doubles */
+
+
 
 /*
 @@ LUA_COMPAT_GETN controls compatibility with old getn behavior.
@@ -513,6 +526,26 @@
 #define LUAI_MAXCSTACK	8000
 
 
+/*
+@@ LUA_USE_COMPUTED_GOTO makes luaV_execute jump from instruction to
+@* instruction through a table of label addresses instead of a switch.
+** Labels as values are a GCC extension, IAR and other compilers keep
+** the switch, so the IAR firmware build dispatches as it always did.
+*/
+#if defined(__GNUC__) && !defined(__ICCARM__)
+#define LUA_USE_COMPUTED_GOTO
+#endif
+
+
+/*
+@@ LUA_USE_INLINE_CACHE gives every function that runs a cache of where
+@* its constant keys were last found, for global and field accesses.
+** It costs 12 bytes per constant of a function that ran at least once.
+** CHANGE it (undefining it) if RAM is tighter than CPU time.
+*/
+#define LUA_USE_INLINE_CACHE
+
+
 
 /*
 ** {==================================================================
@@ -549,12 +582,28 @@
 #define LUAI_MAXUPVALUES	60
 
 
+/*
+@@ LUAI_MAXSHORTLEN is the maximum length of a string that is interned
+@* when it is made. Longer strings (network and file data) are neither
+@* hashed nor looked up in the string table until they are used as a
+@* table key or compared.
+*/
+#define LUAI_MAXSHORTLEN	40
+
+
 /*
 @@ LUAL_BUFFERSIZE is the buffer size used by the lauxlib buffer system.
 */
 //#define LUAL_BUFFERSIZE		BUFSIZ
   #define LUAL_BUFFERSIZE		512
 
+/*
+@@ LUA_LOADFILE_MEMOIZE sets whether luaL_loadfile keeps the compiled
+@* chunk of "x.lua" as "x.lc" and loads that while the source is not
+@* changed. Can be changed at run time with file.memoize().
+*/
+#define LUA_LOADFILE_MEMOIZE	0
+
 /* }================================================================== */
 
 
@@ -674,6 +723,39 @@ LUA_NUMBER luai_ipow(LUA_NUMBER, LUA_NUMBER);
 #endif
 
 
+/*
+@@ LUA_NUMBER_HYBRID adds single precision floats as a second subtype
+@* of number, next to the integral lua_Number, as Lua 5.3 does.
+** Operations on two integers stay integer operations, `/' and `%'
+** included, so existing scripts behave as before. An operand that is
+** a float makes the operation a float one, done by the FPU. Numerals
+** with a decimal point or an exponent are floats. C functions that
+** read a float with lua_tonumber get it truncated, lua_tofloat keeps
+** the fraction.
+@@ LUA_FLOAT is the type of the float subtype.
+@@ LUA_FLOAT_FMT is the format for writing floats.
+@@ lua_float2str converts a float to a string.
+@@ lua_str2float converts a string to a float.
+@@ The luai_flt* macros define the float operations that differ from
+@* the luai_num* ones.
+*/
+#if defined LUA_NUMBER_INTEGRAL
+#define LUA_NUMBER_HYBRID
+#endif
+
+#if defined LUA_NUMBER_HYBRID
+#define LUA_FLOAT		float
+#define LUA_FLOAT_FMT		"%.7g"
+#define lua_float2str(s,n)	sprintf((s), LUA_FLOAT_FMT, (double)(n))
+#define lua_str2float(s,p)	strtof((s), (p))
+#if defined(LUA_CORE)
+#define luai_fltdiv(a,b)	((a)/(b))
+#define luai_fltmod(a,b)	((a) - floorf((a)/(b))*(b))
+#define luai_fltpow(a,b)	(powf(a,b))
+#endif
+#endif
+
+
 /*
 @@ lua_number2int is a macro to convert lua_Number to int.
 @@ lua_number2integer is a macro to convert lua_Number to lua_Integer.
@@ -109,6 +109,31 @@ LUALIB_API int (luaopen_sensor) (lua_State *L);
 LUALIB_API int (luaopen_mqtt) (lua_State *L);
 #endif
 
+#ifdef USE_STRBUF_MODULE
+#define LUA_STRBUFLIBNAME	"strbuf"
+LUALIB_API int (luaopen_strbuf) (lua_State *L);
+#endif
+
+#ifdef USE_TASK_MODULE
+#define LUA_TASKLIBNAME	"task"
+LUALIB_API int (luaopen_task) (lua_State *L);
+#endif
+
+#ifdef USE_HTTP_MODULE
+#define LUA_HTTPLIBNAME	"http"
+LUALIB_API int (luaopen_http) (lua_State *L);
+#endif
+
+#ifdef USE_CRYPTO_MODULE
+#define LUA_CRYPTOLIBNAME	"crypto"
+LUALIB_API int (luaopen_crypto) (lua_State *L);
+#endif
+
+#ifdef USE_CONFIG_MODULE
+#define LUA_CONFIGLIBNAME	"config"
+LUALIB_API int (luaopen_config) (lua_State *L);
+#endif
+
 /* open all previous libraries */
 LUALIB_API void (luaL_openlibs) (lua_State *L); 
 
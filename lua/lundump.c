@@ -168,7 +168,7 @@ static TString* LoadString(LoadState* S)
   if (!luaZ_direct_mode(S->Z)) {
    s = luaZ_openspace(S->L,S->b,size);
    LoadBlock(S,s,size);
-   return luaS_newlstr(S->L,s,size-1); /* remove trailing zero */
+   return luaS_internlstr(S->L,s,size-1); /* remove trailing zero */
   } else {
    s = (char*)luaZ_get_crt_address(S->Z);
    LoadBlock(S,NULL,size);
@@ -215,6 +215,13 @@ static void LoadConstants(LoadState* S, Proto* f)
    case LUA_TNUMBER:
 	setnvalue(o,LoadNumber(S));
 	break;
+#if defined LUA_NUMBER_HYBRID
+   case LUA_TNUMFLT: {
+	lua_Float y;
+	LoadVar(S,y);
+	setfltvalue(o,y);
+	} break;
+#endif
    case LUA_TSTRING:
 	setsvalue2n(S->L,o,LoadString(S));
 	break;
@@ -31,6 +31,20 @@
 /* limit for table tag-method chains (to avoid loops) */
 #define MAXTAGLOOP	100
 
+#if defined LUA_NUMBER_HYBRID
+/* integer comparisons if both are integers, float ones otherwise */
+#define numlt(l,r)	((ttisint(l) && ttisint(r)) ? \
+	luai_numlt(ivalue(l), ivalue(r)) : luai_numlt(nfltvalue(l), nfltvalue(r)))
+#define numle(l,r)	((ttisint(l) && ttisint(r)) ? \
+	luai_numle(ivalue(l), ivalue(r)) : luai_numle(nfltvalue(l), nfltvalue(r)))
+#define numeq(l,r)	luaO_numeq(l, r)
+#else
+#define ivalue(o)	nvalue(o)  /* only one subtype */
+#define numlt(l,r)	luai_numlt(nvalue(l), nvalue(r))
+#define numle(l,r)	luai_numle(nvalue(l), nvalue(r))
+#define numeq(l,r)	luai_numeq(nvalue(l), nvalue(r))
+#endif
+
 #if defined LUA_NUMBER_INTEGRAL
 LUA_NUMBER luai_ipow(LUA_NUMBER a, LUA_NUMBER b) {
   if (b < 0)
@@ -52,6 +66,13 @@ LUA_NUMBER luai_ipow(LUA_NUMBER a, LUA_NUMBER b) {
 #endif
 
 const TValue *luaV_tonumber (const TValue *obj, TValue *n) {
+#if defined LUA_NUMBER_HYBRID
+  if (ttisnumber(obj)) return obj;
+  if (ttisstring(obj) && luaO_str2n(svalue(obj), n))
+    return n;
+  else
+    return NULL;
+#else
   lua_Number num;
   if (ttisnumber(obj)) return obj;
   if (ttisstring(obj) && luaO_str2d(svalue(obj), &num)) {
@@ -60,6 +81,7 @@ const TValue *luaV_tonumber (const TValue *obj, TValue *n) {
   }
   else
     return NULL;
+#endif
 }
 
 
@@ -69,8 +91,18 @@ int luaV_tostring (lua_State *L, StkId obj) {
   else {
     char s[LUAI_MAXNUMBER2STR];
     ptrdiff_t objr = savestack(L, obj);
+#if defined LUA_NUMBER_HYBRID
+    if (ttisfloat(obj)) {
+      lua_float2str(s, fltvalue(obj));
+      if (s[strspn(s, "-0123456789")] == '\0')  /* looks like an int? */
+        strcat(s, ".0");  /* 2.0 converts back to a float */
+    }
+    else
+      lua_number2str(s, ivalue(obj));
+#else
     lua_Number n = nvalue(obj);
     lua_number2str(s, n);
+#endif
     setsvalue2s(L, restorestack(L, objr), luaS_new(L, s));
     return 1;
   }
@@ -260,7 +292,7 @@ int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r) {
   if (ttype(l) != ttype(r))
     return luaG_ordererror(L, l, r);
   else if (ttisnumber(l))
-    return luai_numlt(nvalue(l), nvalue(r));
+    return numlt(l, r);
   else if (ttisstring(l))
     return l_strcmp(rawtsvalue(l), rawtsvalue(r)) < 0;
   else if ((res = call_orderTM(L, l, r, TM_LT)) != -1)
@@ -274,7 +306,7 @@ static int lessequal (lua_State *L, const TValue *l, const TValue *r) {
   if (ttype(l) != ttype(r))
     return luaG_ordererror(L, l, r);
   else if (ttisnumber(l))
-    return luai_numle(nvalue(l), nvalue(r));
+    return numle(l, r);
   else if (ttisstring(l))
     return l_strcmp(rawtsvalue(l), rawtsvalue(r)) <= 0;
   else if ((res = call_orderTM(L, l, r, TM_LE)) != -1)  /* first try `le' */
@@ -290,12 +322,13 @@ int luaV_equalval (lua_State *L, const TValue *t1, const TValue *t2) {
   lua_assert(ttype(t1) == ttype(t2));
   switch (ttype(t1)) {
     case LUA_TNIL: return 1;
-    case LUA_TNUMBER: return luai_numeq(nvalue(t1), nvalue(t2));
+    case LUA_TNUMBER: return numeq(t1, t2);
     case LUA_TBOOLEAN: return bvalue(t1) == bvalue(t2);  /* true must be 1 !! */
     case LUA_TLIGHTUSERDATA: 
     case LUA_TROTABLE:
     case LUA_TLIGHTFUNCTION:
       return pvalue(t1) == pvalue(t2);
+    case LUA_TSTRING: return eqstr(rawtsvalue(t1), rawtsvalue(t2));
     case LUA_TUSERDATA: {
       if (uvalue(t1) == uvalue(t2)) return 1;
       tm = get_compTM(L, uvalue(t1)->metatable, uvalue(t2)->metatable,
@@ -365,7 +398,25 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
   const TValue *b, *c;
   if ((b = luaV_tonumber(rb, &tempb)) != NULL &&
       (c = luaV_tonumber(rc, &tempc)) != NULL) {
-    lua_Number nb = nvalue(b), nc = nvalue(c);
+    lua_Number nb, nc;
+#if defined LUA_NUMBER_HYBRID
+    if (!ttisint(b) || !ttisint(c)) {
+      lua_Float fb = nfltvalue(b), fc = nfltvalue(c);
+      switch (op) {
+        case TM_ADD: setfltvalue(ra, luai_numadd(fb, fc)); break;
+        case TM_SUB: setfltvalue(ra, luai_numsub(fb, fc)); break;
+        case TM_MUL: setfltvalue(ra, luai_nummul(fb, fc)); break;
+        case TM_DIV: setfltvalue(ra, luai_fltdiv(fb, fc)); break;
+        case TM_MOD: setfltvalue(ra, luai_fltmod(fb, fc)); break;
+        case TM_POW: setfltvalue(ra, luai_fltpow(fb, fc)); break;
+        case TM_UNM: setfltvalue(ra, luai_numunm(fb)); break;
+        default: lua_assert(0); break;
+      }
+      return;
+    }
+#endif
+    nb = ivalue(b);
+    nc = ivalue(c);
     switch (op) {
       case TM_ADD: setnvalue(ra, luai_numadd(nb, nc)); break;
       case TM_SUB: setnvalue(ra, luai_numsub(nb, nc)); break;
@@ -392,7 +443,7 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
 ** some macros for common tasks in `luaV_execute'
 */
 
-#define runtime_check(L, c)	{ if (!(c)) break; }
+#define runtime_check(L, c)	{ if (!(c)) vmbreak; }
 
 #define RA(i)	(base+GETARG_A(i))
 /* to be used after possible stack reallocation */
@@ -411,7 +462,26 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
 #define Protect(x)	{ L->savedpc = pc; {x;}; base = L->base; }
 
 
-#define arith_op(op,tm) { \
+#if defined LUA_NUMBER_HYBRID
+/* integers first, then floats on the FPU, everything else in Arith */
+#define arith_op(op,fop,tm) { \
+        TValue *rb = RKB(i); \
+        TValue *rc = RKC(i); \
+        if (ttisint(rb) && ttisint(rc)) { \
+          lua_Number nb = ivalue(rb), nc = ivalue(rc); \
+          setnvalue(ra, op(nb, nc)); \
+        } \
+        else if (ttisnumber(rb) && ttisnumber(rc)) { \
+          lua_Float nb = nfltvalue(rb), nc = nfltvalue(rc); \
+          setfltvalue(ra, fop(nb, nc)); \
+        } \
+        else \
+          Protect(Arith(L, ra, rb, rc, tm)); \
+      }
+#else
+/* one number type, with LUA_NUMBER_INTEGRAL (the firmware) this is the
+   integer fast path: a tag check and a native add */
+#define arith_op(op,fop,tm) { \
         TValue *rb = RKB(i); \
         TValue *rc = RKC(i); \
         if (ttisnumber(rb) && ttisnumber(rc)) { \
@@ -421,7 +491,204 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
         else \
           Protect(Arith(L, ra, rb, rc, tm)); \
       }
+#endif
+
+
+
+/*
+** instruction fetch and dispatch: with LUA_USE_COMPUTED_GOTO every
+** instruction ends with its own fetch and indirect jump through
+** `disptab', otherwise with a jump back to the switch
+*/
+#define vmfetch() { \
+        i = *pc++; \
+        if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) && \
+            (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) { \
+          traceexec(L, pc); \
+          if (L->status == LUA_YIELD) {  /* did hook yield? */ \
+            L->savedpc = pc - 1; \
+            return; \
+          } \
+          base = L->base; \
+        } \
+        /* warning!! several calls may realloc the stack and invalidate `ra' */ \
+        ra = RA(i); \
+        lua_assert(base == L->base && L->base == L->ci->base); \
+        lua_assert(base <= L->top && L->top <= L->stack + L->stacksize); \
+        lua_assert(L->top == L->ci->top || luaG_checkopenop(i)); \
+      }
+
+#if defined LUA_USE_COMPUTED_GOTO
+#define vmdispatch(o)	goto *disptab[o];
+#define vmcase(op)	L_##op:
+#define vmbreak		{ vmfetch(); goto *disptab[GET_OPCODE(i)]; }
+#else
+#define vmdispatch(o)	switch (o)
+#define vmcase(op)	case op:
+#define vmbreak		continue
+#endif
+
+
+/*
+** primitive get for the fast paths; a nil result still needs
+** luaV_gettable for the `__index' metamethod
+*/
+#define fastget(h,key) \
+        (ttisstring(key) ? luaH_getstr(h, rawtsvalue(key)) : luaH_get(h, key))
+
+
+#if defined LUA_USE_INLINE_CACHE
+/*
+** Inline caches: for each constant of a function, where that key was
+** last found by OP_GETGLOBAL, OP_GETTABLE or OP_SELF. Constant keys of
+** rotables stay where they are, a table node is checked to still hold
+** the key, so nothing in a cache has to be kept alive by the collector.
+** Globals that the globals table finds with luaB_index (ROM modules and
+** base functions) are kept with `t' pointing just past the globals
+** table, offset by the type of the value. They are taken without
+** looking the key up in the globals table first while it keeps
+** TABLE_ROMGLOBALS, which every luaH_set and luaH_setstr clears. Setting
+** the bit again starts a new romera, so that entries cached before a
+** key was set stay stale.
+*/
+#define romglobal(env,tt)	cast(const void *, cast(const char *, env) + (tt))
+
+static void newkcache (lua_State *L, Proto *p) {
+  int j;
+  KCache *c = luaM_newvector(L, p->sizek, KCache);
+  for (j = 0; j < p->sizek; j++) {
+    c[j].t = NULL;
+    c[j].era = 0;
+  }
+  p->kcache = c;
+}
+
+
+/* t[k[idx]] for a string constant, NULL when luaV_gettable must do it */
+static const TValue *cachedget (Proto *p, int idx, const TValue *t) {
+  KCache *c = &p->kcache[idx];
+  TString *key = rawtsvalue(&p->k[idx]);
+  const TValue *res;
+  if (ttistable(t)) {
+    Table *h = hvalue(t);
+    if (c->t == h) {
+      const Node *n = cast(const Node *, c->v);
+      if (n >= gnode(h, 0) && n < gnode(h, sizenode(h)) &&
+          ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key &&
+          !ttisnil(gval(n)))
+        return gval(n);
+    }
+    res = luaH_getstr(h, key);
+    if (ttisnil(res))
+      return NULL;
+    c->t = h;
+    c->v = res;  /* string keys are in the hash part */
+    return res;
+  }
+  else if (ttisrotable(t)) {
+    if (c->t == rvalue(t))
+      return cast(const TValue *, c->v);
+    res = luaH_getstr_ro(rvalue(t), key);
+    if (ttisnil(res))
+      return NULL;
+    c->t = rvalue(t);
+    c->v = res;
+    return res;
+  }
+  return NULL;
+}
+
+
+/* is `env' still looking up missing globals with luaB_index? */
+static int romindex (lua_State *L, Table *env) {
+  const TValue *tm = fasttm(L, env->metatable, TM_INDEX);
+  return tm != NULL && ttislightfunction(tm) &&
+         fvalue(tm) == cast(void *, luaB_index);
+}
+
+
+/* global k[idx] into `ra', 0 when luaV_gettable must do it */
+static int cachedglobal (lua_State *L, Proto *p, int idx, Table *env,
+                         StkId ra) {
+  KCache *c = &p->kcache[idx];
+  TValue g;
+  const TValue *res;
+  if ((env->flags & TABLE_ROMGLOBALS) && c->era == G(L)->romera &&
+      romindex(L, env)) {
+    if (c->t == romglobal(env, LUA_TROTABLE)) {
+      setrvalue(ra, cast(void *, c->v));
+      return 1;
+    }
+    if (c->t == romglobal(env, LUA_TLIGHTFUNCTION)) {
+      setfvalue(ra, cast(void *, c->v));
+      return 1;
+    }
+  }
+  sethvalue(L, &g, env);
+  if ((res = cachedget(p, idx, &g)) != NULL) {
+    setobj2s(L, ra, res);
+    return 1;
+  }
+  return 0;
+}
+
 
+/* after luaV_gettable found global k[idx] in ROM, remember it */
+static void romglobalfound (lua_State *L, Proto *p, int idx, Table *env,
+                            StkId ra) {
+  KCache *c = &p->kcache[idx];
+  if ((ra->tt == LUA_TROTABLE || ra->tt == LUA_TLIGHTFUNCTION) &&
+      romindex(L, env)) {
+    if (!(env->flags & TABLE_ROMGLOBALS)) {
+      G(L)->romera++;
+      env->flags |= TABLE_ROMGLOBALS;
+    }
+    c->t = romglobal(env, ra->tt);
+    c->v = ra->value.p;
+    c->era = G(L)->romera;
+  }
+}
+#endif
+
+
+#ifndef LUA_PACK_VALUE
+/*
+** Call the fast version of builtin `ra' with the b-1 values after it
+** as arguments (see lrotable.h). Returns 0 when luaD_precall must call
+** the regular version instead.
+*/
+static int fastcall (lua_State *L, StkId ra, int b, int nresults) {
+  lua_Integer a[3] = {0, 0, 0};
+  lua_Integer res;
+  int nargs = fastnargs(ra);
+  int j;
+  if (b - 1 != nargs || (L->hookmask & (LUA_MASKCALL | LUA_MASKRET)))
+    return 0;
+  for (j = 0; j < nargs; j++) {
+#if defined LUA_NUMBER_HYBRID
+    if (!ttisint(ra + 1 + j)) return 0;
+#else
+    if (!ttisnumber(ra + 1 + j)) return 0;
+#endif
+    a[j] = (lua_Integer)nvalue(ra + 1 + j);
+  }
+  if ((*((const luaR_fastfunc *)fvalue(ra))->ff)(&res, a[0], a[1], a[2]))
+    return 0;  /* argument not accepted, let the regular version complain */
+  j = 0;
+  if (fastnres(ra)) {
+    setnvalue(ra, cast_num(res));
+    j = 1;
+  }
+  if (nresults == LUA_MULTRET)
+    L->top = ra + j;
+  else {
+    for (; j < nresults; j++)
+      setnilvalue(ra + j);
+    L->top = L->ci->top;
+  }
+  return 1;
+}
+#endif
 
 
 void luaV_execute (lua_State *L, int nexeccalls) {
@@ -429,141 +696,199 @@ void luaV_execute (lua_State *L, int nexeccalls) {
   StkId base;
   TValue *k;
   const Instruction *pc;
+#if defined LUA_USE_COMPUTED_GOTO
+  /* ORDER OP */
+  static const void *const disptab[NUM_OPCODES] = {
+    &&L_OP_MOVE, &&L_OP_LOADK, &&L_OP_LOADBOOL, &&L_OP_LOADNIL,
+    &&L_OP_GETUPVAL, &&L_OP_GETGLOBAL, &&L_OP_GETTABLE, &&L_OP_SETGLOBAL,
+    &&L_OP_SETUPVAL, &&L_OP_SETTABLE, &&L_OP_NEWTABLE, &&L_OP_SELF,
+    &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_MOD, &&L_OP_POW,
+    &&L_OP_UNM, &&L_OP_NOT, &&L_OP_LEN, &&L_OP_CONCAT, &&L_OP_JMP,
+    &&L_OP_EQ, &&L_OP_LT, &&L_OP_LE, &&L_OP_TEST, &&L_OP_TESTSET,
+    &&L_OP_CALL, &&L_OP_TAILCALL, &&L_OP_RETURN, &&L_OP_FORLOOP,
+    &&L_OP_FORPREP, &&L_OP_TFORLOOP, &&L_OP_SETLIST, &&L_OP_CLOSE,
+    &&L_OP_CLOSURE, &&L_OP_VARARG
+  };
+#endif
  reentry:  /* entry point */
   lua_assert(isLua(L->ci));
   pc = L->savedpc;
   cl = &clvalue(L->ci->func)->l;
+#if defined LUA_USE_INLINE_CACHE
+  if (cl->p->kcache == NULL && cl->p->sizek > 0)
+    newkcache(L, cl->p);  /* before `base', it may run the collector */
+#endif
   base = L->base;
   k = cl->p->k;
   /* main loop of interpreter */
   for (;;) {
-    const Instruction i = *pc++;
+    Instruction i;
     StkId ra;
-    if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) &&
-        (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) {
-      traceexec(L, pc);
-      if (L->status == LUA_YIELD) {  /* did hook yield? */
-        L->savedpc = pc - 1;
-        return;
-      }
-      base = L->base;
-    }
-    /* warning!! several calls may realloc the stack and invalidate `ra' */
-    ra = RA(i);
-    lua_assert(base == L->base && L->base == L->ci->base);
-    lua_assert(base <= L->top && L->top <= L->stack + L->stacksize);
-    lua_assert(L->top == L->ci->top || luaG_checkopenop(i));
-    switch (GET_OPCODE(i)) {
-      case OP_MOVE: {
+    vmfetch();
+    vmdispatch (GET_OPCODE(i)) {
+      vmcase(OP_MOVE) {
         setobjs2s(L, ra, RB(i));
-        continue;
+        vmbreak;
       }
-      case OP_LOADK: {
+      vmcase(OP_LOADK) {
         setobj2s(L, ra, KBx(i));
-        continue;
+        vmbreak;
       }
-      case OP_LOADBOOL: {
+      vmcase(OP_LOADBOOL) {
         setbvalue(ra, GETARG_B(i));
         if (GETARG_C(i)) pc++;  /* skip next instruction (if C) */
-        continue;
+        vmbreak;
       }
-      case OP_LOADNIL: {
+      vmcase(OP_LOADNIL) {
         TValue *rb = RB(i);
         do {
           setnilvalue(rb--);
         } while (rb >= ra);
-        continue;
+        vmbreak;
       }
-      case OP_GETUPVAL: {
+      vmcase(OP_GETUPVAL) {
         int b = GETARG_B(i);
         setobj2s(L, ra, cl->upvals[b]->v);
-        continue;
+        vmbreak;
       }
-      case OP_GETGLOBAL: {
+      vmcase(OP_GETGLOBAL) {
         TValue g;
         TValue *rb = KBx(i);
-        sethvalue(L, &g, cl->env);
         lua_assert(ttisstring(rb));
+#if defined LUA_USE_INLINE_CACHE
+        if (cachedglobal(L, cl->p, GETARG_Bx(i), cl->env, ra))
+          vmbreak;
+        sethvalue(L, &g, cl->env);
+        Protect(luaV_gettable(L, &g, rb, ra));
+        romglobalfound(L, cl->p, GETARG_Bx(i), cl->env, RA(i));
+#else
+        {
+          const TValue *res = luaH_getstr(cl->env, rawtsvalue(rb));
+          if (!ttisnil(res)) {  /* fast path: plain hit */
+            setobj2s(L, ra, res);
+            vmbreak;
+          }
+        }
+        sethvalue(L, &g, cl->env);
         Protect(luaV_gettable(L, &g, rb, ra));
-        continue;
+#endif
+        vmbreak;
       }
-      case OP_GETTABLE: {
-        Protect(luaV_gettable(L, RB(i), RKC(i), ra));
-        continue;
+      vmcase(OP_GETTABLE) {
+        TValue *rb = RB(i);
+        TValue *rc = RKC(i);
+        const TValue *res;
+#if defined LUA_USE_INLINE_CACHE
+        if (ISK(GETARG_C(i)) && ttisstring(rc)) {
+          if ((res = cachedget(cl->p, INDEXK(GETARG_C(i)), rb)) != NULL) {
+            setobj2s(L, ra, res);
+            vmbreak;
+          }
+        }
+        else
+#endif
+        if (ttistable(rb) && !ttisnil(res = fastget(hvalue(rb), rc))) {
+          setobj2s(L, ra, res);  /* fast path: plain hit */
+          vmbreak;
+        }
+        Protect(luaV_gettable(L, rb, rc, ra));
+        vmbreak;
       }
-      case OP_SETGLOBAL: {
+      vmcase(OP_SETGLOBAL) {
         TValue g;
         sethvalue(L, &g, cl->env);
         lua_assert(ttisstring(KBx(i)));
         Protect(luaV_settable(L, &g, KBx(i), ra));
-        continue;
+        vmbreak;
       }
-      case OP_SETUPVAL: {
+      vmcase(OP_SETUPVAL) {
         UpVal *uv = cl->upvals[GETARG_B(i)];
         setobj(L, uv->v, ra);
         luaC_barrier(L, uv, ra);
-        continue;
+        vmbreak;
       }
-      case OP_SETTABLE: {
+      vmcase(OP_SETTABLE) {
         Protect(luaV_settable(L, ra, RKB(i), RKC(i)));
-        continue;
+        vmbreak;
       }
-      case OP_NEWTABLE: {
+      vmcase(OP_NEWTABLE) {
         int b = GETARG_B(i);
         int c = GETARG_C(i);
         Table *h;
         Protect(h = luaH_new(L, luaO_fb2int(b), luaO_fb2int(c)));
         sethvalue(L, RA(i), h);
         Protect(luaC_checkGC(L));
-        continue;
+        vmbreak;
       }
-      case OP_SELF: {
+      vmcase(OP_SELF) {
         StkId rb = RB(i);
+        TValue *rc = RKC(i);
+        const TValue *res;
         setobjs2s(L, ra+1, rb);
-        Protect(luaV_gettable(L, rb, RKC(i), ra));
-        continue;
+#if defined LUA_USE_INLINE_CACHE
+        if (ISK(GETARG_C(i)) && ttisstring(rc)) {
+          if ((res = cachedget(cl->p, INDEXK(GETARG_C(i)), rb)) != NULL) {
+            setobj2s(L, ra, res);
+            vmbreak;
+          }
+        }
+        else
+#endif
+        if (ttistable(rb) && !ttisnil(res = fastget(hvalue(rb), rc))) {
+          setobj2s(L, ra, res);  /* fast path: plain hit */
+          vmbreak;
+        }
+        Protect(luaV_gettable(L, rb, rc, ra));
+        vmbreak;
       }
-      case OP_ADD: {
-        arith_op(luai_numadd, TM_ADD);
-        continue;
+      vmcase(OP_ADD) {
+        arith_op(luai_numadd, luai_numadd, TM_ADD);
+        vmbreak;
       }
-      case OP_SUB: {
-        arith_op(luai_numsub, TM_SUB);
-        continue;
+      vmcase(OP_SUB) {
+        arith_op(luai_numsub, luai_numsub, TM_SUB);
+        vmbreak;
       }
-      case OP_MUL: {
-        arith_op(luai_nummul, TM_MUL);
-        continue;
+      vmcase(OP_MUL) {
+        arith_op(luai_nummul, luai_nummul, TM_MUL);
+        vmbreak;
       }
-      case OP_DIV: {
-        arith_op(luai_lnumdiv, TM_DIV);
-        continue;
+      vmcase(OP_DIV) {
+        arith_op(luai_lnumdiv, luai_fltdiv, TM_DIV);
+        vmbreak;
       }
-      case OP_MOD: {
-        arith_op(luai_lnummod, TM_MOD);
-        continue;
+      vmcase(OP_MOD) {
+        arith_op(luai_lnummod, luai_fltmod, TM_MOD);
+        vmbreak;
       }
-      case OP_POW: {
-        arith_op(luai_numpow, TM_POW);
-        continue;
+      vmcase(OP_POW) {
+        arith_op(luai_numpow, luai_fltpow, TM_POW);
+        vmbreak;
       }
-      case OP_UNM: {
+      vmcase(OP_UNM) {
         TValue *rb = RB(i);
+#if defined LUA_NUMBER_HYBRID
+        if (ttisfloat(rb)) {
+          lua_Float nb = fltvalue(rb);
+          setfltvalue(ra, luai_numunm(nb));
+        }
+        else
+#endif
         if (ttisnumber(rb)) {
-          lua_Number nb = nvalue(rb);
+          lua_Number nb = ivalue(rb);
           setnvalue(ra, luai_numunm(nb));
         }
         else {
           Protect(Arith(L, ra, rb, rb, TM_UNM));
         }
-        continue;
+        vmbreak;
       }
-      case OP_NOT: {
+      vmcase(OP_NOT) {
         int res = l_isfalse(RB(i));  /* next assignment may change this value */
         setbvalue(ra, res);
-        continue;
+        vmbreak;
       }
-      case OP_LEN: {
+      vmcase(OP_LEN) {
         const TValue *rb = RB(i);
         switch (ttype(rb)) {
           case LUA_TTABLE: 
@@ -583,20 +908,20 @@ void luaV_execute (lua_State *L, int nexeccalls) {
             )
           }
         }
-        continue;
+        vmbreak;
       }
-      case OP_CONCAT: {
+      vmcase(OP_CONCAT) {
         int b = GETARG_B(i);
         int c = GETARG_C(i);
         Protect(luaV_concat(L, c-b+1, c); luaC_checkGC(L));
         setobjs2s(L, RA(i), base+b);
-        continue;
+        vmbreak;
       }
-      case OP_JMP: {
+      vmcase(OP_JMP) {
         dojump(L, pc, GETARG_sBx(i));
-        continue;
+        vmbreak;
       }
-      case OP_EQ: {
+      vmcase(OP_EQ) {
         TValue *rb = RKB(i);
         TValue *rc = RKC(i);
         Protect(
@@ -604,43 +929,47 @@ void luaV_execute (lua_State *L, int nexeccalls) {
             dojump(L, pc, GETARG_sBx(*pc));
         )
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_LT: {
+      vmcase(OP_LT) {
         Protect(
           if (luaV_lessthan(L, RKB(i), RKC(i)) == GETARG_A(i))
             dojump(L, pc, GETARG_sBx(*pc));
         )
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_LE: {
+      vmcase(OP_LE) {
         Protect(
           if (lessequal(L, RKB(i), RKC(i)) == GETARG_A(i))
             dojump(L, pc, GETARG_sBx(*pc));
         )
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_TEST: {
+      vmcase(OP_TEST) {
         if (l_isfalse(ra) != GETARG_C(i))
           dojump(L, pc, GETARG_sBx(*pc));
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_TESTSET: {
+      vmcase(OP_TESTSET) {
         TValue *rb = RB(i);
         if (l_isfalse(rb) != GETARG_C(i)) {
           setobjs2s(L, ra, rb);
           dojump(L, pc, GETARG_sBx(*pc));
         }
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_CALL: {
+      vmcase(OP_CALL) {
         int b = GETARG_B(i);
         int nresults = GETARG_C(i) - 1;
         if (b != 0) L->top = ra+b;  /* else previous instruction set top */
+#ifndef LUA_PACK_VALUE
+        if (ttisfastfunc(ra) && fastcall(L, ra, b, nresults))
+          vmbreak;
+#endif
         L->savedpc = pc;
         switch (luaD_precall(L, ra, nresults)) {
           case PCRLUA: {
@@ -651,14 +980,14 @@ void luaV_execute (lua_State *L, int nexeccalls) {
             /* it was a C function (`precall' called it); adjust results */
             if (nresults >= 0) L->top = L->ci->top;
             base = L->base;
-            continue;
+            vmbreak;
           }
           default: {
             return;  /* yield */
           }
         }
       }
-      case OP_TAILCALL: {
+      vmcase(OP_TAILCALL) {
         int b = GETARG_B(i);
         if (b != 0) L->top = ra+b;  /* else previous instruction set top */
         L->savedpc = pc;
@@ -683,14 +1012,14 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           }
           case PCRC: {  /* it was a C function (`precall' called it) */
             base = L->base;
-            continue;
+            vmbreak;
           }
           default: {
             return;  /* yield */
           }
         }
       }
-      case OP_RETURN: {
+      vmcase(OP_RETURN) {
         int b = GETARG_B(i);
         if (b != 0) L->top = ra+b-1;
         if (L->openupval) luaF_close(L, base);
@@ -705,19 +1034,35 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           goto reentry;
         }
       }
-      case OP_FORLOOP: {
-        lua_Number step = nvalue(ra+2);
-        lua_Number idx = luai_numadd(nvalue(ra), step); /* increment index */
-        lua_Number limit = nvalue(ra+1);
-        if (luai_numlt(0, step) ? luai_numle(idx, limit)
-                                : luai_numle(limit, idx)) {
-          dojump(L, pc, GETARG_sBx(i));  /* jump back */
-          setnvalue(ra, idx);  /* update internal index... */
-          setnvalue(ra+3, idx);  /* ...and external index */
+      vmcase(OP_FORLOOP) {
+#if defined LUA_NUMBER_HYBRID
+        if (ttisfloat(ra)) {  /* OP_FORPREP made all three floats */
+          lua_Float step = fltvalue(ra+2);
+          lua_Float idx = luai_numadd(fltvalue(ra), step);
+          lua_Float limit = fltvalue(ra+1);
+          if (luai_numlt(0, step) ? luai_numle(idx, limit)
+                                  : luai_numle(limit, idx)) {
+            dojump(L, pc, GETARG_sBx(i));
+            setfltvalue(ra, idx);
+            setfltvalue(ra+3, idx);
+          }
         }
-        continue;
+        else
+#endif
+        {
+          lua_Number step = ivalue(ra+2);
+          lua_Number idx = luai_numadd(ivalue(ra), step); /* increment index */
+          lua_Number limit = ivalue(ra+1);
+          if (luai_numlt(0, step) ? luai_numle(idx, limit)
+                                  : luai_numle(limit, idx)) {
+            dojump(L, pc, GETARG_sBx(i));  /* jump back */
+            setnvalue(ra, idx);  /* update internal index... */
+            setnvalue(ra+3, idx);  /* ...and external index */
+          }
+        }
+        vmbreak;
       }
-      case OP_FORPREP: {
+      vmcase(OP_FORPREP) {
         const TValue *init = ra;
         const TValue *plimit = ra+1;
         const TValue *pstep = ra+2;
@@ -728,11 +1073,21 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           luaG_runerror(L, LUA_QL("for") " limit must be a number");
         else if (!tonumber(pstep, ra+2))
           luaG_runerror(L, LUA_QL("for") " step must be a number");
+#if defined LUA_NUMBER_HYBRID
+        if (!ttisint(ra) || !ttisint(ra+1) || !ttisint(ra+2)) {
+          lua_Float step = nfltvalue(ra+2);  /* a float loop */
+          setfltvalue(ra+1, nfltvalue(ra+1));
+          setfltvalue(ra+2, step);
+          setfltvalue(ra, luai_numsub(nfltvalue(ra), step));
+          dojump(L, pc, GETARG_sBx(i));
+          vmbreak;
+        }
+#endif
         setnvalue(ra, luai_numsub(nvalue(ra), nvalue(pstep)));
         dojump(L, pc, GETARG_sBx(i));
-        continue;
+        vmbreak;
       }
-      case OP_TFORLOOP: {
+      vmcase(OP_TFORLOOP) {
         StkId cb = ra + 3;  /* call base */
         setobjs2s(L, cb+2, ra+2);
         setobjs2s(L, cb+1, ra+1);
@@ -746,9 +1101,9 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           dojump(L, pc, GETARG_sBx(*pc));  /* jump back */
         }
         pc++;
-        continue;
+        vmbreak;
       }
-      case OP_SETLIST: {
+      vmcase(OP_SETLIST) {
         int n = GETARG_B(i);
         int c = GETARG_C(i);
         int last;
@@ -770,13 +1125,13 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           luaC_barriert(L, h, val);
         }
         unfixedstack(L);
-        continue;
+        vmbreak;
       }
-      case OP_CLOSE: {
+      vmcase(OP_CLOSE) {
         luaF_close(L, ra);
-        continue;
+        vmbreak;
       }
-      case OP_CLOSURE: {
+      vmcase(OP_CLOSURE) {
         Proto *p;
         Closure *ncl;
         int nup, j;
@@ -796,9 +1151,9 @@ void luaV_execute (lua_State *L, int nexeccalls) {
         }
         unfixedstack(L);
         Protect(luaC_checkGC(L));
-        continue;
+        vmbreak;
       }
-      case OP_VARARG: {
+      vmcase(OP_VARARG) {
         int b = GETARG_B(i) - 1;
         int j;
         CallInfo *ci = L->ci;
@@ -817,7 +1172,7 @@ void luaV_execute (lua_State *L, int nexeccalls) {
             setnilvalue(ra + j);
           }
         }
-        continue;
+        vmbreak;
       }
     }
   }
@@ -9,6 +9,10 @@
 
 #include "lua.h"
 #include "lauxlib.h"
+#include "task.h"
+#include "dns.h"
+#include "http.h"
+#include "KVStoreUtils.h"
 
 extern char *sethostname( char *name );
 
@@ -120,7 +124,8 @@ static void do_quene_task(queue_msg_t* msg)
     if(msg->para2 == LUA_NOREF) return;
     lua_rawgeti(msg->L, LUA_REGISTRYINDEX, msg->para2);
     lua_call(msg->L, 0, 0);
-    lua_gc(msg->L, LUA_GCCOLLECT, 0);
+    /* young collection: frees the callback's garbage without a full one */
+    lua_gc(msg->L, LUA_GCYOUNG, 0);
   }
   else if(msg->source==WIFI)
   {
@@ -144,7 +149,22 @@ static void do_quene_task(queue_msg_t* msg)
             break;
     default:lua_pushstring(msg->L, "ERROR");lua_call(msg->L, 1, 0);break;
     }
-    lua_gc(msg->L, LUA_GCCOLLECT, 0);
+    lua_gc(msg->L, LUA_GCYOUNG, 0);
+  }
+  else if(msg->source==TASK)
+  {
+    task_resume(msg->L, msg->para2, 0);
+    lua_gc(msg->L, LUA_GCYOUNG, 0);
+  }
+  else if(msg->source==DNS)
+  {
+    dns_deliver(msg->L, msg->para2);
+    lua_gc(msg->L, LUA_GCYOUNG, 0);
+  }
+  else if(msg->source==HTTP)
+  {
+    http_deliver(msg->L, msg->para1, msg->para2);
+    lua_gc(msg->L, LUA_GCYOUNG, 0);
   }
 }
 mico_queue_t os_queue;
@@ -183,6 +203,7 @@ int application_start( void )
 {
   MicoInit();
   sethostname("WiFiMCU_Device");
+  KVStoreInit();
   
 //watch dog 
   MicoWdgInitialize( DEFAULT_WATCHDOG_TIMEOUT);
@@ -194,7 +215,7 @@ int application_start( void )
   MicoUartInitialize( LUA_UART, &lua_uart_config, (ring_buffer_t*)&lua_rx_buffer );
   mico_rtos_create_thread(NULL, MICO_DEFAULT_WORKER_PRIORITY, "lua_main_thread", lua_main_thread, 12*1024, 0);
   
-  mico_rtos_init_queue( &os_queue, "queue", sizeof(queue_msg_t), 5 );
+  mico_rtos_init_queue( &os_queue, "queue", sizeof(queue_msg_t), 16 );
   mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "queue", quene_thread, 8*1024, NULL );
   
   mico_rtos_delete_thread(NULL);
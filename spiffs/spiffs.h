@@ -164,6 +164,19 @@ typedef struct {
   // log_block_size / 8
   u32_t log_page_size;
 #endif
+#if SPIFFS_MOUNT_CHECKPOINT
+  // checkpoint area read function, may be null to disable checkpoints
+  spiffs_read hal_ckpt_read_f;
+  // checkpoint area write function
+  spiffs_write hal_ckpt_write_f;
+  // checkpoint area erase function
+  spiffs_erase hal_ckpt_erase_f;
+  // physical address of the checkpoint area, must not overlap
+  // the file system, may be on another flash device
+  u32_t ckpt_addr;
+  // physical size of the checkpoint area, erased as one unit
+  u32_t ckpt_size;
+#endif
 } spiffs_config;
 
 typedef struct {
@@ -206,6 +219,19 @@ typedef struct {
 
 #if SPIFFS_GC_STATS
   u32_t stats_gc_runs;
+#if SPIFFS_GC_BACKGROUND
+  // number of blocks reclaimed by SPIFFS_gc_background
+  u32_t stats_gc_bg_runs;
+#endif
+#endif
+
+#if SPIFFS_WR_STATS
+  // number of bytes given to SPIFFS_write
+  u32_t stats_wr_user;
+  // number of bytes written to flash
+  u32_t stats_wr_phys;
+  // number of logical blocks erased
+  u32_t stats_erases;
 #endif
 
 #if SPIFFS_CACHE
@@ -219,6 +245,17 @@ typedef struct {
 #endif
 #endif
 
+#if SPIFFS_MOUNT_CHECKPOINT
+  // sequence number of last written checkpoint
+  u32_t ckpt_seq;
+  // offset of next free checkpoint slot in checkpoint area
+  u32_t ckpt_offs;
+  // nonzero if last written checkpoint matches the file system
+  u8_t ckpt_valid;
+  // nonzero if file system was mounted from a checkpoint
+  u8_t ckpt_mounted;
+#endif
+
   // check callback function
   spiffs_check_callback check_cb_f;
 
@@ -233,9 +270,21 @@ typedef struct {
   spiffs_obj_id obj_id;
   u32_t size;
   spiffs_obj_type type;
+  spiffs_page_ix pix;
   u8_t name[SPIFFS_OBJ_NAME_LEN];
 } spiffs_stat;
 
+/* spiffs block status struct */
+typedef struct {
+  // value of the file system erase counter when block was last erased,
+  // (spiffs_obj_id)-1 if never erased by spiffs
+  spiffs_obj_id erase_count;
+  // number of pages in use, deleted and free
+  u32_t used;
+  u32_t deleted;
+  u32_t free;
+} spiffs_block_stat;
+
 struct spiffs_dirent {
   spiffs_obj_id obj_id;
   u8_t name[SPIFFS_OBJ_NAME_LEN];
@@ -257,6 +306,8 @@ typedef struct {
  * If SPIFFS_USE_MAGIC is enabled the mounting may fail with SPIFFS_ERR_NOT_A_FS
  * if the flash does not contain a recognizable file system.
  * In this case, SPIFFS_format must be called prior to remounting.
+ * If SPIFFS_MOUNT_CHECKPOINT is enabled and a valid checkpoint is found, the
+ * file system statistics are taken from it instead of scanning all blocks.
  * @param fs            the file system struct
  * @param config        the physical and logical configuration of the file system
  * @param work          a memory work buffer comprising 2*config->log_page_size
@@ -274,7 +325,8 @@ s32_t SPIFFS_mount(spiffs *fs, spiffs_config *config, u8_t *work,
 
 /**
  * Unmounts the file system. All file handles will be flushed of any
- * cached writes and closed.
+ * cached writes and closed. If SPIFFS_MOUNT_CHECKPOINT is enabled, a
+ * checkpoint is written for next mount.
  * @param fs            the file system struct
  */
 void SPIFFS_unmount(spiffs *fs);
@@ -376,12 +428,21 @@ s32_t SPIFFS_stat(spiffs *fs, char *path, spiffs_stat *s);
 s32_t SPIFFS_fstat(spiffs *fs, spiffs_file fh, spiffs_stat *s);
 
 /**
- * Flushes all pending write operations from cache for given file
+ * Flushes all pending write operations from cache for given file.
  * @param fs            the file system struct
  * @param fh            the filehandle of the file to flush
  */
 s32_t SPIFFS_fflush(spiffs *fs, spiffs_file fh);
 
+/**
+ * Flushes all pending write operations from cache for all open files. If
+ * SPIFFS_MOUNT_CHECKPOINT is enabled and the file system was modified since
+ * the last checkpoint, a checkpoint is written, so that mounting after a
+ * power loss need not scan the file system.
+ * @param fs            the file system struct
+ */
+s32_t SPIFFS_sync(spiffs *fs);
+
 /**
  * Closes a filehandle. If there are pending write operations, these are finalized before closing.
  * @param fs            the file system struct
@@ -440,6 +501,27 @@ struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e);
  */
 s32_t SPIFFS_check(spiffs *fs);
 
+/**
+ * Gets page usage and erase counter stamp of a block, e.g. to see how
+ * evenly the blocks are worn.
+ * @param fs            the file system struct
+ * @param bix           the block index, 0 up to number of blocks
+ * @param s             the block stat struct to populate
+ */
+s32_t SPIFFS_block_stat(spiffs *fs, spiffs_block_ix bix, spiffs_block_stat *s);
+
+#if SPIFFS_GC_BACKGROUND
+/**
+ * Runs one step of background garbage collection: if free blocks are
+ * running low, the best candidate block is cleaned and erased. At most one
+ * block is reclaimed per call. Call this periodically while the file
+ * system is idle.
+ * @param fs            the file system struct
+ * @returns 1 if a block was reclaimed, 0 if nothing was done, or -1 on error
+ */
+s32_t SPIFFS_gc_background(spiffs *fs);
+#endif
+
 
 /**
  * Returns number of total bytes available and number of used bytes.
@@ -0,0 +1,241 @@
+/*
+ * spiffs_checkpoint.c
+ *
+ * Persists the file system statistics gathered by spiffs_obj_lu_scan, so
+ * that mounting after a clean unmount or sync does not need to visit the
+ * object lookup pages of all blocks.
+ */
+
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+#include "CRCUtils.h"
+
+#if SPIFFS_MOUNT_CHECKPOINT
+
+#define SPIFFS_CKPT_SLOT_SZ \
+  (sizeof(spiffs_checkpoint))
+#define SPIFFS_CKPT_CONFIGURED(fs) \
+  ((fs)->cfg.hal_ckpt_read_f != 0 && (fs)->cfg.ckpt_size >= 2 * SPIFFS_CKPT_SLOT_SZ)
+
+static u32_t spiffs_checkpoint_crc(spiffs_checkpoint *ckpt) {
+  return CRC32_Update(0, ckpt, offsetof(spiffs_checkpoint, crc));
+}
+
+// Crc of the erase count stamps of all blocks. Any erase changes a stamp
+// and format stamps all blocks with a new generation, so a record written
+// for other file system contents does not match.
+static s32_t spiffs_checkpoint_stamps(spiffs *fs, u32_t *crc) {
+  s32_t res = SPIFFS_OK;
+  spiffs_block_ix bix;
+  *crc = 0;
+  for (bix = 0; bix < fs->block_count; bix++) {
+    spiffs_obj_id erase_count;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ, 0,
+        SPIFFS_ERASE_COUNT_PADDR(fs, bix),
+        sizeof(spiffs_obj_id), (u8_t *)&erase_count);
+    SPIFFS_CHECK_RES(res);
+    *crc = CRC32_Update(*crc, &erase_count, sizeof(spiffs_obj_id));
+  }
+  return res;
+}
+
+static s32_t spiffs_checkpoint_read(spiffs *fs, u32_t offs, spiffs_checkpoint *ckpt, u8_t *ok) {
+  s32_t res = fs->cfg.hal_ckpt_read_f(fs->cfg.ckpt_addr + offs,
+      SPIFFS_CKPT_SLOT_SZ, (u8_t *)ckpt);
+  *ok = ckpt->magic == SPIFFS_CKPT_MAGIC(fs) && ckpt->crc == spiffs_checkpoint_crc(ckpt);
+  return res;
+}
+
+// Finds last written checkpoint record and next free slot. If last record
+// is valid, follows the record before it and is clean, the file system
+// statistics are loaded from it.
+// A sector erase cut short can leave old records behind, so a last record
+// that does not follow its predecessor by sequence number is not trusted,
+// and neither is a record without predecessor, which is only left when
+// writing the first two records after an erase was cut short. Damaged or
+// out of sequence records have the area erased before the next write.
+// Returns SPIFFS_ERR_NOT_FOUND if a full scan is needed.
+s32_t spiffs_checkpoint_load(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_checkpoint ckpt, prev;
+  u32_t offs = 0;
+  u8_t found = 0;
+  u8_t ok;
+
+  fs->ckpt_valid = 0;
+  fs->ckpt_mounted = 0;
+  fs->ckpt_seq = 0;
+  fs->ckpt_offs = 0;
+  if (!SPIFFS_CKPT_CONFIGURED(fs)) {
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+
+  // records are appended, so the last used slot is the most recent one
+  while (offs + SPIFFS_CKPT_SLOT_SZ <= fs->cfg.ckpt_size) {
+    u32_t magic;
+    res = fs->cfg.hal_ckpt_read_f(fs->cfg.ckpt_addr + offs, sizeof(u32_t), (u8_t *)&magic);
+    SPIFFS_CHECK_RES(res);
+    if (magic == (u32_t)-1) {
+      break;
+    }
+    offs += SPIFFS_CKPT_SLOT_SZ;
+    found = 1;
+  }
+  fs->ckpt_offs = offs;
+  if (!found) {
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+
+  res = spiffs_checkpoint_read(fs, offs - SPIFFS_CKPT_SLOT_SZ, &ckpt, &ok);
+  SPIFFS_CHECK_RES(res);
+  if (!ok) {
+    // torn or foreign record
+    SPIFFS_DBG("ckpt: bad record at %i\n", offs - SPIFFS_CKPT_SLOT_SZ);
+    fs->ckpt_offs = fs->cfg.ckpt_size;
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+  fs->ckpt_seq = ckpt.seq;
+  if (offs < 2 * SPIFFS_CKPT_SLOT_SZ) {
+    SPIFFS_DBG("ckpt: record seq %i has no predecessor\n", ckpt.seq);
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+  res = spiffs_checkpoint_read(fs, offs - 2 * SPIFFS_CKPT_SLOT_SZ, &prev, &ok);
+  SPIFFS_CHECK_RES(res);
+  if (!ok || ckpt.seq != prev.seq + 1) {
+    // left over from an interrupted erase
+    SPIFFS_DBG("ckpt: record seq %i out of sequence\n", ckpt.seq);
+    fs->ckpt_offs = fs->cfg.ckpt_size;
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+  if (ckpt.clean != (u32_t)-1 ||
+      ckpt.block_count != fs->block_count ||
+      ckpt.free_cursor_block_ix >= fs->block_count) {
+    // file system modified after record was written, or config changed
+    SPIFFS_DBG("ckpt: stale record seq %i\n", ckpt.seq);
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+  u32_t stamps_crc;
+  res = spiffs_checkpoint_stamps(fs, &stamps_crc);
+  SPIFFS_CHECK_RES(res);
+  if (ckpt.stamps_crc != stamps_crc) {
+    // file system formatted or flashed behind our back
+    SPIFFS_DBG("ckpt: record seq %i of other file system\n", ckpt.seq);
+    fs->ckpt_offs = fs->cfg.ckpt_size;
+    return SPIFFS_ERR_NOT_FOUND;
+  }
+
+  fs->free_blocks = ckpt.free_blocks;
+  fs->stats_p_allocated = ckpt.stats_p_allocated;
+  fs->stats_p_deleted = ckpt.stats_p_deleted;
+  fs->max_erase_count = ckpt.max_erase_count;
+  fs->free_cursor_block_ix = ckpt.free_cursor_block_ix;
+  fs->free_cursor_obj_lu_entry = ckpt.free_cursor_obj_lu_entry;
+  fs->ckpt_valid = 1;
+  fs->ckpt_mounted = 1;
+  SPIFFS_DBG("ckpt: mounted from seq %i\n", ckpt.seq);
+
+  return SPIFFS_OK;
+}
+
+// Appends a checkpoint record describing current file system state.
+// Nothing is written if the last record still matches the file system.
+s32_t spiffs_checkpoint_write(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_checkpoint ckpt;
+
+  if (!SPIFFS_CKPT_CONFIGURED(fs) || fs->ckpt_valid) {
+    return SPIFFS_OK;
+  }
+
+  if (fs->ckpt_offs + SPIFFS_CKPT_SLOT_SZ > fs->cfg.ckpt_size) {
+    // no slot left, start over
+    res = spiffs_checkpoint_erase(fs);
+    SPIFFS_CHECK_RES(res);
+  }
+
+  memset(&ckpt, 0, sizeof(spiffs_checkpoint));
+  ckpt.magic = SPIFFS_CKPT_MAGIC(fs);
+  ckpt.block_count = fs->block_count;
+  ckpt.free_blocks = fs->free_blocks;
+  ckpt.stats_p_allocated = fs->stats_p_allocated;
+  ckpt.stats_p_deleted = fs->stats_p_deleted;
+  ckpt.max_erase_count = fs->max_erase_count;
+  ckpt.free_cursor_block_ix = fs->free_cursor_block_ix;
+  ckpt.free_cursor_obj_lu_entry = fs->free_cursor_obj_lu_entry;
+  res = spiffs_checkpoint_stamps(fs, &ckpt.stamps_crc);
+  SPIFFS_CHECK_RES(res);
+
+  // the first record after an erase is written twice, so that the one
+  // loaded has a predecessor to follow
+  do {
+    ckpt.seq = fs->ckpt_seq + 1;
+    ckpt.crc = spiffs_checkpoint_crc(&ckpt);
+    ckpt.clean = (u32_t)-1;
+
+    res = fs->cfg.hal_ckpt_write_f(fs->cfg.ckpt_addr + fs->ckpt_offs,
+        SPIFFS_CKPT_SLOT_SZ, (u8_t *)&ckpt);
+    SPIFFS_CHECK_RES(res);
+
+    fs->ckpt_offs += SPIFFS_CKPT_SLOT_SZ;
+    fs->ckpt_seq = ckpt.seq;
+  } while (fs->ckpt_offs == SPIFFS_CKPT_SLOT_SZ);
+  fs->ckpt_valid = 1;
+
+  return res;
+}
+
+// Marks last checkpoint record as stale. Must be called before the file
+// system flash is modified, so that a power loss forces a full scan.
+s32_t spiffs_checkpoint_invalidate(
+    spiffs *fs) {
+  if (!fs->ckpt_valid) {
+    return SPIFFS_OK;
+  }
+  fs->ckpt_valid = 0;
+  u32_t clean = 0;
+  return fs->cfg.hal_ckpt_write_f(
+      fs->cfg.ckpt_addr + fs->ckpt_offs - SPIFFS_CKPT_SLOT_SZ + offsetof(spiffs_checkpoint, clean),
+      sizeof(u32_t), (u8_t *)&clean);
+}
+
+// Erases the checkpoint area, dropping all records.
+s32_t spiffs_checkpoint_erase(
+    spiffs *fs) {
+  fs->ckpt_valid = 0;
+  fs->ckpt_offs = 0;
+  if (!SPIFFS_CKPT_CONFIGURED(fs)) {
+    return SPIFFS_OK;
+  }
+  SPIFFS_DBG("ckpt: erase %08x:%08x\n", fs->cfg.ckpt_addr, fs->cfg.ckpt_size);
+  return fs->cfg.hal_ckpt_erase_f(fs->cfg.ckpt_addr, fs->cfg.ckpt_size);
+}
+
+// Finds the erase count format stamps all blocks with: one above the
+// highest stamp found, so that stamps of a former file system, and a
+// checkpoint made of them, never match the formatted one.
+s32_t spiffs_checkpoint_generation(
+    spiffs *fs,
+    spiffs_obj_id *gen) {
+  s32_t res = SPIFFS_OK;
+  spiffs_block_ix bix;
+  spiffs_obj_id max = 0;
+  for (bix = 0; bix < fs->block_count; bix++) {
+    spiffs_obj_id erase_count;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ, 0,
+        SPIFFS_ERASE_COUNT_PADDR(fs, bix),
+        sizeof(spiffs_obj_id), (u8_t *)&erase_count);
+    SPIFFS_CHECK_RES(res);
+    if (erase_count != SPIFFS_OBJ_ID_FREE && erase_count > max) {
+      max = erase_count;
+    }
+  }
+  *gen = max + 1;
+  if (*gen >= SPIFFS_OBJ_ID_IX_FLAG) {
+    *gen = 1;
+  }
+  return res;
+}
+
+#endif
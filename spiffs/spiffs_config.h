@@ -77,6 +77,12 @@
 #define SPIFFS_GC_STATS                 1
 #endif
 
+// Enable/disable statistics on bytes written and blocks erased. Compared
+// to the bytes given to SPIFFS_write, this tells the write amplification.
+#ifndef SPIFFS_WR_STATS
+#define SPIFFS_WR_STATS                 1
+#endif
+
 // Garbage collecting examines all pages in a block which and sums up
 // to a block score. Deleted pages normally gives positive score and
 // used pages normally gives a negative score (as these must be moved).
@@ -119,9 +125,49 @@
 #define SPIFFS_USE_MAGIC                (0)
 #endif
 
+// Enable this to keep a summary of the file system statistics (free blocks,
+// allocated/deleted pages, erase count, free cursor) in a separate checkpoint
+// area. The summary is written on clean unmount and fflush, and is invalidated
+// on the first flash modification after that. If a valid summary is found on
+// mount, the full object lookup scan is skipped.
+// The checkpoint area is given by the ckpt members of spiffs_config. If no
+// checkpoint hal functions are given, spiffs always scans on mount.
+#ifndef SPIFFS_MOUNT_CHECKPOINT
+#define SPIFFS_MOUNT_CHECKPOINT         1
+#endif
+
+// Enable this to have SPIFFS_gc_background in the api. It reclaims one
+// block ahead of time and is meant to be called periodically from a low
+// priority task while the system is idle, so that writes seldom need to
+// run the gc themselves.
+// The api is then entered from several tasks, so the port must define
+// SPIFFS_LOCK and SPIFFS_UNLOCK.
+#ifndef SPIFFS_GC_BACKGROUND
+#define SPIFFS_GC_BACKGROUND            1
+#endif
+#if SPIFFS_GC_BACKGROUND
+// Background gc only runs if there are this many free blocks or less.
+// Writes run the gc themselves at 3 free blocks or less.
+#ifndef SPIFFS_GC_BG_FREE_BLOCKS
+#define SPIFFS_GC_BG_FREE_BLOCKS        5
+#endif
+// Background gc only cleans blocks where at least this percentage of the
+// used pages are deleted. Blocks with mostly live data are left to the gc
+// run by writes, as cleaning them means moving pages.
+#ifndef SPIFFS_GC_BG_DELETED_PERCENT
+#define SPIFFS_GC_BG_DELETED_PERCENT    50
+#endif
+#endif
+
 // SPIFFS_LOCK and SPIFFS_UNLOCK protects spiffs from reentrancy on api level
 // These should be defined on a multithreaded system
 
+// A port can define them and other settings in its own header, given by
+// the build as SPIFFS_PORT_HEADER, e.g. SPIFFS_PORT_HEADER="lspiffs.h"
+#ifdef SPIFFS_PORT_HEADER
+#include SPIFFS_PORT_HEADER
+#endif
+
 // define this to enter a mutex if you're running on a multithreaded system
 #ifndef SPIFFS_LOCK
 #define SPIFFS_LOCK(fs)
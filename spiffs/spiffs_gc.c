@@ -173,18 +173,20 @@ s32_t spiffs_gc_check(
   return res;
 }
 
-// Updates page statistics for a block that is about to be erased
-s32_t spiffs_gc_erase_page_stats(
+// Counts deleted and allocated pages in a block
+s32_t spiffs_gc_block_pages(
     spiffs *fs,
-    spiffs_block_ix bix) {
+    spiffs_block_ix bix,
+    u32_t *dele,
+    u32_t *allo) {
   s32_t res = SPIFFS_OK;
   int obj_lookup_page = 0;
   int entries_per_page = (SPIFFS_CFG_LOG_PAGE_SZ(fs) / sizeof(spiffs_obj_id));
   spiffs_obj_id *obj_lu_buf = (spiffs_obj_id *)fs->lu_work;
   int cur_entry = 0;
-  u32_t dele = 0;
-  u32_t allo = 0;
 
+  *dele = 0;
+  *allo = 0;
   // check each object lookup page
   while (res == SPIFFS_OK && obj_lookup_page < (int)SPIFFS_OBJ_LOOKUP_PAGES(fs)) {
     int entry_offset = obj_lookup_page * entries_per_page;
@@ -196,20 +198,87 @@ s32_t spiffs_gc_erase_page_stats(
       spiffs_obj_id obj_id = obj_lu_buf[cur_entry-entry_offset];
       if (obj_id == SPIFFS_OBJ_ID_FREE) {
       } else if (obj_id == SPIFFS_OBJ_ID_DELETED) {
-        dele++;
+        (*dele)++;
       } else {
-        allo++;
+        (*allo)++;
       }
       cur_entry++;
     } // per entry
     obj_lookup_page++;
   } // per object lookup page
+  return res;
+}
+
+// Updates page statistics for a block that is about to be erased
+s32_t spiffs_gc_erase_page_stats(
+    spiffs *fs,
+    spiffs_block_ix bix) {
+  u32_t dele;
+  u32_t allo;
+  s32_t res = spiffs_gc_block_pages(fs, bix, &dele, &allo);
+  SPIFFS_CHECK_RES(res);
   SPIFFS_GC_DBG("gc_check: wipe pallo:%i pdele:%i\n", allo, dele);
   fs->stats_p_allocated -= allo;
   fs->stats_p_deleted -= dele;
   return res;
 }
 
+#if SPIFFS_GC_BACKGROUND
+// Reclaims at most one block ahead of time, before writes need to run the
+// gc themselves. Nothing is done while there are enough free blocks.
+// Candidates are taken in score order, but only a block that has at least
+// SPIFFS_GC_BG_DELETED_PERCENT of its used pages deleted is cleaned, so
+// that idle time is not spent moving live data around.
+// Returns 1 if a block was erased, 0 if there was nothing worth doing.
+s32_t spiffs_gc_idle(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_block_ix *cands;
+  int count;
+  int cand_ix;
+
+  if (fs->free_blocks > SPIFFS_GC_BG_FREE_BLOCKS || fs->stats_p_deleted == 0) {
+    return 0;
+  }
+
+  res = spiffs_gc_find_candidate(fs, &cands, &count);
+  SPIFFS_CHECK_RES(res);
+
+  for (cand_ix = 0; cand_ix < count; cand_ix++) {
+    // candidate table is in fs->work, which is reused by cleaning
+    spiffs_block_ix cand = cands[cand_ix];
+    u32_t dele;
+    u32_t allo;
+    res = spiffs_gc_block_pages(fs, cand, &dele, &allo);
+    SPIFFS_CHECK_RES(res);
+    SPIFFS_GC_DBG("gc_idle: bix:%i del:%i use:%i\n", cand, dele, allo);
+    if (dele * 100 < (dele + allo) * SPIFFS_GC_BG_DELETED_PERCENT) {
+      continue;
+    }
+
+    if (allo > 0) {
+      fs->cleaning = 1;
+      res = spiffs_gc_clean(fs, cand);
+      fs->cleaning = 0;
+      SPIFFS_GC_DBG("gc_idle: cleaning block %i, result %i\n", cand, res);
+      SPIFFS_CHECK_RES(res);
+    }
+
+    res = spiffs_gc_erase_page_stats(fs, cand);
+    SPIFFS_CHECK_RES(res);
+
+    res = spiffs_gc_erase_block(fs, cand);
+    SPIFFS_CHECK_RES(res);
+#if SPIFFS_GC_STATS
+    fs->stats_gc_bg_runs++;
+#endif
+    return 1;
+  }
+
+  return 0;
+}
+#endif
+
 // Finds block candidates to erase
 s32_t spiffs_gc_find_candidate(
     spiffs *fs,
@@ -34,9 +34,19 @@ s32_t SPIFFS_format(spiffs *fs) {
   s32_t res;
   SPIFFS_LOCK(fs);
 
+  spiffs_obj_id gen = 0;
+#if SPIFFS_MOUNT_CHECKPOINT
+  // drop checkpoints of former file system, and stamp the blocks with a
+  // new generation in case records of it are left elsewhere
+  res = spiffs_checkpoint_erase(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  res = spiffs_checkpoint_generation(fs, &gen);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+
   spiffs_block_ix bix = 0;
   while (bix < fs->block_count) {
-    fs->max_erase_count = 0;
+    fs->max_erase_count = gen;
     res = spiffs_erase_block(fs, bix);
     if (res != SPIFFS_OK) {
       res = SPIFFS_ERR_ERASE_FAIL;
@@ -103,7 +113,15 @@ s32_t SPIFFS_mount(spiffs *fs, spiffs_config *config, u8_t *work,
 
   fs->config_magic = SPIFFS_CONFIG_MAGIC;
 
+#if SPIFFS_MOUNT_CHECKPOINT
+  res = spiffs_checkpoint_load(fs);
+  if (res != SPIFFS_OK) {
+    // no clean checkpoint, count the hard way
+    res = spiffs_obj_lu_scan(fs);
+  }
+#else
   res = spiffs_obj_lu_scan(fs);
+#endif
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
   SPIFFS_DBG("page index byte len:         %i\n", SPIFFS_CFG_LOG_PAGE_SZ(fs));
@@ -138,6 +156,9 @@ void SPIFFS_unmount(spiffs *fs) {
       spiffs_fd_return(fs, cur_fd->file_nbr);
     }
   }
+#if SPIFFS_MOUNT_CHECKPOINT
+  (void)spiffs_checkpoint_write(fs);
+#endif
   fs->mounted = 0;
 
   SPIFFS_UNLOCK(fs);
@@ -343,6 +364,10 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
     SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
   }
 
+#if SPIFFS_WR_STATS
+  fs->stats_wr_user += len;
+#endif
+
   offset = fd->fdoffset;
 
 #if SPIFFS_CACHE_WR
@@ -382,7 +407,7 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
               spiffs_get_cache_page(fs, spiffs_get_cache(fs), fd->cache_page->ix),
               fd->cache_page->offset, fd->cache_page->size);
           spiffs_cache_fd_release(fs, fd->cache_page);
-          SPIFFS_API_CHECK_RES(fs, res);
+          SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
         } else {
           // writing within cache
           alloc_cpage = 0;
@@ -413,7 +438,7 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
         return len;
       } else {
         res = spiffs_hydro_write(fs, fd, buf, offset, len);
-        SPIFFS_API_CHECK_RES(fs, res);
+        SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
         fd->fdoffset += len;
         SPIFFS_UNLOCK(fs);
         return res;
@@ -428,16 +453,16 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
             spiffs_get_cache_page(fs, spiffs_get_cache(fs), fd->cache_page->ix),
             fd->cache_page->offset, fd->cache_page->size);
         spiffs_cache_fd_release(fs, fd->cache_page);
-        SPIFFS_API_CHECK_RES(fs, res);
+        SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
         res = spiffs_hydro_write(fs, fd, buf, offset, len);
-        SPIFFS_API_CHECK_RES(fs, res);
+        SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
       }
     }
   }
 #endif
 
   res = spiffs_hydro_write(fs, fd, buf, offset, len);
-  SPIFFS_API_CHECK_RES(fs, res);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
   fd->fdoffset += len;
 
   SPIFFS_UNLOCK(fs);
@@ -453,7 +478,7 @@ s32_t SPIFFS_lseek(spiffs *fs, spiffs_file fh, s32_t offs, int whence) {
   spiffs_fd *fd;
   s32_t res;
   res = spiffs_fd_get(fs, fh, &fd);
-  SPIFFS_API_CHECK_RES(fs, res);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
 #if SPIFFS_CACHE_WR
   spiffs_fflush_cache(fs, fh);
@@ -567,6 +592,7 @@ static s32_t spiffs_stat_pix(spiffs *fs, spiffs_page_ix pix, spiffs_file fh, spi
 
   s->obj_id = obj_id;
   s->type = objix_hdr.type;
+  s->pix = pix;
   s->size = objix_hdr.size == SPIFFS_UNDEFINED_LEN ? 0 : objix_hdr.size;
   strncpy((char *)s->name, (char *)objix_hdr.name, SPIFFS_OBJ_NAME_LEN);
 
@@ -598,7 +624,7 @@ s32_t SPIFFS_eof(spiffs *fs, spiffs_file fh) {
   spiffs_fd *fd;
   s32_t res;
   res = spiffs_fd_get(fs, fh, &fd);
-  SPIFFS_API_CHECK_RES(fs, res);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
 #if SPIFFS_CACHE_WR
   spiffs_fflush_cache(fs, fh);
@@ -668,12 +694,36 @@ s32_t SPIFFS_fflush(spiffs *fs, spiffs_file fh) {
   SPIFFS_API_CHECK_CFG(fs);
   SPIFFS_API_CHECK_MOUNT(fs);
   s32_t res = SPIFFS_OK;
-#if SPIFFS_CACHE_WR
   SPIFFS_LOCK(fs);
+#if SPIFFS_CACHE_WR
   res = spiffs_fflush_cache(fs, fh);
   SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+#endif
   SPIFFS_UNLOCK(fs);
+
+  return res;
+}
+
+s32_t SPIFFS_sync(spiffs *fs) {
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  s32_t res = SPIFFS_OK;
+  SPIFFS_LOCK(fs);
+#if SPIFFS_CACHE_WR
+  u32_t i;
+  spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
+  for (i = 0; i < fs->fd_count; i++) {
+    if (fds[i].file_nbr != 0) {
+      res = spiffs_fflush_cache(fs, fds[i].file_nbr);
+      SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+    }
+  }
 #endif
+#if SPIFFS_MOUNT_CHECKPOINT
+  res = spiffs_checkpoint_write(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+#endif
+  SPIFFS_UNLOCK(fs);
 
   return res;
 }
@@ -798,7 +848,7 @@ struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e) {
     d->fs->err_code = SPIFFS_ERR_NOT_MOUNTED;
     return 0;
   }
-  SPIFFS_LOCK(fs);
+  SPIFFS_LOCK(d->fs);
 
   spiffs_block_ix bix;
   int entry;
@@ -822,7 +872,7 @@ struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e) {
   } else {
     d->fs->err_code = res;
   }
-  SPIFFS_UNLOCK(fs);
+  SPIFFS_UNLOCK(d->fs);
   return ret;
 }
 
@@ -850,12 +900,51 @@ s32_t SPIFFS_check(spiffs *fs) {
   return res;
 }
 
-s32_t SPIFFS_info(spiffs *fs, u32_t *total, u32_t *used) {
-  s32_t res = SPIFFS_OK;
+s32_t SPIFFS_block_stat(spiffs *fs, spiffs_block_ix bix, spiffs_block_stat *s) {
+  s32_t res;
   SPIFFS_API_CHECK_CFG(fs);
   SPIFFS_API_CHECK_MOUNT(fs);
+  if (bix >= fs->block_count) {
+    fs->err_code = SPIFFS_ERR_NOT_FOUND;
+    return -1;
+  }
   SPIFFS_LOCK(fs);
 
+  res = spiffs_gc_block_pages(fs, bix, &s->deleted, &s->used);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  s->free = SPIFFS_PAGES_PER_BLOCK(fs) - SPIFFS_OBJ_LOOKUP_PAGES(fs) - s->deleted - s->used;
+
+  res = _spiffs_rd(fs, SPIFFS_OP_C_READ | SPIFFS_OP_T_OBJ_LU2, 0,
+      SPIFFS_ERASE_COUNT_PADDR(fs, bix),
+      sizeof(spiffs_obj_id), (u8_t *)&s->erase_count);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+
+#if SPIFFS_GC_BACKGROUND
+s32_t SPIFFS_gc_background(spiffs *fs) {
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+  if (!SPIFFS_CHECK_MOUNT(fs)) {
+    // unmounted while waiting for the lock
+    SPIFFS_UNLOCK(fs);
+    return 0;
+  }
+
+  res = spiffs_gc_idle(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+#endif
+
+// called with the lock held
+static void spiffs_info(spiffs *fs, u32_t *total, u32_t *used) {
   u32_t pages_per_block = SPIFFS_PAGES_PER_BLOCK(fs);
   u32_t blocks = fs->block_count;
   u32_t obj_lu_pages = SPIFFS_OBJ_LOOKUP_PAGES(fs);
@@ -869,6 +958,15 @@ s32_t SPIFFS_info(spiffs *fs, u32_t *total, u32_t *used) {
   if (used) {
     *used = fs->stats_p_allocated * data_page_size;
   }
+}
+
+s32_t SPIFFS_info(spiffs *fs, u32_t *total, u32_t *used) {
+  s32_t res = SPIFFS_OK;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  spiffs_info(fs, total, used);
 
   SPIFFS_UNLOCK(fs);
   return res;
@@ -924,7 +1022,7 @@ s32_t SPIFFS_vis(spiffs *fs) {
     res = _spiffs_rd(fs, SPIFFS_OP_C_READ | SPIFFS_OP_T_OBJ_LU2, 0,
         SPIFFS_ERASE_COUNT_PADDR(fs, bix),
         sizeof(spiffs_obj_id), (u8_t *)&erase_count);
-    SPIFFS_CHECK_RES(res);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
     if (erase_count != (spiffs_obj_id)-1) {
       spiffs_printf("\tera_cnt: %i\n", erase_count);
@@ -942,7 +1040,7 @@ s32_t SPIFFS_vis(spiffs *fs) {
   spiffs_printf("page_alloc:  %i\n", fs->stats_p_allocated);
   spiffs_printf("page_delet:  %i\n", fs->stats_p_deleted);
   u32_t total, used;
-  SPIFFS_info(fs, &total, &used);
+  spiffs_info(fs, &total, &used);
   spiffs_printf("used:        %i of %i\n", used, total);
 
   SPIFFS_UNLOCK(fs);
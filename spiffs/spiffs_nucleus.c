@@ -72,7 +72,10 @@ s32_t spiffs_phys_wr(
     u32_t addr,
     u32_t len,
     u8_t *src) {
-  return fs->cfg.hal_write_f(addr, len, src);
+#if SPIFFS_MOUNT_CHECKPOINT
+  (void)spiffs_checkpoint_invalidate(fs);
+#endif
+  return SPIFFS_HAL_WRITE(fs, addr, len, src);
 }
 
 #endif
@@ -220,6 +223,10 @@ s32_t spiffs_erase_block(
   u32_t addr = SPIFFS_BLOCK_TO_PADDR(fs, bix);
   s32_t size = SPIFFS_CFG_LOG_BLOCK_SZ(fs);
 
+#if SPIFFS_MOUNT_CHECKPOINT
+  (void)spiffs_checkpoint_invalidate(fs);
+#endif
+
   // here we ignore res, just try erasing the block
   while (size > 0) {
     SPIFFS_DBG("erase %08x:%08x\n", addr,  SPIFFS_CFG_PHYS_ERASE_SZ(fs));
@@ -228,6 +235,9 @@ s32_t spiffs_erase_block(
     size -= SPIFFS_CFG_PHYS_ERASE_SZ(fs);
   }
   fs->free_blocks++;
+#if SPIFFS_WR_STATS
+  fs->stats_erases++;
+#endif
 
   // register erase count for this block
   res = _spiffs_wr(fs, SPIFFS_OP_C_WRTHRU | SPIFFS_OP_T_OBJ_LU2, 0,
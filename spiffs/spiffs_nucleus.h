@@ -135,6 +135,8 @@
 
 #define SPIFFS_CONFIG_MAGIC             (0x20090315)
 
+#define SPIFFS_CKPT_MAGIC(fs)           ((u32_t)(0x20161019 ^ SPIFFS_CFG_LOG_PAGE_SZ(fs) ^ SPIFFS_CFG_PHYS_ADDR(fs)))
+
 #if SPIFFS_SINGLETON == 0
 #define SPIFFS_CFG_LOG_PAGE_SZ(fs) \
   ((fs)->cfg.log_page_size)
@@ -256,6 +258,14 @@
 #define SPIFFS_CHECK_CFG(fs) \
   ((fs)->config_magic == SPIFFS_CONFIG_MAGIC)
 
+#if SPIFFS_WR_STATS
+#define SPIFFS_HAL_WRITE(fs, addr, len, src) \
+  ((fs)->stats_wr_phys += (len), (fs)->cfg.hal_write_f((addr), (len), (src)))
+#else
+#define SPIFFS_HAL_WRITE(fs, addr, len, src) \
+  (fs)->cfg.hal_write_f((addr), (len), (src))
+#endif
+
 #define SPIFFS_CHECK_RES(res) \
   do { \
     if ((res) < SPIFFS_OK) return (res); \
@@ -444,6 +454,35 @@ typedef struct {
  u8_t _align[4 - (sizeof(spiffs_page_header)&3)==0 ? 4 : (sizeof(spiffs_page_header)&3)];
 } spiffs_page_object_ix;
 
+#if SPIFFS_MOUNT_CHECKPOINT
+// mount checkpoint record, appended to the checkpoint area on clean
+// unmount or sync. The area is only erased when no slot is left.
+typedef struct {
+  // SPIFFS_CKPT_MAGIC, 0xffffffff marks a free slot
+  u32_t magic;
+  // incremented for each written record
+  u32_t seq;
+  // number of logical blocks, must match mounting configuration
+  u32_t block_count;
+  // file system statistics, as counted by spiffs_obj_lu_scan
+  u32_t free_blocks;
+  u32_t stats_p_allocated;
+  u32_t stats_p_deleted;
+  spiffs_obj_id max_erase_count;
+  // free cursor, saves searching full blocks after mount
+  spiffs_block_ix free_cursor_block_ix;
+  u32_t free_cursor_obj_lu_entry;
+  // crc of the erase count stamps of all blocks, ties the record to the
+  // file system it was written for
+  u32_t stamps_crc;
+  // crc of all members above
+  u32_t crc;
+  // left unwritten (0xffffffff) while record matches the file system,
+  // cleared on first flash modification after the record was written
+  u32_t clean;
+} spiffs_checkpoint;
+#endif
+
 // callback func for object lookup visitor
 typedef s32_t (*spiffs_visitor_f)(spiffs *fs, spiffs_obj_id id, spiffs_block_ix bix, int ix_entry,
     u32_t user_data, void *user_p);
@@ -516,6 +555,26 @@ s32_t spiffs_erase_block(
     spiffs *fs,
     spiffs_block_ix bix);
 
+#if SPIFFS_MOUNT_CHECKPOINT
+// ---------------
+
+s32_t spiffs_checkpoint_load(
+    spiffs *fs);
+
+s32_t spiffs_checkpoint_write(
+    spiffs *fs);
+
+s32_t spiffs_checkpoint_invalidate(
+    spiffs *fs);
+
+s32_t spiffs_checkpoint_erase(
+    spiffs *fs);
+
+s32_t spiffs_checkpoint_generation(
+    spiffs *fs,
+    spiffs_obj_id *gen);
+#endif
+
 // ---------------
 
 s32_t spiffs_obj_lu_scan(
@@ -660,6 +719,12 @@ s32_t spiffs_gc_erase_page_stats(
     spiffs *fs,
     spiffs_block_ix bix);
 
+s32_t spiffs_gc_block_pages(
+    spiffs *fs,
+    spiffs_block_ix bix,
+    u32_t *dele,
+    u32_t *allo);
+
 s32_t spiffs_gc_find_candidate(
     spiffs *fs,
     spiffs_block_ix **block_candidate,
@@ -672,6 +737,11 @@ s32_t spiffs_gc_clean(
 s32_t spiffs_gc_quick(
     spiffs *fs);
 
+#if SPIFFS_GC_BACKGROUND
+s32_t spiffs_gc_idle(
+    spiffs *fs);
+#endif
+
 // ---------------
 
 s32_t spiffs_fd_find_new(